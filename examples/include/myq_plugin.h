@@ -0,0 +1,89 @@
+/*
+ * File:   myq_plugin.h
+ *
+ *
+ * Created on October 20, 2026, 12:30 AM
+ */
+
+#ifndef MYQ_PLUGIN_H
+#define    MYQ_PLUGIN_H
+
+#include <stdint.h>
+
+#ifdef    __cplusplus
+extern "C" {
+#endif
+
+/*
+ * C ABI of pipeline plugins: shared libraries the broker loads to derive one topic from another
+ * (see create_pipeline in myq_api.h). The broker reads batches from the source topic log on the
+ * pipeline thread and hands them to myq_plugin_transform by reference; the messages the plugin
+ * emits are stored in the target topic in atomic batches of up to 128 messages.
+ *
+ * A plugin exports myq_plugin_transform, and optionally myq_plugin_init and myq_plugin_destroy.
+ * Calls for one pipeline come from a single thread; a library used by several pipelines keeps
+ * its per pipeline data in the state myq_plugin_init returns.
+ */
+
+#define MYQ_PLUGIN_ABI_VERSION 1
+
+/**
+ * Message handed to a plugin. The payload points into the broker read buffer and is only valid
+ * during the call
+ */
+typedef struct {
+    const char *data;
+    uint32_t length;
+    uint64_t seq; //1 based position in the source topic log
+}myq_plugin_message;
+
+/**
+ * Store a message in the target topic. The data is copied before it returns
+ * @param emit_context as passed to myq_plugin_transform
+ * @param data
+ * @param length
+ * @return 0 on success
+ */
+typedef int (*myq_plugin_emit_fn)(void *emit_context, const char *data, uint32_t length);
+
+/**
+ * Set up a pipeline. Optional
+ * @param args plugin arguments given to create_pipeline, "" if none
+ * @param state set to the data passed to the other calls
+ * @return MYQ_PLUGIN_ABI_VERSION, anything else refuses the pipeline
+ */
+typedef int (*myq_plugin_init_fn)(const char *args, void **state);
+
+/**
+ * Transform or filter a batch: emit zero or more messages per input message
+ * @param state
+ * @param messages
+ * @param count
+ * @param emit
+ * @param emit_context
+ * @return 0 on success, < 0 on error: emitted messages not stored yet are dropped, the batch is not retried
+ */
+typedef int (*myq_plugin_transform_fn)(void *state, const myq_plugin_message *messages, uint32_t count,
+                                       myq_plugin_emit_fn emit, void *emit_context);
+
+/**
+ * Release the state of a pipeline. Optional
+ * @param state
+ */
+typedef void (*myq_plugin_destroy_fn)(void *state);
+
+/*
+ * Entry points a plugin exports, with the signatures above
+ */
+int myq_plugin_init(const char *args, void **state);
+
+int myq_plugin_transform(void *state, const myq_plugin_message *messages, uint32_t count,
+                         myq_plugin_emit_fn emit, void *emit_context);
+
+void myq_plugin_destroy(void *state);
+
+#ifdef    __cplusplus
+}
+#endif
+
+#endif	/* MYQ_PLUGIN_H */
@@ -0,0 +1,617 @@
+/*
+ * File:   myq-bench-clients.c
+ *
+ *
+ * Created on October 20, 2026, 2:30 AM
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#ifndef __APPLE__
+#include <getopt.h>
+#endif
+#include <ctype.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/resource.h>
+#include <pthread.h>
+#include "myq_api.h"
+
+#define MAX_STEPS 16
+#define FDS_PER_CLIENT 8 //sockets, zmq mailboxes and pipes of one connection, both ends on this host
+
+/*
+ * Broker process counters, read from /proc of a broker on this host
+ */
+typedef struct {
+    uint64_t cpu_ticks; //user + system
+    uint64_t threads;
+    uint64_t fds;
+}broker_sample;
+
+/*
+ * A consumer or producer connection and its thread
+ */
+typedef struct {
+    const char *topic;
+    const char *userid;
+    const char *password;
+    const char *broker_uri;
+    consumer_socket_type socket_type;
+    uint32_t message_size;
+    uint64_t messages; //producers: messages to send
+    volatile bool connected;
+    volatile bool failed;
+    double connect_ms;
+    volatile uint64_t count; //consumers: received, producers: sent
+    volatile uint64_t last_us; //consumers: last receive, producers: last send
+}bench_client;
+
+/*
+ * Results of one step: consumers consumers and producers producers on a new topic
+ */
+typedef struct {
+    unsigned consumers;
+    unsigned producers;
+    unsigned connect_failed;
+    double consumer_connect_avg_ms;
+    double consumer_connect_p99_ms;
+    double consumer_connect_max_ms;
+    double producer_connect_avg_ms;
+    double producer_connect_max_ms;
+    uint64_t sent;
+    uint64_t delivered;
+    uint64_t expected;
+    double throughput; //messages delivered per second, all consumers together
+    uint64_t delivered_min; //per consumer
+    uint64_t delivered_max;
+    double delivered_mean;
+    double delivered_stddev;
+    double broker_cpu_percent; //of one core, from the first send to the last delivery
+    broker_sample broker;
+}step_result;
+
+static volatile bool start_sending = false;
+static volatile uint64_t start_us = 0;
+
+static uint64_t now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+/*
+ * pid of the process named myq-broker, 0 if none runs on this host
+ */
+static int find_broker_pid() {
+    DIR *dir = opendir("/proc");
+    if (!dir) {
+        return 0;
+    }
+    int pid = 0;
+    struct dirent *entry;
+    while (pid == 0 && (entry = readdir(dir)) != NULL) {
+        if (!isdigit((unsigned char) entry->d_name[0])) {
+            continue;
+        }
+        char path[300];
+        char name[64] = "";
+        snprintf(path, sizeof(path), "/proc/%s/comm", entry->d_name);
+        FILE *file = fopen(path, "r");
+        if (file) {
+            if (fgets(name, sizeof(name), file) && !strcmp(name, "myq-broker\n")) {
+                pid = atoi(entry->d_name);
+            }
+            fclose(file);
+        }
+    }
+    closedir(dir);
+    return pid;
+}
+
+static void read_broker_sample(int pid, broker_sample *sample) {
+    memset(sample, 0, sizeof(*sample));
+    if (pid <= 0) {
+        return;
+    }
+    char path[64];
+    char line[1024];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    FILE *file = fopen(path, "r");
+    if (file) {
+        if (fgets(line, sizeof(line), file)) {
+            //fields after the command name: state is field 3, utime 14, stime 15, num_threads 20
+            char *fields = strrchr(line, ')');
+            unsigned long long utime = 0, stime = 0, threads = 0;
+            if (fields && sscanf(fields + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu %*d %*d %*d %*d %llu",
+                                 &utime, &stime, &threads) == 3) {
+                sample->cpu_ticks = utime + stime;
+                sample->threads = threads;
+            }
+        }
+        fclose(file);
+    }
+    snprintf(path, sizeof(path), "/proc/%d/fd", pid);
+    DIR *dir = opendir(path);
+    if (dir) {
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (entry->d_name[0] != '.') {
+                ++sample->fds;
+            }
+        }
+        closedir(dir);
+    }
+}
+
+static void *execute_consumer(void *p_arg) {
+    bench_client *client = (bench_client *) p_arg;
+    uint64_t start = now_us();
+    myq_consumer_conn *p_consumer = init_consumer(client->userid, client->password, client->topic,
+                                                  client->broker_uri, client->socket_type);
+    client->connect_ms = (now_us() - start) / 1000.0;
+    if (!p_consumer) {
+        client->failed = true;
+        return NULL;
+    }
+    client->connected = true;
+    uint32_t buffer_size = client->message_size + 1024;
+    char *buffer = (char *) malloc(buffer_size);
+    for (;;) {
+        if (receive_message(p_consumer, buffer, buffer_size) > 0) {
+            ++client->count;
+            client->last_us = now_us();
+        }
+    }
+    return NULL;
+}
+
+static void *execute_producer(void *p_arg) {
+    bench_client *client = (bench_client *) p_arg;
+    uint64_t start = now_us();
+    myq_producer_conn *p_producer = init_producer(client->userid, client->password, client->topic,
+                                                  client->broker_uri);
+    client->connect_ms = (now_us() - start) / 1000.0;
+    if (!p_producer) {
+        client->failed = true;
+        return NULL;
+    }
+    client->connected = true;
+    char *message = (char *) malloc(client->message_size + 1);
+    generate_random_string(message, client->message_size);
+    while (!start_sending) {
+        sleep_ms(1);
+    }
+    for (uint64_t n = 0; n < client->messages; ++n) {
+        if (publish_message(p_producer, message, client->message_size) > 0) {
+            ++client->count;
+        }
+    }
+    client->last_us = now_us();
+    free(message);
+    return NULL;
+}
+
+/*
+ * start one thread per client, false if the thread can't be created
+ */
+static bool start_client(bench_client *client, void *(*execute)(void *), size_t stack_size) {
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, stack_size);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_t tid;
+    int err = pthread_create(&tid, &attr, execute, client);
+    pthread_attr_destroy(&attr);
+    if (err != 0) {
+        client->failed = true;
+        return false;
+    }
+    return true;
+}
+
+/*
+ * wait until every client connected or failed
+ */
+static void wait_connected(bench_client *clients, unsigned count, unsigned timeout_ms) {
+    uint64_t deadline = now_us() + (uint64_t) timeout_ms * 1000;
+    for (unsigned i = 0; i < count; ++i) {
+        while (!clients[i].connected && !clients[i].failed && now_us() < deadline) {
+            sleep_ms(10);
+        }
+        if (!clients[i].connected) {
+            clients[i].failed = true;
+        }
+    }
+}
+
+static unsigned get_step_value(const unsigned *values, unsigned count, unsigned step) {
+    return values[step < count ? step : count - 1];
+}
+
+static unsigned parse_counts(const char *arg, unsigned *values) {
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer), "%s", arg);
+    unsigned count = 0;
+    char *save = NULL;
+    for (char *token = strtok_r(buffer, ",", &save); token && count < MAX_STEPS; token = strtok_r(NULL, ",", &save)) {
+        if (atoi(token) > 0) {
+            values[count++] = atoi(token);
+        }
+    }
+    return count;
+}
+
+/*
+ * Benchmarks the broker as the number of client connections grows: at every step, connects consumers and
+ * producers to a new topic in parallel, sends a fixed number of messages and records the connect latency,
+ * the aggregate throughput, how evenly the messages spread over the consumers and the broker CPU
+ */
+int main(int argc, char **argv) {
+
+    int c;
+    const char *admin_userid = "myq_admin";
+    const char *admin_password = "T0p$3cr31";
+    const char *userid = "test_admin";
+    const char *password = "T0p$3cr31";
+    const char *bind_uri = "tcp://127.0.0.1:5500";
+    const char *prefix = "clients";
+    const char *storage = "queue";
+    const char *consumer_type = "zmq";
+    const char *consumers_arg = "10,100,1000,10000";
+    const char *producers_arg = "1";
+    const char *json_path = "myq-bench-clients.json";
+    const char *loglevel = "error";
+    uint64_t messages = 100000;
+    uint32_t message_size = 100;
+    unsigned timeout_ms = 5000;
+    unsigned connect_timeout_ms = 120000;
+    uint64_t memory_quota_mb = 0;
+    unsigned stack_kb = 256;
+    int broker_pid = 0;
+
+    while ((c = getopt(argc, argv, "ht:a:d:b:u:p:s:c:q:n:r:m:z:w:W:k:P:o:l:")) != -1) {
+        switch (c) {
+            case 'h':
+                printf(
+                    "Usage: [%s] [-t topic_prefix[%s]] [-a admin_userid[%s]] [-d admin_password[%s]] [-b bind_uri[%s]] [-u userid[%s]] [-p password[%s]] [-s storage[%s]] [-c consumer_type[%s] (zmq or socket)] [-q memory_quota_mb] [-n consumer_counts[%s]] [-r producer_counts[%s]] [-m messages_per_step[%llu]] [-z message_size[%u]] [-w idle_timeout_ms[%u]] [-W connect_timeout_ms[%u]] [-k client_stack_kb[%u]] [-P broker_pid[myq-broker on this host]] [-o json_output[%s]] [-l loglevel[%s]]\n",
+                    argv[0], prefix, admin_userid, admin_password, bind_uri, userid, password, storage,
+                    consumer_type, consumers_arg, producers_arg, (unsigned long long) messages, message_size,
+                    timeout_ms, connect_timeout_ms, stack_kb, json_path, loglevel);
+                return 1;
+            case 't':
+                prefix = optarg;
+                break;
+            case 'a':
+                admin_userid = optarg;
+                break;
+            case 'd':
+                admin_password = optarg;
+                break;
+            case 'b':
+                bind_uri = optarg;
+                break;
+            case 'u':
+                userid = optarg;
+                break;
+            case 'p':
+                password = optarg;
+                break;
+            case 's':
+                storage = optarg;
+                break;
+            case 'c':
+                consumer_type = optarg;
+                break;
+            case 'q':
+                memory_quota_mb = strtoull(optarg, NULL, 10);
+                break;
+            case 'n':
+                consumers_arg = optarg;
+                break;
+            case 'r':
+                producers_arg = optarg;
+                break;
+            case 'm':
+                messages = strtoull(optarg, NULL, 10);
+                break;
+            case 'z':
+                message_size = atoi(optarg);
+                break;
+            case 'w':
+                timeout_ms = atoi(optarg);
+                break;
+            case 'W':
+                connect_timeout_ms = atoi(optarg);
+                break;
+            case 'k':
+                stack_kb = atoi(optarg);
+                break;
+            case 'P':
+                broker_pid = atoi(optarg);
+                break;
+            case 'o':
+                json_path = optarg;
+                break;
+            case 'l':
+                loglevel = optarg;
+                break;
+            case '?':
+                if (isprint(optopt))
+                    fprintf(stderr, "Unknown option `-%c'.\n", optopt);
+                else
+                    fprintf(
+                        stderr,
+                        "Unknown option character `\\x%x'.\n",
+                        optopt);
+                return 1;
+            default:
+                break;
+        }
+    }
+
+    unsigned consumer_counts[MAX_STEPS];
+    unsigned producer_counts[MAX_STEPS];
+    unsigned step_count = parse_counts(consumers_arg, consumer_counts);
+    unsigned producer_steps = parse_counts(producers_arg, producer_counts);
+    if (step_count == 0 || producer_steps == 0) {
+        fprintf(stderr, "Expected client counts like 10,100,1000\n");
+        return 1;
+    }
+    if (message_size == 0 || message_size > 65536) {
+        message_size = 100;
+    }
+    broker_storage_type type = queue_type;
+    if (!strcmp(storage, "file")) {
+        type = file_type;
+    } else if (!strcmp(storage, "queue_file")) {
+        type = queue_file_type;
+    }
+    consumer_socket_type socket_type = strcmp(consumer_type, "socket") ? zmq_consumer : socket_consumer;
+    topic_options options;
+    memset(&options, 0, sizeof(options));
+    options.key_delimiter = '|';
+    options.memory_quota_mb = memory_quota_mb;
+
+    init_log("logs", argv[0], str_to_loglevel(loglevel));
+    if (broker_pid == 0) {
+        broker_pid = find_broker_pid();
+    }
+    if (broker_pid == 0) {
+        printf("No myq-broker process on this host, broker CPU is not reported\n");
+    }
+    long ticks_per_second = sysconf(_SC_CLK_TCK);
+
+    // every client holds descriptors for the whole run, take the hard limit and warn if it won't do
+    uint64_t clients = 0;
+    for (unsigned s = 0; s < step_count; ++s) {
+        clients += consumer_counts[s] + get_step_value(producer_counts, producer_steps, s);
+    }
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+        if (limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur < clients * FDS_PER_CLIENT) {
+            printf("Open file limit %llu is below the %llu descriptors %llu clients may need, "
+                   "the last steps can fail to connect\n", (unsigned long long) limit.rlim_cur,
+                   (unsigned long long) (clients * FDS_PER_CLIENT), (unsigned long long) clients);
+        }
+    }
+
+    // opened before the clients take the descriptors
+    FILE *json = fopen(json_path, "w");
+    if (!json) {
+        fprintf(stderr, "Failed to open %s\n", json_path);
+        return 1;
+    }
+
+    step_result results[MAX_STEPS];
+    memset(results, 0, sizeof(results));
+    char topics[MAX_STEPS][256];
+    unsigned completed = 0;
+
+    for (unsigned s = 0; s < step_count; ++s) {
+        step_result *result = &results[s];
+        result->consumers = consumer_counts[s];
+        result->producers = get_step_value(producer_counts, producer_steps, s);
+        // a new topic per step, clients of earlier steps stay connected and idle
+        snprintf(topics[s], sizeof(topics[s]), "%s_%u_%u", prefix, s + 1, result->consumers);
+        if (!create_topic_with_options(bind_uri, topics[s], admin_userid, admin_password, userid, password, type,
+                                       &options)) {
+            printf("Failed to create topic %s, stopping\n", topics[s]);
+            break;
+        }
+        printf("Topic[%s], connecting %u consumers and %u producers\n", topics[s], result->consumers,
+               result->producers);
+        fflush(stdout);
+
+        bench_client *consumers = (bench_client *) calloc(result->consumers, sizeof(bench_client));
+        bench_client *producers = (bench_client *) calloc(result->producers, sizeof(bench_client));
+        start_sending = false;
+        for (unsigned i = 0; i < result->consumers; ++i) {
+            bench_client *client = &consumers[i];
+            client->topic = topics[s];
+            client->userid = userid;
+            client->password = password;
+            client->broker_uri = bind_uri;
+            client->socket_type = socket_type;
+            client->message_size = message_size;
+            start_client(client, execute_consumer, stack_kb * 1024);
+        }
+        wait_connected(consumers, result->consumers, connect_timeout_ms);
+        for (unsigned i = 0; i < result->producers; ++i) {
+            bench_client *client = &producers[i];
+            client->topic = topics[s];
+            client->userid = userid;
+            client->password = password;
+            client->broker_uri = bind_uri;
+            client->message_size = message_size;
+            client->messages = messages / result->producers + (i < messages % result->producers ? 1 : 0);
+            start_client(client, execute_producer, stack_kb * 1024);
+        }
+        wait_connected(producers, result->producers, connect_timeout_ms);
+
+        double *connect_ms = (double *) malloc(sizeof(double) * (result->consumers + 1));
+        unsigned connected = 0;
+        double sum = 0;
+        for (unsigned i = 0; i < result->consumers; ++i) {
+            if (consumers[i].connected) {
+                connect_ms[connected++] = consumers[i].connect_ms;
+                sum += consumers[i].connect_ms;
+            } else {
+                ++result->connect_failed;
+            }
+        }
+        if (connected > 0) {
+            qsort(connect_ms, connected, sizeof(double), compare_double);
+            result->consumer_connect_avg_ms = sum / connected;
+            result->consumer_connect_p99_ms = connect_ms[(connected - 1) * 99 / 100];
+            result->consumer_connect_max_ms = connect_ms[connected - 1];
+        }
+        free(connect_ms);
+        unsigned producers_connected = 0;
+        sum = 0;
+        for (unsigned i = 0; i < result->producers; ++i) {
+            if (producers[i].connected) {
+                ++producers_connected;
+                sum += producers[i].connect_ms;
+                if (producers[i].connect_ms > result->producer_connect_max_ms) {
+                    result->producer_connect_max_ms = producers[i].connect_ms;
+                }
+            } else {
+                ++result->connect_failed;
+            }
+        }
+        if (producers_connected > 0) {
+            result->producer_connect_avg_ms = sum / producers_connected;
+        }
+
+        // send, then wait until everything is delivered or nothing arrives for the idle timeout
+        broker_sample before;
+        read_broker_sample(broker_pid, &before);
+        start_us = now_us();
+        start_sending = true;
+        uint64_t last_progress_us = start_us;
+        uint64_t last_delivered = 0;
+        for (;;) {
+            sleep_ms(10);
+            uint64_t sent = 0;
+            bool sending = false;
+            for (unsigned i = 0; i < result->producers; ++i) {
+                sent += producers[i].count;
+                sending = sending || (producers[i].connected && producers[i].last_us == 0);
+            }
+            uint64_t delivered = 0;
+            for (unsigned i = 0; i < result->consumers; ++i) {
+                delivered += consumers[i].count;
+            }
+            result->sent = sent;
+            result->delivered = delivered;
+            // socket consumers read the whole log each, zmq consumers share the messages
+            result->expected = socket_type == socket_consumer ? sent * connected : sent;
+            uint64_t now = now_us();
+            if (delivered != last_delivered || sending) {
+                last_delivered = delivered;
+                last_progress_us = now;
+            }
+            if ((!sending && delivered >= result->expected) || now - last_progress_us > (uint64_t) timeout_ms * 1000) {
+                break;
+            }
+        }
+        broker_sample after;
+        read_broker_sample(broker_pid, &after);
+        uint64_t end_us = start_us;
+        for (unsigned i = 0; i < result->consumers; ++i) {
+            if (consumers[i].last_us > end_us) {
+                end_us = consumers[i].last_us;
+            }
+        }
+        if (end_us > start_us) {
+            result->throughput = result->delivered * 1000000.0 / (end_us - start_us);
+        }
+        uint64_t wall_us = now_us() - start_us;
+        if (wall_us > 0 && ticks_per_second > 0) {
+            result->broker_cpu_percent =
+                (after.cpu_ticks - before.cpu_ticks) * 100.0 * 1000000.0 / ticks_per_second / wall_us;
+        }
+        result->broker = after;
+        if (connected > 0) {
+            double mean = (double) result->delivered / connected;
+            double variance = 0;
+            bool first = true;
+            for (unsigned i = 0; i < result->consumers; ++i) {
+                if (!consumers[i].connected) {
+                    continue;
+                }
+                uint64_t count = consumers[i].count;
+                if (first || count < result->delivered_min) {
+                    result->delivered_min = count;
+                }
+                if (first || count > result->delivered_max) {
+                    result->delivered_max = count;
+                }
+                first = false;
+                variance += (count - mean) * (count - mean);
+            }
+            result->delivered_mean = mean;
+            result->delivered_stddev = sqrt(variance / connected);
+        }
+        completed = s + 1;
+        // the client threads keep running on their connections, so the structs are not freed
+        if (connected == 0 || producers_connected == 0) {
+            printf("No consumer or no producer could connect at %u consumers, stopping\n", result->consumers);
+            break;
+        }
+    }
+
+    printf("%9s %9s %7s %10s %10s %10s %10s %10s %10s %12s %10s %10s %10s %10s %8s %8s %8s\n",
+           "consumers", "producers", "failed", "c_conn_avg", "c_conn_p99", "c_conn_max", "p_conn_avg", "sent",
+           "delivered", "msg/s", "min", "max", "mean", "stddev", "cpu%", "threads", "fds");
+    for (unsigned s = 0; s < completed; ++s) {
+        step_result *r = &results[s];
+        printf("%9u %9u %7u %8.1fms %8.1fms %8.1fms %8.1fms %10llu %10llu %12.0f %10llu %10llu %10.1f %10.1f %7.1f%% %8llu %8llu\n",
+               r->consumers, r->producers, r->connect_failed, r->consumer_connect_avg_ms,
+               r->consumer_connect_p99_ms, r->consumer_connect_max_ms, r->producer_connect_avg_ms,
+               (unsigned long long) r->sent, (unsigned long long) r->delivered, r->throughput,
+               (unsigned long long) r->delivered_min, (unsigned long long) r->delivered_max, r->delivered_mean,
+               r->delivered_stddev, r->broker_cpu_percent, (unsigned long long) r->broker.threads,
+               (unsigned long long) r->broker.fds);
+    }
+
+    fprintf(json, "{\n  \"storage\": \"%s\",\n  \"consumer_type\": \"%s\",\n  \"messages_per_step\": %llu,\n"
+                  "  \"message_size\": %u,\n  \"steps\": [\n",
+            storage, consumer_type, (unsigned long long) messages, message_size);
+    for (unsigned s = 0; s < completed; ++s) {
+        step_result *r = &results[s];
+        fprintf(json,
+                "    {\"consumers\": %u, \"producers\": %u, \"connect_failed\": %u, "
+                "\"consumer_connect_avg_ms\": %.3f, \"consumer_connect_p99_ms\": %.3f, "
+                "\"consumer_connect_max_ms\": %.3f, \"producer_connect_avg_ms\": %.3f, "
+                "\"producer_connect_max_ms\": %.3f, \"sent\": %llu, \"delivered\": %llu, \"expected\": %llu, "
+                "\"throughput\": %.0f, \"delivered_min\": %llu, \"delivered_max\": %llu, "
+                "\"delivered_mean\": %.3f, \"delivered_stddev\": %.3f, \"broker_cpu_percent\": %.1f, "
+                "\"broker_threads\": %llu, \"broker_fds\": %llu}%s\n",
+                r->consumers, r->producers, r->connect_failed, r->consumer_connect_avg_ms,
+                r->consumer_connect_p99_ms, r->consumer_connect_max_ms, r->producer_connect_avg_ms,
+                r->producer_connect_max_ms, (unsigned long long) r->sent, (unsigned long long) r->delivered,
+                (unsigned long long) r->expected, r->throughput, (unsigned long long) r->delivered_min,
+                (unsigned long long) r->delivered_max, r->delivered_mean, r->delivered_stddev,
+                r->broker_cpu_percent, (unsigned long long) r->broker.threads,
+                (unsigned long long) r->broker.fds, s + 1 < completed ? "," : "");
+    }
+    fprintf(json, "  ]\n}\n");
+    fclose(json);
+    printf("Results written to %s\n", json_path);
+    fflush(stdout);
+    // client threads block in receive_message for ever
+    _exit(completed == step_count ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,457 @@
+/*
+ * File:   myq-bench-topics.c
+ *
+ *
+ * Created on October 20, 2026, 1:30 AM
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#ifndef __APPLE__
+#include <getopt.h>
+#endif
+#include <ctype.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <pthread.h>
+#include "myq_api.h"
+
+#define MAX_STEPS 16
+#define MAX_SAMPLES 64
+
+/*
+ * Broker resources, read from /proc of a broker on this host
+ */
+typedef struct {
+    uint64_t rss_kb;
+    uint64_t threads;
+    uint64_t fds;
+}broker_resources;
+
+/*
+ * Results of one step: the broker with topics topics
+ */
+typedef struct {
+    unsigned topics;
+    unsigned failed; //topics the broker refused
+    double create_avg_ms;
+    double create_p99_ms;
+    double create_max_ms;
+    broker_resources idle; //after creating the topics
+    broker_resources loaded; //after the sample topics joined and sent
+    unsigned samples;
+    double stats_avg_ms;
+    double stats_max_ms;
+    double throughput_avg; //messages per second per sample topic
+    double throughput_min;
+    uint64_t messages_lost; //sent by the sample producers but not received within the timeout
+}step_result;
+
+typedef struct {
+    myq_consumer_conn *p_consumer;
+    uint64_t messages;
+    volatile uint64_t received;
+    volatile uint64_t last_received_us;
+}sample_consumer;
+
+static uint64_t now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+/*
+ * pid of the process named myq-broker, 0 if none runs on this host
+ */
+static int find_broker_pid() {
+    DIR *dir = opendir("/proc");
+    if (!dir) {
+        return 0;
+    }
+    int pid = 0;
+    struct dirent *entry;
+    while (pid == 0 && (entry = readdir(dir)) != NULL) {
+        if (!isdigit((unsigned char) entry->d_name[0])) {
+            continue;
+        }
+        char path[300];
+        char name[64] = "";
+        snprintf(path, sizeof(path), "/proc/%s/comm", entry->d_name);
+        FILE *file = fopen(path, "r");
+        if (file) {
+            if (fgets(name, sizeof(name), file) && !strcmp(name, "myq-broker\n")) {
+                pid = atoi(entry->d_name);
+            }
+            fclose(file);
+        }
+    }
+    closedir(dir);
+    return pid;
+}
+
+static void read_broker_resources(int pid, broker_resources *resources) {
+    memset(resources, 0, sizeof(*resources));
+    if (pid <= 0) {
+        return;
+    }
+    char path[64];
+    char line[256];
+    snprintf(path, sizeof(path), "/proc/%d/status", pid);
+    FILE *file = fopen(path, "r");
+    if (file) {
+        while (fgets(line, sizeof(line), file)) {
+            if (!strncmp(line, "VmRSS:", 6)) {
+                resources->rss_kb = strtoull(line + 6, NULL, 10);
+            } else if (!strncmp(line, "Threads:", 8)) {
+                resources->threads = strtoull(line + 8, NULL, 10);
+            }
+        }
+        fclose(file);
+    }
+    snprintf(path, sizeof(path), "/proc/%d/fd", pid);
+    DIR *dir = opendir(path);
+    if (dir) {
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (entry->d_name[0] != '.') {
+                ++resources->fds;
+            }
+        }
+        closedir(dir);
+    }
+}
+
+static void *execute_consumer(void *p_arg) {
+    sample_consumer *consumer = (sample_consumer *) p_arg;
+    char buffer[65536];
+    while (consumer->received < consumer->messages) {
+        if (receive_message(consumer->p_consumer, buffer, sizeof(buffer)) > 0) {
+            ++consumer->received;
+            consumer->last_received_us = now_us();
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Benchmarks the broker as the number of topics grows: creates topics in steps through the admin API
+ * and, at every step, records the broker resources, the topic creation latency, the latency of the
+ * stats request and the throughput of a few newly created topics
+ */
+int main(int argc, char **argv) {
+
+    int c;
+    const char *admin_userid = "myq_admin";
+    const char *admin_password = "T0p$3cr31";
+    const char *userid = "test_admin";
+    const char *password = "T0p$3cr31";
+    const char *bind_uri = "tcp://127.0.0.1:5500";
+    const char *prefix = "bench";
+    const char *storage = "queue";
+    const char *steps_arg = "1,10,100,1000,10000";
+    const char *json_path = "myq-bench-topics.json";
+    const char *loglevel = "error";
+    unsigned samples = 4;
+    uint64_t messages = 10000;
+    uint32_t message_size = 100;
+    unsigned stats_requests = 20;
+    unsigned timeout_ms = 10000;
+    uint64_t memory_quota_mb = 0;
+    int broker_pid = 0;
+
+    while ((c = getopt(argc, argv, "ht:a:d:b:u:p:s:q:n:k:m:z:r:w:P:o:l:")) != -1) {
+        switch (c) {
+            case 'h':
+                printf(
+                    "Usage: [%s] [-t topic_prefix[%s]] [-a admin_userid[%s]] [-d admin_password[%s]] [-b bind_uri[%s]] [-u userid[%s]] [-p password[%s]] [-s storage[%s]] [-q memory_quota_mb (per topic, sizes its queue)] [-n topic_counts[%s]] [-k sample_topics[%u]] [-m messages_per_sample[%llu]] [-z message_size[%u]] [-r stats_requests[%u]] [-w timeout_ms[%u]] [-P broker_pid[myq-broker on this host]] [-o json_output[%s]] [-l loglevel[%s]]\n",
+                    argv[0], prefix, admin_userid, admin_password, bind_uri, userid, password, storage, steps_arg,
+                    samples, (unsigned long long) messages, message_size, stats_requests, timeout_ms, json_path,
+                    loglevel);
+                return 1;
+            case 't':
+                prefix = optarg;
+                break;
+            case 'a':
+                admin_userid = optarg;
+                break;
+            case 'd':
+                admin_password = optarg;
+                break;
+            case 'b':
+                bind_uri = optarg;
+                break;
+            case 'u':
+                userid = optarg;
+                break;
+            case 'p':
+                password = optarg;
+                break;
+            case 's':
+                storage = optarg;
+                break;
+            case 'q':
+                memory_quota_mb = strtoull(optarg, NULL, 10);
+                break;
+            case 'n':
+                steps_arg = optarg;
+                break;
+            case 'k':
+                samples = atoi(optarg);
+                break;
+            case 'm':
+                messages = strtoull(optarg, NULL, 10);
+                break;
+            case 'z':
+                message_size = atoi(optarg);
+                break;
+            case 'r':
+                stats_requests = atoi(optarg);
+                break;
+            case 'w':
+                timeout_ms = atoi(optarg);
+                break;
+            case 'P':
+                broker_pid = atoi(optarg);
+                break;
+            case 'o':
+                json_path = optarg;
+                break;
+            case 'l':
+                loglevel = optarg;
+                break;
+            case '?':
+                if (isprint(optopt))
+                    fprintf(stderr, "Unknown option `-%c'.\n", optopt);
+                else
+                    fprintf(
+                        stderr,
+                        "Unknown option character `\\x%x'.\n",
+                        optopt);
+                return 1;
+            default:
+                break;
+        }
+    }
+
+    unsigned steps[MAX_STEPS];
+    unsigned step_count = 0;
+    char steps_buffer[256];
+    snprintf(steps_buffer, sizeof(steps_buffer), "%s", steps_arg);
+    char *save = NULL;
+    for (char *token = strtok_r(steps_buffer, ",", &save); token && step_count < MAX_STEPS;
+         token = strtok_r(NULL, ",", &save)) {
+        unsigned count = atoi(token);
+        if (count > 0 && (step_count == 0 || count > steps[step_count - 1])) {
+            steps[step_count++] = count;
+        }
+    }
+    if (step_count == 0) {
+        fprintf(stderr, "No topic counts in [%s], expected increasing counts like 1,10,100\n", steps_arg);
+        return 1;
+    }
+    if (samples > MAX_SAMPLES) {
+        samples = MAX_SAMPLES;
+    }
+    if (message_size == 0 || message_size > 65536) {
+        message_size = 100;
+    }
+    broker_storage_type type = queue_type;
+    if (!strcmp(storage, "file")) {
+        type = file_type;
+    } else if (!strcmp(storage, "queue_file")) {
+        type = queue_file_type;
+    }
+    topic_options options;
+    memset(&options, 0, sizeof(options));
+    options.key_delimiter = '|';
+    options.memory_quota_mb = memory_quota_mb;
+
+    init_log("logs", argv[0], str_to_loglevel(loglevel));
+    if (broker_pid == 0) {
+        broker_pid = find_broker_pid();
+    }
+    if (broker_pid == 0) {
+        printf("No myq-broker process on this host, broker resources are not reported\n");
+    }
+
+    step_result results[MAX_STEPS];
+    memset(results, 0, sizeof(results));
+    unsigned last_step_topics = steps[step_count - 1];
+    double *create_ms = (double *) malloc(sizeof(double) * last_step_topics);
+    unsigned *topic_ids = (unsigned *) malloc(sizeof(unsigned) * last_step_topics); //topics the broker created
+    char *message = (char *) malloc(message_size + 1);
+    generate_random_string(message, message_size);
+    char topic[256];
+    unsigned created = 0;
+    unsigned topics = 0;
+    unsigned completed = 0;
+
+    for (unsigned s = 0; s < step_count; ++s) {
+        step_result *result = &results[s];
+        unsigned first = created;
+        unsigned first_topic = topics;
+        unsigned latencies = 0;
+        printf("Creating topics %u to %u\n", first + 1, steps[s]);
+        fflush(stdout);
+        for (; created < steps[s]; ++created) {
+            snprintf(topic, sizeof(topic), "%s_%u", prefix, created + 1);
+            uint64_t start = now_us();
+            bool ok = create_topic_with_options(bind_uri, topic, admin_userid, admin_password, userid, password, type,
+                                                &options);
+            double elapsed_ms = (now_us() - start) / 1000.0;
+            if (!ok) {
+                ++result->failed;
+                continue;
+            }
+            create_ms[latencies++] = elapsed_ms;
+            topic_ids[topics++] = created + 1;
+        }
+        result->topics = topics;
+        if (latencies > 0) {
+            qsort(create_ms, latencies, sizeof(double), compare_double);
+            double sum = 0;
+            for (unsigned i = 0; i < latencies; ++i) {
+                sum += create_ms[i];
+            }
+            result->create_avg_ms = sum / latencies;
+            result->create_p99_ms = create_ms[(latencies - 1) * 99 / 100];
+            result->create_max_ms = create_ms[latencies - 1];
+        }
+        read_broker_resources(broker_pid, &result->idle);
+
+        // traffic through the newest topics of the step, one at a time
+        unsigned step_topics = topics - first_topic;
+        result->samples = samples < step_topics ? samples : step_topics;
+        result->throughput_min = 0;
+        double stats_sum = 0;
+        unsigned stats_count = 0;
+        double throughput_sum = 0;
+        unsigned throughput_count = 0;
+        for (unsigned i = 0; i < result->samples; ++i) {
+            snprintf(topic, sizeof(topic), "%s_%u", prefix, topic_ids[topics - 1 - i]);
+            // the consumer thread may still wait for lost messages after the sample, so it keeps its
+            // state for the life of the process, like the connections
+            sample_consumer *consumer = malloc(sizeof(sample_consumer));
+            if (!consumer) {
+                break;
+            }
+            consumer->messages = messages;
+            consumer->received = 0;
+            consumer->last_received_us = 0;
+            consumer->p_consumer = init_consumer(userid, password, topic, bind_uri, zmq_consumer);
+            myq_producer_conn *p_producer = init_producer(userid, password, topic, bind_uri);
+            if (!consumer->p_consumer || !p_producer) {
+                printf("Topic[%s], failed to join\n", topic);
+                free(consumer);
+                continue;
+            }
+            pthread_t tid;
+            if (pthread_create(&tid, NULL, execute_consumer, consumer) != 0) {
+                free(consumer);
+                continue;
+            }
+            pthread_detach(tid);
+            uint64_t start = now_us();
+            for (uint64_t n = 0; n < messages; ++n) {
+                publish_message(p_producer, message, message_size);
+            }
+            uint64_t deadline = now_us() + (uint64_t) timeout_ms * 1000;
+            while (consumer->received < messages && now_us() < deadline) {
+                sleep_ms(1);
+            }
+            uint64_t received = consumer->received;
+            uint64_t last_received_us = consumer->last_received_us;
+            result->messages_lost += messages - received;
+            if (received > 0 && last_received_us > start) {
+                double throughput = received * 1000000.0 / (last_received_us - start);
+                if (throughput_count == 0 || throughput < result->throughput_min) {
+                    result->throughput_min = throughput;
+                }
+                throughput_sum += throughput;
+                ++throughput_count;
+            }
+
+            topic_stats stats;
+            for (unsigned r = 0; r < stats_requests; ++r) {
+                uint64_t stats_start = now_us();
+                if (!get_stats(p_producer->conn, &stats)) {
+                    continue;
+                }
+                double elapsed_ms = (now_us() - stats_start) / 1000.0;
+                stats_sum += elapsed_ms;
+                ++stats_count;
+                if (elapsed_ms > result->stats_max_ms) {
+                    result->stats_max_ms = elapsed_ms;
+                }
+            }
+            // connections stay open, so the next steps run with these topics joined
+        }
+        if (stats_count > 0) {
+            result->stats_avg_ms = stats_sum / stats_count;
+        }
+        if (throughput_count > 0) {
+            result->throughput_avg = throughput_sum / throughput_count;
+        }
+        read_broker_resources(broker_pid, &result->loaded);
+        completed = s + 1;
+        if (result->failed > 0) {
+            printf("Broker refused %u of %u topics, stopping\n", result->failed, steps[s] - first);
+            break;
+        }
+    }
+
+    printf("%8s %7s %10s %10s %10s %10s %8s %7s %10s %8s %7s %10s %10s %12s %12s %8s\n",
+           "topics", "failed", "create_avg", "create_p99", "create_max", "rss_idle", "threads", "fds",
+           "rss_loaded", "threads", "fds", "stats_avg", "stats_max", "msg/s_avg", "msg/s_min", "lost");
+    for (unsigned s = 0; s < completed; ++s) {
+        step_result *r = &results[s];
+        printf("%8u %7u %8.3fms %8.3fms %8.3fms %8lluKB %8llu %7llu %8lluKB %8llu %7llu %8.3fms %8.3fms %12.0f %12.0f %8llu\n",
+               r->topics, r->failed, r->create_avg_ms, r->create_p99_ms, r->create_max_ms,
+               (unsigned long long) r->idle.rss_kb, (unsigned long long) r->idle.threads,
+               (unsigned long long) r->idle.fds, (unsigned long long) r->loaded.rss_kb,
+               (unsigned long long) r->loaded.threads, (unsigned long long) r->loaded.fds,
+               r->stats_avg_ms, r->stats_max_ms, r->throughput_avg, r->throughput_min,
+               (unsigned long long) r->messages_lost);
+    }
+
+    FILE *json = fopen(json_path, "w");
+    if (!json) {
+        fprintf(stderr, "Failed to open %s\n", json_path);
+    } else {
+        fprintf(json, "{\n  \"storage\": \"%s\",\n  \"memory_quota_mb\": %llu,\n  \"messages_per_sample\": %llu,\n  \"message_size\": %u,\n"
+                      "  \"steps\": [\n", storage, (unsigned long long) memory_quota_mb,
+                (unsigned long long) messages, message_size);
+        for (unsigned s = 0; s < completed; ++s) {
+            step_result *r = &results[s];
+            fprintf(json,
+                    "    {\"topics\": %u, \"failed\": %u, \"create_avg_ms\": %.3f, \"create_p99_ms\": %.3f, "
+                    "\"create_max_ms\": %.3f, \"rss_idle_kb\": %llu, \"threads_idle\": %llu, \"fds_idle\": %llu, "
+                    "\"rss_loaded_kb\": %llu, \"threads_loaded\": %llu, \"fds_loaded\": %llu, \"samples\": %u, "
+                    "\"stats_avg_ms\": %.3f, \"stats_max_ms\": %.3f, \"throughput_avg\": %.0f, "
+                    "\"throughput_min\": %.0f, \"messages_lost\": %llu}%s\n",
+                    r->topics, r->failed, r->create_avg_ms, r->create_p99_ms, r->create_max_ms,
+                    (unsigned long long) r->idle.rss_kb, (unsigned long long) r->idle.threads,
+                    (unsigned long long) r->idle.fds, (unsigned long long) r->loaded.rss_kb,
+                    (unsigned long long) r->loaded.threads, (unsigned long long) r->loaded.fds, r->samples,
+                    r->stats_avg_ms, r->stats_max_ms, r->throughput_avg, r->throughput_min,
+                    (unsigned long long) r->messages_lost, s + 1 < completed ? "," : "");
+        }
+        fprintf(json, "  ]\n}\n");
+        fclose(json);
+        printf("Results written to %s\n", json_path);
+    }
+    fflush(stdout);
+    free(create_ms);
+    free(topic_ids);
+    free(message);
+    // consumer threads may still block in receive_message on a lost message
+    _exit(completed == step_count && results[completed - 1].failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -27,13 +27,19 @@ int main(int argc, char **argv) {
     unsigned bind_port = 5500;
     const char *transport = "tcp";
     const char *loglevel = "event";
+    uint64_t memory_limit_mb = 0;
+    uint32_t max_open_segments = 0;
+    const char *plugin_dir = NULL;
+    const char *data_dirs[64];
+    unsigned num_data_dirs = 0;
+    data_placement placement = placement_round_robin_topics;
 
 
-    while ((c = getopt(argc, argv, "hu:p:i:b:t:l:")) != -1) {
+    while ((c = getopt(argc, argv, "hu:p:i:b:t:l:M:D:SF:P:")) != -1) {
         switch (c) {
             case 'h':
                 printf(
-                    "Usage: [%s] [-u admin_userid[%s]] [-p admin_password[%s]] [-i bind_ip[%s]] [-b bind_port[%d]] [-t transport[%s]] [-l loglevel[event]]\n",
+                    "Usage: [%s] [-u admin_userid[%s]] [-p admin_password[%s]] [-i bind_ip[%s]] [-b bind_port[%d]] [-t transport[%s]] [-M memory_limit_mb[3/4 of RAM]] [-D data_dir (repeat per disk)] [-S (stripe segments across data dirs)] [-F max_open_segments[1024]] [-P plugin_dir (enables pipelines)] [-l loglevel[event]]\n",
                     argv[0], admin_userid, admin_password, bind_ip, bind_port, transport);
                 return 1;
             case 'u':
@@ -58,6 +64,28 @@ int main(int argc, char **argv) {
                 loglevel = optarg;
                 break;
 
+            case 'M':
+                memory_limit_mb = strtoull(optarg, NULL, 10);
+                break;
+
+            case 'F':
+                max_open_segments = strtoul(optarg, NULL, 10);
+                break;
+
+            case 'D':
+                if (num_data_dirs < sizeof(data_dirs) / sizeof(data_dirs[0])) {
+                    data_dirs[num_data_dirs++] = optarg;
+                }
+                break;
+
+            case 'S':
+                placement = placement_stripe_segments;
+                break;
+
+            case 'P':
+                plugin_dir = optarg;
+                break;
+
             case 't':
                 transport = optarg;
                 if ((strcmp("tcp", transport) != 0) && (strcmp("ipc", transport) != 0) &&
@@ -90,6 +118,20 @@ int main(int argc, char **argv) {
     myq_broker_mgr *p_broker = init_broker(admin_userid, admin_password, transport, bind_ip, bind_port);
 
     if (p_broker) {
+        set_broker_memory_limit(p_broker, memory_limit_mb);
+        if (max_open_segments > 0) {
+            set_broker_max_open_segments(p_broker, max_open_segments);
+        }
+        if (num_data_dirs > 0 && !set_broker_data_directories(p_broker, data_dirs, num_data_dirs, placement)) {
+            printf("Invalid data directories\n");
+            free_broker_mgr(p_broker);
+            return (EXIT_FAILURE);
+        }
+        if (plugin_dir && !set_broker_plugin_directory(p_broker, plugin_dir)) {
+            printf("Invalid plugin directory\n");
+            free_broker_mgr(p_broker);
+            return (EXIT_FAILURE);
+        }
         run_broker(p_broker, true);
     } else {
         printf("Failed to initialize broker\n");
@@ -86,6 +86,14 @@ static void execute_consumer(void *p_con_info) {
         printf(
             "Topic[%s], Average latency [%.2f] nano sec\n", p_info->topic,
             (double) ((consumer_end_to_producer_start_time * 1000000 / p_info->messages_to_receive)));
+        subscriber_stats sub_stats;
+        if ((p_info->type == zmq_subscriber || p_info->type == multicast_subscriber) &&
+            get_subscriber_stats(p_info->p_consumer, &sub_stats)) {
+            printf(
+                "Topic[%s], Last seq [%llu], gaps detected [%llu], messages recovered [%llu], messages lost [%llu], snapshot messages [%llu]\n",
+                p_info->topic, sub_stats.last_seq, sub_stats.gaps_detected, sub_stats.messages_recovered,
+                sub_stats.messages_lost, sub_stats.snapshot_messages);
+        }
 
     } else {
         printf("Failed to initialize consumer\n");
@@ -93,6 +101,58 @@ static void execute_consumer(void *p_con_info) {
 
 }
 
+/**
+ * receive the messages of all partitions on this thread, through a consumer set
+ * @param p_set
+ * @param num_partitions
+ * @param messages_to_receive per partition
+ */
+static void execute_consumer_set(myq_consumer_set *p_set, unsigned num_partitions, uint64_t messages_to_receive) {
+
+    enum {
+        batch_count = 64
+    };
+    unsigned buffer_size = 64 * 1024;
+    static char buffers[batch_count][64 * 1024];
+    myq_message messages[batch_count];
+    for (unsigned i = 0; i < batch_count; ++i) {
+        messages[i].buffer = buffers[i];
+        messages[i].buffer_length = buffer_size;
+    }
+
+    uint64_t total_messages = messages_to_receive * num_partitions;
+    uint64_t total_received = 0;
+    uint64_t total_bytes_received = 0;
+    unsigned long start_time = 0;
+    while (total_received < total_messages) {
+        int received = consumer_set_receive(p_set, messages, batch_count, 1000);
+        if (received < 0) {
+            printf("Failed to receive messages. received [%llu]\n", total_received);
+            break;
+        }
+        if (received > 0 && start_time == 0) {
+            start_time = get_current_time_millsec();
+            printf("Topic[%s], First message at consumer time [%lu]\n", messages[0].topic, start_time);
+        }
+        for (int i = 0; i < received; ++i) {
+            total_bytes_received += messages[i].length;
+        }
+        total_received += received;
+    }
+    unsigned long end_time = get_current_time_millsec();
+    float total_time_sec = (end_time - start_time) / 1000.0;
+    if (total_time_sec <= 0) {
+        total_time_sec = 0.001;
+    }
+    printf(
+        "Consumer set of [%u] topics, Total message received [%llu] in [%.2f]sec\n", num_partitions, total_received,
+        total_time_sec);
+    printf("Consumer set, Average messages received per second [%.2f]\n", total_received / total_time_sec);
+    printf(
+        "Consumer set, Total bytes received [%llu], average bandwidth received per second [%.4f]MB\n",
+        total_bytes_received, total_bytes_received / (1024 * 1024 * total_time_sec));
+}
+
 /*
  * start producer
  */
@@ -107,13 +167,16 @@ int main(int argc, char **argv) {
     const char *consumer_type = "zmq";
     uint64_t messages_to_receive = 1000000;
     unsigned num_partitions = 1;
+    uint64_t start_time_ms = 0;
+    uint64_t start_seq = 0;
+    bool single_thread = false;
 
-    while ((c = getopt(argc, argv, "ht:u:p:b:c:m:n:l:")) != -1) {
+    while ((c = getopt(argc, argv, "ht:u:p:b:c:m:n:l:s:o:S")) != -1) {
 
         switch (c) {
             case 'h':
                 printf(
-                    "Usage: [%s] [-t topic[%s]] [-u userid[%s]]  [-p password[%s]]  [-b broker_uri[%s]] [-c consumer_type[%s]] [-m messages_to_receive[%llu]] [-n num_partitions[%u]] [-l loglevel[event]]\n",
+                    "Usage: [%s] [-t topic[%s]] [-u userid[%s]]  [-p password[%s]]  [-b broker_uri[%s]] [-c consumer_type[%s]] [-m messages_to_receive[%llu]] [-n num_partitions[%u]] [-l loglevel[event]] [-s start_time_ms] [-o start_seq] (socket consumer, file topic) [-S (one thread for all partitions, consumer set)]\n",
                     argv[0], topic, userid, password, broker_uri, consumer_type, messages_to_receive,
                     num_partitions);
                 return 0;
@@ -142,6 +205,15 @@ int main(int argc, char **argv) {
             case 'l':
                 loglevel = optarg;
                 break;
+            case 's':
+                start_time_ms = strtoull(optarg, NULL, 10);
+                break;
+            case 'o':
+                start_seq = strtoull(optarg, NULL, 10);
+                break;
+            case 'S':
+                single_thread = true;
+                break;
             case '?':
                 if (isprint(optopt))
                     fprintf(stderr, "Unknown option `-%c'.\n", optopt);
@@ -175,9 +247,35 @@ int main(int argc, char **argv) {
     if (!strcmp(consumer_type, "socket")) {
         type = socket_consumer;
         printf("Using consumer socket as tcp socket\n");
+    } else if (!strcmp(consumer_type, "sub")) {
+        type = zmq_subscriber;
+        printf("Using consumer socket as zmq subscriber with gap recovery\n");
+    } else if (!strcmp(consumer_type, "mcast")) {
+        type = multicast_subscriber;
+        printf("Using consumer socket as multicast subscriber with gap recovery\n");
     }//
 
 
+    if (single_thread) {
+        myq_consumer_set *p_set = init_consumer_set(userid, password, broker_uri, type);
+        if (!p_set) {
+            printf("Failed to initialize consumer set\n");
+            return -1;
+        }
+        char set_topic[256];
+        for (unsigned i = 0; i < num_partitions; ++i) {
+            sprintf(set_topic, "%s_%u", topic, i + 1);
+            if (!consumer_set_add(p_set, set_topic)) {
+                printf("Failed to join topic[%s]\n", set_topic);
+                free_consumer_set(p_set);
+                return -1;
+            }
+        }
+        execute_consumer_set(p_set, num_partitions, messages_to_receive);
+        free_consumer_set(p_set);
+        return (EXIT_SUCCESS);
+    }
+
     pthread_t tid[10];
     consumer_info coninfo[10];
     char topic_buffer[256];
@@ -191,6 +289,12 @@ int main(int argc, char **argv) {
         coninfo[i].type = type;
         coninfo[i].messages_to_receive = messages_to_receive;
         coninfo[i].p_consumer = init_consumer(userid, password, topic_buffer, broker_uri, type);
+        if (start_time_ms > 0 && coninfo[i].p_consumer && !seek_to_time(coninfo[i].p_consumer, start_time_ms)) {
+            printf("Topic[%s], Failed to seek to time [%llu]\n", topic_buffer, start_time_ms);
+        }
+        if (start_seq > 0 && coninfo[i].p_consumer && !seek(coninfo[i].p_consumer, start_seq)) {
+            printf("Topic[%s], Failed to seek to seq [%llu]\n", topic_buffer, start_seq);
+        }
 
     }
 
@@ -0,0 +1,65 @@
+/*
+ * File:   myq-filter.c
+ *
+ *
+ * Created on October 20, 2026, 1:10 AM
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "myq_plugin.h"
+
+/*
+ * Pipeline plugin passing on the messages that contain the plugin argument, all messages if it is empty.
+ * Build as a shared library and give its path to create_pipeline (myq-pipeline -P)
+ */
+
+typedef struct {
+    char *pattern;
+    size_t pattern_length;
+} filter_state;
+
+int myq_plugin_init(const char *args, void **state) {
+    filter_state *filter = (filter_state *) malloc(sizeof(filter_state));
+    if (!filter) {
+        return -1;
+    }
+    filter->pattern_length = strlen(args);
+    filter->pattern = (char *) malloc(filter->pattern_length + 1);
+    if (!filter->pattern) {
+        free(filter);
+        return -1;
+    }
+    memcpy(filter->pattern, args, filter->pattern_length + 1);
+    *state = filter;
+    return MYQ_PLUGIN_ABI_VERSION;
+}
+
+static int contains(const char *data, uint32_t length, const char *pattern, size_t pattern_length) {
+    if (pattern_length == 0) {
+        return 1;
+    }
+    for (uint32_t i = 0; i + pattern_length <= length; ++i) {
+        if (data[i] == pattern[0] && memcmp(data + i, pattern, pattern_length) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int myq_plugin_transform(void *state, const myq_plugin_message *messages, uint32_t count,
+                         myq_plugin_emit_fn emit, void *emit_context) {
+    filter_state *filter = (filter_state *) state;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (contains(messages[i].data, messages[i].length, filter->pattern, filter->pattern_length) &&
+            emit(emit_context, messages[i].data, messages[i].length) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void myq_plugin_destroy(void *state) {
+    filter_state *filter = (filter_state *) state;
+    free(filter->pattern);
+    free(filter);
+}
@@ -0,0 +1,88 @@
+/*
+ * File:   myq-pipeline.c
+ *
+ *
+ * Created on October 20, 2026, 1:20 AM
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#ifndef __APPLE__
+#include <getopt.h>
+#endif
+#include <ctype.h>
+#include <string.h>
+#include "myq_api.h"
+
+/*
+ * Derives a topic from another through a plugin running in the broker
+ */
+int main(int argc, char **argv) {
+
+    int c;
+    const char *admin_userid = "myq_admin";
+    const char *admin_password = "T0p$3cr31";
+    const char *bind_uri = "tcp://127.0.0.1:5500";
+    const char *source_topic = NULL;
+    const char *target_topic = NULL;
+    const char *plugin = NULL;
+    const char *plugin_args = "";
+    const char *loglevel = "event";
+
+    while ((c = getopt(argc, argv, "ha:d:b:s:t:P:A:l:")) != -1) {
+        switch (c) {
+            case 'h':
+                printf(
+                    "Usage: [%s] -s source_topic -t target_topic -P plugin (file name in the broker plugin directory) [-A plugin_args] [-a admin_userid[%s]] [-d admin_password[%s]] [-b bind_uri[%s]] [-l loglevel[event]]\n",
+                    argv[0], admin_userid, admin_password, bind_uri);
+                return 1;
+            case 'a':
+                admin_userid = optarg;
+                break;
+            case 'd':
+                admin_password = optarg;
+                break;
+            case 'b':
+                bind_uri = optarg;
+                break;
+            case 's':
+                source_topic = optarg;
+                break;
+            case 't':
+                target_topic = optarg;
+                break;
+            case 'P':
+                plugin = optarg;
+                break;
+            case 'A':
+                plugin_args = optarg;
+                break;
+            case 'l':
+                loglevel = optarg;
+                break;
+            case '?':
+                if (isprint(optopt))
+                    fprintf(stderr, "Unknown option `-%c'.\n", optopt);
+                else
+                    fprintf(
+                        stderr,
+                        "Unknown option character `\\x%x'.\n",
+                        optopt);
+                return 1;
+            default:
+                break;
+        }
+    }
+    if (!source_topic || !target_topic || !plugin) {
+        fprintf(stderr, "source topic, target topic and plugin are required, see -h\n");
+        return (EXIT_FAILURE);
+    }
+
+    init_log("logs", argv[0], str_to_loglevel(loglevel));
+    if (!create_pipeline(bind_uri, admin_userid, admin_password, source_topic, target_topic, plugin, plugin_args)) {
+        fprintf(stderr, "Failed to create pipeline %s -> %s\n", source_topic, target_topic);
+        return (EXIT_FAILURE);
+    }
+    printf("pipeline %s -> %s created\n", source_topic, target_topic);
+    return (EXIT_SUCCESS);
+}
@@ -23,6 +23,8 @@ typedef struct {
     char broker_uri[256];
     unsigned message_size;
     uint64_t messages_to_send;
+    bool idempotent;
+    uint32_t batch_size;
     myq_producer_conn *p_producer;
 }publisher_info;
 
@@ -31,6 +33,8 @@ static void execute_publisher(void *p_pub) {
 
 
     char buffer[pub->message_size + 1];
+    const char *batch[pub->batch_size];
+    uint32_t batch_lengths[pub->batch_size];
 
     if (pub->p_producer) {
         uint64_t total_bytes_sent = 0;
@@ -44,10 +48,21 @@ static void execute_publisher(void *p_pub) {
         for (uint64_t i = 0; i < pub->messages_to_send; ++i) {
             if (i == 0) {
                 sprintf(buffer, "%lu", start_time);
-                bytes_sent = publish_message(pub->p_producer, buffer, strlen(buffer));
+                bytes_sent = pub->idempotent ? publish_message_idempotent(pub->p_producer, i + 1, buffer, strlen(buffer))
+                                             : publish_message(pub->p_producer, buffer, strlen(buffer));
                 printf("Topic[%s], Producer: first message sent timestamp [%lu]\n", pub->topic, start_time);
+            } else if (pub->batch_size > 1) {
+                uint32_t count = 0;
+                for (; count < pub->batch_size && i + count < pub->messages_to_send; ++count) {
+                    batch[count] = buffer;
+                    batch_lengths[count] = pub->message_size;
+                }
+                bytes_sent = pub->idempotent ? publish_batch_idempotent(pub->p_producer, i + 1, batch, batch_lengths, count)
+                                             : publish_batch(pub->p_producer, batch, batch_lengths, count);
+                i += count - 1;
             } else {
-                bytes_sent = publish_message(pub->p_producer, buffer, pub->message_size);
+                bytes_sent = pub->idempotent ? publish_message_idempotent(pub->p_producer, i + 1, buffer, pub->message_size)
+                                             : publish_message(pub->p_producer, buffer, pub->message_size);
             }
 
             if (bytes_sent > 0) {
@@ -57,6 +72,7 @@ static void execute_publisher(void *p_pub) {
             }
         }
 
+        flush_producer(pub->p_producer);
         end_time = get_current_time_millsec();
         printf("Topic[%s], Producer: last message sent timestamp [%lu]\n", pub->topic, end_time);
         unsigned total_time_ms = end_time - start_time;
@@ -89,14 +105,18 @@ int main(int argc, char **argv) {
     uint32_t message_size = 100;
     uint64_t messages_to_send = 1000000;
     unsigned num_partitions = 1;
+    bool idempotent = false;
+    uint32_t batch_size = 1;
+    uint64_t latency_target_us = 0;
 
-    while ((c = getopt(argc, argv, "ht:u:p:b:m:s:n:l:")) != -1)
+    while ((c = getopt(argc, argv, "ht:u:p:b:m:s:n:l:dg:L:")) != -1)
 
         switch (c) {
             case 'h':
                 printf(
-                    "Usage: [%s] [-t topic[%s]] [-u userid[%s]]  [-p password[%s]]  [-b broker_uri[%s]] [-s message_size[%u]] [-m messages_to_send[%llu]] [-n num_partitions[%u]] [-l loglevel[event]]\n",
-                    argv[0], topic, userid, password, broker_uri, message_size, messages_to_send, num_partitions);
+                    "Usage: [%s] [-t topic[%s]] [-u userid[%s]]  [-p password[%s]]  [-b broker_uri[%s]] [-s message_size[%u]] [-m messages_to_send[%llu]] [-n num_partitions[%u]] [-l loglevel[event]] [-d (idempotent publish)] [-g batch_size[%u]] [-L latency_target_us[%llu] (adaptive client batching)]\n",
+                    argv[0], topic, userid, password, broker_uri, message_size, messages_to_send, num_partitions,
+                    batch_size, latency_target_us);
                 return 0;
             case 't':
                 topic = optarg;
@@ -123,6 +143,15 @@ int main(int argc, char **argv) {
             case 'l':
                 loglevel = optarg;
                 break;
+            case 'd':
+                idempotent = true;
+                break;
+            case 'g':
+                batch_size = atoi(optarg);
+                break;
+            case 'L':
+                latency_target_us = strtoull(optarg, NULL, 10);
+                break;
             case '?':
                 if (isprint(optopt))
                     fprintf(stderr, "Unknown option `-%c'.\n", optopt);
@@ -167,7 +196,12 @@ int main(int argc, char **argv) {
         strcpy(pubs[i].broker_uri, broker_uri);
         pubs[i].message_size = message_size;
         pubs[i].messages_to_send = messages_to_send;
+        pubs[i].idempotent = idempotent;
+        pubs[i].batch_size = batch_size > 0 ? batch_size : 1;
         pubs[i].p_producer = init_producer(userid, password, topic_buffer, broker_uri);
+        if (pubs[i].p_producer && latency_target_us > 0) {
+            set_producer_latency_target(pubs[i].p_producer, latency_target_us);
+        }
 
     }
     sleep(3);
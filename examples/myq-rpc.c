@@ -0,0 +1,240 @@
+/*
+ * File:   myq-rpc.c
+ *
+ *
+ * Created on October 20, 2026, 7:20 AM
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#ifndef __APPLE__
+#include <getopt.h>
+#endif
+#include <ctype.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "myq_api.h"
+
+#define MAX_RESPONDERS 16
+
+/*
+ * An echo responder and its thread
+ */
+typedef struct {
+    const char *userid;
+    const char *password;
+    const char *topic;
+    const char *broker_uri;
+    myq_rpc_conn *p_conn;
+    uint64_t served;
+}responder_info;
+
+static volatile bool stop_responders = false;
+
+static uint64_t now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+/**
+ * answer every request with its own payload until stopped
+ * @param p_arg
+ */
+static void *execute_responder(void *p_arg) {
+    responder_info *p_info = (responder_info *) p_arg;
+    unsigned buffer_size = 1024 * 1024;
+    char *buffer = malloc(buffer_size);
+    myq_request_context context;
+    while (!stop_responders) {
+        int length = receive_request(p_info->p_conn, &context, buffer, buffer_size, 100);
+        if (length < 0) {
+            printf("Topic[%s], Failed to receive request\n", p_info->topic);
+            break;
+        }
+        if (length == 0) {
+            continue;
+        }
+        if (send_reply(p_info->p_conn, &context, buffer, length) < 0) {
+            printf("Topic[%s], Failed to send reply\n", p_info->topic);
+        }
+        ++p_info->served;
+    }
+    free(buffer);
+    return NULL;
+}
+
+/*
+ * request/reply round trips through the broker
+ */
+int main(int argc, char **argv) {
+
+    int c;
+    const char *userid = "test_admin";
+    const char *password = "T0p$3cr31";
+    const char *broker_uri = "tcp://127.0.0.1:5500";
+    const char *loglevel = "event";
+    const char *topic = "test_1";
+    uint64_t requests = 10000;
+    uint32_t message_size = 100;
+    unsigned num_responders = 1;
+    int timeout_ms = 1000;
+    bool respond_only = false;
+    bool request_only = false;
+
+    while ((c = getopt(argc, argv, "ht:u:p:b:m:s:w:T:l:rq")) != -1) {
+
+        switch (c) {
+            case 'h':
+                printf(
+                    "Usage: [%s] [-t topic[%s]] [-u userid[%s]]  [-p password[%s]]  [-b broker_uri[%s]] [-m requests[%llu]] [-s message_size[%u]] [-w responders[%u]] [-T timeout_ms[%d]] [-l loglevel[event]] [-r (responders only)] [-q (requests only)]\n",
+                    argv[0], topic, userid, password, broker_uri, requests, message_size, num_responders,
+                    timeout_ms);
+                return 0;
+            case 't':
+                topic = optarg;
+                break;
+            case 'u':
+                userid = optarg;
+                break;
+            case 'p':
+                password = optarg;
+                break;
+            case 'b':
+                broker_uri = optarg;
+                break;
+            case 'm':
+                requests = strtoull(optarg, NULL, 10);
+                break;
+            case 's':
+                message_size = atoi(optarg);
+                break;
+            case 'w':
+                num_responders = atoi(optarg);
+                if (num_responders > MAX_RESPONDERS) {
+                    num_responders = MAX_RESPONDERS;
+                }
+                break;
+            case 'T':
+                timeout_ms = atoi(optarg);
+                break;
+            case 'l':
+                loglevel = optarg;
+                break;
+            case 'r':
+                respond_only = true;
+                break;
+            case 'q':
+                request_only = true;
+                break;
+            case '?':
+                if (isprint(optopt))
+                    fprintf(stderr, "Unknown option `-%c'.\n", optopt);
+                else
+                    fprintf(
+                        stderr,
+                        "Unknown option character `\\x%x'.\n",
+                        optopt);
+                return 1;
+            default:
+                break;
+        }
+    }
+
+    myq_loglevel level = str_to_loglevel(loglevel);
+    if (!init_log("logs", argv[0], level)) {
+        printf("Failed to initialize logging\n");
+        return -1;
+    }
+
+    responder_info responders[MAX_RESPONDERS];
+    pthread_t tid[MAX_RESPONDERS];
+    unsigned started = 0;
+    for (unsigned i = 0; i < num_responders && !request_only; ++i) {
+        responders[i].userid = userid;
+        responders[i].password = password;
+        responders[i].topic = topic;
+        responders[i].broker_uri = broker_uri;
+        responders[i].served = 0;
+        responders[i].p_conn = init_rpc_conn(userid, password, topic, broker_uri, true);
+        if (!responders[i].p_conn) {
+            printf("Topic[%s], Failed to initialize responder\n", topic);
+            break;
+        }
+        int err = pthread_create(&tid[i], NULL, execute_responder, &responders[i]);
+        if (err != 0) {
+            printf("can't create thread :[%s]\n", strerror(err));
+            free_rpc_conn(responders[i].p_conn);
+            break;
+        }
+        ++started;
+    }
+    if (respond_only) {
+        printf("Topic[%s], [%u] responders serving requests\n", topic, started);
+        for (unsigned i = 0; i < started; ++i) {
+            pthread_join(tid[i], NULL);
+        }
+        return (EXIT_SUCCESS);
+    }
+
+    int result = EXIT_SUCCESS;
+    myq_rpc_conn *p_conn = init_rpc_conn(userid, password, topic, broker_uri, false);
+    if (!p_conn) {
+        printf("Topic[%s], Failed to initialize requester\n", topic);
+        result = EXIT_FAILURE;
+    } else {
+        char *request = malloc(message_size + 1);
+        char *reply = malloc(message_size + 1);
+        double *latency_us = malloc(sizeof(double) * (requests ? requests : 1));
+        memset(request, 'r', message_size);
+        uint64_t completed = 0;
+        uint64_t failed = 0;
+        uint64_t start_us = now_us();
+        for (uint64_t i = 0; i < requests; ++i) {
+            uint64_t sent_us = now_us();
+            int length = send_request(p_conn, request, message_size, reply, message_size + 1, timeout_ms);
+            if (length != (int) message_size) {
+                ++failed;
+                continue;
+            }
+            latency_us[completed++] = now_us() - sent_us;
+        }
+        double total_sec = (now_us() - start_us) / 1000000.0;
+        if (completed > 0) {
+            qsort(latency_us, completed, sizeof(double), compare_double);
+            double sum = 0;
+            for (uint64_t i = 0; i < completed; ++i) {
+                sum += latency_us[i];
+            }
+            printf(
+                "Topic[%s], Requests [%llu], failed [%llu], [%.0f] requests per second\n", topic, completed, failed,
+                completed / total_sec);
+            printf(
+                "Topic[%s], Round trip avg [%.1f]us, p50 [%.1f]us, p99 [%.1f]us, max [%.1f]us\n", topic,
+                sum / completed, latency_us[completed / 2], latency_us[completed * 99 / 100],
+                latency_us[completed - 1]);
+        } else {
+            printf("Topic[%s], No request completed, failed [%llu]\n", topic, failed);
+            result = EXIT_FAILURE;
+        }
+        free(latency_us);
+        free(reply);
+        free(request);
+        free_rpc_conn(p_conn);
+    }
+
+    stop_responders = true;
+    for (unsigned i = 0; i < started; ++i) {
+        pthread_join(tid[i], NULL);
+        free_rpc_conn(responders[i].p_conn);
+    }
+    return result;
+}
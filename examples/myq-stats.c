@@ -0,0 +1,98 @@
+/*
+ * File:   myq-stats.c
+ *
+ *
+ * Created on October 19, 2026, 10:15 PM
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#ifndef __APPLE__
+#include <getopt.h>
+#endif
+#include <ctype.h>
+#include <string.h>
+#include "myq_api.h"
+
+/*
+ * Prints the topic statistics a broker on this host publishes in shared memory
+ */
+int main(int argc, char **argv) {
+
+    int c;
+    const char *bind_uri = "tcp://127.0.0.1:5500";
+    const char *topic = NULL;
+    const char *loglevel = "error";
+    unsigned interval = 1;
+    unsigned count = 1;
+
+    while ((c = getopt(argc, argv, "hb:t:i:c:l:")) != -1) {
+        switch (c) {
+            case 'h':
+                printf(
+                    "Usage: [%s] [-b bind_uri[%s]] [-t topic[all]] [-i interval_seconds[%u]] [-c count[%u], 0 for ever] [-l loglevel[error]]\n",
+                    argv[0], bind_uri, interval, count);
+                return 1;
+            case 'b':
+                bind_uri = optarg;
+                break;
+            case 't':
+                topic = optarg;
+                break;
+            case 'i':
+                interval = atoi(optarg);
+                break;
+            case 'c':
+                count = atoi(optarg);
+                break;
+            case 'l':
+                loglevel = optarg;
+                break;
+            case '?':
+                if (isprint(optopt))
+                    fprintf(stderr, "Unknown option `-%c'.\n", optopt);
+                else
+                    fprintf(
+                        stderr,
+                        "Unknown option character `\\x%x'.\n",
+                        optopt);
+                return 1;
+            default:
+                break;
+        }
+    }
+
+    init_log("logs", argv[0], str_to_loglevel(loglevel));
+    myq_stats_reader *reader = open_stats_reader(bind_uri);
+    if (!reader) {
+        fprintf(stderr, "No broker statistics for %s on this host\n", bind_uri);
+        return (EXIT_FAILURE);
+    }
+    topic_stats stats;
+    uint64_t updated_ms = 0;
+    for (unsigned n = 0; count == 0 || n < count; ++n) {
+        if (n > 0) {
+            sleep(interval);
+        }
+        printf("%-32s %-10s %12s %12s %12s %5s %5s %12s %12s %12s %12s %12s\n",
+               "topic", "type", "received", "sent", "queue", "pubs", "subs", "mem_used", "append_avg", "append_max",
+               "cpu_in", "cpu_out");
+        uint32_t topics = get_stats_topic_count(reader);
+        for (uint32_t i = 0; i < topics; ++i) {
+            if (!read_stats_at(reader, i, &stats, &updated_ms) || (topic && strcmp(topic, stats.topic))) {
+                continue;
+            }
+            printf("%-32s %-10s %12llu %12llu %12llu %5llu %5llu %12llu %10lluns %10lluns %10llums %10llums\n",
+                   stats.topic, stats.topic_type,
+                   (unsigned long long)stats.messages_received, (unsigned long long)stats.messages_sent,
+                   (unsigned long long)stats.queue_size, (unsigned long long)stats.publishers_count,
+                   (unsigned long long)stats.subscribers_count, (unsigned long long)stats.memory_used,
+                   (unsigned long long)stats.append_latency_avg_ns, (unsigned long long)stats.append_latency_max_ns,
+                   (unsigned long long)(stats.cpu_producer_ns / 1000000),
+                   (unsigned long long)((stats.cpu_consumer_ns + stats.cpu_egress_ns) / 1000000));
+        }
+        fflush(stdout);
+    }
+    close_stats_reader(reader);
+    return (EXIT_SUCCESS);
+}
@@ -30,13 +30,26 @@ int main(int argc, char **argv) {
 
     const char *loglevel = "event";
     unsigned num_partitions = 1;
+    topic_options options;
+    options.last_value_cache = false;
+    options.key_delimiter = '|';
+    options.conflate = false;
+    options.multicast_uri = NULL;
+    options.multicast_interface = NULL;
+    options.memory_quota_mb = 0;
+    options.egress_threads = 1;
+    options.aggregate_window_ms = 0;
+    options.aggregate_field = 0;
+    options.latency_target_us = 0;
+    options.segment_size_mb = 0;
+    options.preallocate_segments = false;
 
 
-    while ((c = getopt(argc, argv, "ht:a:d:b:u:p:s:l:n:")) != -1) {
+    while ((c = getopt(argc, argv, "ht:a:d:b:u:p:s:l:n:k:cg:i:q:e:w:f:L:S:P")) != -1) {
         switch (c) {
             case 'h':
                 printf(
-                    "Usage: [%s] [-t topic[%s]] [-a admin_userid[%s]] [-d admin_password[%s]] [-b bind_uri[%s]] [-u userid[%s]] [-p password[%s]] [-s storage[%s]] [-n num_partitions[%u]] [-l loglevel[event]]\n",
+                    "Usage: [%s] [-t topic[%s]] [-a admin_userid[%s]] [-d admin_password[%s]] [-b bind_uri[%s]] [-u userid[%s]] [-p password[%s]] [-s storage[%s]] [-n num_partitions[%u]] [-k key_delimiter (enables last value cache)] [-c (conflate per key for slow consumers)] [-g multicast_uri] [-i multicast_interface] [-q memory_quota_mb] [-e egress_threads[1]] [-w aggregate_window_ms] [-f aggregate_field (0 counts only)] [-L latency_target_us (adaptive batches)] [-S segment_size_mb] [-P (preallocate segments)] [-l loglevel[event]]\n",
                     argv[0], topic, admin_userid, admin_password, bind_uri, userid, password, storage,
                     num_partitions);
                 return 1;
@@ -70,6 +83,40 @@ int main(int argc, char **argv) {
             case 'n':
                 num_partitions = atoi(optarg);
                 break;
+            case 'k':
+                options.last_value_cache = true;
+                options.key_delimiter = optarg[0];
+                break;
+            case 'c':
+                options.conflate = true;
+                break;
+            case 'g':
+                options.multicast_uri = optarg;
+                break;
+            case 'i':
+                options.multicast_interface = optarg;
+                break;
+            case 'q':
+                options.memory_quota_mb = strtoull(optarg, NULL, 10);
+                break;
+            case 'e':
+                options.egress_threads = atoi(optarg);
+                break;
+            case 'w':
+                options.aggregate_window_ms = strtoull(optarg, NULL, 10);
+                break;
+            case 'f':
+                options.aggregate_field = atoi(optarg);
+                break;
+            case 'L':
+                options.latency_target_us = strtoull(optarg, NULL, 10);
+                break;
+            case 'S':
+                options.segment_size_mb = atoi(optarg);
+                break;
+            case 'P':
+                options.preallocate_segments = true;
+                break;
             case '?':
                 if (isprint(optopt))
                     fprintf(stderr, "Unknown option `-%c'.\n", optopt);
@@ -94,6 +141,8 @@ int main(int argc, char **argv) {
     broker_storage_type type = queue_type;
     if (!strcmp(storage, "file")) {
         type = file_type;
+    } else if (!strcmp(storage, "queue_file")) {
+        type = queue_file_type;
     }
     char topic_buffer[256];
     strcpy(topic_buffer, "");
@@ -101,7 +150,8 @@ int main(int argc, char **argv) {
     for (unsigned i = 0; i < num_partitions; ++i) {
         sprintf(topic_buffer, "%s_%u", topic, i + 1);
         printf("creating topic %s\n", topic_buffer);
-        if (create_topic(bind_uri, topic_buffer, admin_userid, admin_password, userid, password, type)) {
+        if (create_topic_with_options(
+                bind_uri, topic_buffer, admin_userid, admin_password, userid, password, type, &options)) {
             printf("topic %s created successfully\n", topic);
         } else {
             printf("Failed to create topic %s\n", topic);
@@ -0,0 +1,145 @@
+/*
+ * File:   adaptive_batch.h
+ *
+ *
+ * Created on October 20, 2026, 3:10 AM
+ */
+
+#ifndef ADAPTIVE_BATCH_H
+#define ADAPTIVE_BATCH_H
+
+#include <algorithm>
+#include <cstdint>
+#include "utils.h"
+using namespace mymq;
+namespace myq
+{
+
+    /**
+     * adaptive_batch
+     * Batch size and linger time tuned to a latency target with an AIMD rule, from what every sent batch
+     * observed: the backlog still waiting, the messages sent and the latency of its oldest message.
+     * - a batch over the target halves the batch size and the linger (multiplicative decrease)
+     * - a backlog larger than the batch grows the batch by a sixteenth of the maximum (additive increase)
+     * - a batch that doesn't fill lingers a little longer next time while latency has headroom, so moderate
+     *   traffic goes out in fewer sends; a single message means traffic is quiet and is sent at once
+     * - a sender that doesn't see its backlog (a client publishing one message at a time) reports arrivals:
+     *   messages closer together than half the target start a linger from their gap
+     * Not thread safe, each sender owns one.
+     */
+    class adaptive_batch
+    {
+    public:
+        /**
+         * constructor
+         * @param latency_target_us
+         * @param max_batch_size
+         */
+        adaptive_batch(uint64_t latency_target_us, unsigned max_batch_size)
+            : latency_target_us_(latency_target_us), max_batch_size_(std::max(1u, max_batch_size)),
+              max_linger_us_(latency_target_us / 2), batch_size_(1), linger_us_(0), batches_(0),
+              batches_over_target_(0)
+        {
+            increase_ = std::max(1u, max_batch_size_ / 16);
+            linger_step_ = std::max<uint64_t>(1, latency_target_us / 16);
+        }
+
+        /**
+         * adjust to a sent batch
+         * @param backlog messages still waiting after the batch
+         * @param sent messages in the batch
+         * @param latency_us wait of the oldest message of the batch, until sent
+         */
+        void update(uint64_t backlog, unsigned sent, uint64_t latency_us)
+        {
+            ++batches_;
+            if (latency_us > latency_target_us_)
+            {
+                ++batches_over_target_;
+                batch_size_ = std::max(1u, batch_size_ / 2);
+                linger_us_ /= 2;
+            }
+            else if (backlog > 0)
+            {
+                batch_size_ = std::min(max_batch_size_, batch_size_ + increase_);
+            }
+            else if (sent <= 1)
+            {
+                linger_us_ = 0;
+            }
+            else if (sent < batch_size_ && latency_us < latency_target_us_ / 2)
+            {
+                linger_us_ = std::min(max_linger_us_, linger_us_ + linger_step_);
+            }
+        }
+
+        /**
+         * note a message arriving for the next batch. While nothing lingers, one that follows the previous
+         * within half the target means messages come fast enough to share a batch, so start lingering for
+         * about the gap between them; update grows it from there
+         * @param gap_us time since the previous message arrived
+         */
+        void arrived(uint64_t gap_us)
+        {
+            if (linger_us_ == 0 && gap_us < latency_target_us_ / 2)
+            {
+                linger_us_ = std::min(max_linger_us_, std::max(linger_step_, gap_us));
+            }
+        }
+
+        /**
+         * messages to send at once
+         * @return
+         */
+        inline unsigned get_batch_size() const
+        {
+            return batch_size_;
+        }
+
+        /**
+         * time to wait for a batch to fill before sending what is there
+         * @return
+         */
+        inline uint64_t get_linger_us() const
+        {
+            return linger_us_;
+        }
+
+        /**
+         * longest a sender should sleep between looks at an empty queue
+         * @return
+         */
+        inline uint64_t get_poll_us() const
+        {
+            return std::max<uint64_t>(1, std::min<uint64_t>(latency_target_us_ / 4, utils::queue_poll_wait * 1000));
+        }
+
+        inline uint64_t get_latency_target_us() const
+        {
+            return latency_target_us_;
+        }
+
+        inline uint64_t get_batches() const
+        {
+            return batches_;
+        }
+
+        inline uint64_t get_batches_over_target() const
+        {
+            return batches_over_target_;
+        }
+
+    private:
+        uint64_t latency_target_us_;
+        unsigned max_batch_size_;
+        uint64_t max_linger_us_;
+        unsigned increase_;
+        uint64_t linger_step_;
+        unsigned batch_size_;
+        uint64_t linger_us_;
+        uint64_t batches_;
+        uint64_t batches_over_target_;
+    };
+}
+
+#endif /* ADAPTIVE_BATCH_H */
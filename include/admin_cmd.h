@@ -144,6 +144,15 @@ namespace myq
             std::string status_; // OK or ERROR
             std::string topic_;
             std::string bind_uri_;
+            std::string sync_uri_; // sub only: retransmission endpoint
+            bool last_value_cache_; // sub only: snapshot available on sync endpoint
+            std::string multicast_uri_; // sub only: udp multicast group carrying the pub stream
+            std::string multicast_interface_;
+
+            join_resp()
+            {
+                last_value_cache_ = false;
+            }
 
             std::string to_json()
             {
@@ -153,6 +162,15 @@ namespace myq
                 obj["status"] = picojson::value(status_);
                 obj["topic"] = picojson::value(topic_);
                 obj["bind_uri"] = picojson::value(bind_uri_);
+                if (!sync_uri_.empty())
+                    obj["sync_uri"] = picojson::value(sync_uri_);
+                if (last_value_cache_)
+                    obj["last_value_cache"] = picojson::value(last_value_cache_);
+                if (!multicast_uri_.empty())
+                {
+                    obj["multicast_uri"] = picojson::value(multicast_uri_);
+                    obj["multicast_interface"] = picojson::value(multicast_interface_);
+                }
                 picojson::value v(obj);
                 std::string json_str = v.serialize(true);
                 LOG_TRACE("json_str [%s]", json_str.c_str());
@@ -175,6 +193,14 @@ namespace myq
                     status_ = v.get("status").get<std::string>();
                 if (v.get("bind_uri").is<std::string>())
                     bind_uri_ = v.get("bind_uri").get<std::string>();
+                if (v.get("sync_uri").is<std::string>())
+                    sync_uri_ = v.get("sync_uri").get<std::string>();
+                if (v.get("last_value_cache").is<bool>())
+                    last_value_cache_ = v.get("last_value_cache").get<bool>();
+                if (v.get("multicast_uri").is<std::string>())
+                    multicast_uri_ = v.get("multicast_uri").get<std::string>();
+                if (v.get("multicast_interface").is<std::string>())
+                    multicast_interface_ = v.get("multicast_interface").get<std::string>();
                 LOG_RET_TRUE("");
             }
         };
@@ -240,6 +266,25 @@ namespace myq
             const std::string subscribers_count_str = "subscribers_count";
             const std::string total_bytes_written_str = "total_bytes_written";
             const std::string total_bytes_read_str = "total_bytes_read";
+            const std::string messages_conflated_str = "messages_conflated";
+            const std::string duplicates_dropped_str = "duplicates_dropped";
+            const std::string memory_used_str = "memory_used";
+            const std::string memory_quota_str = "memory_quota";
+            const std::string memory_throttled_str = "memory_throttled";
+            const std::string memory_fixed_str = "memory_fixed";
+            const std::string memory_queued_str = "memory_queued";
+            const std::string memory_indexes_str = "memory_indexes";
+            const std::string cpu_producer_ns_str = "cpu_producer_ns";
+            const std::string cpu_consumer_ns_str = "cpu_consumer_ns";
+            const std::string cpu_egress_ns_str = "cpu_egress_ns";
+            const std::string broker_memory_used_str = "broker_memory_used";
+            const std::string broker_memory_limit_str = "broker_memory_limit";
+            const std::string append_latency_avg_ns_str = "append_latency_avg_ns";
+            const std::string append_latency_max_ns_str = "append_latency_max_ns";
+            const std::string segment_cache_hits_str = "segment_cache_hits";
+            const std::string segment_cache_misses_str = "segment_cache_misses";
+            const std::string broker_segments_open_str = "broker_segments_open";
+            const std::string broker_segments_open_limit_str = "broker_segments_open_limit";
             const std::string cmd_ = "stats";
             std::string status_;
             std::string topic_;
@@ -251,6 +296,25 @@ namespace myq
             int64_t subscribers_count_;
             int64_t total_bytes_written_;
             int64_t total_bytes_read_;
+            int64_t messages_conflated_;
+            int64_t duplicates_dropped_;
+            int64_t memory_used_;
+            int64_t memory_quota_;
+            int64_t memory_throttled_;
+            int64_t memory_fixed_;
+            int64_t memory_queued_;
+            int64_t memory_indexes_;
+            int64_t cpu_producer_ns_;
+            int64_t cpu_consumer_ns_;
+            int64_t cpu_egress_ns_;
+            int64_t broker_memory_used_;
+            int64_t broker_memory_limit_;
+            int64_t append_latency_avg_ns_;
+            int64_t append_latency_max_ns_;
+            int64_t segment_cache_hits_;
+            int64_t segment_cache_misses_;
+            int64_t broker_segments_open_;
+            int64_t broker_segments_open_limit_;
 
             stats_resp()
             {
@@ -264,6 +328,25 @@ namespace myq
                 subscribers_count_ = 0;
                 total_bytes_written_ = 0;
                 total_bytes_read_ = 0;
+                messages_conflated_ = 0;
+                duplicates_dropped_ = 0;
+                memory_used_ = 0;
+                memory_quota_ = 0;
+                memory_throttled_ = 0;
+                memory_fixed_ = 0;
+                memory_queued_ = 0;
+                memory_indexes_ = 0;
+                cpu_producer_ns_ = 0;
+                cpu_consumer_ns_ = 0;
+                cpu_egress_ns_ = 0;
+                broker_memory_used_ = 0;
+                broker_memory_limit_ = 0;
+                append_latency_avg_ns_ = 0;
+                append_latency_max_ns_ = 0;
+                segment_cache_hits_ = 0;
+                segment_cache_misses_ = 0;
+                broker_segments_open_ = 0;
+                broker_segments_open_limit_ = 0;
             }
             std::string to_json()
             {
@@ -279,6 +362,25 @@ namespace myq
                 obj[subscribers_count_str] = picojson::value(subscribers_count_);
                 obj[total_bytes_written_str] = picojson::value(total_bytes_written_);
                 obj[total_bytes_read_str] = picojson::value(total_bytes_read_);
+                obj[messages_conflated_str] = picojson::value(messages_conflated_);
+                obj[duplicates_dropped_str] = picojson::value(duplicates_dropped_);
+                obj[memory_used_str] = picojson::value(memory_used_);
+                obj[memory_quota_str] = picojson::value(memory_quota_);
+                obj[memory_throttled_str] = picojson::value(memory_throttled_);
+                obj[memory_fixed_str] = picojson::value(memory_fixed_);
+                obj[memory_queued_str] = picojson::value(memory_queued_);
+                obj[memory_indexes_str] = picojson::value(memory_indexes_);
+                obj[cpu_producer_ns_str] = picojson::value(cpu_producer_ns_);
+                obj[cpu_consumer_ns_str] = picojson::value(cpu_consumer_ns_);
+                obj[cpu_egress_ns_str] = picojson::value(cpu_egress_ns_);
+                obj[broker_memory_used_str] = picojson::value(broker_memory_used_);
+                obj[broker_memory_limit_str] = picojson::value(broker_memory_limit_);
+                obj[append_latency_avg_ns_str] = picojson::value(append_latency_avg_ns_);
+                obj[append_latency_max_ns_str] = picojson::value(append_latency_max_ns_);
+                obj[segment_cache_hits_str] = picojson::value(segment_cache_hits_);
+                obj[segment_cache_misses_str] = picojson::value(segment_cache_misses_);
+                obj[broker_segments_open_str] = picojson::value(broker_segments_open_);
+                obj[broker_segments_open_limit_str] = picojson::value(broker_segments_open_limit_);
                 picojson::value v(obj);
                 std::string json_str = v.serialize(true);
                 LOG_TRACE("json_str [%s]", json_str.c_str());
@@ -316,8 +418,491 @@ namespace myq
                     total_bytes_written_ = v.get(total_bytes_written_str).get<int64_t>();
                 if (v.get(total_bytes_read_str).is<int64_t>())
                     total_bytes_read_ = v.get(total_bytes_read_str).get<int64_t>();
+                if (v.get(messages_conflated_str).is<int64_t>())
+                    messages_conflated_ = v.get(messages_conflated_str).get<int64_t>();
+                if (v.get(duplicates_dropped_str).is<int64_t>())
+                    duplicates_dropped_ = v.get(duplicates_dropped_str).get<int64_t>();
+                if (v.get(memory_used_str).is<int64_t>())
+                    memory_used_ = v.get(memory_used_str).get<int64_t>();
+                if (v.get(memory_quota_str).is<int64_t>())
+                    memory_quota_ = v.get(memory_quota_str).get<int64_t>();
+                if (v.get(memory_throttled_str).is<int64_t>())
+                    memory_throttled_ = v.get(memory_throttled_str).get<int64_t>();
+                if (v.get(memory_fixed_str).is<int64_t>())
+                    memory_fixed_ = v.get(memory_fixed_str).get<int64_t>();
+                if (v.get(memory_queued_str).is<int64_t>())
+                    memory_queued_ = v.get(memory_queued_str).get<int64_t>();
+                if (v.get(memory_indexes_str).is<int64_t>())
+                    memory_indexes_ = v.get(memory_indexes_str).get<int64_t>();
+                if (v.get(cpu_producer_ns_str).is<int64_t>())
+                    cpu_producer_ns_ = v.get(cpu_producer_ns_str).get<int64_t>();
+                if (v.get(cpu_consumer_ns_str).is<int64_t>())
+                    cpu_consumer_ns_ = v.get(cpu_consumer_ns_str).get<int64_t>();
+                if (v.get(cpu_egress_ns_str).is<int64_t>())
+                    cpu_egress_ns_ = v.get(cpu_egress_ns_str).get<int64_t>();
+                if (v.get(broker_memory_used_str).is<int64_t>())
+                    broker_memory_used_ = v.get(broker_memory_used_str).get<int64_t>();
+                if (v.get(broker_memory_limit_str).is<int64_t>())
+                    broker_memory_limit_ = v.get(broker_memory_limit_str).get<int64_t>();
+                if (v.get(append_latency_avg_ns_str).is<int64_t>())
+                    append_latency_avg_ns_ = v.get(append_latency_avg_ns_str).get<int64_t>();
+                if (v.get(append_latency_max_ns_str).is<int64_t>())
+                    append_latency_max_ns_ = v.get(append_latency_max_ns_str).get<int64_t>();
+                if (v.get(segment_cache_hits_str).is<int64_t>())
+                    segment_cache_hits_ = v.get(segment_cache_hits_str).get<int64_t>();
+                if (v.get(segment_cache_misses_str).is<int64_t>())
+                    segment_cache_misses_ = v.get(segment_cache_misses_str).get<int64_t>();
+                if (v.get(broker_segments_open_str).is<int64_t>())
+                    broker_segments_open_ = v.get(broker_segments_open_str).get<int64_t>();
+                if (v.get(broker_segments_open_limit_str).is<int64_t>())
+                    broker_segments_open_limit_ = v.get(broker_segments_open_limit_str).get<int64_t>();
+                LOG_RET_TRUE("");
+            }
+        };
+
+        /**
+         * derive a topic from another through a plugin running in the broker
+         */
+        struct create_pipeline_req
+        {
+            const std::string cmd_ = "create_pipeline";
+            std::string admin_user_id_;
+            std::string admin_password_;
+            std::string source_topic_; // file or queue_file topic
+            std::string target_topic_; // topic without publishers, the pipeline writes it
+            std::string plugin_;       // file name of the shared library in the broker plugin directory
+            std::string plugin_args_;
+
+            bool from_json(const std::string &json_str)
+            {
+                LOG_IN("json_str[%s]", json_str.c_str());
+                picojson::value v;
+                std::string err = picojson::parse(v, json_str);
+                if (!err.empty())
+                {
+                    LOG_ERROR("Failed to parse json. Error[%s]", err.c_str());
+                    LOG_RET_FALSE("failed");
+                }
+                if (v.get("admin_user_id").is<std::string>())
+                    admin_user_id_ = v.get("admin_user_id").get<std::string>();
+                if (v.get("admin_password").is<std::string>())
+                    admin_password_ = v.get("admin_password").get<std::string>();
+                if (v.get("source_topic").is<std::string>())
+                    source_topic_ = v.get("source_topic").get<std::string>();
+                if (v.get("target_topic").is<std::string>())
+                    target_topic_ = v.get("target_topic").get<std::string>();
+                if (v.get("plugin").is<std::string>())
+                    plugin_ = v.get("plugin").get<std::string>();
+                if (v.get("plugin_args").is<std::string>())
+                    plugin_args_ = v.get("plugin_args").get<std::string>();
+                LOG_RET_TRUE("");
+            }
+
+            std::string to_json(bool mask_password = false)
+            {
+                LOG_IN("");
+                picojson::value::object obj;
+                obj["cmd"] = picojson::value(cmd_);
+                obj["admin_user_id"] = picojson::value(admin_user_id_);
+                if (mask_password)
+                {
+                    obj["admin_password"] = picojson::value("******");
+                }
+                else
+                {
+                    obj["admin_password"] = picojson::value(admin_password_);
+                }
+                obj["source_topic"] = picojson::value(source_topic_);
+                obj["target_topic"] = picojson::value(target_topic_);
+                obj["plugin"] = picojson::value(plugin_);
+                obj["plugin_args"] = picojson::value(plugin_args_);
+                picojson::value v(obj);
+                std::string json_str = v.serialize(true);
+                LOG_TRACE("json_str [%s]", json_str.c_str());
+                return std::move(json_str);
+            }
+        };
+
+        /**
+         * windowed aggregates of a topic
+         */
+        struct aggregates_req
+        {
+            const std::string cmd_ = "aggregates";
+            std::string topic_;
+            std::string user_id_;
+            std::string password_;
+            int64_t window_start_ms_; // closed window starting at, 0 for the latest closed window
+            bool open_;               // the window still collecting messages instead
+
+            aggregates_req()
+            {
+                window_start_ms_ = 0;
+                open_ = false;
+            }
+
+            bool from_json(const std::string &json_str)
+            {
+                LOG_IN("json_str[%s]", json_str.c_str());
+                picojson::value v;
+                std::string err = picojson::parse(v, json_str);
+                if (!err.empty())
+                {
+                    LOG_ERROR("Failed to parse json. Error[%s]", err.c_str());
+                    LOG_RET_FALSE("failed");
+                }
+                if (v.get("topic").is<std::string>())
+                    topic_ = v.get("topic").get<std::string>();
+                if (v.get("user_id").is<std::string>())
+                    user_id_ = v.get("user_id").get<std::string>();
+                if (v.get("password").is<std::string>())
+                    password_ = v.get("password").get<std::string>();
+                if (v.get("window_start_ms").is<int64_t>())
+                    window_start_ms_ = v.get("window_start_ms").get<int64_t>();
+                if (v.get("open").is<bool>())
+                    open_ = v.get("open").get<bool>();
+                LOG_RET_TRUE("");
+            }
+
+            std::string to_json(bool mask_password = false)
+            {
+                LOG_IN("");
+                picojson::value::object obj;
+                obj["cmd"] = picojson::value(cmd_);
+                obj["topic"] = picojson::value(topic_);
+                obj["user_id"] = picojson::value(user_id_);
+                if (mask_password)
+                {
+                    obj["password"] = picojson::value("******");
+                }
+                else
+                {
+                    obj["password"] = picojson::value(password_);
+                }
+                if (window_start_ms_ > 0)
+                    obj["window_start_ms"] = picojson::value(window_start_ms_);
+                if (open_)
+                    obj["open"] = picojson::value(open_);
+                picojson::value v(obj);
+                std::string json_str = v.serialize(true);
+                LOG_TRACE("json_str [%s]", json_str.c_str());
+                return std::move(json_str);
+            }
+        };
+
+        /**
+         * windowed aggregates response: the window and count, sum, min and max for every key
+         */
+        struct aggregates_resp
+        {
+            struct key_aggregate
+            {
+                std::string key_;
+                int64_t count_;
+                int64_t values_;
+                double sum_;
+                double min_;
+                double max_;
+            };
+
+            const std::string cmd_ = "aggregates";
+            std::string status_;
+            std::string description_;
+            std::string topic_;
+            int64_t window_start_ms_;
+            int64_t window_end_ms_;
+            int64_t messages_;
+            int64_t untracked_; // messages of keys the window had no room for
+            std::vector<key_aggregate> keys_;
+
+            aggregates_resp()
+            {
+                window_start_ms_ = 0;
+                window_end_ms_ = 0;
+                messages_ = 0;
+                untracked_ = 0;
+            }
+
+            bool from_json(const std::string &json_str)
+            {
+                LOG_IN("json_str[%s]", json_str.c_str());
+                picojson::value v;
+                std::string err = picojson::parse(v, json_str);
+                if (!err.empty())
+                {
+                    LOG_ERROR("Failed to parse json. Error[%s]", err.c_str());
+                    LOG_RET_FALSE("failed");
+                }
+                if (v.get("status").is<std::string>())
+                    status_ = v.get("status").get<std::string>();
+                if (v.get("description").is<std::string>())
+                    description_ = v.get("description").get<std::string>();
+                if (v.get("topic").is<std::string>())
+                    topic_ = v.get("topic").get<std::string>();
+                if (v.get("window_start_ms").is<int64_t>())
+                    window_start_ms_ = v.get("window_start_ms").get<int64_t>();
+                if (v.get("window_end_ms").is<int64_t>())
+                    window_end_ms_ = v.get("window_end_ms").get<int64_t>();
+                if (v.get("messages").is<int64_t>())
+                    messages_ = v.get("messages").get<int64_t>();
+                if (v.get("untracked").is<int64_t>())
+                    untracked_ = v.get("untracked").get<int64_t>();
+                keys_.clear();
+                if (v.get("keys").is<picojson::array>())
+                {
+                    const picojson::array &keys = v.get("keys").get<picojson::array>();
+                    for (unsigned i = 0; i < keys.size(); ++i)
+                    {
+                        key_aggregate k;
+                        k.key_ = keys[i].get("key").is<std::string>() ? keys[i].get("key").get<std::string>() : "";
+                        k.count_ = keys[i].get("count").is<int64_t>() ? keys[i].get("count").get<int64_t>() : 0;
+                        k.values_ = keys[i].get("values").is<int64_t>() ? keys[i].get("values").get<int64_t>() : 0;
+                        k.sum_ = keys[i].get("sum").is<double>() ? keys[i].get("sum").get<double>() : 0;
+                        k.min_ = keys[i].get("min").is<double>() ? keys[i].get("min").get<double>() : 0;
+                        k.max_ = keys[i].get("max").is<double>() ? keys[i].get("max").get<double>() : 0;
+                        keys_.push_back(k);
+                    }
+                }
+                LOG_RET_TRUE("");
+            }
+
+            std::string to_json()
+            {
+                LOG_IN("");
+                picojson::value::object obj;
+                obj["cmd"] = picojson::value(cmd_);
+                obj["status"] = picojson::value(status_);
+                obj["description"] = picojson::value(description_);
+                obj["topic"] = picojson::value(topic_);
+                obj["window_start_ms"] = picojson::value(window_start_ms_);
+                obj["window_end_ms"] = picojson::value(window_end_ms_);
+                obj["messages"] = picojson::value(messages_);
+                obj["untracked"] = picojson::value(untracked_);
+                picojson::array keys;
+                for (unsigned i = 0; i < keys_.size(); ++i)
+                {
+                    picojson::value::object k;
+                    k["key"] = picojson::value(keys_[i].key_);
+                    k["count"] = picojson::value(keys_[i].count_);
+                    k["values"] = picojson::value(keys_[i].values_);
+                    k["sum"] = picojson::value(keys_[i].sum_);
+                    k["min"] = picojson::value(keys_[i].min_);
+                    k["max"] = picojson::value(keys_[i].max_);
+                    keys.push_back(picojson::value(k));
+                }
+                obj["keys"] = picojson::value(keys);
+                picojson::value v(obj);
+                std::string json_str = v.serialize(true);
+                LOG_TRACE("json_str [%s]", json_str.c_str());
+                return std::move(json_str);
+            }
+        };
+
+        /**
+         * retransmission request for a range of sequence numbers (sent to the topic sync endpoint)
+         */
+        struct nak_req
+        {
+            const std::string cmd_ = "nak";
+            std::string topic_;
+            int64_t from_seq_;
+            int64_t to_seq_;
+
+            nak_req()
+            {
+                from_seq_ = 0;
+                to_seq_ = 0;
+            }
+
+            bool from_json(const std::string &json_str)
+            {
+                LOG_IN("json_str[%s]", json_str.c_str());
+                picojson::value v;
+                std::string err = picojson::parse(v, json_str);
+                if (!err.empty())
+                {
+                    LOG_ERROR("Failed to parse json. Error[%s]", err.c_str());
+                    LOG_RET_FALSE("failed");
+                }
+                if (v.get("topic").is<std::string>())
+                    topic_ = v.get("topic").get<std::string>();
+                if (v.get("from_seq").is<int64_t>())
+                    from_seq_ = v.get("from_seq").get<int64_t>();
+                if (v.get("to_seq").is<int64_t>())
+                    to_seq_ = v.get("to_seq").get<int64_t>();
+                LOG_RET_TRUE("");
+            }
+
+            std::string to_json()
+            {
+                LOG_IN("");
+                picojson::value::object obj;
+                obj["cmd"] = picojson::value(cmd_);
+                obj["topic"] = picojson::value(topic_);
+                obj["from_seq"] = picojson::value(from_seq_);
+                obj["to_seq"] = picojson::value(to_seq_);
+                picojson::value v(obj);
+                std::string json_str = v.serialize(true);
+                LOG_TRACE("json_str [%s]", json_str.c_str());
+                return std::move(json_str);
+            }
+        };
+
+        /**
+         * retransmission response. first frame of the reply; followed by [seq][payload] frame pairs
+         */
+        struct nak_resp
+        {
+            const std::string cmd_ = "nak";
+            std::string status_;
+            std::string description_;
+            std::string topic_;
+            int64_t from_seq_;
+            int64_t to_seq_;   // last seq included in the reply, from_seq_ - 1 if none
+            int64_t last_seq_; // last seq published on the topic
+
+            nak_resp()
+            {
+                from_seq_ = 0;
+                to_seq_ = 0;
+                last_seq_ = 0;
+            }
+
+            bool from_json(const std::string &json_str)
+            {
+                LOG_IN("json_str[%s]", json_str.c_str());
+                picojson::value v;
+                std::string err = picojson::parse(v, json_str);
+                if (!err.empty())
+                {
+                    LOG_ERROR("Failed to parse json. Error[%s]", err.c_str());
+                    LOG_RET_FALSE("failed");
+                }
+                if (v.get("status").is<std::string>())
+                    status_ = v.get("status").get<std::string>();
+                if (v.get("description").is<std::string>())
+                    description_ = v.get("description").get<std::string>();
+                if (v.get("topic").is<std::string>())
+                    topic_ = v.get("topic").get<std::string>();
+                if (v.get("from_seq").is<int64_t>())
+                    from_seq_ = v.get("from_seq").get<int64_t>();
+                if (v.get("to_seq").is<int64_t>())
+                    to_seq_ = v.get("to_seq").get<int64_t>();
+                if (v.get("last_seq").is<int64_t>())
+                    last_seq_ = v.get("last_seq").get<int64_t>();
+                LOG_RET_TRUE("");
+            }
+
+            std::string to_json()
+            {
+                LOG_IN("");
+                picojson::value::object obj;
+                obj["cmd"] = picojson::value(cmd_);
+                obj["status"] = picojson::value(status_);
+                obj["description"] = picojson::value(description_);
+                obj["topic"] = picojson::value(topic_);
+                obj["from_seq"] = picojson::value(from_seq_);
+                obj["to_seq"] = picojson::value(to_seq_);
+                obj["last_seq"] = picojson::value(last_seq_);
+                picojson::value v(obj);
+                std::string json_str = v.serialize(true);
+                LOG_TRACE("json_str [%s]", json_str.c_str());
+                return std::move(json_str);
+            }
+        };
+
+        /**
+         * last value cache snapshot request (sent to the topic sync endpoint)
+         */
+        struct snapshot_req
+        {
+            const std::string cmd_ = "snapshot";
+            std::string topic_;
+
+            bool from_json(const std::string &json_str)
+            {
+                LOG_IN("json_str[%s]", json_str.c_str());
+                picojson::value v;
+                std::string err = picojson::parse(v, json_str);
+                if (!err.empty())
+                {
+                    LOG_ERROR("Failed to parse json. Error[%s]", err.c_str());
+                    LOG_RET_FALSE("failed");
+                }
+                if (v.get("topic").is<std::string>())
+                    topic_ = v.get("topic").get<std::string>();
                 LOG_RET_TRUE("");
             }
+
+            std::string to_json()
+            {
+                LOG_IN("");
+                picojson::value::object obj;
+                obj["cmd"] = picojson::value(cmd_);
+                obj["topic"] = picojson::value(topic_);
+                picojson::value v(obj);
+                std::string json_str = v.serialize(true);
+                LOG_TRACE("json_str [%s]", json_str.c_str());
+                return std::move(json_str);
+            }
+        };
+
+        /**
+         * snapshot response. first frame of the reply; followed by [seq][payload] frame pairs, one per key
+         */
+        struct snapshot_resp
+        {
+            const std::string cmd_ = "snapshot";
+            std::string status_;
+            std::string description_;
+            std::string topic_;
+            int64_t count_;
+            int64_t last_seq_; // live messages with seq <= last_seq_ are already reflected in the snapshot
+
+            snapshot_resp()
+            {
+                count_ = 0;
+                last_seq_ = 0;
+            }
+
+            bool from_json(const std::string &json_str)
+            {
+                LOG_IN("json_str[%s]", json_str.c_str());
+                picojson::value v;
+                std::string err = picojson::parse(v, json_str);
+                if (!err.empty())
+                {
+                    LOG_ERROR("Failed to parse json. Error[%s]", err.c_str());
+                    LOG_RET_FALSE("failed");
+                }
+                if (v.get("status").is<std::string>())
+                    status_ = v.get("status").get<std::string>();
+                if (v.get("description").is<std::string>())
+                    description_ = v.get("description").get<std::string>();
+                if (v.get("topic").is<std::string>())
+                    topic_ = v.get("topic").get<std::string>();
+                if (v.get("count").is<int64_t>())
+                    count_ = v.get("count").get<int64_t>();
+                if (v.get("last_seq").is<int64_t>())
+                    last_seq_ = v.get("last_seq").get<int64_t>();
+                LOG_RET_TRUE("");
+            }
+
+            std::string to_json()
+            {
+                LOG_IN("");
+                picojson::value::object obj;
+                obj["cmd"] = picojson::value(cmd_);
+                obj["status"] = picojson::value(status_);
+                obj["description"] = picojson::value(description_);
+                obj["topic"] = picojson::value(topic_);
+                obj["count"] = picojson::value(count_);
+                obj["last_seq"] = picojson::value(last_seq_);
+                picojson::value v(obj);
+                std::string json_str = v.serialize(true);
+                LOG_TRACE("json_str [%s]", json_str.c_str());
+                return std::move(json_str);
+            }
         };
 
         // FIXME
@@ -331,6 +916,30 @@ namespace myq
             std::string admin_password_;
             std::string user_id_;
             std::string password_;
+            bool last_value_cache_;
+            std::string key_delimiter_;
+            std::string delivery_mode_; // "all" (default) or "conflate"
+            std::string multicast_uri_; // udp://group:port, empty for no multicast egress
+            std::string multicast_interface_;
+            int64_t memory_quota_mb_; // 0 for no topic quota
+            int64_t egress_threads_;  // file topics: threads sending to socket consumers
+            int64_t aggregate_window_ms_; // 0 for no aggregation
+            int64_t aggregate_field_;     // field after the key summed per key, 0 to count only
+            int64_t latency_target_us_;   // queue topics: adaptive dispatch batches, 0 for fixed batches
+            int64_t segment_size_mb_;     // file topics: 0 for the default segment size
+            bool preallocate_segments_;
+
+            create_topic_req()
+            {
+                last_value_cache_ = false;
+                memory_quota_mb_ = 0;
+                egress_threads_ = 1;
+                aggregate_window_ms_ = 0;
+                aggregate_field_ = 0;
+                latency_target_us_ = 0;
+                segment_size_mb_ = 0;
+                preallocate_segments_ = false;
+            }
 
             bool from_json(const std::string &json_str)
             {
@@ -344,6 +953,30 @@ namespace myq
                 }
                 if (v.get("topic").is<std::string>())
                     topic_ = v.get("topic").get<std::string>();
+                if (v.get("last_value_cache").is<bool>())
+                    last_value_cache_ = v.get("last_value_cache").get<bool>();
+                if (v.get("key_delimiter").is<std::string>())
+                    key_delimiter_ = v.get("key_delimiter").get<std::string>();
+                if (v.get("delivery_mode").is<std::string>())
+                    delivery_mode_ = v.get("delivery_mode").get<std::string>();
+                if (v.get("multicast_uri").is<std::string>())
+                    multicast_uri_ = v.get("multicast_uri").get<std::string>();
+                if (v.get("multicast_interface").is<std::string>())
+                    multicast_interface_ = v.get("multicast_interface").get<std::string>();
+                if (v.get("memory_quota_mb").is<int64_t>())
+                    memory_quota_mb_ = v.get("memory_quota_mb").get<int64_t>();
+                if (v.get("egress_threads").is<int64_t>())
+                    egress_threads_ = v.get("egress_threads").get<int64_t>();
+                if (v.get("aggregate_window_ms").is<int64_t>())
+                    aggregate_window_ms_ = v.get("aggregate_window_ms").get<int64_t>();
+                if (v.get("aggregate_field").is<int64_t>())
+                    aggregate_field_ = v.get("aggregate_field").get<int64_t>();
+                if (v.get("latency_target_us").is<int64_t>())
+                    latency_target_us_ = v.get("latency_target_us").get<int64_t>();
+                if (v.get("segment_size_mb").is<int64_t>())
+                    segment_size_mb_ = v.get("segment_size_mb").get<int64_t>();
+                if (v.get("preallocate_segments").is<bool>())
+                    preallocate_segments_ = v.get("preallocate_segments").get<bool>();
                 if (v.get("broker_type").is<std::string>())
                     broker_type_ = v.get("broker_type").get<std::string>();
                 if (v.get("admin_user_id").is<std::string>())
@@ -364,6 +997,31 @@ namespace myq
                 obj["cmd"] = picojson::value(cmd_);
                 obj["topic"] = picojson::value(topic_);
                 obj["broker_type"] = picojson::value(broker_type_);
+                obj["last_value_cache"] = picojson::value(last_value_cache_);
+                if (!key_delimiter_.empty())
+                    obj["key_delimiter"] = picojson::value(key_delimiter_);
+                if (!delivery_mode_.empty())
+                    obj["delivery_mode"] = picojson::value(delivery_mode_);
+                if (!multicast_uri_.empty())
+                {
+                    obj["multicast_uri"] = picojson::value(multicast_uri_);
+                    obj["multicast_interface"] = picojson::value(multicast_interface_);
+                }
+                if (memory_quota_mb_ > 0)
+                    obj["memory_quota_mb"] = picojson::value(memory_quota_mb_);
+                if (egress_threads_ > 1)
+                    obj["egress_threads"] = picojson::value(egress_threads_);
+                if (aggregate_window_ms_ > 0)
+                {
+                    obj["aggregate_window_ms"] = picojson::value(aggregate_window_ms_);
+                    obj["aggregate_field"] = picojson::value(aggregate_field_);
+                }
+                if (latency_target_us_ > 0)
+                    obj["latency_target_us"] = picojson::value(latency_target_us_);
+                if (segment_size_mb_ > 0)
+                    obj["segment_size_mb"] = picojson::value(segment_size_mb_);
+                if (preallocate_segments_)
+                    obj["preallocate_segments"] = picojson::value(preallocate_segments_);
                 obj["admin_user_id"] = picojson::value(admin_user_id_);
                 if (mask_password)
                 {
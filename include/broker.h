@@ -8,6 +8,7 @@
 #ifndef BROKER_H
 #define BROKER_H
 
+#include <atomic>
 #include "thirdparty/readerwriterqueue.h"
 #include "connection.h"
 #include "connection_zmq.h"
@@ -16,6 +17,7 @@
 #include "broker_config.h"
 #include "producer.h"
 #include "consumer.h"
+#include "rpc_endpoint.h"
 
 namespace myq
 {
@@ -27,14 +29,20 @@ namespace myq
         /**
          * constructor
          * @param config
+         * @param p_memory broker memory manager, NULL for no accounting
+         * @param p_dirs broker data directories, NULL to keep the log in the output directory
+         * @param p_fds broker fd cache of sealed log segments, NULL to keep them all open
          */
-        broker(broker_config &config) : config_(config), storage_(config)
+        broker(broker_config &config, memory_manager *p_memory = NULL, data_directories *p_dirs = NULL,
+               fd_cache *p_fds = NULL)
+            : config_(config), storage_(config, p_memory, p_dirs, p_fds)
         {
 
             LOG_IN("broker_config: %s", config.to_string().c_str());
             stop_ = false;
             p_producer_ = NULL;
             p_consumer_ = NULL;
+            p_rpc_endpoint_ = NULL;
             LOG_OUT("");
         }
 
@@ -44,64 +52,97 @@ namespace myq
         ~broker()
         {
             LOG_IN("");
-            delete p_producer_;
-            delete p_consumer_;
+            delete p_producer_.load();
+            delete p_consumer_.load();
+            delete p_rpc_endpoint_.load();
             LOG_OUT("");
         }
 
         bool init()
         {
             LOG_IN("");
-            storage_.init(config_);
+            if (!storage_.init(config_))
+            {
+                LOG_RET_FALSE("Failed to initialize storage");
+            }
             LOG_RET_TRUE("success");
         }
 
+        /**
+         * start the consumer endpoint. It is published to other threads (get_consumer) only once it runs
+         * @param consumer_config
+         * @return false if it failed, the topic has no consumer then
+         */
         bool init_consumer(consumer_config &consumer_config)
         {
             LOG_IN("");
             // initialize consumer
-            p_consumer_ = new consumer(&storage_, consumer_config);
-            if (!p_consumer_->init())
+            consumer *p_consumer = new consumer(&storage_, consumer_config);
+            if (!p_consumer->init())
             {
+                delete p_consumer;
                 LOG_RET_FALSE("Failed to initialize consumer");
             }
-            else
+            LOG_DEBUG("Consumer initialized successfully");
+            if (!p_consumer->run())
             {
-                LOG_DEBUG("Consumer initialized successfully");
+                delete p_consumer;
+                LOG_RET_FALSE("Failed to run consumer");
             }
-            storage_.set_consumer_socket(p_consumer_->get_consumer_socket());
-            if (p_consumer_->run())
+            if (p_consumer->get_raw_consumer_socket())
             {
-                LOG_RET_TRUE("success");
+                storage_.set_consumer_socket(p_consumer->get_raw_consumer_socket());
             }
-            else
+            else if (p_consumer->get_zmq_consumer_socket())
             {
-                LOG_RET_FALSE("Failed to run consumer");
+                storage_.set_consumer_socket(p_consumer->get_zmq_consumer_socket());
             }
+            p_consumer_.store(p_consumer, std::memory_order_release);
+            LOG_RET_TRUE("success");
         }
 
+        /**
+         * start the producer endpoint. It is published to other threads (get_producer) only once it runs
+         * @param prod_config
+         * @return false if it failed, the topic has no producer then
+         */
         bool init_producer(producer_config &prod_config)
         {
             LOG_IN("");
 
             // initialize producer
-            p_producer_ = new producer(&storage_, prod_config);
-            if (!p_producer_->init())
+            producer *p_producer = new producer(&storage_, prod_config);
+            if (!p_producer->init())
             {
+                delete p_producer;
                 LOG_RET_FALSE("Failed to initialize producer");
             }
-            else
-            {
-                LOG_DEBUG("Producer initialized successfully");
-            }
-            if (p_producer_->run())
+            LOG_DEBUG("Producer initialized successfully");
+            if (!p_producer->run())
             {
-                LOG_RET_TRUE("success");
+                delete p_producer;
+                LOG_RET_FALSE("Failed to run producer");
             }
-            else
+            p_producer_.store(p_producer, std::memory_order_release);
+            LOG_RET_TRUE("success");
+        }
+
+        /**
+         * start routing request/reply on the topic
+         * @param bind_uri
+         * @return
+         */
+        bool init_rpc(const std::string &bind_uri)
+        {
+            LOG_IN("bind_uri[%s]", bind_uri.c_str());
+            rpc_endpoint *p_rpc_endpoint = new rpc_endpoint(config_.id_, bind_uri);
+            if (!p_rpc_endpoint->init() || !p_rpc_endpoint->run())
             {
-                LOG_RET_FALSE("Failed to run producer");
+                delete p_rpc_endpoint;
+                LOG_RET_FALSE("Failed to initialize rpc endpoint");
             }
+            p_rpc_endpoint_.store(p_rpc_endpoint, std::memory_order_release);
+            LOG_RET_TRUE("success");
         }
 
         /**
@@ -130,14 +171,27 @@ namespace myq
             return storage_.get_queue_size();
         }
 
+        /**
+         * safe from any thread, see init_producer
+         * @return NULL until the producer endpoint runs
+         */
         producer *get_producer()
         {
-            return p_producer_;
+            return p_producer_.load(std::memory_order_acquire);
         }
 
+        /**
+         * safe from any thread, see init_consumer
+         * @return NULL until the consumer endpoint runs
+         */
         consumer *get_consumer()
         {
-            return p_consumer_;
+            return p_consumer_.load(std::memory_order_acquire);
+        }
+
+        rpc_endpoint *get_rpc_endpoint()
+        {
+            return p_rpc_endpoint_.load(std::memory_order_acquire);
         }
 
         broker_config &get_config()
@@ -154,8 +208,10 @@ namespace myq
         broker_config config_;
         bool stop_;
         broker_storage storage_;
-        producer *p_producer_;
-        consumer *p_consumer_;
+        // set once by the admin thread when the endpoint runs, read by the stats thread too
+        std::atomic<producer *> p_producer_;
+        std::atomic<consumer *> p_consumer_;
+        std::atomic<rpc_endpoint *> p_rpc_endpoint_;
     };
 }
 
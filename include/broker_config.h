@@ -36,7 +36,20 @@ namespace myq {
       uint32_t default_queue_size_ = 1024 * 1024 * 5;
       uint32_t max_message_size = 128 * 1048; // make it configurable
       std::string output_directory_ = "/tmp";
+      int data_directory_ = -1; //broker data directory of the first log segment, -1 for output_directory_
       std::string bind_interface = "tcp://*";
+      bool last_value_cache_ = false; //keep latest message per key for late joining subscribers
+      char key_delimiter_ = '|'; //message key is the prefix before the delimiter
+      bool conflate_ = false; //slow pull consumers get only the newest pending message per key
+      std::string multicast_uri_; //udp://group:port, pub stream is also sent to this group when set
+      std::string multicast_interface_; //local address to send multicast on, empty for default route
+      uint64_t memory_quota_ = 0; //bytes the topic may hold in memory, 0 for the broker limit only
+      unsigned egress_threads_ = 1; //threads sending a file topic to socket consumers
+      uint64_t aggregate_window_ms_ = 0; //tumbling window of the per key aggregates, 0 for no aggregation
+      unsigned aggregate_field_ = 0; //field after the key holding the value to sum (1 based), 0 to count only
+      uint64_t latency_target_us_ = 0; //queue topics: dispatch batches adapt to this latency, 0 for fixed batches
+      uint64_t segment_size_ = 0; //file topics: bytes per log segment, 0 for the default (2 GB)
+      bool preallocate_segments_ = false; //file topics: reserve every segment's full size on disk when created
 
 
       /**
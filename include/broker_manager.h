@@ -11,12 +11,21 @@
 #include <iostream>
 #include <string>
 #include <map>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "log.h"
 #include "connection.h"
 #include "connection_zmq.h"
 #include "broker_config.h"
 #include "broker.h"
 #include "admin_cmd.h"
+#include "stats_shm.h"
+#include "data_directories.h"
+#include "pipeline.h"
 using namespace mymq;
 namespace myq
 {
@@ -35,7 +44,8 @@ namespace myq
         broker_manager(
             const std::string &admin_uri, const std::string &user_id = "myq_admin",
             const std::string &password = "T0p$3cr31")
-            : admin_uri_(admin_uri), user_id_(user_id), password_(password)
+            : admin_uri_(admin_uri), user_id_(user_id), password_(password),
+              stats_shm_(stats_shm::name_for_uri(admin_uri))
         {
 
             LOG_IN("admin_uri[%s], user_id[%s], password[%s]",
@@ -55,6 +65,13 @@ namespace myq
         ~broker_manager()
         {
             LOG_IN("");
+            stop_ = true;
+            if (stats_tid_.joinable())
+                stats_tid_.join();
+            for (std::map<std::string, pipeline *>::iterator it = pipelines_.begin(); it != pipelines_.end(); ++it)
+            {
+                delete it->second;
+            }
             delete p_conn_admin_;
             LOG_OUT("");
         }
@@ -72,6 +89,15 @@ namespace myq
             if (p_conn_admin_->init())
             {
                 LOG_EVENT("Broker manager is initialized with bind uri %s", admin_uri_.c_str());
+                // stats in shared memory are a convenience for local tools, the broker runs without them
+                if (stats_shm_.create())
+                {
+                    stats_tid_ = std::thread(
+                        [&]()
+                        {
+                            publish_stats();
+                        });
+                }
                 std::string l = utils::format_str("Broker Manager is bind to %s", admin_uri_.c_str());
                 LOG_RET_TRUE(l.c_str());
             }
@@ -79,6 +105,57 @@ namespace myq
             LOG_RET_FALSE(utils::format_str("Broker Manager failed to listen on %s", admin_uri_.c_str()).c_str());
         }
 
+        /**
+         * set the memory all topics may hold together
+         * @param limit bytes, 0 for three quarters of physical memory
+         */
+        void set_memory_limit(uint64_t limit)
+        {
+            memory_.set_limit(limit);
+        }
+
+        /**
+         * keep topic logs in several directories (one per disk) instead of the default output directory.
+         * Only topics created afterwards use them
+         * @param paths
+         * @param policy round robin topics, or stripe every topic's segments across the directories
+         * @return false if already set or a directory is not writable
+         */
+        bool set_data_directories(const std::vector<std::string> &paths, data_directories::placement policy)
+        {
+            return data_dirs_.init(paths, policy);
+        }
+
+        /**
+         * directory pipeline plugins are loaded from. Pipelines name a shared library in it, so an admin
+         * request can't load any other file. Unset, pipelines are refused
+         * @param path
+         * @return false if it is not a readable directory
+         */
+        bool set_plugin_directory(const std::string &path)
+        {
+            LOG_IN("path[%s]", path.c_str());
+            struct stat st;
+            if (path.empty() || stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode) || access(path.c_str(), R_OK | X_OK) != 0)
+            {
+                LOG_ERROR("Plugin directory %s is not a readable directory", path.c_str());
+                LOG_RET_FALSE("invalid");
+            }
+            plugin_dir_ = path;
+            LOG_EVENT("Pipeline plugins are loaded from %s", plugin_dir_.c_str());
+            LOG_RET_TRUE("");
+        }
+
+        /**
+         * bound the sealed log segments that keep an fd open, across all topics. Colder ones are
+         * closed and reopened when read
+         * @param max_open
+         */
+        void set_max_open_segments(uint32_t max_open)
+        {
+            segment_fds_.set_capacity(max_open);
+        }
+
         /**
          *
          * @return
@@ -157,6 +234,15 @@ namespace myq
                 }
                 return reply_to_stats(req);
             }
+            else if (cmd == CMD_AGGREGATES)
+            {
+                admin_cmd::aggregates_req req;
+                if (!req.from_json(message))
+                {
+                    return reply_invalid_cmd(cmd);
+                }
+                return reply_to_aggregates(req);
+            }
             else if (cmd == CMD_CREATE_TOPIC)
             {
                 admin_cmd::create_topic_req req;
@@ -166,6 +252,15 @@ namespace myq
                 }
                 return reply_create_topic(req);
             }
+            else if (cmd == CMD_CREATE_PIPELINE)
+            {
+                admin_cmd::create_pipeline_req req;
+                if (!req.from_json(message))
+                {
+                    return reply_invalid_cmd(cmd);
+                }
+                return reply_create_pipeline(req);
+            }
             else
             {
                 return reply_invalid_cmd(cmd);
@@ -224,32 +319,251 @@ namespace myq
             }
             admin_cmd::stats_resp resp;
             resp.status_ = STATUS_SUCCESS;
+            fill_stats(it->second, resp);
+            std::string resp_str = resp.to_json();
+            LOG_EVENT("Status response: %s", resp_str.c_str());
+            return reply_cmd(resp_str);
+        }
+
+        /**
+         * reply to create pipeline: load the plugin and start deriving the target topic from the source
+         * @param req
+         * @return
+         */
+        ssize_t reply_create_pipeline(admin_cmd::create_pipeline_req &req)
+        {
+            LOG_IN("req [%s]", req.to_json(true).c_str());
+            admin_cmd::common_resp resp;
+            resp.cmd_ = req.cmd_;
+            resp.status_ = STATUS_ERROR;
+            std::map<std::string, broker *>::iterator source = brokers_.find(req.source_topic_);
+            std::map<std::string, broker *>::iterator target = brokers_.find(req.target_topic_);
+            if (user_id_ != req.admin_user_id_ || password_ != req.admin_password_)
+            {
+                LOG_EVENT("Unauthorized user[%s]", req.admin_user_id_.c_str());
+                resp.description_ = CMD_UNAUTH;
+            }
+            else if (source == brokers_.end() || target == brokers_.end())
+            {
+                resp.description_ = STATUS_TOPIC_NOT_FOUND;
+            }
+            else if (source == target || (source->second->get_config().broker_type_ != broker_config::broker_file &&
+                                          source->second->get_config().broker_type_ != broker_config::broker_queue_file))
+            {
+                resp.description_ = "source must be another file or queue_file topic";
+            }
+            else if (target->second->get_producer() != NULL || pipelines_.count(req.target_topic_) > 0)
+            {
+                resp.description_ = "target topic already has publishers";
+            }
+            else if (plugin_dir_.empty())
+            {
+                resp.description_ = "pipelines are disabled, the broker has no plugin directory";
+            }
+            else if (!valid_plugin_name(req.plugin_))
+            {
+                LOG_EVENT("Refused plugin[%s] of user[%s]", req.plugin_.c_str(), req.admin_user_id_.c_str());
+                resp.description_ = "plugin must be a file name in the broker plugin directory";
+            }
+            else
+            {
+                pipeline *p_pipeline = new pipeline(req.source_topic_ + "->" + req.target_topic_,
+                                                    &source->second->get_storage(), &target->second->get_storage());
+                if (!p_pipeline->init(plugin_dir_ + "/" + req.plugin_, req.plugin_args_) || !p_pipeline->run())
+                {
+                    delete p_pipeline;
+                    resp.description_ = "Failed to load plugin";
+                }
+                else
+                {
+                    pipelines_[req.target_topic_] = p_pipeline;
+                    resp.status_ = STATUS_SUCCESS;
+                }
+            }
+            std::string resp_str = resp.to_json();
+            LOG_EVENT("Status response: %s", resp_str.c_str());
+            return reply_cmd(resp_str);
+        }
+
+        /**
+         * a plugin is named by its file name alone: no path, no directory traversal
+         * @param name
+         * @return
+         */
+        static bool valid_plugin_name(const std::string &name)
+        {
+            return !name.empty() && name.find('/') == std::string::npos && name.find("..") == std::string::npos;
+        }
+
+        /**
+         * reply to aggregates: a closed window (the latest by default) or the open one
+         * @param req
+         * @return
+         */
+        ssize_t reply_to_aggregates(admin_cmd::aggregates_req &req)
+        {
+            LOG_IN("req [%s]", req.to_json(true).c_str());
+            admin_cmd::aggregates_resp resp;
             resp.topic_ = req.topic_;
-            resp.topic_type_ = it->second->get_config().get_broker_type_to_str();
-            resp.queue_size_ = it->second->get_queue_size();
-            resp.messages_received_ = it->second->get_total_msg_received();
-            resp.messages_sent_ = it->second->get_total_msg_sent();
-            resp.total_bytes_written_ = it->second->get_storage().get_file_total_bytes_written();
-            resp.total_bytes_read_ = it->second->get_storage().get_total_bytes_read();
-            if (it->second->get_producer())
+            resp.status_ = STATUS_ERROR;
+            std::map<std::string, broker *>::iterator it = brokers_.find(req.topic_);
+            window_aggregator::window window;
+            if (it == brokers_.end())
+            {
+                resp.description_ = STATUS_TOPIC_NOT_FOUND;
+            }
+            else if (it->second->get_config().user_id_ != req.user_id_ ||
+                     it->second->get_config().password_ != req.password_)
+            {
+                LOG_EVENT("Unauthorized user[%s]", req.user_id_.c_str());
+                resp.description_ = CMD_UNAUTH;
+            }
+            else if (it->second->get_storage().get_aggregator() == NULL)
+            {
+                resp.description_ = "topic has no aggregation rule";
+            }
+            else if (req.open_)
+            {
+                it->second->get_storage().get_aggregator()->get_open_window(window);
+                resp.status_ = STATUS_SUCCESS;
+            }
+            else if (!it->second->get_storage().get_aggregator()->get_closed_window(req.window_start_ms_, window))
+            {
+                resp.description_ = "window not available";
+            }
+            else
+            {
+                resp.status_ = STATUS_SUCCESS;
+            }
+            if (resp.status_ == STATUS_SUCCESS)
             {
-                resp.publishers_count_ = it->second->get_producer()->get_num_clients();
+                resp.window_start_ms_ = window.start_ms_;
+                resp.window_end_ms_ = window.end_ms_;
+                resp.messages_ = window.messages_;
+                resp.untracked_ = window.untracked_;
+                resp.keys_.reserve(window.keys_.size());
+                for (std::unordered_map<std::string, window_aggregator::aggregate>::iterator k = window.keys_.begin();
+                     k != window.keys_.end(); ++k)
+                {
+                    admin_cmd::aggregates_resp::key_aggregate a;
+                    a.key_ = k->first;
+                    a.count_ = k->second.count_;
+                    a.values_ = k->second.values_;
+                    a.sum_ = k->second.sum_;
+                    a.min_ = k->second.min_;
+                    a.max_ = k->second.max_;
+                    resp.keys_.push_back(a);
+                }
+            }
+            std::string resp_str = resp.to_json();
+            LOG_DEBUG("Aggregates response: %s", resp_str.c_str());
+            return reply_cmd(resp_str);
+        }
+
+        /**
+         * collect the statistics of a topic
+         * @param pb
+         * @param resp
+         */
+        void fill_stats(broker *pb, admin_cmd::stats_resp &resp)
+        {
+            resp.topic_ = pb->get_config().id_;
+            resp.topic_type_ = pb->get_config().get_broker_type_to_str();
+            resp.queue_size_ = pb->get_queue_size();
+            resp.messages_received_ = pb->get_total_msg_received();
+            resp.messages_sent_ = pb->get_total_msg_sent();
+            resp.total_bytes_written_ = pb->get_storage().get_file_total_bytes_written();
+            resp.total_bytes_read_ = pb->get_storage().get_total_bytes_read();
+            resp.duplicates_dropped_ = pb->get_storage().get_duplicates_dropped();
+            resp.memory_used_ = pb->get_storage().get_memory_used();
+            resp.memory_quota_ = pb->get_storage().get_memory_quota();
+            resp.memory_throttled_ = pb->get_storage().get_memory_throttled();
+            resp.memory_fixed_ = pb->get_storage().get_memory_fixed();
+            resp.memory_queued_ = pb->get_storage().get_memory_queued();
+            resp.memory_indexes_ = pb->get_storage().get_memory_indexes();
+            resp.broker_memory_used_ = memory_.get_used();
+            resp.broker_memory_limit_ = memory_.get_limit();
+            resp.segment_cache_hits_ = pb->get_storage().get_segment_cache_hits();
+            resp.segment_cache_misses_ = pb->get_storage().get_segment_cache_misses();
+            resp.broker_segments_open_ = segment_fds_.get_open();
+            resp.broker_segments_open_limit_ = segment_fds_.get_capacity();
+            if (pb->get_producer())
+            {
+                resp.publishers_count_ = pb->get_producer()->get_num_clients();
+                resp.cpu_producer_ns_ = pb->get_producer()->get_cpu_time_ns();
             }
             else
             {
                 resp.publishers_count_ = 0;
             }
-            if (it->second->get_consumer())
+            if (pb->get_consumer())
             {
-                resp.subscribers_count_ = it->second->get_consumer()->get_num_pub_clients() + it->second->get_consumer()->get_num_pull_clients();
+                resp.subscribers_count_ = pb->get_consumer()->get_num_pub_clients() + pb->get_consumer()->get_num_pull_clients();
+                resp.messages_conflated_ = pb->get_consumer()->get_messages_conflated();
+                resp.cpu_consumer_ns_ = pb->get_consumer()->get_cpu_time_ns();
+                resp.cpu_egress_ns_ = pb->get_consumer()->get_egress_cpu_time_ns();
             }
             else
             {
                 resp.subscribers_count_ = 0;
             }
-            std::string resp_str = resp.to_json();
-            LOG_EVENT("Status response: %s", resp_str.c_str());
-            return reply_cmd(resp_str);
+            resp.append_latency_avg_ns_ = pb->get_storage().get_append_latency_avg_ns();
+            resp.append_latency_max_ns_ = pb->get_storage().get_append_latency_max_ns();
+        }
+
+        /**
+         * copy the statistics of every topic to shared memory every stats_interval_ms_
+         */
+        void publish_stats()
+        {
+            LOG_IN("");
+            stats_shm::record r;
+            while (!stop_)
+            {
+                std::vector<std::pair<int, broker *> > topics;
+                {
+                    std::lock_guard<std::mutex> lock(stats_mutex_);
+                    topics = stats_topics_;
+                }
+                for (unsigned i = 0; i < topics.size(); ++i)
+                {
+                    admin_cmd::stats_resp resp;
+                    fill_stats(topics[i].second, resp);
+                    memset(&r, 0, sizeof(r));
+                    strncpy(r.topic_, resp.topic_.c_str(), sizeof(r.topic_) - 1);
+                    strncpy(r.topic_type_, resp.topic_type_.c_str(), sizeof(r.topic_type_) - 1);
+                    r.queue_size_ = resp.queue_size_;
+                    r.messages_sent_ = resp.messages_sent_;
+                    r.messages_received_ = resp.messages_received_;
+                    r.publishers_count_ = resp.publishers_count_;
+                    r.subscribers_count_ = resp.subscribers_count_;
+                    r.total_bytes_written_ = resp.total_bytes_written_;
+                    r.total_bytes_read_ = resp.total_bytes_read_;
+                    r.messages_conflated_ = resp.messages_conflated_;
+                    r.duplicates_dropped_ = resp.duplicates_dropped_;
+                    r.memory_used_ = resp.memory_used_;
+                    r.memory_quota_ = resp.memory_quota_;
+                    r.memory_throttled_ = resp.memory_throttled_;
+                    r.memory_fixed_ = resp.memory_fixed_;
+                    r.memory_queued_ = resp.memory_queued_;
+                    r.memory_indexes_ = resp.memory_indexes_;
+                    r.cpu_producer_ns_ = resp.cpu_producer_ns_;
+                    r.cpu_consumer_ns_ = resp.cpu_consumer_ns_;
+                    r.cpu_egress_ns_ = resp.cpu_egress_ns_;
+                    r.broker_memory_used_ = resp.broker_memory_used_;
+                    r.broker_memory_limit_ = resp.broker_memory_limit_;
+                    r.append_latency_avg_ns_ = resp.append_latency_avg_ns_;
+                    r.append_latency_max_ns_ = resp.append_latency_max_ns_;
+                    r.segment_cache_hits_ = resp.segment_cache_hits_;
+                    r.segment_cache_misses_ = resp.segment_cache_misses_;
+                    r.broker_segments_open_ = resp.broker_segments_open_;
+                    r.broker_segments_open_limit_ = resp.broker_segments_open_limit_;
+                    r.updated_ms_ = utils::get_currenttime_milliseconds();
+                    stats_shm_.write(topics[i].first, r);
+                }
+                utils::sleep_ms(stats_interval_ms_);
+            }
+            LOG_OUT("");
         }
 
         /**
@@ -305,6 +619,53 @@ namespace myq
             config.id_ = req.topic_;
             config.user_id_ = req.user_id_;
             config.password_ = req.password_;
+            config.last_value_cache_ = req.last_value_cache_;
+            if (!req.key_delimiter_.empty())
+            {
+                config.key_delimiter_ = req.key_delimiter_[0];
+            }
+            config.conflate_ = (req.delivery_mode_ == "conflate");
+            config.multicast_uri_ = req.multicast_uri_;
+            config.multicast_interface_ = req.multicast_interface_;
+            if (req.memory_quota_mb_ > 0)
+            {
+                config.memory_quota_ = (uint64_t)req.memory_quota_mb_ * 1024 * 1024;
+            }
+            if (req.aggregate_window_ms_ > 0)
+            {
+                config.aggregate_window_ms_ = req.aggregate_window_ms_;
+                config.aggregate_field_ = req.aggregate_field_ > 0 ? (unsigned)req.aggregate_field_ : 0;
+            }
+            if (req.egress_threads_ > 1)
+            {
+                config.egress_threads_ = (unsigned)std::min<int64_t>(req.egress_threads_, max_egress_threads_);
+            }
+            if (req.latency_target_us_ > 0)
+            {
+                config.latency_target_us_ = req.latency_target_us_;
+            }
+            if (req.segment_size_mb_ > 0)
+            {
+                config.segment_size_ = (uint64_t)req.segment_size_mb_ * 1024 * 1024;
+                if (config.segment_size_ < utils::max_msg_size + sizeof(uint32_t))
+                {
+                    LOG_WARN("Refusing topic[%s]: segment size %llu can't hold a message of %u bytes",
+                             req.topic_.c_str(), config.segment_size_, utils::max_msg_size);
+                    admin_cmd::common_resp resp;
+                    resp.cmd_ = req.cmd_;
+                    resp.status_ = STATUS_ERROR;
+                    resp.description_ = "segment_size_mb is smaller than the largest message";
+                    std::string resp_str = resp.to_json();
+                    LOG_EVENT("Status response: %s", resp_str.c_str());
+                    return reply_cmd(resp_str);
+                }
+            }
+            config.preallocate_segments_ = req.preallocate_segments_;
+            if (data_dirs_.size() > 0)
+            {
+                config.data_directory_ = data_dirs_.next_topic_directory();
+                config.output_directory_ = data_dirs_.get_path(config.data_directory_);
+            }
             LOG_DEBUG("creating broker_id: %s", config.id_.c_str());
 
             broker_config::broker_type broker_type = broker_config::broker_queue;
@@ -330,9 +691,10 @@ namespace myq
                 broker_type = broker_config::broker_queue; // default
             }
             config.broker_type_ = broker_type;
-            broker *pb = new broker(config);
+            broker *pb = new broker(config, &memory_, &data_dirs_, &segment_fds_);
             if (!pb->init())
             {
+                delete pb;
                 admin_cmd::common_resp resp;
                 resp.cmd_ = req.cmd_;
                 resp.status_ = STATUS_ERROR;
@@ -342,6 +704,14 @@ namespace myq
                 return reply_cmd(resp_str);
             }
             brokers_.insert(std::pair<std::string, broker *>(config.id_, pb));
+            {
+                std::lock_guard<std::mutex> lock(stats_mutex_);
+                int slot = stats_shm_.add_topic(config.id_);
+                if (slot > -1)
+                {
+                    stats_topics_.push_back(std::make_pair(slot, pb));
+                }
+            }
             admin_cmd::common_resp resp;
             resp.cmd_ = req.cmd_;
             resp.status_ = STATUS_SUCCESS;
@@ -383,6 +753,29 @@ namespace myq
                 if (req.type_ == "pub")
                 {
                     LOG_TRACE("request type is pub");
+                    if (pipelines_.count(req.topic_) > 0)
+                    {
+                        LOG_WARN("Refusing publisher on topic[%s]: written by a pipeline", req.topic_.c_str());
+                        admin_cmd::common_resp cmd_resp;
+                        cmd_resp.cmd_ = req.cmd_;
+                        cmd_resp.status_ = STATUS_ERROR;
+                        cmd_resp.description_ = "topic is written by a pipeline";
+                        std::string resp_str = cmd_resp.to_json();
+                        LOG_EVENT("Status response: %s", resp_str.c_str());
+                        return reply_cmd(resp_str);
+                    }
+                    if (!memory_.admit_publisher())
+                    {
+                        LOG_WARN("Refusing publisher on topic[%s]: broker is using %llu of %llu bytes",
+                                 req.topic_.c_str(), memory_.get_used(), memory_.get_limit());
+                        admin_cmd::common_resp cmd_resp;
+                        cmd_resp.cmd_ = req.cmd_;
+                        cmd_resp.status_ = STATUS_ERROR;
+                        cmd_resp.description_ = STATUS_NO_MEMORY;
+                        std::string resp_str = cmd_resp.to_json();
+                        LOG_EVENT("Status response: %s", resp_str.c_str());
+                        return reply_cmd(resp_str);
+                    }
                     if (it->second->get_producer() == NULL)
                     {
                         LOG_TRACE("Producer is null. Initializing...");
@@ -428,6 +821,30 @@ namespace myq
                         return reply_cmd(resp_str);
                     }
                 }
+                else if (req.type_ == "rpc")
+                {
+                    if (it->second->get_rpc_endpoint() == NULL)
+                    {
+                        std::string rpc_bind_uri = it->second->get_config().bind_interface;
+                        rpc_bind_uri.append(":");
+                        rpc_bind_uri.append(std::to_string(broker_config::get_next_port()));
+                        if (!it->second->init_rpc(rpc_bind_uri))
+                        {
+                            admin_cmd::common_resp cmd_resp;
+                            cmd_resp.cmd_ = req.cmd_;
+                            cmd_resp.status_ = STATUS_ERROR;
+                            cmd_resp.description_ = "Failed to initialize rpc endpoint";
+                            std::string resp_str = cmd_resp.to_json();
+                            LOG_EVENT("Status response: %s", resp_str.c_str());
+                            return reply_cmd(resp_str);
+                        }
+                    }
+                    resp.bind_uri_ = it->second->get_rpc_endpoint()->get_bind_uri();
+                    utils::replace(resp.bind_uri_, "*", "127.0.0.1");
+                    std::string resp_str = resp.to_json();
+                    LOG_EVENT("Status response: %s", resp_str.c_str());
+                    return reply_cmd(resp_str);
+                }
                 else
                 {
                     if (it->second->get_consumer() == NULL)
@@ -445,8 +862,17 @@ namespace myq
                         {
                             stream = connection::stream_socket;
                         }
+                        else
+                        {
+                            consumer_conf.sync_bind_uri_ = it->second->get_config().bind_interface;
+                            consumer_conf.sync_bind_uri_.append(":");
+                            consumer_conf.sync_bind_uri_.append(std::to_string(broker_config::get_next_port()));
+                            consumer_conf.multicast_uri_ = it->second->get_config().multicast_uri_;
+                            consumer_conf.multicast_interface_ = it->second->get_config().multicast_interface_;
+                        }
                         consumer_conf.stream_type_ = stream;
                         consumer_conf.socket_connect_type_ = connection::bind_socket;
+                        consumer_conf.egress_threads_ = it->second->get_config().egress_threads_;
                         if (!it->second->init_consumer(consumer_conf))
                         {
                             admin_cmd::common_resp cmd_resp;
@@ -472,6 +898,11 @@ namespace myq
                     if (req.type_ == "sub")
                     {
                         resp.bind_uri_ = it->second->get_consumer()->get_pub_bind_uri();
+                        resp.sync_uri_ = it->second->get_consumer()->get_sync_bind_uri();
+                        utils::replace(resp.sync_uri_, "*", "127.0.0.1");
+                        resp.last_value_cache_ = it->second->get_config().last_value_cache_;
+                        resp.multicast_uri_ = it->second->get_consumer()->get_multicast_uri();
+                        resp.multicast_interface_ = it->second->get_config().multicast_interface_;
                     }
                     else
                     {
@@ -610,12 +1041,23 @@ namespace myq
         std::string admin_uri_;
         std::string user_id_;
         std::string password_;
-        bool stop_;
+        std::atomic<bool> stop_;
 
         std::map<std::string, broker *> brokers_;
+        memory_manager memory_;
+        data_directories data_dirs_;
+        fd_cache segment_fds_; // open fds of sealed log segments, across topics
+        std::map<std::string, pipeline *> pipelines_; // by target topic
+        std::string plugin_dir_;                      // pipeline plugins, none if empty
+        stats_shm stats_shm_;
+        std::vector<std::pair<int, broker *> > stats_topics_; // slot in stats_shm_ of each topic
+        std::mutex stats_mutex_;                             // guards stats_topics_
+        std::thread stats_tid_;
 
         const std::string broker_mgr_topic_ = "myq_topic";
         const unsigned max_read_buffer_ = 4 * 1024;
+        const unsigned stats_interval_ms_ = 100;
+        const unsigned max_egress_threads_ = 64;
         const std::string CMD_INVALID = "invalid_cmd";
         const std::string CMD_PUB = "pub";
         const std::string CMD_SUB = "sub";
@@ -630,6 +1072,8 @@ namespace myq
         const std::string CMD_SERVER_ERROR = "server_error";
         const std::string CMD_SERVER_ERROR_EXCEED_MSG_LENGTH = "server_error: message lenth exceeded max buffer size";
         const std::string CMD_STATS = "stats";
+        const std::string CMD_AGGREGATES = "aggregates";
+        const std::string CMD_CREATE_PIPELINE = "create_pipeline";
         const std::string CMD_JOIN = "join";
         const std::string CMD_CREATE_TOPIC = "create_topic";
         const std::string STATUS_ERROR = "error";
@@ -637,6 +1081,7 @@ namespace myq
         const std::string STATUS_TOPIC_NOT_FOUND = "topic not found";
         const std::string STATUS_TOPIC_EXISTS = "topic already exists";
         const std::string STATUS_TOPIC_CREATED = "topic created successfully";
+        const std::string STATUS_NO_MEMORY = "broker memory limit reached";
     };
 }
 
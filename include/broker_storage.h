@@ -12,6 +12,12 @@
 #include "thirdparty/readerwriterqueue.h"
 //#include "connection_socket.h"
 #include "connection_file.h"
+#include "connection_zmq.h"
+#include "transport.h"
+#include "last_value_cache.h"
+#include "producer_dedup.h"
+#include "memory_manager.h"
+#include "window_aggregator.h"
 
 namespace myq {
   class broker;
@@ -19,39 +25,80 @@ namespace myq {
   class broker_storage {
   public:
 
-      broker_storage(broker_config &config) : config_(config),
-                                              total_enqueued_messages_(0), total_dequeued_messages_(0),
-                                              total_bytes_written_(0), total_bytes_read_(0) {
-          p_consumer_socket_ = NULL;
+      broker_storage(broker_config &config, memory_manager *p_memory = NULL, data_directories *p_dirs = NULL,
+                     fd_cache *p_fds = NULL)
+          : config_(config), p_memory_(p_memory), p_dirs_(p_dirs), p_fds_(p_fds),
+            total_enqueued_messages_(0), total_dequeued_messages_(0),
+            total_bytes_written_(0), total_bytes_read_(0),
+            file_read_seq_(0), publish_seq_(0), file_appends_(0),
+            append_latency_avg_ns_(0), append_latency_max_ns_(0) {
+          p_direct_consumer_ = NULL;
+          direct_write_ = NULL;
           p_file = NULL;
+          p_lvc_ = NULL;
+          p_dedup_ = NULL;
+          p_account_ = NULL;
+          p_aggregator_ = NULL;
+          p_enqueue_stamps_ = NULL;
       }
 
       ~broker_storage() {
           if (queue_to_file_thread_.joinable()) {
               queue_to_file_thread_.join();
           }
-          delete p_consumer_socket_;
-
-          p_file->close_all();
+          if (p_file) { //NULL if init failed before the log was opened
+              p_file->close_all();
+          }
           delete p_file;
-
+          delete p_lvc_;
+          delete p_dedup_;
+          delete p_aggregator_;
+          delete p_enqueue_stamps_;
+          if (p_account_) {
+              p_memory_->close_account(p_account_);
+          }
       }
 
       bool init(broker_config &config) {
           LOG_IN("config [%p]", &config);
+          if (p_memory_ && !open_memory_account(config)) {
+              LOG_RET_FALSE("Not enough memory for the topic");
+          }
+          if (config.last_value_cache_) {
+              p_lvc_ = new last_value_cache();
+          }
+          if (config.aggregate_window_ms_ > 0) {
+              p_aggregator_ = new window_aggregator(config.aggregate_window_ms_, config.aggregate_field_,
+                                                    config.key_delimiter_);
+          }
+          //file backed topics keep producer windows in a journal next to the log, so they survive restarts
+          std::string journal_path;
+          if (config.broker_type_ == broker_config::broker_file ||
+              config.broker_type_ == broker_config::broker_queue_file) {
+              journal_path = config.output_directory_ + "/" + config.id_ + "_producers.txt";
+          }
+          p_dedup_ = new producer_dedup(journal_path);
+          if (!p_dedup_->init()) {
+              LOG_RET_FALSE("Failed to load producer journal");
+          }
           //initialize broker storage
           if (config.broker_type_ == broker_config::broker_queue) {
               LOG_DEBUG("Broker type is queue");
-              p_queue_ = new moodycamel::ReaderWriterQueue<std::string>(config.default_queue_size_);
+              p_queue_ = new moodycamel::ReaderWriterQueue<std::string>(config_.default_queue_size_);
+              if (config.latency_target_us_ > 0) {
+                  p_enqueue_stamps_ = new moodycamel::ReaderWriterQueue<enqueue_stamp>(config_.default_queue_size_);
+              }
               LOG_RET_TRUE("success");
           } else if (config.broker_type_ == broker_config::broker_file) {
               LOG_DEBUG("Broker type is file");
               p_file = new connection_file(config_.output_directory_, config.id_, "", connection::conn_broker, true);
+              configure_segments(config);
               LOG_RET_TRUE("success");
           } else if (config.broker_type_ == broker_config::broker_queue_file) {
-              p_queue_ = new moodycamel::ReaderWriterQueue<std::string>(config.default_queue_size_);
+              p_queue_ = new moodycamel::ReaderWriterQueue<std::string>(config_.default_queue_size_);
               p_file = new connection_file(config.output_directory_, config.id_, "", connection::conn_broker, true);
-              run_queue_to_file_loop();
+              configure_segments(config);
+              LOG_RET("", run_queue_to_file_loop());
           } else {
               LOG_DEBUG("Broker type is direct");
               LOG_RET_TRUE("success");
@@ -59,6 +106,22 @@ namespace myq {
           LOG_RET_FALSE("Not supported");
       }
 
+      /**
+       * size and preallocation of the log segments, and their place on the broker data directories
+       * when the topic was given one
+       * @param config
+       */
+      void configure_segments(broker_config &config) {
+          if (config.segment_size_ > 0) {
+              p_file->set_max_file_size(config.segment_size_);
+          }
+          p_file->set_preallocate(config.preallocate_segments_);
+          p_file->set_fd_cache(p_fds_);
+          if (p_dirs_ && p_dirs_->size() > 0 && config.data_directory_ >= 0) {
+              p_file->set_data_directories(p_dirs_, config.data_directory_);
+          }
+      }
+
       /**
        * queue to file loop
        * @return
@@ -67,15 +130,28 @@ namespace myq {
           LOG_IN("");
           std::thread th = std::thread(
               [&] {
-                  std::string message;
-                  message.reserve(utils::max_msg_size);
+                  std::string messages[utils::max_batch_size];
+                  std::string records;
                   while (true) {
                       while (get_queue_size() <= 0) {
                           utils::sleep_ms(utils::queue_poll_wait);
                       }
-                      ssize_t bytes_read = get_message_from_queue(message);
-                      if (bytes_read > 0) {
-                          write_to_file(message, true);
+                      //everything committed so far goes to the log in one append
+                      unsigned count = get_messages_from_queue(messages, utils::max_batch_size);
+                      records.clear();
+                      for (unsigned i = 0; i < count; ++i) {
+                          uint32_t length = messages[i].length();
+                          records.append((const char *) &length, sizeof(length));
+                          records.append(messages[i]);
+                      }
+                      if (count > 0) {
+                          ssize_t bytes_written = p_file->write_records(records.data(), records.length(), count);
+                          if (bytes_written < 0) {
+                              LOG_ERROR("Failed to write %u messages to file", count);
+                          } else {
+                              total_bytes_written_ += bytes_written;
+                              note_file_appends(count);
+                          }
                       }
                   }
 
@@ -99,20 +175,27 @@ namespace myq {
       bool add_to_storage(const std::string &message, bool write_size = true) {
           LOG_IN("message: [%s],  message length: [%d], write_size[%d]",
                  message.c_str(), message.length(), write_size);
+          bool stored = false;
           if (config_.broker_type_ == broker_config::broker_direct) {
               LOG_DEBUG("Broker type is direct");
-              return direct_write_consumer(message);
+              stored = direct_write_consumer(message);
 
           } else if (config_.broker_type_ == broker_config::broker_queue ||
                      config_.broker_type_ == broker_config::broker_queue_file) {
               LOG_DEBUG("Broker type is queue");
-              return write_to_queue(message);
+              stored = write_to_queue(message);
           }
           else if (config_.broker_type_ == broker_config::broker_file) {
               LOG_DEBUG("Broker type is file");
-              return write_to_file(message, true);
+              stored = write_to_file(message, true);
           }
-          LOG_RET_FALSE("failed");
+          if (!stored) {
+              LOG_RET_FALSE("failed");
+          }
+          if (p_aggregator_) {
+              p_aggregator_->add(message.c_str(), message.length());
+          }
+          LOG_RET_TRUE("success");
 
       }
 
@@ -120,25 +203,80 @@ namespace myq {
       bool add_to_storage(const char *message, unsigned message_size, bool write_size = true) {
           LOG_IN("message: [%p],  message length: [%d], write_size[%d]",
                  message, message_size, write_size);
+          bool stored = false;
           if (config_.broker_type_ == broker_config::broker_direct) {
               LOG_DEBUG("Broker type is direct");
-              return direct_write_consumer(message, message_size);
+              stored = direct_write_consumer(message, message_size);
 
           } else if (config_.broker_type_ == broker_config::broker_queue ||
                      config_.broker_type_ == broker_config::broker_queue_file) {
               LOG_DEBUG("Broker type is queue");
               std::string msg(message, message_size);
-              return write_to_queue(std::move(msg));
+              stored = write_to_queue(std::move(msg));
           }
           else if (config_.broker_type_ == broker_config::broker_file) {
               LOG_DEBUG("Broker type is file");
-              return write_to_file(message, message_size, true);
+              stored = write_to_file(message, message_size, true);
           }
-          LOG_RET_FALSE("failed");
+          if (!stored) {
+              LOG_RET_FALSE("failed");
+          }
+          if (p_aggregator_) {
+              p_aggregator_->add(message, message_size);
+          }
+          LOG_RET_TRUE("success");
 
       }
 
 
+      /**
+       * add records of an atomic batch, packed as the log stores them ([uint32 length][payload] each).
+       * The batch lands contiguously and consumers see all of it or none of it
+       * @param records
+       * @param length
+       * @param count number of records
+       * @return
+       */
+      bool add_batch_to_storage(const char *records, unsigned length, unsigned count) {
+          LOG_IN("records[%p], length[%u], count[%u]", records, length, count);
+          if (!valid_batch(records, length, count)) {
+              LOG_RET_FALSE("Malformed batch");
+          }
+          bool stored = false;
+          if (config_.broker_type_ == broker_config::broker_direct) {
+              //written from this thread back to back, nothing can get in between
+              unsigned offset = 0;
+              for (unsigned i = 0; i < count; ++i) {
+                  uint32_t record_length;
+                  memcpy(&record_length, records + offset, sizeof(record_length));
+                  if (!direct_write_consumer(records + offset + sizeof(record_length), record_length)) {
+                      LOG_RET_FALSE("failure");
+                  }
+                  offset += sizeof(record_length) + record_length;
+              }
+              stored = true;
+          } else if (config_.broker_type_ == broker_config::broker_queue ||
+                     config_.broker_type_ == broker_config::broker_queue_file) {
+              stored = write_batch_to_queue(records, length, count);
+          } else if (config_.broker_type_ == broker_config::broker_file) {
+              ssize_t bytes_written = p_file->write_records(records, length, count);
+              if (bytes_written < 0) {
+                  LOG_ERROR("Failed to write batch to file");
+                  LOG_RET_FALSE("failed");
+              }
+              total_bytes_written_ += bytes_written;
+              note_file_appends(count);
+              stored = true;
+          }
+          if (!stored) {
+              LOG_RET_FALSE("failed");
+          }
+          if (p_aggregator_) {
+              p_aggregator_->add_records(records, length, count);
+          }
+          LOG_RET_TRUE("success");
+      }
+
       uint64_t get_total_bytes_read() {
           return total_bytes_read_;
       }
@@ -148,10 +286,13 @@ namespace myq {
       }
 
       /**
-       * read file and send to socket
-       * @return
+       * read next message from file
+       * @param p_payload set to the payload (record length prefix stripped), valid until next call
+       * @param seq set to the sequence number (1 based position in the log) of the message
+       * @param ntohl
+       * @return payload length, 0 if no data, < 0 on error
        */
-      ssize_t file_to_consumer(connection *p_consumer_socket, bool ntohl = false) {
+      ssize_t read_next_file_msg(const char *&p_payload, uint64_t &seq, bool ntohl = false) {
           LOG_IN("");
           assert(p_file);
           ssize_t result = 0;
@@ -159,42 +300,107 @@ namespace myq {
           if (get_file_total_bytes_written() + sizeof(uint32_t) <= get_total_bytes_read()) {
               LOG_RET("No data to read. return", 0);
           }
-          std::string message;
 
           buffer_[0] = '\0';
           result = p_file->read(buffer_, utils::max_msg_size, total_bytes_read_, ntohl);
-          // result = p_file->read_msg(message,total_bytes_read_, ntohl);
           if (result < 0) {
-              //   LOG_ERROR("Failed to read from the file : %s", p_file->get_current_file().c_str());
-              LOG_ERROR("Failed to read from offset %lld, total bytes written: %lld ", total_bytes_read_,
+              LOG_ERROR("Failed to read from offset %lld, total bytes written: %lld ", total_bytes_read_.load(),
                         get_file_total_bytes_written());
-
-              LOG_RET_FALSE("Failed to read from file");
-
+              LOG_RET("Failed to read from file", -1);
           }
-          buffer_[result + 1] = '\0'; //set end of string
-          total_bytes_read_ += result;
-          if (result > 0) {
-              if (p_consumer_socket_->get_stream_type() == connection::stream_type::stream_socket) {
-                  result = p_consumer_socket->write_msg(buffer_, result);
-              } else if (p_consumer_socket_->get_stream_type() == connection::stream_type::stream_zmq) {
-                  unsigned size_of_uint32 = sizeof(uint32_t);
-                  //for zmq, we need to remove the message length (first 4 bytes) and offset(last 4 bytes)
-                  result = p_consumer_socket->write_msg(
-                      &buffer_[size_of_uint32],
-                      result - size_of_uint32 - size_of_uint32);
-              }
+          if (result == 0) {
+              LOG_RET("No data to read. return", 0);
           }
+          total_bytes_read_ += result;
+          seq = ++file_read_seq_;
+          //zmq keeps message boundaries, so strip the record length prefix (first 4 bytes)
+          p_payload = &buffer_[sizeof(uint32_t)];
+          LOG_RET("success", result - sizeof(uint32_t));
+      }
+
+      /**
+       * reserve sequence numbers for messages published from the queue
+       * @param count
+       * @return first sequence number of the reserved range
+       */
+      inline uint64_t next_publish_seq(unsigned count) {
+          return publish_seq_.fetch_add(count) + 1;
+      }
 
-          if (result >= 0) {
-              LOG_RET("success", result);
+      /**
+       * record message as the latest value for its key, if the topic keeps a last value cache
+       * @param seq
+       * @param message
+       * @param length
+       */
+      inline void update_last_value(uint64_t seq, const char *message, unsigned length) {
+          if (p_lvc_ == NULL) {
+              return;
+          }
+          if (utils::get_message_key(message, length, config_.key_delimiter_, lvc_key_)) {
+              p_lvc_->update(lvc_key_, seq, message, length);
           } else {
-              //   LOG_ERROR("Failed to write to the consumer socket: %s", p_consumer_socket->topic().c_str());
-              LOG_RET("Failed to write to the consumer socket", result)
+              p_lvc_->advance(seq);
           }
+      }
+
+      /**
+       * get windowed aggregates, NULL if the topic has no aggregation rule
+       * @return
+       */
+      inline window_aggregator *get_aggregator() {
+          return p_aggregator_;
+      }
+
+      /**
+       * get last value cache, NULL if not enabled for the topic
+       * @return
+       */
+      inline last_value_cache *get_last_value_cache() {
+          return p_lvc_;
+      }
+
+      /**
+       * check publish of an idempotent producer against the producer window
+       * @param producer_id
+       * @param seq
+       * @return true if it is a retry of a message already stored
+       */
+      inline bool is_duplicate_producer_seq(uint64_t producer_id, uint64_t seq) {
+          return p_dedup_->is_duplicate(producer_id, seq);
+      }
+
+      /**
+       * record the sequence of a publish that was stored
+       * @param producer_id
+       * @param seq
+       */
+      inline void commit_producer_seq(uint64_t producer_id, uint64_t seq) {
+          p_dedup_->commit(producer_id, seq);
+      }
+
+      /**
+       * persist producer sequences accepted since the last call
+       */
+      inline void flush_producer_state() {
+          p_dedup_->flush();
+      }
 
+      /**
+       * number of retried publishes dropped
+       * @return
+       */
+      inline uint64_t get_duplicates_dropped() const {
+          return p_dedup_ ? p_dedup_->get_duplicates() : 0;
       }
 
+      /**
+       * last sequence number published to subscribers
+       * @return
+       */
+      inline uint64_t get_last_publish_seq() {
+          return p_file ? file_read_seq_.load() : publish_seq_.load();
+      }
 
       /**
        * writ
@@ -207,12 +413,92 @@ namespace myq {
           if (p_queue_->try_dequeue(message)) {
               LOG_DEBUG("Dequeue message :%s", message.c_str());
               ++total_dequeued_messages_;
+              release_memory(message.length());
               LOG_RET("success", message.length());
           }
           LOG_RET("", result);
 
       }
 
+      /**
+       * dequeue up to max_count messages
+       * @param messages
+       * @param max_count
+       * @return number of messages dequeued
+       */
+      unsigned get_messages_from_queue(std::string *messages, unsigned max_count) {
+          assert(p_queue_);
+          //stop at the last commit, the rest of a batch being enqueued is not visible yet
+          uint64_t committed = get_queue_size();
+          if (committed < max_count) {
+              max_count = committed;
+          }
+          unsigned count = 0;
+          uint64_t bytes = 0;
+          while (count < max_count && p_queue_->try_dequeue(messages[count])) {
+              bytes += messages[count].length();
+              ++count;
+          }
+          total_dequeued_messages_ += count;
+          release_memory(bytes);
+          return count;
+      }
+
+      /**
+       * bytes held in memory by the topic: buffers, queued messages and indexes
+       * @return
+       */
+      inline uint64_t get_memory_used() const {
+          return p_account_ ? p_account_->get_used() : 0;
+      }
+
+      inline uint64_t get_memory_fixed() const {
+          return p_account_ ? p_account_->fixed_.load() : 0;
+      }
+
+      inline uint64_t get_memory_queued() const {
+          return p_account_ ? p_account_->queued_.load() : 0;
+      }
+
+      inline uint64_t get_memory_indexes() const {
+          return p_account_ ? p_account_->indexes_.load() : 0;
+      }
+
+      inline uint64_t get_memory_quota() const {
+          return p_account_ ? p_account_->quota_ : 0;
+      }
+
+      /**
+       * number of messages the producer had to hold back until memory was available
+       * @return
+       */
+      inline uint64_t get_memory_throttled() const {
+          return p_account_ ? p_account_->throttled_.load() : 0;
+      }
+
+      /**
+       * record the time the producer thread took to store one received batch.
+       * Only called from the producer thread
+       * @param ns
+       */
+      void record_append_latency(uint64_t ns) {
+          int64_t avg = append_latency_avg_ns_.load(std::memory_order_relaxed);
+          // moving average over roughly the last 64 batches
+          avg = avg ? avg + ((int64_t)ns - avg) / 64 : ns;
+          append_latency_avg_ns_.store(avg, std::memory_order_relaxed);
+          if (ns > append_latency_max_ns_.load(std::memory_order_relaxed)) {
+              append_latency_max_ns_.store(ns, std::memory_order_relaxed);
+          }
+      }
+
+      inline uint64_t get_append_latency_avg_ns() const {
+          return append_latency_avg_ns_.load(std::memory_order_relaxed);
+      }
+
+      inline uint64_t get_append_latency_max_ns() const {
+          return append_latency_max_ns_.load(std::memory_order_relaxed);
+      }
+
       inline uint64_t get_total_dequeued_messages() {
           return total_dequeued_messages_;
       }
@@ -221,6 +507,24 @@ namespace myq {
           return total_enqueued_messages_;
       }
 
+      /**
+       * when the oldest message still in the queue was enqueued. Only kept for queue topics with a
+       * latency target, and only called by the thread dequeuing
+       * @return nanoseconds, 0 if unknown
+       */
+      uint64_t get_oldest_enqueue_ns() {
+          if (!p_enqueue_stamps_) {
+              return 0;
+          }
+          enqueue_stamp *p_front = p_enqueue_stamps_->peek();
+          //drop commits whose messages were all dequeued; the next one holds the head of the queue
+          while (p_front && p_front->first <= total_dequeued_messages_) {
+              p_enqueue_stamps_->pop();
+              p_front = p_enqueue_stamps_->peek();
+          }
+          return p_front ? p_front->second : 0;
+      }
+
       inline uint64_t get_queue_size() {
           //  LOG_IN("");
           // LOG_RET("%lld", );
@@ -235,12 +539,22 @@ namespace myq {
           }
       }
 
-      inline void set_consumer_socket(connection *p_socket) {
+      /**
+       * set consumer connection used by broker type direct
+       * @param p_socket
+       */
+      template <typename Connection>
+      inline void set_consumer_socket(Connection *p_socket) {
           LOG_IN("p_socket[%p]", p_socket);
-          p_consumer_socket_ = p_socket;
+          p_direct_consumer_ = p_socket;
+          direct_write_ = &transport<Connection>::send_thunk;
           LOG_OUT("");
       }
 
+      inline const broker_config &get_config() const {
+          return config_;
+      }
+
       inline broker_config::broker_type get_broker_type() {
           return config_.broker_type_;
       }
@@ -251,62 +565,205 @@ namespace myq {
           return 0;
       }
 
+      inline uint64_t get_segment_cache_hits() const {
+          return p_file ? p_file->get_segment_cache_hits() : 0;
+      }
+
+      inline uint64_t get_segment_cache_misses() const {
+          return p_file ? p_file->get_segment_cache_misses() : 0;
+      }
+
       inline connection_file *get_file_connection() {
           return p_file;
       }
 
   private:
 
-      bool direct_write_consumer(const std::string &message) {
-          LOG_IN("");
-          if (p_consumer_socket_ == NULL) {
-              LOG_ERROR("Consumer socket must be set for broker type direct");
-              LOG_RET_FALSE("invalid initialization");
+      /**
+       * size the preallocated queue to the topic quota and charge the topic buffers
+       * @param config
+       * @return false if the broker has no room for the topic
+       */
+      bool open_memory_account(const broker_config &config) {
+          LOG_IN("quota[%llu]", config.memory_quota_);
+          bool queue = config.broker_type_ == broker_config::broker_queue ||
+                       config.broker_type_ == broker_config::broker_queue_file;
+          bool file = config.broker_type_ == broker_config::broker_file ||
+                      config.broker_type_ == broker_config::broker_queue_file;
+          //empty queue slots may take at most a quarter of the quota, the rest is for messages
+          uint64_t max_slots = config.memory_quota_ / 4 / sizeof(std::string);
+          if (config.memory_quota_ && config_.default_queue_size_ > max_slots) {
+              config_.default_queue_size_ = max_slots > 0 ? max_slots : 1;
           }
-          ssize_t bytes_written = p_consumer_socket_->write_msg(message);
-          if (bytes_written < 0) {
-              LOG_ERROR("Failed to write to consumer connection id: %s, consumer_bind_uri: %s",
-                        config_.id_.c_str(), p_consumer_socket_->get_resource_uri_().c_str());
-              LOG_RET_FALSE("failure");
+          uint64_t fixed = sizeof(buffer_);
+          if (queue) {
+              fixed += (uint64_t) config_.default_queue_size_ * sizeof(std::string);
           }
-          total_bytes_written_ += bytes_written;
-          LOG_RET_TRUE("success");
+          if (file) {
+              fixed += utils::max_msg_size; //read buffer of the log
+          }
+          p_account_ = p_memory_->open_account(config.id_, config.memory_quota_, fixed);
+          if (p_account_ == NULL) {
+              LOG_RET_FALSE("refused");
+          }
+          LOG_RET_TRUE("");
+      }
+
+      /**
+       * charge a message to the topic, holding the producer back while it doesn't fit
+       * @param bytes
+       */
+      void charge_memory(uint64_t bytes) {
+          if (p_account_ == NULL || p_memory_->try_charge(p_account_, bytes)) {
+              return;
+          }
+          ++p_account_->throttled_;
+          LOG_WARN("Topic[%s] is out of memory (%llu bytes used, broker %llu of %llu). Throttling producer",
+                   config_.id_.c_str(), p_account_->get_used(), p_memory_->get_used(), p_memory_->get_limit());
+          while (!p_memory_->try_charge(p_account_, bytes)) {
+              utils::sleep_ms(utils::queue_poll_wait);
+          }
+      }
+
+      inline void release_memory(uint64_t bytes) {
+          if (p_account_ && bytes) {
+              p_memory_->release(p_account_, bytes);
+          }
+      }
+
+      /**
+       * count records appended to the log, re-reading the index size whenever it may have grown
+       * @param count
+       */
+      inline void note_file_appends(unsigned count) {
+          uint64_t before = file_appends_;
+          file_appends_ += count;
+          if (p_account_ && before / index_check_interval_ != file_appends_ / index_check_interval_) {
+              p_memory_->set_indexes(p_account_, p_file->get_index_bytes());
+          }
+      }
+
+      bool direct_write_consumer(const std::string &message) {
+          LOG_IN("");
+          return direct_write_consumer(message.c_str(), message.length());
       }
 
       bool direct_write_consumer(const char *message, unsigned message_len) {
           LOG_IN("message[%p],message_len[%u]", message, message_len);
-          if (p_consumer_socket_ == NULL) {
+          if (p_direct_consumer_ == NULL) {
               LOG_ERROR("Consumer socket must be set for broker type direct");
               LOG_RET_FALSE("invalid initialization");
           }
-          ssize_t bytes_written = p_consumer_socket_->write_msg(message, message_len);
+          ssize_t bytes_written = direct_write_(p_direct_consumer_, message, message_len);
           if (bytes_written < 0) {
-              LOG_ERROR("Failed to write to consumer connection id: %s, consumer_bind_uri: %s",
-                        config_.id_.c_str(), p_consumer_socket_->get_resource_uri_().c_str());
+              LOG_ERROR("Failed to write to consumer connection id: %s", config_.id_.c_str());
               LOG_RET_FALSE("failure");
           }
           total_bytes_written_ += bytes_written;
           LOG_RET_TRUE("success");
       }
 
+      /**
+       * record the time of the commit just made, for get_oldest_enqueue_ns
+       */
+      inline void stamp_enqueue() {
+          if (p_enqueue_stamps_) {
+              p_enqueue_stamps_->enqueue(enqueue_stamp(total_enqueued_messages_.load(std::memory_order_relaxed),
+                                                       utils::get_currenttime_nanoseconds()));
+          }
+      }
+
       bool write_to_queue(const std::string &message) {
           LOG_IN("message: %u", message.length());
+          charge_memory(message.length());
           while (!p_queue_->try_enqueue(message)) {
               utils::sleep_ms(utils::queue_poll_wait);
               LOG_TRACE("Retrying to enqueue message");
           }
           ++total_enqueued_messages_;
+          stamp_enqueue();
           total_bytes_written_ += message.length();
-          LOG_DEBUG("message  enqueue. Total messages in the queue: %lld ", total_enqueued_messages_);
+          LOG_DEBUG("message  enqueue. Total messages in the queue: %lld ", total_enqueued_messages_.load());
           LOG_RET_TRUE("enqueued message");
       }
 
+      /**
+       * reserve room for the whole batch, enqueue it, then commit it with a single counter update.
+       * Nothing is enqueued unless all of it fits, since the queue can't take back records it was given
+       * @param records
+       * @param length
+       * @param count
+       * @return false if the batch is larger than the queue
+       */
+      bool write_batch_to_queue(const char *records, unsigned length, unsigned count) {
+          LOG_IN("records[%p], count[%u]", records, count);
+          if (count > config_.default_queue_size_) {
+              LOG_ERROR("Batch of %u messages is larger than the queue of topic[%s] (%u)",
+                        count, config_.id_.c_str(), config_.default_queue_size_);
+              LOG_RET_FALSE("too large");
+          }
+          //an uncommitted batch can't be dequeued, so it must not wait on a full queue half way. The queue
+          //holds no more than the committed messages, so with this room every try_enqueue below succeeds
+          while (get_queue_size() + count > config_.default_queue_size_) {
+              utils::sleep_ms(utils::queue_poll_wait);
+              LOG_TRACE("Waiting for room to enqueue batch");
+          }
+          charge_memory(length - count * sizeof(uint32_t));
+          unsigned offset = 0;
+          uint64_t bytes = 0;
+          for (unsigned i = 0; i < count; ++i) {
+              uint32_t record_length;
+              memcpy(&record_length, records + offset, sizeof(record_length));
+              std::string message(records + offset + sizeof(record_length), record_length);
+              if (!p_queue_->try_enqueue(std::move(message))) {
+                  //room was reserved, so only a broken queue gets here. What was enqueued can't be taken
+                  //back: commit it rather than let the next batch pick it up, and free the rest
+                  LOG_ERROR("Failed to enqueue batch message %u of %u on topic[%s]", i, count, config_.id_.c_str());
+                  total_enqueued_messages_ += i;
+                  stamp_enqueue();
+                  total_bytes_written_ += bytes;
+                  release_memory(length - count * sizeof(uint32_t) - bytes);
+                  LOG_RET_FALSE("failed");
+              }
+              offset += sizeof(record_length) + record_length;
+              bytes += record_length;
+          }
+          total_enqueued_messages_ += count;
+          stamp_enqueue();
+          total_bytes_written_ += bytes;
+          LOG_RET_TRUE("enqueued batch");
+      }
+
+      /**
+       * check that records are well formed and exactly fill the batch
+       * @param records
+       * @param length
+       * @param count
+       * @return
+       */
+      static bool valid_batch(const char *records, unsigned length, unsigned count) {
+          uint64_t offset = 0;
+          for (unsigned i = 0; i < count; ++i) {
+              if (offset + sizeof(uint32_t) > length) {
+                  return false;
+              }
+              uint32_t record_length;
+              memcpy(&record_length, records + offset, sizeof(record_length));
+              if (record_length > utils::max_msg_size) {
+                  return false;
+              }
+              offset += sizeof(record_length) + record_length;
+          }
+          return count > 0 && offset == length;
+      }
+
       bool write_to_file(const std::string &message, bool write_size) {
           ssize_t bytes_written = p_file->write_to_file(message, write_size);
           if (bytes_written > 0) {
               LOG_INFO("message  written to file ");
               LOG_DEBUG("%d bytes written to file", bytes_written);
               total_bytes_written_ += bytes_written;
+              note_file_appends(1);
               LOG_RET_TRUE("success")
           } else {
               LOG_ERROR("Failed to write to file");
@@ -321,6 +778,7 @@ namespace myq {
               LOG_INFO("message  written to file ");
               LOG_DEBUG("%d bytes written to file", bytes_written);
               total_bytes_written_ += bytes_written;
+              note_file_appends(1);
               LOG_RET_TRUE("success")
           } else {
               LOG_ERROR("Failed to write to file");
@@ -329,15 +787,34 @@ namespace myq {
       }
 
 
+      static const unsigned index_check_interval_ = 64;
+
       broker_config config_;
+      memory_manager *p_memory_;
+      memory_manager::account *p_account_;
+      data_directories *p_dirs_;
+      fd_cache *p_fds_; //broker wide bound on open sealed segments, NULL to keep them all open
 
       moodycamel::ReaderWriterQueue<std::string> *p_queue_;
+      typedef std::pair<uint64_t, uint64_t> enqueue_stamp; //messages enqueued after a commit, time of the commit
+      moodycamel::ReaderWriterQueue<enqueue_stamp> *p_enqueue_stamps_; //latency target only, see get_oldest_enqueue_ns
       connection_file *p_file;
-      connection *p_consumer_socket_;
-      uint64_t total_enqueued_messages_;
+      //broker type direct: consumer connection and its statically bound send function
+      void *p_direct_consumer_;
+      ssize_t (*direct_write_)(void *p_conn, const char *message, unsigned length);
+      std::atomic<uint64_t> total_enqueued_messages_; //commit point: messages past it are not visible to consumers
       uint64_t total_dequeued_messages_;
       uint64_t total_bytes_written_;
-      uint64_t total_bytes_read_;
+      std::atomic<uint64_t> total_bytes_read_;
+      std::atomic<uint64_t> file_read_seq_; //seq of the last message read from the file log
+      std::atomic<uint64_t> publish_seq_;   //seq of the last message published from the queue
+      last_value_cache *p_lvc_;
+      std::string lvc_key_;
+      producer_dedup *p_dedup_;
+      window_aggregator *p_aggregator_;
+      uint64_t file_appends_;
+      std::atomic<int64_t> append_latency_avg_ns_;
+      std::atomic<uint64_t> append_latency_max_ns_;
       char buffer_[utils::max_msg_size]; //128*1024
       std::thread queue_to_file_thread_;
 
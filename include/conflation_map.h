@@ -0,0 +1,104 @@
+/*
+ * File:   conflation_map.h
+ *
+ *
+ * Created on October 19, 2026, 2:35 PM
+ */
+
+#ifndef CONFLATION_MAP_H
+#define CONFLATION_MAP_H
+
+#include <atomic>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+namespace myq
+{
+
+    /**
+     * conflation_map
+     * Backlog of a slow consumer, one pending message per key. A newer message for a key that is
+     * already waiting replaces it in place, so the key keeps its turn and the backlog never grows
+     * past the number of distinct keys. Keys are delivered in the order they first became pending.
+     * Only used by the consumer thread; the conflated counter may be read from anywhere.
+     */
+    class conflation_map
+    {
+    public:
+        conflation_map() : conflated_(0)
+        {
+        }
+
+        /**
+         * queue message for key, replacing any pending one
+         * @param key
+         * @param message
+         * @param length
+         */
+        void put(const std::string &key, const char *message, unsigned length)
+        {
+            std::unordered_map<std::string, std::list<slot>::iterator>::iterator it = index_.find(key);
+            if (it != index_.end())
+            {
+                it->second->message_.assign(message, length);
+                ++conflated_;
+                return;
+            }
+            order_.push_back(slot());
+            order_.back().key_ = key;
+            order_.back().message_.assign(message, length);
+            index_[key] = --order_.end();
+        }
+
+        /**
+         * oldest pending message
+         * @return
+         */
+        inline const std::string &front() const
+        {
+            return order_.front().message_;
+        }
+
+        /**
+         * drop oldest pending message
+         */
+        void pop_front()
+        {
+            index_.erase(order_.front().key_);
+            order_.pop_front();
+        }
+
+        inline bool empty() const
+        {
+            return order_.empty();
+        }
+
+        inline size_t size() const
+        {
+            return index_.size();
+        }
+
+        /**
+         * number of messages replaced by a newer one before delivery
+         * @return
+         */
+        inline uint64_t get_conflated() const
+        {
+            return conflated_.load();
+        }
+
+    private:
+        struct slot
+        {
+            std::string key_;
+            std::string message_;
+        };
+
+        std::list<slot> order_;
+        std::unordered_map<std::string, std::list<slot>::iterator> index_;
+        std::atomic<uint64_t> conflated_;
+    };
+}
+
+#endif /* CONFLATION_MAP_H */
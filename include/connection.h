@@ -22,8 +22,17 @@ namespace myq {
           stream_zmq,
           stream_nanomsg,
           stream_file,
-          stream_socket
+          stream_socket,
+          stream_multicast
       };
+      //producer id and per producer sequence of an idempotent publish, producer_id_ 0 for plain messages.
+      //batch_count_ is the number of records packed in an atomic batch (seq_ is the first one's), 0 for a single message
+      struct producer_stamp {
+          uint64_t producer_id_;
+          uint64_t seq_;
+          uint32_t batch_count_;
+      };
+
       //endpoint type
       enum endpoint_type {
           conn_consumer,
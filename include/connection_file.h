@@ -10,6 +10,9 @@
 
 #include <cstdio>
 #include <vector>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -26,12 +29,15 @@
 
 #include "connection.h"
 #include "file_details.h"
+#include "data_directories.h"
+#include "io_thread.h"
+#include "fd_cache.h"
 
 namespace myq {
 
   //class connection type file
 
-  class connection_file : public connection {
+  class connection_file final : public connection {
   public:
 
       /**
@@ -58,8 +64,17 @@ namespace myq {
           total_bytes_writen_ = 0;
           msg_counter_ = 0;
           max_file_size_ = 2000000000; //fixme config option
-          file_fds_.reserve(10); //fixme config option
-
+          segment_count_ = 0;
+          std::fill(segment_chunks_, segment_chunks_ + max_segment_chunks_, static_cast<file_details **>(NULL));
+          p_dirs_ = NULL;
+          first_dir_ = 0;
+          preallocate_ = false;
+          p_next_segment_ = NULL;
+          next_segment_index_ = 0;
+          next_segment_pending_ = false;
+          p_fd_cache_ = NULL;
+          segment_cache_hits_ = 0;
+          segment_cache_misses_ = 0;
       }
 
       /**
@@ -85,10 +100,27 @@ namespace myq {
        */
       ~connection_file() {
           LOG_IN("");
+          file_details *p_next = take_next_segment(current_fd_index_ + 1);
+          if (p_next) {
+              //never written, don't leave an empty (or preallocated) file behind
+              p_next->close();
+              unlink(p_next->file_name_.c_str());
+              delete p_next;
+          }
+          if (preallocate_ && get_segment_count() > current_fd_index_) {
+              file_details *p_current = segment(current_fd_index_);
+              if (ftruncate(p_current->fd_, p_current->offset_) != 0) {
+                  LOG_ERROR("Failed to trim file[%s]. Err: %d, ErrDesc: %s",
+                            p_current->file_name_.c_str(), errno, strerror(errno));
+              }
+          }
           close_all();
-          for (unsigned i = 0; i < file_fds_.size(); ++i) {
-              file_fds_[i]->close();
-              delete file_fds_[i];
+          for (unsigned i = 0; i < get_segment_count(); ++i) {
+              segment(i)->close();
+              delete segment(i);
+          }
+          for (unsigned i = 0; i < max_segment_chunks_ && segment_chunks_[i]; ++i) {
+              delete[] segment_chunks_[i];
           }
           LOG_OUT("");
       }
@@ -101,7 +133,7 @@ namespace myq {
       inline uint64_t get_total_bytes_writen() const {
           // LOG_IN("");
           // LOG_RET("", (unsigned long long)total_bytes_writen_);
-          return total_bytes_writen_;
+          return total_bytes_writen_.load(std::memory_order_acquire);
       }
 
       /**
@@ -114,13 +146,111 @@ namespace myq {
           LOG_OUT("");
       }
 
+      /**
+       * reserve the full segment size on disk when a segment is created, so appends never wait
+       * for the file system to allocate blocks. A segment is trimmed to its records once it is full
+       * @param preallocate
+       */
+      inline void set_preallocate(bool preallocate) {
+          LOG_IN("preallocate[%d]", preallocate);
+          preallocate_ = preallocate;
+          LOG_OUT("");
+      }
+
+      /**
+       * place segments on the broker data directories instead of directory
+       * @param p_dirs
+       * @param first_dir directory of the first segment; with stripe_segments placement the
+       * following segments go to the next directories in turn
+       */
+      inline void set_data_directories(data_directories *p_dirs, unsigned first_dir) {
+          LOG_IN("p_dirs[%p], first_dir[%u]", p_dirs, first_dir);
+          p_dirs_ = p_dirs;
+          first_dir_ = first_dir;
+          LOG_OUT("");
+      }
+
+      /**
+       * let the broker fd cache close sealed segments that aren't being read, instead of keeping
+       * every segment open
+       * @param p_cache
+       */
+      inline void set_fd_cache(fd_cache *p_cache) {
+          LOG_IN("p_cache[%p]", p_cache);
+          p_fd_cache_ = p_cache;
+          LOG_OUT("");
+      }
+
+      /**
+       * reads of sealed segments whose fd was open
+       * @return
+       */
+      inline uint64_t get_segment_cache_hits() const {
+          return segment_cache_hits_.load(std::memory_order_relaxed);
+      }
+
+      /**
+       * reads of sealed segments that had to reopen the file
+       * @return
+       */
+      inline uint64_t get_segment_cache_misses() const {
+          return segment_cache_misses_.load(std::memory_order_relaxed);
+      }
+
       /**
        * get message counter
        * @return
        */
       inline uint64_t get_msg_counter() {
           LOG_IN("");
-          LOG_RET("", msg_counter_);
+          LOG_RET("", msg_counter_.load(std::memory_order_acquire));
+      }
+
+      /**
+       * memory held by the seq and time indexes
+       * @return
+       */
+      uint64_t get_index_bytes() {
+          uint64_t bytes = 0;
+          {
+              std::lock_guard<std::mutex> lock(seq_index_mutex_);
+              bytes += seq_index_.capacity() * sizeof(uint64_t);
+          }
+          std::lock_guard<std::mutex> lock(time_index_mutex_);
+          for (unsigned i = 0; i < get_segment_count(); ++i) {
+              bytes += segment(i)->time_index_.capacity() * sizeof(file_details::time_index_entry);
+          }
+          return bytes;
+      }
+
+      /**
+       * Read log bytes as stored (records with their length prefix) from offset, up to the end of the
+       * segment holding it. Records never span segments, so a read ends on a record boundary unless
+       * the buffer fills first
+       * @param buffer
+       * @param size_of_buffer
+       * @param offset
+       * @return bytes read, 0 if offset is at the end of the log, < 0 on error
+       */
+      ssize_t read_bytes(char *buffer, uint32_t size_of_buffer, uint64_t offset) {
+          LOG_IN("buffer: %p, size_of_buffer :%u, offset:%llu", buffer, size_of_buffer, offset);
+          if (offset >= total_bytes_writen_.load(std::memory_order_acquire)) {
+              LOG_RET("No data to read", 0);
+          }
+          for (unsigned i = 0; i < get_segment_count(); ++i) {
+              uint64_t segment_end = segment(i)->bytes_written_across_all_files_.load(std::memory_order_acquire);
+              if (offset >= segment_end) {
+                  continue;
+              }
+              uint64_t segment_start = i > 0 ? segment(i - 1)->bytes_written_across_all_files_.load() : 0;
+              uint64_t length = std::min<uint64_t>(size_of_buffer, segment_end - offset);
+              fd_cache::lease lease(p_fd_cache_, segment(i));
+              if (!count_lease(lease, i)) {
+                  LOG_RET("failed", -1);
+              }
+              LOG_RET("", segment(i)->read_buffer(buffer, size_of_buffer, length, offset - segment_start));
+          }
+          LOG_RET("No data to read", 0);
       }
 
       /**
@@ -134,25 +264,29 @@ namespace myq {
       ssize_t read(char *buffer, uint32_t size_of_buffer, uint64_t offset, bool ntohl = false) {
           LOG_IN("buffer: %p, size_of_buffer :%u, offset:%llu, ntohl: %d",
                  buffer, size_of_buffer, offset, ntohl);
-          if (file_fds_.size() == 0) {
+          if (get_segment_count() == 0) {
               LOG_DEBUG("No data available to read. try later");
               LOG_RET("Try again", 0);
           }
           LOG_EVENT("Reading from file offset[%llu]", offset);
           uint64_t offset_currentfile = offset;
-          for (unsigned i = 0; i < file_fds_.size(); ++i) {
-              if (offset >= file_fds_[i]->bytes_written_across_all_files_) {
+          for (unsigned i = 0; i < get_segment_count(); ++i) {
+              if (offset >= segment(i)->bytes_written_across_all_files_) {
 
-                  //    offset_currentfile -= file_fds_[i]->bytes_written_across_all_files_;
+                  //    offset_currentfile -= segment(i)->bytes_written_across_all_files_;
                   LOG_ERROR("Skipping the fd index [%d], offset_currentfile[%llu]", i, offset_currentfile);
                   continue; //offset is larger than total bytes written to this file. move to next
               }
               if (i > 0) {
-                  offset_currentfile -= file_fds_[i - 1]->bytes_written_across_all_files_;
+                  offset_currentfile -= segment(i - 1)->bytes_written_across_all_files_;
               }
               LOG_TRACE("reading from offset: %llu", offset_currentfile);
               //FIXME: calculate per file offset from global read offset
-              ssize_t bytes_read = file_fds_[i]->read_msg(buffer, size_of_buffer, offset_currentfile, ntohl);
+              fd_cache::lease lease(p_fd_cache_, segment(i));
+              if (!count_lease(lease, i)) {
+                  LOG_RET("failed", -1);
+              }
+              ssize_t bytes_read = segment(i)->read_msg(buffer, size_of_buffer, offset_currentfile, ntohl);
               if (bytes_read > 0) {
                   LOG_TRACE("Message read with size: %d", bytes_read);
                   LOG_RET("Success", bytes_read);
@@ -161,6 +295,87 @@ namespace myq {
           LOG_RET("Error", -1);
       }
 
+      /**
+       * Read message by sequence number (1 based position in the log)
+       * @param seq
+       * @param buffer
+       * @param size_of_buffer
+       * @return bytes read including the length prefix, 0 if seq is not in the log
+       */
+      ssize_t read_by_seq(uint64_t seq, char *buffer, uint32_t size_of_buffer) {
+          LOG_IN("seq[%llu], buffer[%p], size_of_buffer[%u]", seq, buffer, size_of_buffer);
+          if (seq == 0 || seq > msg_counter_.load(std::memory_order_acquire)) {
+              LOG_RET("seq not in the log", 0);
+          }
+          int64_t offset = find_offset_by_seq(seq);
+          if (offset < 0) {
+              LOG_RET("seq not indexed", 0);
+          }
+          LOG_RET("", read(buffer, size_of_buffer, offset));
+      }
+
+      /**
+       * Find the offset of a message by sequence number (1 based position in the log)
+       * @param seq
+       * @return offset in the log, total bytes written for the next seq to be written, -1 if not in the log
+       */
+      int64_t find_offset_by_seq(uint64_t seq) {
+          LOG_IN("seq[%llu]", seq);
+          //the counter is published last, so every record up to it is readable; the next seq is
+          //found by walking past the last one rather than from the total, which may already be ahead
+          uint64_t counter = msg_counter_.load(std::memory_order_acquire);
+          if (seq == 0 || seq > counter + 1) {
+              LOG_RET("seq not in the log", -1);
+          }
+          uint64_t offset = 0;
+          uint64_t slot = (seq - 1) / seq_index_interval_;
+          {
+              std::lock_guard<std::mutex> lock(seq_index_mutex_);
+              if (seq_index_.empty()) {
+                  LOG_RET("empty log", 0);
+              }
+              if (slot >= seq_index_.size()) {
+                  slot = seq_index_.size() - 1; //next seq starts a slot not indexed yet
+              }
+              offset = seq_index_[slot];
+          }
+          //walk the length prefixes from the nearest index entry
+          for (uint64_t i = slot * seq_index_interval_; i < seq - 1; ++i) {
+              ssize_t length = read_length(offset);
+              if (length < 0) {
+                  LOG_RET("Failed to read length", -1);
+              }
+              offset += sizeof(uint32_t) + length;
+          }
+          LOG_RET("", (int64_t) offset);
+      }
+
+      /**
+       * Find where to start reading to get the records appended at or after the given time.
+       * The time index is sparse, so the offset may be up to time_index_interval_ms_ earlier
+       * @param timestamp_ms milliseconds since epoch
+       * @return offset in the log, total bytes written if nothing was appended since timestamp_ms
+       */
+      uint64_t find_offset_by_time(uint64_t timestamp_ms) {
+          LOG_IN("timestamp_ms[%llu]", timestamp_ms);
+          std::lock_guard<std::mutex> lock(time_index_mutex_);
+          for (unsigned i = 0; i < get_segment_count(); ++i) {
+              const std::vector<file_details::time_index_entry> &index = segment(i)->time_index_;
+              if (index.empty() || index.back().timestamp_ + time_index_interval_ms_ <= timestamp_ms) {
+                  continue; //whole segment was appended before timestamp_ms
+              }
+              //records of an entry were appended within time_index_interval_ms_ of its timestamp,
+              //so start at the first entry that may hold a record at or after timestamp_ms
+              std::vector<file_details::time_index_entry>::const_iterator it = std::upper_bound(
+                  index.begin(), index.end(), timestamp_ms,
+                  [](uint64_t timestamp, const file_details::time_index_entry &entry) {
+                      return timestamp < entry.timestamp_ + time_index_interval_ms_;
+                  });
+              LOG_RET("", it->offset_);
+          }
+          LOG_RET("nothing appended since", total_bytes_writen_.load());
+      }
+
       /**
        * write string to the file
        * @param msg
@@ -171,16 +386,17 @@ namespace myq {
           if (!set_current_file()) {
               LOG_RET("failed", -1);
           }
-
-
-          int bytes_written = file_fds_[current_fd_index_]->write_msg(msg, write_msg_size, include_offset);
-          if (bytes_written > 0) {
-              msg_counter_++;
-              total_bytes_writen_ += bytes_written;
-              file_fds_[current_fd_index_]->bytes_written_across_all_files_ = total_bytes_writen_;
-              LOG_RET("Success: ", bytes_written);
+          file_details *p_current = segment(current_fd_index_);
+          uint64_t start = p_current->offset_;
+          ssize_t bytes_written = p_current->write_msg(msg, write_msg_size, include_offset);
+          if (bytes_written != (ssize_t) record_size(msg.length(), write_msg_size, include_offset)) {
+              rollback_append(p_current, start);
+              LOG_RET("Error: ", -1);
           }
-          LOG_RET("Error: ", bytes_written);
+          update_seq_index();
+          update_time_index();
+          publish_append(bytes_written, 1);
+          LOG_RET("Success: ", bytes_written);
       }
 
 
@@ -194,16 +410,57 @@ namespace myq {
           bool include_offset = false) {
           LOG_IN("msg[%p], msg_len[%u], write_msg_size[%d], include_offset[%d]",
                  msg, msg_len, write_msg_size, include_offset);
-          set_current_file();
+          if (!set_current_file()) {
+              LOG_RET("failed", -1);
+          }
+          file_details *p_current = segment(current_fd_index_);
+          uint64_t start = p_current->offset_;
+          ssize_t bytes_written = p_current->write_msg(msg, msg_len, write_msg_size, include_offset);
+          if (bytes_written != (ssize_t) record_size(msg_len, write_msg_size, include_offset)) {
+              rollback_append(p_current, start);
+              LOG_RET("Error: ", -1);
+          }
+          update_seq_index();
+          update_time_index();
+          publish_append(bytes_written, 1);
+          LOG_RET("Success: ", bytes_written);
+      }
 
-          int bytes_written = file_fds_[current_fd_index_]->write_msg(msg, msg_len, write_msg_size, include_offset);
-          if (bytes_written > 0) {
-              msg_counter_++;
-              total_bytes_writen_ += bytes_written;
-              file_fds_[current_fd_index_]->bytes_written_across_all_files_ = total_bytes_writen_;
-              LOG_RET("Success: ", bytes_written);
+      /**
+       * Append records already packed as the log stores them ([uint32 length][payload] each) with one write.
+       * Readers go by total bytes written, so they see either none or all of the records
+       * @param records
+       * @param length
+       * @param count number of records
+       * @return bytes written, -1 on error
+       */
+      ssize_t write_records(const char *records, unsigned length, unsigned count) {
+          LOG_IN("records[%p], length[%u], count[%u]", records, length, count);
+          if (!set_current_file()) {
+              LOG_RET("failed", -1);
+          }
+          file_details *p_current = segment(current_fd_index_);
+          uint64_t start = p_current->offset_;
+          ssize_t bytes_written = p_current->write_buffer(records, length);
+          if (bytes_written != (ssize_t) length) {
+              rollback_append(p_current, start);
+              LOG_RET("Error: ", -1);
           }
-          LOG_RET("Error: ", bytes_written);
+          p_current->write_counter_ += count;
+          update_time_index();
+          //index slots starting inside the batch point at their record
+          uint64_t offset = 0;
+          for (unsigned i = 0; i < count; ++i) {
+              if ((msg_counter_.load(std::memory_order_relaxed) + i) % seq_index_interval_ == 0) {
+                  std::lock_guard<std::mutex> lock(seq_index_mutex_);
+                  seq_index_.push_back(total_bytes_writen_.load(std::memory_order_relaxed) + offset);
+              }
+              uint32_t record_length;
+              memcpy(&record_length, records + offset, sizeof(record_length));
+              offset += sizeof(record_length) + record_length;
+          }
+          publish_append(bytes_written, count);
+          LOG_RET("Success: ", bytes_written);
       }
 
       /**
@@ -219,7 +476,7 @@ namespace myq {
           for (unsigned i = 0; i < size; ++i) {
               buffer.append(values[i]);
           }
-          if (!write_to_file(buffer)) {
+          if (write_to_file(buffer) <= 0) {
               LOG_RET_FALSE("Error");
           }
           LOG_RET_TRUE("Success");
@@ -233,33 +490,40 @@ namespace myq {
        * @param size
        * @return
        */
-      ssize_t send_file(int fd, uint64_t offset, uint32_t size) {
-          LOG_IN("fd[%d], offset[%u], size[%u]", fd, offset, size);
-          if (offset >= (unsigned long long) total_bytes_writen_) {
+      ssize_t send_file(int fd, uint64_t offset, uint64_t size) {
+          LOG_IN("fd[%d], offset[%llu], size[%llu]", fd, offset, size);
+          if (offset >= total_bytes_writen_.load(std::memory_order_acquire)) {
               LOG_RET("No data to read ", 0);
           }
-          uint64_t offset_currentfile = offset;
-          for (unsigned i = 0; i < file_fds_.size(); ++i) {
-              LOG_DEBUG("file_fds_[%d]->offset_across_all_files_[%llu], offset[%llu]", i,
-                        file_fds_[i]->bytes_written_across_all_files_, offset);
-              if (offset >= file_fds_[i]->bytes_written_across_all_files_) {
-                  //    offset_currentfile -= file_fds_[i]->bytes_written_across_all_files_;
-                  LOG_DEBUG("Skipping the fd index [%d], offset_currentfile[%llu]", i, offset_currentfile);
+          // a transfer runs on into the next segment until size is sent or the socket is full
+          uint64_t total_sent = 0;
+          for (unsigned i = 0; i < get_segment_count() && total_sent < size; ++i) {
+              uint64_t current = offset + total_sent;
+              LOG_DEBUG("segments[%d]->offset_across_all_files_[%llu], offset[%llu]", i,
+                        segment(i)->bytes_written_across_all_files_.load(), current);
+              if (current >= segment(i)->bytes_written_across_all_files_) {
                   continue; //offset is larger than total bytes written to this file. move to next
               }
+              uint64_t offset_currentfile = current;
               if (i > 0) {
-                  offset_currentfile -= file_fds_[i - 1]->bytes_written_across_all_files_;
+                  offset_currentfile -= segment(i - 1)->bytes_written_across_all_files_;
               }
-              LOG_DEBUG("Sending file from offset %llu for size %llu ", offset_currentfile, size);
-              ssize_t bytes_read = file_fds_[i]->send_file(fd, offset_currentfile, size);
-              if (bytes_read > 0) {
-
-                  LOG_RET("Success", bytes_read);
-              } else {
+              uint64_t remaining = size - total_sent;
+              LOG_DEBUG("Sending file from offset %llu for size %llu ", offset_currentfile, remaining);
+              fd_cache::lease lease(p_fd_cache_, segment(i));
+              ssize_t bytes_sent = count_lease(lease, i) ? segment(i)->send_file(fd, offset_currentfile, remaining) : -1;
+              if (bytes_sent < 0) {
+                  if (total_sent > 0) {
+                      break;
+                  }
                   LOG_RET("failed", -1);
               }
+              total_sent += bytes_sent;
+              if (offset + total_sent < segment(i)->bytes_written_across_all_files_) {
+                  break; // socket is full (or segment still growing)
+              }
           }
-          LOG_RET("", 0);
+          LOG_RET("", total_sent);
       }
 
       ssize_t read_msg(char *message, uint32_t buffer_length, uint64_t offset, bool ntohl = false) {
@@ -298,8 +562,8 @@ namespace myq {
       std::string get_current_file() const {
           LOG_IN("");
           std::string filename;
-          if (file_fds_.size() > current_fd_index_) {
-              filename = file_fds_[current_fd_index_]->file_name_;
+          if (get_segment_count() > current_fd_index_) {
+              filename = segment(current_fd_index_)->file_name_;
           }
           LOG_TRACE("filename [%s]", filename.c_str());
           return std::move(filename);
@@ -308,8 +572,16 @@ namespace myq {
 
       void close_all() {
           LOG_IN("");
-          for (unsigned i = 0; i < file_fds_.size(); ++i) {
-              file_fds_[i]->close();
+          if (p_fd_cache_) {
+              for (unsigned i = 0; i < get_segment_count(); ++i) {
+                  p_fd_cache_->remove(segment(i));
+              }
+              p_fd_cache_ = NULL;
+          }
+          for (unsigned i = 0; i < get_segment_count(); ++i) {
+              if (segment(i)->fd_ >= 0) {
+                  segment(i)->close();
+              }
           }
           LOG_OUT("");
       }
@@ -318,27 +590,327 @@ namespace myq {
   private:
 
       std::string directory_;
-      std::vector<file_details *> file_fds_;
+      data_directories *p_dirs_; //NULL to keep all segments in directory_
+      unsigned first_dir_;
+      //append only segment table, grown a chunk at a time. A slot (and its chunk) is set before segment_count_
+      //publishes it (release), and readers only look at slots below the count they loaded (acquire), so they
+      //never see a half built segment. Segment i is slot i
+      static const unsigned segment_chunk_size_ = 1024;
+      static const unsigned max_segment_chunks_ = 1024;
+      static const unsigned max_segments_ = segment_chunk_size_ * max_segment_chunks_;
+      file_details **segment_chunks_[max_segment_chunks_];
+      std::atomic<unsigned> segment_count_;
       unsigned current_fd_index_;
       uint64_t max_file_size_;
-      std::atomic<uint64_t> total_bytes_writen_; //FIXME: Do we need as atomic
-      uint64_t msg_counter_;
+      bool preallocate_;
+      //the segment after the current one, created ahead on an I/O thread so rolling over is a swap
+      file_details *p_next_segment_;
+      unsigned next_segment_index_;
+      bool next_segment_pending_;
+      std::mutex next_segment_mutex_;
+      std::condition_variable next_segment_cond_;
+      fd_cache *p_fd_cache_; //NULL to keep every segment open
+      std::atomic<uint64_t> segment_cache_hits_;
+      std::atomic<uint64_t> segment_cache_misses_;
+      std::atomic<uint64_t> total_bytes_writen_; //high water mark readers go by, see publish_append
+      std::atomic<uint64_t> msg_counter_;
+      //sparse seq -> offset index, one entry every seq_index_interval_ messages
+      static const unsigned seq_index_interval_ = 64;
+      std::vector<uint64_t> seq_index_;
+      std::mutex seq_index_mutex_;
+      //sparse append time -> offset index, kept per segment with one entry every time_index_interval_ms_
+      static const unsigned time_index_interval_ms_ = 100;
+      std::mutex time_index_mutex_;
       char buffer_[utils::max_msg_size]; //128*1024
 
+      inline file_details *segment(unsigned index) const {
+          return segment_chunks_[index / segment_chunk_size_][index % segment_chunk_size_];
+      }
+
+      inline unsigned get_segment_count() const {
+          return segment_count_.load(std::memory_order_acquire);
+      }
+
       /**
-       * Set and possibly create a file
+       * make appended records visible to readers. The segment end and then the log high water mark
+       * are stored with release after the bytes are written, and the message counter last, so a reader
+       * that loads either with acquire can read everything below it
+       * @param bytes
+       * @param count
+       */
+      inline void publish_append(uint64_t bytes, unsigned count) {
+          uint64_t total = total_bytes_writen_.load(std::memory_order_relaxed) + bytes;
+          segment(current_fd_index_)->bytes_written_across_all_files_.store(total, std::memory_order_release);
+          total_bytes_writen_.store(total, std::memory_order_release);
+          msg_counter_.store(msg_counter_.load(std::memory_order_relaxed) + count, std::memory_order_release);
+      }
+
+      /**
+       * bytes a message takes in the file
+       * @param msg_len
+       * @param write_msg_size
+       * @param include_offset
+       * @return
+       */
+      static inline uint64_t record_size(unsigned msg_len, bool write_msg_size, bool include_offset) {
+          return (write_msg_size ? sizeof(uint32_t) : 0) + msg_len + (include_offset ? sizeof(uint64_t) : 0);
+      }
+
+      /**
+       * forget the bytes of a failed append, the next one is written over them. Nothing of it was
+       * published or indexed
+       * @param p_segment
+       * @param offset end of the file before the append
+       */
+      inline void rollback_append(file_details *p_segment, uint64_t offset) {
+          LOG_WARN("Rolling back [%llu] bytes of a failed append to file[%s]",
+                   p_segment->offset_.load() - offset, p_segment->file_name_.c_str());
+          p_segment->offset_.store(offset);
+      }
+
+      /**
+       * record offset of the next message if it starts a new index slot. Called once the message is in
+       * the file, before it is published
+       */
+      inline void update_seq_index() {
+          if (msg_counter_.load(std::memory_order_relaxed) % seq_index_interval_ == 0) {
+              std::lock_guard<std::mutex> lock(seq_index_mutex_);
+              seq_index_.push_back(total_bytes_writen_.load(std::memory_order_relaxed));
+          }
+      }
+
+      /**
+       * stamp the record being published with the append time. records of the same interval share an index entry
+       */
+      inline void update_time_index() {
+          uint64_t now = utils::get_currenttime_milliseconds();
+          std::vector<file_details::time_index_entry> &index = segment(current_fd_index_)->time_index_;
+          if (index.empty() || now >= index.back().timestamp_ + time_index_interval_ms_) {
+              file_details::time_index_entry entry;
+              entry.timestamp_ = now;
+              entry.offset_ = total_bytes_writen_.load(std::memory_order_relaxed);
+              std::lock_guard<std::mutex> lock(time_index_mutex_);
+              index.push_back(entry);
+          }
+      }
+
+      /**
+       * read message length at given offset
+       * @param offset
+       * @return
+       */
+      ssize_t read_length(uint64_t offset) {
+          LOG_IN("offset[%llu]", offset);
+          char buffer[sizeof(uint32_t)];
+          uint64_t offset_currentfile = offset;
+          for (unsigned i = 0; i < get_segment_count(); ++i) {
+              if (offset >= segment(i)->bytes_written_across_all_files_) {
+                  continue;
+              }
+              if (i > 0) {
+                  offset_currentfile -= segment(i - 1)->bytes_written_across_all_files_;
+              }
+              fd_cache::lease lease(p_fd_cache_, segment(i));
+              if (!count_lease(lease, i)) {
+                  LOG_RET("failed", -1);
+              }
+              LOG_RET("", segment(i)->read_buffer_length(buffer, sizeof(buffer), offset_currentfile, false));
+          }
+          LOG_RET("Error", -1);
+      }
+
+      /**
+       * count a read of a sealed segment as a cache hit or miss
+       * @param lease
+       * @param index
+       * @return false if the segment couldn't be reopened
+       */
+      inline bool count_lease(const fd_cache::lease &lease, unsigned index) {
+          if (!lease.ok()) {
+              return false;
+          }
+          if (lease.missed()) {
+              segment_cache_misses_.fetch_add(1, std::memory_order_relaxed);
+          } else if (p_fd_cache_ && index + 1 < get_segment_count()) {
+              segment_cache_hits_.fetch_add(1, std::memory_order_relaxed);
+          }
+          return true;
+      }
+
+      /**
+       * data directory of a segment
+       * @param index
+       * @return
+       */
+      inline unsigned get_segment_dir(unsigned index) const {
+          if (p_dirs_->get_placement() == data_directories::stripe_segments) {
+              return first_dir_ + index;
+          }
+          return first_dir_;
+      }
+
+      /**
+       * I/O thread for the work of topics without data directories
+       * @return
+       */
+      static io_thread &default_io_thread() {
+          static io_thread io;
+          return io;
+      }
+
+      /**
+       * run a task on the I/O thread of a segment's directory
+       * @param index
+       * @param task
+       */
+      void submit_io(unsigned index, const std::function<void()> &task) {
+          if (p_dirs_) {
+              p_dirs_->submit(get_segment_dir(index), task);
+          } else {
+              default_io_thread().submit(task);
+          }
+      }
+
+      /**
+       * create segment file, preallocated when set_preallocate is on
+       * @param index
+       * @return NULL on error
+       */
+      file_details *open_segment(unsigned index) {
+          file_details *pInfo = new file_details();
+          const std::string &directory = p_dirs_ ? p_dirs_->get_path(get_segment_dir(index)) : directory_;
+          if (!pInfo->create_file(directory, topic_, index)) {
+              delete pInfo;
+              return NULL;
+          }
+#ifndef __APPLE__
+          if (preallocate_) {
+              int err = posix_fallocate(pInfo->fd_, 0, max_file_size_);
+              if (err != 0) {
+                  LOG_ERROR("Failed to preallocate file[%s]. Err: %d, ErrDesc: %s",
+                            pInfo->file_name_.c_str(), err, strerror(err));
+              }
+          }
+#endif
+          return pInfo;
+      }
+
+      /**
+       * publish a created segment as the next one of the log
+       * @param pInfo
+       * @return
+       */
+      bool add_segment(file_details *pInfo) {
+          unsigned count = segment_count_.load(std::memory_order_relaxed);
+          if (count >= max_segments_) {
+              LOG_ERROR("Topic[%s] has reached %u segments", topic_.c_str(), max_segments_);
+              return false;
+          }
+          pInfo->bytes_written_across_all_files_ = total_bytes_writen_.load(std::memory_order_relaxed);
+          file_details **&chunk = segment_chunks_[count / segment_chunk_size_];
+          if (!chunk) {
+              chunk = new file_details *[segment_chunk_size_]();
+          }
+          chunk[count % segment_chunk_size_] = pInfo;
+          segment_count_.store(count + 1, std::memory_order_release);
+          return true;
+      }
+
+      /**
+       * create segment file
+       * @param index
+       * @return
+       */
+      bool create_segment(unsigned index) {
+          file_details *pInfo = open_segment(index);
+          if (!pInfo) {
+              return false;
+          }
+          if (!add_segment(pInfo)) {
+              delete pInfo;
+              return false;
+          }
+          return true;
+      }
+
+      /**
+       * start creating the segment after the current one on the I/O thread of its directory
+       * @param index
+       */
+      void prepare_next_segment(unsigned index) {
+          if (index >= max_segments_) {
+              return;
+          }
+          {
+              std::lock_guard<std::mutex> lock(next_segment_mutex_);
+              next_segment_index_ = index;
+              next_segment_pending_ = true;
+          }
+          submit_io(index, [this, index]() {
+              file_details *pInfo = open_segment(index);
+              std::lock_guard<std::mutex> lock(next_segment_mutex_);
+              p_next_segment_ = pInfo;
+              next_segment_pending_ = false;
+              next_segment_cond_.notify_all();
+          });
+      }
+
+      /**
+       * take the segment created ahead, waiting if the I/O thread is still on it
+       * @param index
+       * @return NULL if there is none for index
+       */
+      file_details *take_next_segment(unsigned index) {
+          std::unique_lock<std::mutex> lock(next_segment_mutex_);
+          next_segment_cond_.wait(lock, [this]() { return !next_segment_pending_; });
+          file_details *pInfo = p_next_segment_;
+          p_next_segment_ = NULL;
+          if (pInfo && next_segment_index_ != index) {
+              delete pInfo;
+              pInfo = NULL;
+          }
+          return pInfo;
+      }
+
+      /**
+       * seal a full segment: trim the preallocated space after its records and sync it to disk.
+       * Runs on the I/O thread of the segment's directory, on a duplicate fd so the segment stays
+       * readable meanwhile
+       * @param index
+       */
+      void sync_segment(unsigned index) {
+          int fd = dup(segment(index)->fd_);
+          if (fd < 0) {
+              segment(index)->flush();
+              return;
+          }
+          std::string file_name = segment(index)->file_name_;
+          uint64_t length = segment(index)->offset_;
+          bool trim = preallocate_;
+          submit_io(index, [fd, file_name, length, trim]() {
+              if (trim && ftruncate(fd, length) != 0) {
+                  LOG_ERROR("Failed to trim file[%s]. Err: %d, ErrDesc: %s", file_name.c_str(), errno, strerror(errno));
+              }
+              fdatasync(fd);
+              ::close(fd);
+              LOG_EVENT("File[%s] is flushed to disk", file_name.c_str());
+          });
+      }
+
+      /**
+       * Set and possibly create a file. Rolling over takes the segment prepared ahead, so the
+       * writer neither creates nor syncs files
        * @return
        */
       bool set_current_file() {
           LOG_IN("");
-          LOG_DEBUG("current file fd size: %u", file_fds_.size());
-          if (file_fds_.size() == 0) {
+          LOG_DEBUG("current file fd size: %u", get_segment_count());
+          if (get_segment_count() == 0) {
 
-              file_details *pInfo = new file_details();
               LOG_DEBUG("Creating a file");
-              if (pInfo->create_file(directory_, topic_, current_fd_index_)) {
+              if (create_segment(current_fd_index_)) {
                   LOG_DEBUG("File created successfully");
-                  file_fds_.push_back(pInfo);
+                  prepare_next_segment(current_fd_index_ + 1);
                   LOG_RET_TRUE("Success");
               } else {
                   LOG_ERROR("Failed to create a file for index :%u", current_fd_index_)
@@ -346,19 +918,31 @@ namespace myq {
               LOG_RET_FALSE("Failed to create file");
           }
           LOG_DEBUG("File already exist.");
-          unsigned fd_to_use = total_bytes_writen_ / max_file_size_;
-          LOG_INFO("fd_to_use: %d, current_fd_index_:% u ", fd_to_use, current_fd_index_);
-          if (fd_to_use > current_fd_index_) {
+          //roll over once the current segment is full; a record larger than what is left still goes in whole
+          if (segment(current_fd_index_)->offset_ >= max_file_size_) {
+              unsigned fd_to_use = current_fd_index_ + 1;
               LOG_INFO("fd_to_use: %d", fd_to_use);
-              file_fds_[current_fd_index_]->bytes_written_across_all_files_ = total_bytes_writen_;
-              // file_fds_[current_fd_index_]->close(); we need to provide support to read
-              file_fds_[current_fd_index_]->flush();
-
+              file_details *pInfo = take_next_segment(fd_to_use);
+              if (!pInfo) {
+                  LOG_EVENT("Topic[%s] segment %u was not created ahead", topic_.c_str(), fd_to_use);
+                  pInfo = open_segment(fd_to_use);
+              }
+              if (!pInfo || !add_segment(pInfo)) {
+                  //keep writing nothing until a segment can be added; the current one stays as it is
+                  if (pInfo) {
+                      pInfo->close();
+                      unlink(pInfo->file_name_.c_str());
+                      delete pInfo;
+                  }
+                  LOG_RET_FALSE("Failed to roll over to a new segment");
+              }
+              // segment(current_fd_index_)->close(); we need to provide support to read
+              sync_segment(current_fd_index_);
+              file_details *p_sealed = segment(current_fd_index_);
               current_fd_index_ = fd_to_use;
-              file_details *pInfo = new file_details();
-              if (pInfo->create_file(directory_, topic_, current_fd_index_)) {
-                  file_fds_.push_back(pInfo);
-                  LOG_RET_TRUE("Success");
+              prepare_next_segment(current_fd_index_ + 1);
+              if (p_fd_cache_) {
+                  p_fd_cache_->add(p_sealed);
               }
           }
           LOG_RET_TRUE("Success");
@@ -0,0 +1,518 @@
+/*
+ * File:   connection_multicast.h
+ *
+ *
+ * Created on October 19, 2026, 3:30 PM
+ */
+
+#ifndef CONNECTION_MULTICAST_H
+#define CONNECTION_MULTICAST_H
+
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstring>
+#include "log.h"
+#include "connection.h"
+#include "utils.h"
+using namespace mymq;
+namespace myq
+{
+
+    /**
+     * connection_multicast
+     * UDP multicast pub egress. Sequence stamped messages are packed into datagrams of at most
+     * max_datagram_size_ bytes, so the broker sends each message once whatever the number of
+     * subscribers. Datagram layout (integers in network byte order):
+     *   header: [seq: uint64][count: uint16][frag_index: uint16][frag_count: uint16][reserved: uint16]
+     *   body:   count x [length: uint32][payload]        when frag_count == 1
+     *           chunk frag_index of the message seq      when frag_count > 1
+     * Messages in a datagram have consecutive sequence numbers starting at seq. Nothing is
+     * retransmitted here; receivers detect gaps from the sequence numbers (see subscriber).
+     */
+    class connection_multicast final : public connection
+    {
+    public:
+        /**
+         * constructor
+         * @param topic
+         * @param uri udp://group:port
+         * @param ep_type
+         * @param connect_type bind_socket to send, connect_socket to join the group and receive
+         * @param interface local address of the interface to send/join on, empty for the default route
+         */
+        connection_multicast(
+            const std::string &topic,
+            const std::string &uri,
+            endpoint_type ep_type,
+            connection::socket_connect_type connect_type,
+            const std::string &interface = "") : connection(topic, uri, connection::stream_multicast,
+                                                            ep_type, connect_type, false),
+                                                 interface_(interface)
+        {
+            LOG_IN("topic: %s, uri: %s, interface: %s", topic.c_str(), uri.c_str(), interface.c_str());
+            socket_ = -1;
+            port_ = 0;
+            send_used_ = header_size_;
+            send_count_ = 0;
+            send_first_seq_ = 0;
+            recv_offset_ = 0;
+            recv_length_ = 0;
+            recv_seq_ = 0;
+            frag_seq_ = 0;
+            frag_next_index_ = 0;
+            total_datagrams_sent_ = 0;
+            LOG_OUT("");
+        }
+
+        /**
+         * destructor
+         */
+        ~connection_multicast()
+        {
+            LOG_IN("");
+            if (socket_ >= 0)
+            {
+                if (socket_connect_type_ == connection::bind_socket)
+                {
+                    flush();
+                }
+                close(socket_);
+            }
+            LOG_OUT("");
+        }
+
+        /**
+         * init
+         * @return
+         */
+        bool init()
+        {
+            LOG_IN("");
+            if (!utils::convert_uri_host_port(resource_uri_, host_, port_))
+            {
+                LOG_RET_FALSE(utils::format_str("Invalid multicast uri: %s", resource_uri_.c_str()).c_str());
+            }
+            socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+            if (socket_ < 0)
+            {
+                LOG_RET_FALSE(utils::format_str("Failed to create udp socket. Error: %s", strerror(errno)).c_str());
+            }
+            memset(&group_addr_, 0, sizeof(group_addr_));
+            group_addr_.sin_family = AF_INET;
+            group_addr_.sin_addr.s_addr = inet_addr(host_.c_str());
+            group_addr_.sin_port = htons(port_);
+
+            bool result = socket_connect_type_ == connection::bind_socket ? init_sender() : init_receiver();
+            LOG_RET("", result);
+        }
+
+        /**
+         * run
+         * @return
+         */
+        bool run()
+        {
+            LOG_IN("")
+            LOG_RET_TRUE("dummy");
+        }
+
+        /**
+         * messages need a sequence number on this transport, use write_msg_seq
+         * @param message
+         * @return
+         */
+        ssize_t write_msg(const std::string &message)
+        {
+            return write_msg(message.c_str(), message.length());
+        }
+
+        /**
+         * messages need a sequence number on this transport, use write_msg_seq
+         * @param message
+         * @param length
+         * @return
+         */
+        ssize_t write_msg(const char *message, unsigned length)
+        {
+            LOG_IN("message:%p, length:%u", message, length);
+            LOG_RET("multicast messages must carry a sequence number", -1);
+        }
+
+        /**
+         * queue message stamped with seq in the current datagram. the datagram goes out when full,
+         * when seq doesn't follow the previous message, or on flush()
+         * @param seq
+         * @param message
+         * @param length
+         * @return
+         */
+        ssize_t write_msg_seq(uint64_t seq, const char *message, unsigned length)
+        {
+            LOG_IN("seq:%llu, message:%p, length:%u", seq, message, length);
+            if (send_count_ > 0 &&
+                (seq != send_first_seq_ + send_count_ ||
+                 send_used_ + sizeof(uint32_t) + length > max_datagram_size_ ||
+                 send_count_ == max_messages_per_datagram_))
+            {
+                if (flush() < 0)
+                {
+                    LOG_RET("failed", -1);
+                }
+            }
+            if (header_size_ + sizeof(uint32_t) + length > max_datagram_size_)
+            {
+                LOG_RET("", send_fragments(seq, message, length));
+            }
+            if (send_count_ == 0)
+            {
+                send_first_seq_ = seq;
+            }
+            uint32_t nlength = htonl(length);
+            memcpy(&send_buffer_[send_used_], &nlength, sizeof(nlength));
+            memcpy(&send_buffer_[send_used_ + sizeof(nlength)], message, length);
+            send_used_ += sizeof(nlength) + length;
+            ++send_count_;
+            total_bytes_written_ += length;
+            LOG_RET("", length);
+        }
+
+        /**
+         * send batch of messages with consecutive sequence numbers, packed into as few datagrams as possible
+         * @param messages
+         * @param count
+         * @param first_seq
+         * @return total bytes written
+         */
+        ssize_t write_msgs_seq(const std::string *messages, unsigned count, uint64_t first_seq)
+        {
+            LOG_IN("count:%u, first_seq:%llu", count, first_seq);
+            ssize_t total = 0;
+            for (unsigned i = 0; i < count; ++i)
+            {
+                if (write_msg_seq(first_seq + i, messages[i].c_str(), messages[i].length()) < 0)
+                {
+                    LOG_RET("failed", -1);
+                }
+                total += messages[i].length();
+            }
+            if (flush() < 0)
+            {
+                LOG_RET("failed", -1);
+            }
+            LOG_RET("", total);
+        }
+
+        /**
+         * send the pending datagram
+         * @return bytes sent, 0 if nothing was pending
+         */
+        ssize_t flush()
+        {
+            if (send_count_ == 0)
+            {
+                return 0;
+            }
+            encode_header(send_buffer_, send_first_seq_, send_count_, 0, 1);
+            ssize_t result = send_datagram(send_buffer_, send_used_);
+            send_used_ = header_size_;
+            send_count_ = 0;
+            return result;
+        }
+
+        /**
+         * read message
+         * @param message
+         * @return
+         */
+        ssize_t read_msg(std::string &message)
+        {
+            uint64_t seq = 0;
+            return read_msg_seq(message, seq);
+        }
+
+        /**
+         * read message
+         * @param buffer
+         * @param buffer_length
+         * @param ntohl
+         * @return
+         */
+        ssize_t read_msg(char *buffer, uint32_t buffer_length, bool ntohl = false)
+        {
+            LOG_IN("buffer: %p , size:%u, ntohl[%d]", buffer, buffer_length, ntohl);
+            uint64_t seq = 0;
+            ssize_t length = read_msg_seq(message_, seq);
+            if (length < 0)
+            {
+                LOG_RET("failed", -1);
+            }
+            if (message_.length() > buffer_length)
+            {
+                LOG_RET("Message is larger than buffer", -1);
+            }
+            memcpy(buffer, message_.data(), message_.length());
+            LOG_RET("", message_.length());
+        }
+
+        /**
+         * read next message and its sequence number. fragmented messages are reassembled; a message
+         * with a lost fragment is dropped and shows up as a sequence gap
+         * @param message
+         * @param seq
+         * @return message length, -1 on error
+         */
+        ssize_t read_msg_seq(std::string &message, uint64_t &seq)
+        {
+            LOG_IN("");
+            while (true)
+            {
+                if (recv_offset_ < recv_length_)
+                {
+                    uint32_t length = 0;
+                    if (recv_offset_ + sizeof(length) > recv_length_)
+                    {
+                        LOG_ERROR("Truncated datagram for seq[%llu]", recv_seq_);
+                        recv_offset_ = recv_length_;
+                        continue;
+                    }
+                    memcpy(&length, &recv_buffer_[recv_offset_], sizeof(length));
+                    length = ntohl(length);
+                    recv_offset_ += sizeof(length);
+                    if (recv_offset_ + length > recv_length_)
+                    {
+                        LOG_ERROR("Truncated datagram for seq[%llu]", recv_seq_);
+                        recv_offset_ = recv_length_;
+                        continue;
+                    }
+                    message.assign(&recv_buffer_[recv_offset_], length);
+                    recv_offset_ += length;
+                    seq = recv_seq_++;
+                    ++total_msg_read_;
+                    total_bytes_read_ += length;
+                    LOG_RET("", length);
+                }
+
+                ssize_t nbytes = recv(socket_, recv_buffer_, sizeof(recv_buffer_), 0);
+                if (nbytes < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    LOG_ERROR("Failed to receive datagram. Error: %s", strerror(errno));
+                    LOG_RET("failed", -1);
+                }
+                if ((size_t)nbytes < header_size_)
+                {
+                    LOG_WARN("Ignoring runt datagram of %lld bytes", (long long)nbytes);
+                    continue;
+                }
+                uint64_t datagram_seq;
+                uint16_t count, frag_index, frag_count;
+                decode_header(recv_buffer_, datagram_seq, count, frag_index, frag_count);
+                if (frag_count <= 1)
+                {
+                    recv_seq_ = datagram_seq;
+                    recv_offset_ = header_size_;
+                    recv_length_ = nbytes;
+                    continue;
+                }
+
+                if (frag_index == 0)
+                {
+                    frag_seq_ = datagram_seq;
+                    frag_next_index_ = 0;
+                    reassembly_.clear();
+                }
+                if (datagram_seq != frag_seq_ || frag_index != frag_next_index_)
+                {
+                    LOG_WARN("Dropping fragment %u/%u of seq[%llu]", frag_index, frag_count, datagram_seq);
+                    frag_next_index_ = 0;
+                    continue;
+                }
+                reassembly_.append(&recv_buffer_[header_size_], nbytes - header_size_);
+                if (++frag_next_index_ == frag_count)
+                {
+                    message.swap(reassembly_);
+                    reassembly_.clear();
+                    frag_next_index_ = 0;
+                    seq = datagram_seq;
+                    ++total_msg_read_;
+                    total_bytes_read_ += message.length();
+                    LOG_RET("", message.length());
+                }
+            }
+        }
+
+        inline int get_socket() const
+        {
+            return socket_;
+        }
+
+        inline uint64_t get_total_datagrams_sent() const
+        {
+            return total_datagrams_sent_;
+        }
+
+    private:
+        static const size_t header_size_ = sizeof(uint64_t) + 4 * sizeof(uint16_t);
+        static const size_t max_datagram_size_ = 1472; // 1500 byte ethernet MTU less ip and udp headers
+        static const unsigned max_messages_per_datagram_ = 0xffff;
+
+        std::string interface_;
+        std::string host_;
+        uint32_t port_;
+        int socket_;
+        struct sockaddr_in group_addr_;
+
+        char send_buffer_[max_datagram_size_];
+        size_t send_used_;
+        unsigned send_count_;
+        uint64_t send_first_seq_;
+        uint64_t total_datagrams_sent_;
+
+        char recv_buffer_[65536];
+        size_t recv_offset_;
+        size_t recv_length_;
+        uint64_t recv_seq_;
+        std::string reassembly_;
+        uint64_t frag_seq_;
+        uint16_t frag_next_index_;
+        std::string message_;
+
+        uint64_t total_bytes_written_ = 0;
+        uint64_t total_bytes_read_ = 0;
+        uint64_t total_msg_read_ = 0;
+
+        /**
+         * sender: multicast ttl 1 (stay on the local network) and loopback on, so
+         * subscribers on the broker host receive too
+         * @return
+         */
+        bool init_sender()
+        {
+            LOG_IN("");
+            unsigned char ttl = 1;
+            unsigned char loop = 1;
+            if (setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0 ||
+                setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0)
+            {
+                LOG_RET_FALSE(utils::format_str("Failed to set multicast options. Error: %s", strerror(errno)).c_str());
+            }
+            if (!interface_.empty())
+            {
+                struct in_addr local;
+                local.s_addr = inet_addr(interface_.c_str());
+                if (setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_IF, &local, sizeof(local)) < 0)
+                {
+                    LOG_RET_FALSE(utils::format_str("Failed to set multicast interface %s. Error: %s",
+                                                    interface_.c_str(), strerror(errno))
+                                      .c_str());
+                }
+            }
+            int sndbuf = 4 * 1024 * 1024;
+            setsockopt(socket_, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+            LOG_EVENT("Sending multicast to %s:%u", host_.c_str(), port_);
+            LOG_RET_TRUE("");
+        }
+
+        /**
+         * receiver: bind the group port (shared with other subscribers on the host) and join the group
+         * @return
+         */
+        bool init_receiver()
+        {
+            LOG_IN("");
+            int opt = 1;
+            if (setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0)
+            {
+                LOG_ERROR("Failed to setsockopt for SO_REUSEADDR");
+            }
+            int rcvbuf = 8 * 1024 * 1024;
+            setsockopt(socket_, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+            if (bind(socket_, (struct sockaddr *)&group_addr_, sizeof(group_addr_)) < 0)
+            {
+                LOG_RET_FALSE(utils::format_str("Failed to bind %s:%u. Error: %s",
+                                                host_.c_str(), port_, strerror(errno))
+                                  .c_str());
+            }
+            struct ip_mreq mreq;
+            mreq.imr_multiaddr = group_addr_.sin_addr;
+            mreq.imr_interface.s_addr = interface_.empty() ? htonl(INADDR_ANY) : inet_addr(interface_.c_str());
+            if (setsockopt(socket_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0)
+            {
+                LOG_RET_FALSE(utils::format_str("Failed to join multicast group %s. Error: %s",
+                                                host_.c_str(), strerror(errno))
+                                  .c_str());
+            }
+            LOG_EVENT("Joined multicast group %s:%u", host_.c_str(), port_);
+            LOG_RET_TRUE("");
+        }
+
+        /**
+         * send message larger than a datagram as a run of fragments
+         * @param seq
+         * @param message
+         * @param length
+         * @return
+         */
+        ssize_t send_fragments(uint64_t seq, const char *message, unsigned length)
+        {
+            LOG_IN("seq:%llu, length:%u", seq, length);
+            const size_t chunk_size = max_datagram_size_ - header_size_;
+            size_t frag_count = (length + chunk_size - 1) / chunk_size;
+            if (frag_count > 0xffff)
+            {
+                LOG_RET("Message too large for multicast", -1);
+            }
+            char datagram[max_datagram_size_];
+            for (size_t i = 0; i < frag_count; ++i)
+            {
+                size_t offset = i * chunk_size;
+                size_t chunk = std::min<size_t>(chunk_size, length - offset);
+                encode_header(datagram, seq, 1, i, frag_count);
+                memcpy(&datagram[header_size_], message + offset, chunk);
+                if (send_datagram(datagram, header_size_ + chunk) < 0)
+                {
+                    LOG_RET("failed", -1);
+                }
+            }
+            total_bytes_written_ += length;
+            LOG_RET("", length);
+        }
+
+        ssize_t send_datagram(const char *datagram, size_t length)
+        {
+            ssize_t result = sendto(socket_, datagram, length, 0, (struct sockaddr *)&group_addr_, sizeof(group_addr_));
+            if (result < 0)
+            {
+                LOG_ERROR("Failed to send datagram to %s:%u. Error: %s", host_.c_str(), port_, strerror(errno));
+                return -1;
+            }
+            ++total_datagrams_sent_;
+            return result;
+        }
+
+        static void encode_header(char *buffer, uint64_t seq, uint16_t count, uint16_t frag_index, uint16_t frag_count)
+        {
+            utils::encode_uint64(seq, buffer);
+            uint16_t fields[4] = {htons(count), htons(frag_index), htons(frag_count), 0};
+            memcpy(buffer + sizeof(uint64_t), fields, sizeof(fields));
+        }
+
+        static void decode_header(const char *buffer, uint64_t &seq, uint16_t &count, uint16_t &frag_index,
+                                  uint16_t &frag_count)
+        {
+            seq = utils::decode_uint64(buffer);
+            uint16_t fields[4];
+            memcpy(fields, buffer + sizeof(uint64_t), sizeof(fields));
+            count = ntohs(fields[0]);
+            frag_index = ntohs(fields[1]);
+            frag_count = ntohs(fields[2]);
+        }
+    };
+}
+
+#endif /* CONNECTION_MULTICAST_H */
@@ -14,6 +14,10 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
+#include <poll.h>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
 #include "log.h"
 #include "connection.h"
 #include "utils.h"
@@ -23,12 +27,27 @@ using namespace mymq;
 namespace myq
 {
 
-    class connection_socket : public connection
+    class connection_socket final : public connection
     {
     public:
         // read fd call back
         typedef int (*process_fd_callback)(int fd);
 
+        // first request of a socket consumer: [uint32 fetch_type][uint64 value], host byte order
+        enum fetch_type
+        {
+            fetch_from_offset = 0, // value is a byte offset in the file log
+            fetch_from_time = 1,   // value is an append time, milliseconds since epoch
+            fetch_from_seq = 2     // value is a message sequence number, 1 for the first message
+        };
+
+        // position of a consumer connection in the file log
+        struct client_cursor
+        {
+            int fd_;
+            uint64_t offset_;
+        };
+
         // constuctor
 
         connection_socket(
@@ -49,8 +68,14 @@ namespace myq
             listen_fd_ = -1;
             stop_ = false;
             process_fd_callback_ = NULL;
-            current_write_offset_ = 0;
             current_fd_index_ = 0;
+            fds_version_ = 0;
+            io_fds_version_ = 0;
+            nowait_size_ = 0;
+            nowait_header_read_ = 0;
+            nowait_body_read_ = 0;
+            nowait_drop_ = false;
+            nowait_in_place_ = false;
             p_storage_ = 0;
             LOG_OUT("");
         }
@@ -233,7 +258,26 @@ namespace myq
                                          host_.c_str(), port_, errno, strerror(errno));
                              }*/
 
+                            if (p_storage_ && p_storage_->get_file_connection())
+                            {
+                                // the fetch request is read by the dispatching thread, see admit_pending_locked
+                                if (fcntl(connfd, F_SETFL, fcntl(connfd, F_GETFL, 0) | O_NONBLOCK) == -1)
+                                {
+                                    LOG_ERROR("Failed to set O_NONBLOCK on fd %d. Err: %d, ErrDesc: %s",
+                                              connfd, errno, strerror(errno));
+                                }
+                                pending_consumer pending;
+                                pending.fd_ = connfd;
+                                pending.deadline_ms_ = utils::get_currenttime_milliseconds() + fetch_request_wait_ms_;
+                                pending.received_ = 0;
+                                std::lock_guard<std::mutex> lock(fds_mutex_);
+                                pending_.push_back(pending);
+                                continue;
+                            }
+                            std::lock_guard<std::mutex> lock(fds_mutex_);
                             fds_.push_back(connfd);
+                            ++fds_version_;
+                            offsets_[connfd] = 0;
                             LOG_EVENT("Connect with FD %d is connected. Total clients: %u", connfd, fds_.size());
                         }
                         LOG_DEBUG("Existing while loop");
@@ -347,6 +391,111 @@ namespace myq
             LOG_RET("Offset read", offset);
         }
 
+        /**
+         * tell the broker where to start reading the file log. sent once, right after connecting
+         * @param type
+         * @param value
+         * @return
+         */
+        bool send_fetch_request(fetch_type type, uint64_t value)
+        {
+            LOG_IN("type[%d], value[%llu]", type, value);
+            char request[sizeof(uint32_t) + sizeof(uint64_t)];
+            uint32_t request_type = type;
+            memcpy(request, &request_type, sizeof(request_type));
+            memcpy(request + sizeof(request_type), &value, sizeof(value));
+            if (utils::write_buffer(socket_, request, sizeof(request)) != (ssize_t)sizeof(request))
+            {
+                LOG_RET_FALSE("Failed to send fetch request");
+            }
+            LOG_RET_TRUE("");
+        }
+
+        /**
+         * offset in the file log a fetch request asks for
+         * @param fd
+         * @param request [type: uint32][value: uint64]
+         * @return offset to start sending from
+         */
+        uint64_t fetch_offset(int fd, const char *request)
+        {
+            LOG_IN("fd[%d]", fd);
+            uint32_t type = 0;
+            uint64_t value = 0;
+            memcpy(&type, request, sizeof(type));
+            memcpy(&value, request + sizeof(type), sizeof(value));
+            uint64_t offset = 0;
+            if (type == fetch_from_time)
+            {
+                offset = p_storage_->get_file_connection()->find_offset_by_time(value);
+            }
+            else if (type == fetch_from_seq)
+            {
+                // seq past the end of the log waits for new messages, like offsets past the end
+                int64_t seq_offset = p_storage_->get_file_connection()->find_offset_by_seq(std::max<uint64_t>(value, 1));
+                offset = seq_offset < 0 ? p_storage_->get_file_total_bytes_written() : seq_offset;
+            }
+            else
+            {
+                offset = std::min<uint64_t>(value, p_storage_->get_file_total_bytes_written());
+            }
+            LOG_EVENT("Consumer fd %d starts at offset %llu (fetch type %u, value %llu)", fd, offset, type, value);
+            LOG_RET("", offset);
+        }
+
+        /**
+         * read what arrived of the fetch requests of new file log consumers, without blocking, and add the
+         * consumers whose request is complete. Clients that send none within fetch_request_wait_ms_ read
+         * from the start of the log. Called with fds_mutex_ held
+         */
+        void admit_pending_locked()
+        {
+            if (pending_.empty())
+            {
+                return;
+            }
+            uint64_t now_ms = utils::get_currenttime_milliseconds();
+            for (unsigned i = 0; i < pending_.size();)
+            {
+                pending_consumer &pending = pending_[i];
+                ssize_t result = recv(pending.fd_, pending.request_ + pending.received_,
+                                      sizeof(pending.request_) - pending.received_, MSG_DONTWAIT);
+                if (result > 0)
+                {
+                    pending.received_ += result;
+                }
+                else if (result == 0 || !try_again(errno))
+                {
+                    LOG_EVENT("Consumer fd %d disconnected before its fetch request", pending.fd_);
+                    close(pending.fd_);
+                    pending_.erase(pending_.begin() + i);
+                    continue;
+                }
+                uint64_t offset = 0;
+                if (pending.received_ == sizeof(pending.request_))
+                {
+                    offset = fetch_offset(pending.fd_, pending.request_);
+                }
+                else if (now_ms < pending.deadline_ms_)
+                {
+                    ++i;
+                    continue;
+                }
+                else if (pending.received_ > 0)
+                {
+                    LOG_ERROR("Incomplete fetch request on fd %d, closing it", pending.fd_);
+                    close(pending.fd_);
+                    pending_.erase(pending_.begin() + i);
+                    continue;
+                }
+                fds_.push_back(pending.fd_);
+                ++fds_version_;
+                offsets_[pending.fd_] = offset;
+                LOG_EVENT("Connect with FD %d is connected. Total clients: %u", pending.fd_, fds_.size());
+                pending_.erase(pending_.begin() + i);
+            }
+        }
+
         /**
          * get next fd
          * @return
@@ -354,26 +503,77 @@ namespace myq
         unsigned get_next_fd()
         {
             LOG_IN("");
-            if (fds_.size() == 0)
+            if (io_fds().size() == 0)
             {
                 LOG_RET("No fd", -1);
             }
-            if (current_fd_index_ >= fds_.size())
+            if (current_fd_index_ >= io_fds_.size())
             {
                 current_fd_index_ = 0;
             }
-            int fd = fds_[current_fd_index_++];
+            int fd = io_fds_[current_fd_index_++];
             LOG_DEBUG("returning fd: %d", fd);
             LOG_RET("fd: %d", fd);
         }
 
         std::vector<int> get_active_fds()
         {
+            std::lock_guard<std::mutex> lock(fds_mutex_);
             return fds_;
         }
 
+        /**
+         * log position of every connected consumer, or of those whose fd falls in a shard. New consumers
+         * whose fetch request arrived are added first
+         * @param cursors
+         * @param shard
+         * @param shards
+         */
+        void get_cursors(std::vector<client_cursor> &cursors, unsigned shard = 0, unsigned shards = 1)
+        {
+            std::lock_guard<std::mutex> lock(fds_mutex_);
+            admit_pending_locked();
+            cursors.clear();
+            for (unsigned i = 0; i < fds_.size(); ++i)
+            {
+                if ((unsigned)fds_[i] % shards != shard)
+                {
+                    continue;
+                }
+                client_cursor cursor;
+                cursor.fd_ = fds_[i];
+                cursor.offset_ = offsets_[fds_[i]];
+                cursors.push_back(cursor);
+            }
+        }
+
+        /**
+         * move consumer connection to a new log position
+         * @param fd
+         * @param offset
+         */
+        void set_offset(int fd, uint64_t offset)
+        {
+            std::lock_guard<std::mutex> lock(fds_mutex_);
+            std::unordered_map<int, uint64_t>::iterator it = offsets_.find(fd);
+            if (it != offsets_.end())
+            {
+                it->second = offset;
+            }
+        }
+
+        /**
+         * cpu time of the connection thread (accepting consumers, or reading producers)
+         * @return nanoseconds
+         */
+        uint64_t get_cpu_time_ns()
+        {
+            return utils::get_thread_cpu_nanoseconds(bind_thread_id_);
+        }
+
         unsigned get_total_connected_clients()
         {
+            std::lock_guard<std::mutex> lock(fds_mutex_);
             return fds_.size();
         }
 
@@ -384,11 +584,14 @@ namespace myq
         bool remove_fd(int fd)
         {
             LOG_IN("");
+            std::lock_guard<std::mutex> lock(fds_mutex_);
             if (fds_.size() == 0)
             {
                 LOG_RET("No fd", false);
             }
             fds_.erase(std::remove(fds_.begin(), fds_.end(), fd), fds_.end());
+            ++fds_version_;
+            offsets_.erase(fd);
             LOG_RET_TRUE("success");
         }
 
@@ -402,26 +605,26 @@ namespace myq
             LOG_IN("message:%s", message.c_str());
             if (endpoint_type_ != endpoint_type::conn_broker)
             {
-                while (fds_.size() > 0)
+                while (io_fds().size() > 0)
                 {
 
-                    if (current_fd_index_ >= fds_.size())
+                    if (current_fd_index_ >= io_fds_.size())
                     {
                         current_fd_index_ = 0;
                     }
-                    ssize_t result = utils::write_size(fds_[current_fd_index_], message.length(), true);
-                    if (result == sizeof(message.length()))
+                    ssize_t result = utils::write_size(io_fds_[current_fd_index_], message.length(), false); // host order, like log records
+                    if (result != sizeof(uint32_t))
                     {
-                        LOG_ERROR("Failed to write payload size to socket :%d", fds_[current_fd_index_]);
-                        remove_fd(current_fd_index_);
+                        LOG_ERROR("Failed to write payload size to socket :%d", io_fds_[current_fd_index_]);
+                        remove_fd(io_fds_[current_fd_index_]);
                         continue;
                     }
-                    result = utils::write_buffer(fds_[current_fd_index_], message.c_str(), message.length());
+                    result = utils::write_buffer(io_fds_[current_fd_index_], message.c_str(), message.length());
 
                     if (result == -1)
                     {
-                        LOG_ERROR("Failed to write to socket :%d", fds_[current_fd_index_]);
-                        remove_fd(current_fd_index_);
+                        LOG_ERROR("Failed to write to socket :%d", io_fds_[current_fd_index_]);
+                        remove_fd(io_fds_[current_fd_index_]);
                         continue;
                         // don't increment because we failed so next would be next element
                     }
@@ -454,26 +657,26 @@ namespace myq
             LOG_IN("message:%s", message);
             if (endpoint_type_ != endpoint_type::conn_broker)
             {
-                while (fds_.size() > 0)
+                while (io_fds().size() > 0)
                 {
 
-                    if (current_fd_index_ >= fds_.size())
+                    if (current_fd_index_ >= io_fds_.size())
                     {
                         current_fd_index_ = 0;
                     }
-                    ssize_t result = utils::write_size(fds_[current_fd_index_], length, true);
-                    if (result == sizeof(length))
+                    ssize_t result = utils::write_size(io_fds_[current_fd_index_], length, false); // host order, like log records
+                    if (result != sizeof(length))
                     {
-                        LOG_ERROR("Failed to write payload size to socket :%d", fds_[current_fd_index_]);
-                        remove_fd(current_fd_index_);
+                        LOG_ERROR("Failed to write payload size to socket :%d", io_fds_[current_fd_index_]);
+                        remove_fd(io_fds_[current_fd_index_]);
                         continue;
                     }
-                    result = utils::write_buffer(fds_[current_fd_index_], message, length);
+                    result = utils::write_buffer(io_fds_[current_fd_index_], message, length);
 
                     if (result == -1)
                     {
-                        LOG_ERROR("Failed to write to socket :%d", fds_[current_fd_index_]);
-                        remove_fd(current_fd_index_);
+                        LOG_ERROR("Failed to write to socket :%d", io_fds_[current_fd_index_]);
+                        remove_fd(io_fds_[current_fd_index_]);
                         continue;
                         // don't increment because we failed so next would be next element
                     }
@@ -496,6 +699,96 @@ namespace myq
             }
         }
 
+        /**
+         * write batch of messages to the next consumer as a single buffer
+         * @param messages
+         * @param count
+         * @return total bytes written
+         */
+        ssize_t write_msgs(const std::string *messages, unsigned count)
+        {
+            LOG_IN("messages:%p, count:%u", messages, count);
+            if (endpoint_type_ == endpoint_type::conn_broker)
+            {
+                throw std::runtime_error("For broker connection, write must be handled in callback function");
+            }
+            batch_buffer_.clear();
+            for (unsigned i = 0; i < count; ++i)
+            {
+                uint32_t length = messages[i].length(); // host order, like log records
+                batch_buffer_.append(reinterpret_cast<const char *>(&length), sizeof(length));
+                batch_buffer_.append(messages[i]);
+            }
+            while (io_fds().size() > 0)
+            {
+                if (current_fd_index_ >= io_fds_.size())
+                {
+                    current_fd_index_ = 0;
+                }
+                int fd = io_fds_[current_fd_index_];
+                ssize_t result = utils::write_buffer(fd, batch_buffer_.c_str(), batch_buffer_.length());
+                if (result < (ssize_t)batch_buffer_.length())
+                {
+                    LOG_ERROR("Failed to write batch to socket :%d", fd);
+                    remove_fd(fd);
+                    continue;
+                }
+                ++current_fd_index_;
+                LOG_RET("success", result);
+            }
+            LOG_RET("no consumers", 0);
+        }
+
+        /**
+         * read batch of messages. Reads the first message as read_msg does, then
+         * only keeps reading while the next socket already has data pending
+         * @param messages
+         * @param max_count
+         * @return number of messages read
+         */
+        ssize_t read_msgs(std::string *messages, unsigned max_count)
+        {
+            LOG_IN("messages:%p, max_count:%u", messages, max_count);
+            ssize_t count = 0;
+            while ((unsigned)count < max_count)
+            {
+                if (count > 0 && !has_pending_data())
+                {
+                    break;
+                }
+                ssize_t result = read_msg(messages[count]);
+                if (result < 0)
+                {
+                    LOG_RET("error", count > 0 ? count : -1);
+                }
+                if (result == 0)
+                {
+                    break;
+                }
+                ++count;
+            }
+            LOG_RET("", count);
+        }
+
+        /**
+         * read batch of messages. socket producers have no stamp frame, so every message gets a zero stamp
+         * @param messages
+         * @param stamps
+         * @param max_count
+         * @return number of messages read
+         */
+        ssize_t read_msgs_stamped(std::string *messages, producer_stamp *stamps, unsigned max_count)
+        {
+            ssize_t count = read_msgs(messages, max_count);
+            for (ssize_t i = 0; i < count; ++i)
+            {
+                stamps[i].producer_id_ = 0;
+                stamps[i].seq_ = 0;
+                stamps[i].batch_count_ = 0;
+            }
+            return count;
+        }
+
         ssize_t client_socket_read_msg(std::string &message, bool ntohl = false)
         {
             LOG_IN("");
@@ -630,27 +923,27 @@ namespace myq
                 return client_socket_read_msg(message, ntohl);
             }
 
-            LOG_DEBUG("Number of FDS[%d]", fds_.size());
-            while (fds_.size() > 0)
+            LOG_DEBUG("Number of FDS[%d]", io_fds_.size());
+            while (io_fds().size() > 0)
             {
-                if (current_fd_index_ >= fds_.size())
+                if (current_fd_index_ >= io_fds_.size())
                 {
                     current_fd_index_ = 0;
                 }
-                LOG_DEBUG("Current fd index [%d],  fd[%d]", current_fd_index_, fds_[current_fd_index_]);
+                LOG_DEBUG("Current fd index [%d],  fd[%d]", current_fd_index_, io_fds_[current_fd_index_]);
                 if (endpoint_type_ != endpoint_type::conn_broker)
                 {
-                    LOG_DEBUG("Reading siz from fd[%d]", fds_[current_fd_index_]);
-                    result = utils::read_size(fds_[current_fd_index_], ntohl);
+                    LOG_DEBUG("Reading siz from fd[%d]", io_fds_[current_fd_index_]);
+                    result = utils::read_size(io_fds_[current_fd_index_], ntohl);
                     if (result < 0)
                     {
-                        LOG_ERROR("Failed to write payload size to socket :%d", fds_[current_fd_index_]);
-                        remove_fd(current_fd_index_);
+                        LOG_ERROR("Failed to write payload size to socket :%d", io_fds_[current_fd_index_]);
+                        remove_fd(io_fds_[current_fd_index_]);
                         continue;
                     }
                     else if (result == 0)
                     {
-                        LOG_DEBUG("no data available to read :%d", fds_[current_fd_index_]);
+                        LOG_DEBUG("no data available to read :%d", io_fds_[current_fd_index_]);
                         ++current_fd_index_;
                         continue;
                     }
@@ -660,12 +953,12 @@ namespace myq
                     while (result <= 0)
                     {
                         result = utils::read_buffer(
-                            fds_[current_fd_index_], (char *&)buffer_, utils::max_msg_size,
+                            io_fds_[current_fd_index_], (char *&)buffer_, utils::max_msg_size,
                             result);
                         if (result == -1)
                         {
-                            LOG_ERROR("Failed to write to socket :%d", fds_[current_fd_index_]);
-                            remove_fd(current_fd_index_);
+                            LOG_ERROR("Failed to write to socket :%d", io_fds_[current_fd_index_]);
+                            remove_fd(io_fds_[current_fd_index_]);
                             continue;
                             // don't increment because we failed so next would be next element
                         }
@@ -678,12 +971,12 @@ namespace myq
                 }
                 else
                 {
-                    result = utils::read_line(fds_[current_fd_index_], buffer_, utils::max_msg_size);
+                    result = utils::read_line(io_fds_[current_fd_index_], buffer_, utils::max_msg_size);
                 }
                 if (result == -1)
                 {
-                    LOG_ERROR("Failed to write to socket :%d", fds_[current_fd_index_]);
-                    remove_fd(current_fd_index_);
+                    LOG_ERROR("Failed to write to socket :%d", io_fds_[current_fd_index_]);
+                    remove_fd(io_fds_[current_fd_index_]);
                     continue;
                     // don't increment because we failed so next would be next element
                 }
@@ -706,21 +999,6 @@ namespace myq
             LOG_RET("", 0);
         }
 
-        uint64_t get_write_offset()
-        {
-            //  LOG_IN("");
-            //  LOG_DEBUG("current_write_offset_[%u]", current_write_offset_);
-            //   LOG_RET("", current_write_offset_);
-            return current_write_offset_;
-        }
-
-        void set_write_offset(uint64_t offset)
-        {
-            //   LOG_IN("ofset[%u]", offset);
-            current_write_offset_ = offset;
-            //  LOG_OUT("");
-        }
-
         /**
          * send offset
          * @param offset
@@ -739,7 +1017,161 @@ namespace myq
             return client_pull_;
         }
 
+        /**
+         * socket of a client connection, to poll it
+         * @return
+         */
+        inline int get_socket_fd() const
+        {
+            return socket_;
+        }
+
+        /**
+         * read a message of a client consumer without blocking. A message that arrives in pieces is
+         * put together over several calls in buffer_; one larger than the buffer is read and dropped
+         * @param message
+         * @param length
+         * @param size set to the length of the message read
+         * @return 1 if a message was read, 0 if no whole message waited, -1 on error or when the broker
+         * closed the connection
+         */
+        int read_msg_nowait(char *message, uint32_t length, uint32_t &size)
+        {
+            LOG_IN("message[%p], length[%u]", message, length);
+            while (true)
+            {
+                if (nowait_header_read_ == sizeof(nowait_size_) && nowait_body_read_ == nowait_size_)
+                {
+                    bool drop = nowait_drop_ || nowait_size_ > length;
+                    nowait_header_read_ = 0;
+                    nowait_body_read_ = 0;
+                    nowait_drop_ = false;
+                    if (drop)
+                    {
+                        LOG_ERROR("Dropping message of %u bytes, buffer length is %u", nowait_size_, length);
+                        continue;
+                    }
+                    if (!nowait_in_place_)
+                    {
+                        memcpy(message, buffer_, nowait_size_);
+                    }
+                    size = nowait_size_;
+                    LOG_RET("", 1);
+                }
+                char *p_dest = NULL;
+                uint32_t wanted = 0;
+                nowait_in_place_ = false;
+                if (nowait_header_read_ < sizeof(nowait_size_))
+                {
+                    p_dest = reinterpret_cast<char *>(&nowait_size_) + nowait_header_read_;
+                    wanted = sizeof(nowait_size_) - nowait_header_read_;
+                }
+                else if (nowait_drop_)
+                {
+                    p_dest = buffer_;
+                    wanted = std::min<uint32_t>(nowait_size_ - nowait_body_read_, sizeof(buffer_));
+                }
+                else if (nowait_body_read_ == 0)
+                {
+                    // straight into the caller's buffer; only a partial read is kept in buffer_
+                    p_dest = message;
+                    wanted = nowait_size_;
+                    nowait_in_place_ = true;
+                }
+                else
+                {
+                    p_dest = buffer_ + nowait_body_read_;
+                    wanted = nowait_size_ - nowait_body_read_;
+                }
+                ssize_t result = recv(socket_, p_dest, wanted, MSG_DONTWAIT);
+                if (result == 0)
+                {
+                    LOG_ERROR("Broker closed socket :%d", socket_);
+                    LOG_RET("closed", -1);
+                }
+                if (result < 0)
+                {
+                    if (try_again(errno))
+                    {
+                        LOG_RET("no whole message", 0);
+                    }
+                    LOG_ERROR("Failed to read socket :%d. Err: %d, ErrDesc: %s", socket_, errno, strerror(errno));
+                    LOG_RET("error", -1);
+                }
+                if (nowait_header_read_ < sizeof(nowait_size_))
+                {
+                    nowait_header_read_ += result;
+                    if (nowait_header_read_ == sizeof(nowait_size_))
+                    {
+                        nowait_drop_ = nowait_size_ > length || nowait_size_ > sizeof(buffer_);
+                    }
+                    continue;
+                }
+                if (nowait_in_place_ && (uint32_t)result < wanted)
+                {
+                    memcpy(buffer_, message, result);
+                    nowait_in_place_ = false;
+                }
+                nowait_body_read_ += result;
+            }
+        }
+
     private:
+        /**
+         * a non blocking call failed only for now
+         * @param error errno
+         * @return
+         */
+        static inline bool try_again(int error)
+        {
+#if EAGAIN != EWOULDBLOCK
+            if (error == EWOULDBLOCK)
+            {
+                return true;
+            }
+#endif
+            return error == EAGAIN || error == EINTR;
+        }
+
+        /**
+         * connections for the thread reading or writing messages: a copy of fds_, taken again
+         * whenever a connection was added or removed since, so the accept thread can change fds_
+         * @return
+         */
+        inline std::vector<int> &io_fds()
+        {
+            if (fds_version_.load(std::memory_order_acquire) != io_fds_version_)
+            {
+                std::lock_guard<std::mutex> lock(fds_mutex_);
+                io_fds_ = fds_;
+                io_fds_version_ = fds_version_.load(std::memory_order_relaxed);
+            }
+            return io_fds_;
+        }
+
+        /**
+         * check if next fd in round robin has data to read without blocking
+         * @return
+         */
+        bool has_pending_data()
+        {
+            int fd = -1;
+            if (socket_connect_type_ == socket_connect_type::connect_socket)
+            {
+                fd = socket_;
+            }
+            else if (io_fds().size() > 0)
+            {
+                fd = io_fds_[current_fd_index_ < io_fds_.size() ? current_fd_index_ : 0];
+            }
+            int pending = 0;
+            if (fd < 0 || ioctl(fd, FIONREAD, &pending) < 0)
+            {
+                return false;
+            }
+            return pending > 0;
+        }
+
         /**
          * get remote address
          * @param sock_addr
@@ -806,10 +1238,31 @@ namespace myq
         std::thread bind_thread_id_;
         bool stop_;
         std::vector<int> fds_;
-        uint64_t current_write_offset_;
+        std::unordered_map<int, uint64_t> offsets_; // per consumer position in the file log
+        // file log consumer waiting for its fetch request
+        struct pending_consumer
+        {
+            int fd_;
+            uint64_t deadline_ms_;
+            unsigned received_;
+            char request_[sizeof(uint32_t) + sizeof(uint64_t)];
+        };
+        std::vector<pending_consumer> pending_;
+        std::mutex fds_mutex_;
+        std::atomic<unsigned> fds_version_; // changes with fds_
+        std::vector<int> io_fds_;           // see io_fds
+        unsigned io_fds_version_;
+        const int fetch_request_wait_ms_ = 100;
         unsigned current_fd_index_;
         process_fd_callback process_fd_callback_;
         char buffer_[utils::max_msg_size]; // 128*1024 not thread safe
+        std::string batch_buffer_;
+        // message read_msg_nowait is in the middle of
+        uint32_t nowait_size_;
+        unsigned nowait_header_read_;
+        uint32_t nowait_body_read_;
+        bool nowait_drop_;     // larger than the buffer, read and dropped
+        bool nowait_in_place_; // the body was read straight into the caller's buffer
         bool client_pull_;
         broker_storage *p_storage_;
     };
@@ -9,6 +9,7 @@
 #define CONNECTION_ZMQ_H
 
 #include <thread>
+#include <vector>
 #include "thirdparty/zhelpers.hpp"
 #include "log.h"
 
@@ -17,13 +18,14 @@
 #include "utils.h"
 
 #define ZMQ_IOTHREADS 4
+#define ZMQ_MAXSOCKETS 65535
 using namespace mymq;
 namespace myq
 {
 
     // zmq connection type
 
-    class connection_zmq : public connection
+    class connection_zmq final : public connection
     {
     public:
         enum zmq_socket_type
@@ -60,6 +62,10 @@ namespace myq
             zmq_socket_type_ = zmq_type;
             fd_ = -1;
             p_socket_ = NULL;
+            total_msg_written_ = 0;
+            total_msg_read_ = 0;
+            total_bytes_written_ = 0;
+            total_bytes_read_ = 0;
             monitor_enabled_ = monitor_enabled;
             LOG_OUT("");
         }
@@ -223,6 +229,41 @@ namespace myq
             LOG_RET("failed", -1);
         }
 
+        /**
+         * write without blocking
+         * @param message
+         * @param length
+         * @return bytes written, 0 if the socket is at its high water mark (or has no peer), -1 on error
+         */
+        ssize_t try_write_msg(const char *message, unsigned length)
+        {
+            LOG_IN("message:%p, length:%u", message, length);
+            try
+            {
+                if (get_zmq_connect_type() == ZMQ_PUB)
+                {
+                    s_sendmore(*p_socket_, topic_, false);
+                }
+                if (zmq_send((void *)*p_socket_, message, length, ZMQ_DONTWAIT) < 0)
+                {
+                    if (zmq_errno() == EAGAIN)
+                    {
+                        LOG_RET("would block", 0);
+                    }
+                    LOG_RET("failed", -1);
+                }
+                total_bytes_written_ += length;
+                total_msg_written_ += 1;
+                LOG_RET("Successfully send message", length);
+            }
+            catch (zmq::error_t &ex)
+            {
+                char buffer[utils::max_small_msg_size];
+                sprintf(buffer, "Exception: %s, error number:%d", ex.what(), ex.num());
+                LOG_RET(buffer, -1);
+            }
+        }
+
         /**
          * write
          * @param message
@@ -295,11 +336,441 @@ namespace myq
             LOG_RET("Failed", -1);
         }
 
+        /**
+         * write batch of messages
+         * @param messages
+         * @param count
+         * @return total bytes written
+         */
+        ssize_t write_msgs(const std::string *messages, unsigned count)
+        {
+            LOG_IN("messages:%p, count:%u", messages, count);
+            bool is_pub = get_zmq_connect_type() == ZMQ_PUB;
+            ssize_t bytes_written = 0;
+            try
+            {
+                for (unsigned i = 0; i < count; ++i)
+                {
+                    if (is_pub)
+                    {
+                        s_sendmore(*p_socket_, topic_, false);
+                    }
+                    if (!s_send(*p_socket_, messages[i], false))
+                    {
+                        LOG_ERROR("Failed to send message %u of batch size %u", i, count);
+                        break;
+                    }
+                    bytes_written += messages[i].length();
+                    total_msg_written_ += 1;
+                }
+            }
+            catch (zmq::error_t &ex)
+            {
+                char buffer[utils::max_small_msg_size];
+                sprintf(buffer, "Exception: %s, error number:%d", ex.what(), ex.num());
+                LOG_RET(buffer, -1);
+            }
+            total_bytes_written_ += bytes_written;
+            LOG_RET("Sent batch", bytes_written);
+        }
+
+        /**
+         * read batch of messages. Blocks (per socket mode) for the first message only,
+         * then drains whatever is already queued without waiting
+         * @param messages
+         * @param max_count
+         * @return number of messages read
+         */
+        ssize_t read_msgs(std::string *messages, unsigned max_count)
+        {
+            LOG_IN("messages:%p, max_count:%u", messages, max_count);
+            ssize_t count = 0;
+            try
+            {
+                zmq::message_t zmq_msg;
+                int flags = 0;
+                while ((unsigned)count < max_count)
+                {
+                    if (!p_socket_->recv(&zmq_msg, flags))
+                    {
+                        break;
+                    }
+                    messages[count].assign(static_cast<char *>(zmq_msg.data()), zmq_msg.size());
+                    total_bytes_read_ += zmq_msg.size();
+                    ++total_msg_read_;
+                    ++count;
+                    flags = ZMQ_DONTWAIT;
+                }
+            }
+            catch (zmq::error_t &ex)
+            {
+                char buffer[utils::max_small_msg_size];
+                sprintf(buffer, "Exception: %s, error number:%d", ex.what(), ex.num());
+                LOG_RET(buffer, -1);
+            }
+            LOG_RET("Received batch", count);
+        }
+
+        /**
+         * read batch of messages as read_msgs does. Idempotent producers send each message as
+         * [producer_id: uint64][seq: uint64][payload] (see write_msg_stamped); plain messages get a zero stamp.
+         * Atomic batches come as [producer_id: uint64][seq: uint64][count: uint32][records] (see write_batch)
+         * and are returned as one message holding the packed records, with batch_count_ set
+         * @param messages
+         * @param stamps
+         * @param max_count
+         * @return number of messages read
+         */
+        ssize_t read_msgs_stamped(std::string *messages, producer_stamp *stamps, unsigned max_count)
+        {
+            LOG_IN("messages:%p, stamps:%p, max_count:%u", messages, stamps, max_count);
+            ssize_t count = 0;
+            try
+            {
+                zmq::message_t zmq_msg;
+                int flags = 0;
+                while ((unsigned)count < max_count)
+                {
+                    if (!p_socket_->recv(&zmq_msg, flags))
+                    {
+                        break;
+                    }
+                    stamps[count].producer_id_ = 0;
+                    stamps[count].seq_ = 0;
+                    stamps[count].batch_count_ = 0;
+                    if (zmq_msg.more())
+                    {
+                        if (zmq_msg.size() == stamp_size_ || zmq_msg.size() == batch_stamp_size_)
+                        {
+                            const char *stamp = static_cast<const char *>(zmq_msg.data());
+                            stamps[count].producer_id_ = utils::decode_uint64(stamp);
+                            stamps[count].seq_ = utils::decode_uint64(stamp + sizeof(uint64_t));
+                            if (zmq_msg.size() == batch_stamp_size_)
+                            {
+                                stamps[count].batch_count_ = utils::decode_uint32(stamp + stamp_size_);
+                            }
+                        }
+                        // rest of a multipart message is always queued with its first frame
+                        p_socket_->recv(&zmq_msg, 0);
+                    }
+                    messages[count].assign(static_cast<char *>(zmq_msg.data()), zmq_msg.size());
+                    total_bytes_read_ += zmq_msg.size();
+                    ++total_msg_read_;
+                    ++count;
+                    flags = ZMQ_DONTWAIT;
+                }
+            }
+            catch (zmq::error_t &ex)
+            {
+                char buffer[utils::max_small_msg_size];
+                sprintf(buffer, "Exception: %s, error number:%d", ex.what(), ex.num());
+                LOG_RET(buffer, -1);
+            }
+            LOG_RET("Received batch", count);
+        }
+
+        /**
+         * write message of an idempotent producer, frames: [producer_id: uint64][seq: uint64], [payload]
+         * @param producer_id
+         * @param seq
+         * @param message
+         * @param length
+         * @return
+         */
+        ssize_t write_msg_stamped(uint64_t producer_id, uint64_t seq, const char *message, unsigned length)
+        {
+            LOG_IN("producer_id:%llu, seq:%llu, message:%p, length:%u", producer_id, seq, message, length);
+            try
+            {
+                char stamp[stamp_size_];
+                utils::encode_uint64(producer_id, stamp);
+                utils::encode_uint64(seq, stamp + sizeof(uint64_t));
+                p_socket_->send(stamp, sizeof(stamp), ZMQ_SNDMORE);
+                if (s_send(*p_socket_, message, length, false))
+                {
+                    total_bytes_written_ += length;
+                    total_msg_written_ += 1;
+                    LOG_RET("Successfully send message", length);
+                }
+            }
+            catch (zmq::error_t &ex)
+            {
+                char buffer[utils::max_small_msg_size];
+                sprintf(buffer, "Exception: %s, error number:%d", ex.what(), ex.num());
+                LOG_RET(buffer, -1);
+            }
+            LOG_RET("failed", -1);
+        }
+
+        /**
+         * write records as one atomic batch, frames: [producer_id: uint64][seq: uint64][count: uint32], [records].
+         * records are packed as the log stores them, [length: uint32 host order][payload] each
+         * @param producer_id 0 if not idempotent
+         * @param first_seq producer sequence of the first record, the rest follow consecutively
+         * @param records
+         * @param length
+         * @param count number of records
+         * @return
+         */
+        ssize_t write_batch(uint64_t producer_id, uint64_t first_seq, const char *records, unsigned length, uint32_t count)
+        {
+            LOG_IN("producer_id:%llu, first_seq:%llu, records:%p, length:%u, count:%u",
+                   producer_id, first_seq, records, length, count);
+            try
+            {
+                char stamp[batch_stamp_size_];
+                utils::encode_uint64(producer_id, stamp);
+                utils::encode_uint64(first_seq, stamp + sizeof(uint64_t));
+                utils::encode_uint32(count, stamp + stamp_size_);
+                p_socket_->send(stamp, sizeof(stamp), ZMQ_SNDMORE);
+                if (s_send(*p_socket_, records, length, false))
+                {
+                    total_bytes_written_ += length;
+                    total_msg_written_ += count;
+                    LOG_RET("Successfully send batch", length);
+                }
+            }
+            catch (zmq::error_t &ex)
+            {
+                char buffer[utils::max_small_msg_size];
+                sprintf(buffer, "Exception: %s, error number:%d", ex.what(), ex.num());
+                LOG_RET(buffer, -1);
+            }
+            LOG_RET("failed", -1);
+        }
+
+        /**
+         * write message stamped with a sequence number.
+         * frames: [topic] (pub only), [seq: uint64 network order], [payload]
+         * @param seq
+         * @param message
+         * @param length
+         * @return
+         */
+        ssize_t write_msg_seq(uint64_t seq, const char *message, unsigned length)
+        {
+            LOG_IN("seq:%llu, message:%p, length:%u", seq, message, length);
+            try
+            {
+                if (get_zmq_connect_type() == ZMQ_PUB)
+                {
+                    s_sendmore(*p_socket_, topic_, false);
+                }
+                char seq_buffer[sizeof(uint64_t)];
+                utils::encode_uint64(seq, seq_buffer);
+                p_socket_->send(seq_buffer, sizeof(seq_buffer), ZMQ_SNDMORE);
+                if (s_send(*p_socket_, message, length, false))
+                {
+                    total_bytes_written_ += length;
+                    total_msg_written_ += 1;
+                    LOG_RET("Successfully send message", length);
+                }
+            }
+            catch (zmq::error_t &ex)
+            {
+                char buffer[utils::max_small_msg_size];
+                sprintf(buffer, "Exception: %s, error number:%d", ex.what(), ex.num());
+                LOG_RET(buffer, -1);
+            }
+            LOG_RET("failed", -1);
+        }
+
+        /**
+         * write batch of messages with consecutive sequence numbers starting at first_seq
+         * @param messages
+         * @param count
+         * @param first_seq
+         * @return total bytes written
+         */
+        ssize_t write_msgs_seq(const std::string *messages, unsigned count, uint64_t first_seq)
+        {
+            LOG_IN("messages:%p, count:%u, first_seq:%llu", messages, count, first_seq);
+            ssize_t bytes_written = 0;
+            for (unsigned i = 0; i < count; ++i)
+            {
+                ssize_t result = write_msg_seq(first_seq + i, messages[i].c_str(), messages[i].length());
+                if (result < 0)
+                {
+                    LOG_ERROR("Failed to send message %u of batch size %u", i, count);
+                    break;
+                }
+                bytes_written += result;
+            }
+            LOG_RET("Sent batch", bytes_written);
+        }
+
+        /**
+         * read message stamped with a sequence number (see write_msg_seq)
+         * @param message
+         * @param seq
+         * @return payload size, 0 if nothing read
+         */
+        ssize_t read_msg_seq(std::string &message, uint64_t &seq)
+        {
+            LOG_IN("");
+            std::vector<std::string> frames;
+            ssize_t result = read_frames(frames);
+            if (result <= 0)
+            {
+                LOG_RET("", result);
+            }
+            // sub sockets receive the topic envelope first
+            unsigned first = (get_zmq_connect_type() == ZMQ_SUB) ? 1 : 0;
+            if (frames.size() < first + 2 || frames[first].length() != sizeof(uint64_t))
+            {
+                LOG_ERROR("Received message without sequence number. frames: %u", frames.size());
+                LOG_RET("invalid", -1);
+            }
+            seq = utils::decode_uint64(frames[first].c_str());
+            message.swap(frames[first + 1]);
+            LOG_RET("", message.length());
+        }
+
+        /**
+         * write multipart message
+         * @param frames
+         * @param count
+         * @return total bytes written
+         */
+        ssize_t write_frames(const std::string *frames, unsigned count)
+        {
+            LOG_IN("frames:%p, count:%u", frames, count);
+            ssize_t bytes_written = 0;
+            try
+            {
+                for (unsigned i = 0; i < count; ++i)
+                {
+                    int flags = (i + 1 < count) ? ZMQ_SNDMORE : 0;
+                    p_socket_->send(frames[i].data(), frames[i].length(), flags);
+                    bytes_written += frames[i].length();
+                }
+            }
+            catch (zmq::error_t &ex)
+            {
+                char buffer[utils::max_small_msg_size];
+                sprintf(buffer, "Exception: %s, error number:%d", ex.what(), ex.num());
+                LOG_RET(buffer, -1);
+            }
+            total_bytes_written_ += bytes_written;
+            total_msg_written_ += 1;
+            LOG_RET("Sent frames", bytes_written);
+        }
+
+        /**
+         * write multipart message if the peer can take it now. Once the first frame is queued the
+         * rest go out with it
+         * @param frames
+         * @param count
+         * @param p_error set to the zmq error number when the send fails, e.g. EAGAIN if it would block,
+         *        EHOSTUNREACH if a router (with ZMQ_ROUTER_MANDATORY) has no such peer. May be NULL
+         * @return total bytes written, -1 on error or if the send would block
+         */
+        ssize_t write_frames_nowait(const std::string *frames, unsigned count, int *p_error = NULL)
+        {
+            LOG_IN("frames:%p, count:%u", frames, count);
+            ssize_t bytes_written = 0;
+            for (unsigned i = 0; i < count; ++i)
+            {
+                int flags = ZMQ_DONTWAIT | ((i + 1 < count) ? ZMQ_SNDMORE : 0);
+                if (zmq_send(get_socket_handle(), frames[i].data(), frames[i].length(), flags) < 0)
+                {
+                    int error = zmq_errno();
+                    if (p_error)
+                    {
+                        *p_error = error;
+                    }
+                    LOG_DEBUG("Failed to send frame %u. Error number :%d, Description :%s", i, error,
+                              zmq_strerror(error));
+                    LOG_RET(error == EAGAIN ? "would block" : "Failed", -1);
+                }
+                bytes_written += frames[i].length();
+            }
+            total_bytes_written_ += bytes_written;
+            total_msg_written_ += 1;
+            LOG_RET("Sent frames", bytes_written);
+        }
+
+        /**
+         * read all frames of a multipart message
+         * @param frames
+         * @return number of frames read
+         */
+        ssize_t read_frames(std::vector<std::string> &frames)
+        {
+            LOG_IN("");
+            frames.clear();
+            try
+            {
+                zmq::message_t zmq_msg;
+                do
+                {
+                    if (!p_socket_->recv(&zmq_msg, 0))
+                    {
+                        LOG_RET("try again", frames.size());
+                    }
+                    frames.push_back(std::string(static_cast<char *>(zmq_msg.data()), zmq_msg.size()));
+                    total_bytes_read_ += zmq_msg.size();
+                } while (zmq_msg.more());
+            }
+            catch (zmq::error_t &ex)
+            {
+                char buffer[utils::max_small_msg_size];
+                sprintf(buffer, "Exception: %s, error number:%d", ex.what(), ex.num());
+                LOG_RET(buffer, -1);
+            }
+            ++total_msg_read_;
+            LOG_RET("", frames.size());
+        }
+
         uint32_t get_num_connected_clients()
         {
             return monitor_.num_clients_;
         }
 
+        /**
+         * zmq socket, to poll it with zmq_poll
+         * @return
+         */
+        inline void *get_socket_handle()
+        {
+            return static_cast<void *>(*p_socket_);
+        }
+
+        /**
+         * read a message if one is waiting. One larger than the buffer is dropped
+         * @param buffer
+         * @param size
+         * @param length set to the length of the message read, which may be 0
+         * @return 1 if a message was read, 0 if none waited, -1 on error
+         */
+        int read_msg_nowait(char *buffer, uint32_t size, uint32_t &length)
+        {
+            LOG_IN("buffer: %p , size:%u", buffer, size);
+            while (true)
+            {
+                int nbytes = zmq_recv(get_socket_handle(), buffer, size, ZMQ_DONTWAIT);
+                if (nbytes < 0)
+                {
+                    if (zmq_errno() == EAGAIN)
+                    {
+                        LOG_RET("none waiting", 0);
+                    }
+                    LOG_ERROR("Failed to receive message. Error number :%d, Description :%s", zmq_errno(),
+                              zmq_strerror(zmq_errno()));
+                    LOG_RET("Failed", -1);
+                }
+                if ((uint32_t)nbytes > size)
+                {
+                    LOG_ERROR("Dropping message of %d bytes, buffer length is %u", nbytes, size);
+                    continue;
+                }
+                total_bytes_read_ += nbytes;
+                ++total_msg_read_;
+                length = nbytes;
+                LOG_RET("", 1);
+            }
+        }
+
         uint64_t get_total_bytes_written()
         {
             return total_bytes_written_;
@@ -362,9 +833,31 @@ namespace myq
         static zmq::context_t &context()
         {
             static zmq::context_t context(ZMQ_IOTHREADS);
+            static int max_sockets = set_max_sockets(context);
+            (void)max_sockets;
             return context;
         }
 
+        /**
+         * raise the socket limit of the context from the zmq default of 1023, which caps a process at a few
+         * hundred client connections, to what zmq supports on this host
+         * @param context
+         * @return the limit set
+         */
+        static int set_max_sockets(zmq::context_t &context)
+        {
+            int limit = zmq_ctx_get(static_cast<void *>(context), ZMQ_SOCKET_LIMIT);
+            if (limit > ZMQ_MAXSOCKETS)
+            {
+                limit = ZMQ_MAXSOCKETS;
+            }
+            if (limit <= 0 || zmq_ctx_set(static_cast<void *>(context), ZMQ_MAX_SOCKETS, limit) != 0)
+            {
+                return ZMQ_MAX_SOCKETS_DFLT;
+            }
+            return limit;
+        }
+
         /**
          * Start monitoring
          */
@@ -418,6 +911,9 @@ namespace myq
             LOG_OUT("");
         }
 
+        static const unsigned stamp_size_ = 2 * sizeof(uint64_t);                       //producer_id, seq
+        static const unsigned batch_stamp_size_ = 2 * sizeof(uint64_t) + sizeof(uint32_t); //producer_id, seq, count
+
         zmq_socket_type zmq_socket_type_;
         zmq::socket_t *p_socket_;
 
@@ -13,6 +13,11 @@
 #include "broker_storage.h"
 #include "connection_socket.h"
 #include "connection_zmq.h"
+#include "connection_multicast.h"
+#include "transport.h"
+#include "sync_endpoint.h"
+#include "conflation_map.h"
+#include "adaptive_batch.h"
 using namespace mymq;
 namespace myq
 {
@@ -22,8 +27,16 @@ namespace myq
         std::string id_;
         std::string push_bind_uri_;
         std::string pub_bind_uri_;
+        std::string sync_bind_uri_; // zmq only: retransmission side channel for pub subscribers
+        std::string multicast_uri_; // zmq only: udp multicast egress for the pub stream
+        std::string multicast_interface_;
         connection::stream_type stream_type_;
         connection::socket_connect_type socket_connect_type_;
+        unsigned egress_threads_; // socket only: threads sending a file topic, each to its share of the consumers
+
+        consumer_config() : egress_threads_(1)
+        {
+        }
 
         /**
          * to string
@@ -46,6 +59,20 @@ namespace myq
     class consumer
     {
     public:
+        // consumers served by one egress thread: connections whose fd falls in the shard, with
+        // buffers reused by dispatch_from_file
+        struct egress_shard
+        {
+            unsigned index_;
+            unsigned count_;
+            std::vector<connection_socket::client_cursor> cursors_;
+            std::vector<pollfd> pollfds_;
+
+            egress_shard() : index_(0), count_(1)
+            {
+            }
+        };
+
         /**
          * constructor
          */
@@ -54,8 +81,11 @@ namespace myq
         {
             LOG_IN("broker_storage: %p, config: %s", p_storage_, config_.to_string().c_str());
             stop_ = false;
-            p_consumer_socket_ = NULL;
-            p_consumer_pub_socket = NULL;
+            p_push_socket_ = NULL;
+            p_pub_socket_ = NULL;
+            p_raw_socket_ = NULL;
+            p_sync_endpoint_ = NULL;
+            p_mcast_socket_ = NULL;
             running_ = false;
             LOG_OUT("");
         }
@@ -68,9 +98,17 @@ namespace myq
             LOG_IN("");
             if (consumer_tid_.joinable())
                 consumer_tid_.join();
+            for (unsigned i = 0; i < egress_tids_.size(); ++i)
+            {
+                if (egress_tids_[i].joinable())
+                    egress_tids_[i].join();
+            }
 
-            delete p_consumer_socket_;
-            delete p_consumer_pub_socket;
+            delete p_push_socket_;
+            delete p_pub_socket_;
+            delete p_raw_socket_;
+            delete p_sync_endpoint_;
+            delete p_mcast_socket_;
             LOG_OUT("");
         }
 
@@ -85,7 +123,7 @@ namespace myq
             {
                 if (!config_.push_bind_uri_.empty())
                 {
-                    p_consumer_socket_ = new connection_zmq(
+                    p_push_socket_ = new connection_zmq(
                         config_.id_, config_.push_bind_uri_,
                         consumer_endpoint_type_,
                         connection_zmq::zmq_push,
@@ -93,7 +131,7 @@ namespace myq
                         false,
                         true);
 
-                    if (!p_consumer_socket_->init())
+                    if (!p_push_socket_->init())
                     {
 
                         LOG_RET_FALSE(utils::format_str(
@@ -104,7 +142,7 @@ namespace myq
                 }
                 if (!config_.pub_bind_uri_.empty())
                 {
-                    p_consumer_pub_socket = new connection_zmq(
+                    p_pub_socket_ = new connection_zmq(
                         config_.id_, config_.pub_bind_uri_,
                         consumer_endpoint_type_,
                         connection_zmq::zmq_pub,
@@ -112,7 +150,7 @@ namespace myq
                         true,
                         true);
 
-                    if (!p_consumer_pub_socket->init())
+                    if (!p_pub_socket_->init())
                     {
 
                         LOG_RET_FALSE(utils::format_str(
@@ -120,19 +158,44 @@ namespace myq
                                           config_.id_.c_str(), config_.pub_bind_uri_.c_str())
                                           .c_str());
                     }
+                    if (!config_.multicast_uri_.empty())
+                    {
+                        p_mcast_socket_ = new connection_multicast(
+                            config_.id_, config_.multicast_uri_,
+                            consumer_endpoint_type_,
+                            connection::bind_socket,
+                            config_.multicast_interface_);
+                        if (!p_mcast_socket_->init())
+                        {
+                            LOG_RET_FALSE(utils::format_str(
+                                              "Failed to initialize broker: %s, multicast_uri: %s",
+                                              config_.id_.c_str(), config_.multicast_uri_.c_str())
+                                              .c_str());
+                        }
+                    }
+                    if (!config_.sync_bind_uri_.empty())
+                    {
+                        p_sync_endpoint_ = new sync_endpoint(p_storage_, config_.id_, config_.sync_bind_uri_);
+                        if (!p_sync_endpoint_->init() || !p_sync_endpoint_->run())
+                        {
+                            LOG_RET_FALSE(utils::format_str(
+                                              "Failed to initialize broker: %s, sync_bind_uri: %s",
+                                              config_.id_.c_str(), config_.sync_bind_uri_.c_str())
+                                              .c_str());
+                        }
+                    }
                 }
             }
             else if (config_.stream_type_ == connection::stream_socket)
             {
 
-                p_consumer_socket_ = new connection_socket(
+                p_raw_socket_ = new connection_socket(
                     config_.id_,
                     config_.push_bind_uri_,
                     consumer_endpoint_type_,
                     connection::bind_socket,
                     true);
-                connection_socket *psocket = (connection_socket *)p_consumer_socket_;
-                if (!psocket->init(p_storage_))
+                if (!p_raw_socket_->init(p_storage_))
                 {
 
                     LOG_RET_FALSE(utils::format_str(
@@ -142,7 +205,7 @@ namespace myq
                 }
                 else
                 {
-                    if (!p_consumer_socket_->run())
+                    if (!p_raw_socket_->run())
                     {
                         LOG_RET_FALSE(utils::format_str(
                                           "Failed to run consumer broker: %s, consumer_bind_uri: %s",
@@ -175,105 +238,150 @@ namespace myq
             {
                 return running_;
             }
-            running_ = true;
+            // socket consumers of a file log are split by connection across the egress threads, the
+            // consumer thread serves the first share
+            unsigned shards = 1;
+            if (p_raw_socket_ && (p_storage_->get_broker_type() == broker_config::broker_file ||
+                                  p_storage_->get_broker_type() == broker_config::broker_queue_file))
+            {
+                shards = std::max(1u, config_.egress_threads_);
+            }
+            egress_shards_.resize(shards);
+            for (unsigned i = 0; i < shards; ++i)
+            {
+                egress_shards_[i].index_ = i;
+                egress_shards_[i].count_ = shards;
+            }
             consumer_tid_ = std::thread(
                 [&]()
                 {
                     process_consumers();
                 });
+            for (unsigned i = 1; i < shards; ++i)
+            {
+                egress_shard *p_shard = &egress_shards_[i];
+                egress_tids_.push_back(std::thread(
+                    [this, p_shard]()
+                    {
+                        process_egress(*p_shard);
+                    }));
+            }
+            if (shards > 1)
+            {
+                LOG_EVENT("Broker %s sends to socket consumers on %u threads", config_.id_.c_str(), shards);
+            }
+            running_ = true;
             LOG_RET_TRUE("");
         }
 
         /**
          * Process consumers
+         * Picks the concrete transport once, then runs the dispatch loop statically typed over it.
          */
         void process_consumers()
         {
             LOG_IN("");
-            std::string message;
-            message.reserve(utils::max_msg_size);
-            while (!stop_)
+            if (p_raw_socket_)
             {
-                if (p_storage_->get_broker_type() == broker_config::broker_file &&
-                    p_consumer_socket_->get_stream_type() == connection::stream_type::stream_socket)
-                {
-                    connection_socket *psocket = (connection_socket *)p_consumer_socket_;
-                    if (psocket->is_consumer_pull_messages())
-                    {
-                        LOG_INFO("Consumer is socket and directly pulling messages from file.");
-                        LOG_OUT("");
-                    }
-                }
-                // if no messages to consume, sleep
+                transport<connection_socket> socket_transport(p_raw_socket_);
+                process_consumers(socket_transport);
+            }
+            else
+            {
+                transport<connection_zmq> zmq_transport(p_push_socket_);
+                process_consumers(zmq_transport);
+            }
+            LOG_OUT("");
+        }
 
-                message.clear();
-                bool result = false;
+        /**
+         * Process consumers over the given transport
+         * @param consumer_transport
+         */
+        template <typename Connection>
+        void process_consumers(transport<Connection> &consumer_transport)
+        {
+            LOG_IN("");
+            transport<connection_zmq> pub_transport(p_pub_socket_);
+            transport<connection_multicast> mcast_transport(p_mcast_socket_);
+            std::string messages[utils::max_adaptive_batch_size];
+            // queue topics with a latency target size their batches to it, the others send what is there
+            uint64_t latency_target_us = p_storage_->get_config().latency_target_us_;
+            adaptive_batch batch(latency_target_us, utils::max_adaptive_batch_size);
+            uint64_t waiting_since_ns = 0;
+            while (!stop_)
+            {
+                ssize_t result = 0;
 
-                // based on consumer socket type, either use send file or write buffer
                 if (p_storage_->get_broker_type() == broker_config::broker_file ||
                     p_storage_->get_broker_type() == broker_config::broker_queue_file)
                 {
-                    if (p_consumer_socket_->get_stream_type() == connection::stream_type::stream_socket)
+                    result = dispatch_from_file(consumer_transport, pub_transport, mcast_transport);
+                }
+                else if (p_storage_->get_broker_type() == broker_config::broker_queue)
+                {
+                    unsigned max_count = utils::max_batch_size;
+                    if (latency_target_us > 0)
                     {
-                        connection_socket *psocket = (connection_socket *)p_consumer_socket_;
-                        while (p_storage_->get_file_total_bytes_written() <
-                               psocket->get_write_offset() + sizeof(uint32_t))
-                        {
-                            utils::sleep_ms(utils::queue_poll_wait); // define magic number fixme
-                        }
-                        LOG_DEBUG("Data are available for read");
-                        result = sendfile_to_socket();
+                        wait_for_batch(batch, waiting_since_ns);
+                        max_count = batch.get_batch_size();
                     }
                     else
                     {
-                        while (p_storage_->get_file_total_bytes_written() <=
-                               p_storage_->get_total_bytes_read() + sizeof(uint32_t))
+                        while (p_storage_->get_queue_size() <= 0 && backlog_.empty())
                         {
-                            utils::sleep_ms(
-                                utils::queue_poll_wait); // define magic number fixme may be implement condition variabl
+                            utils::sleep_ms(utils::queue_poll_wait); // define magic number fixme
                         }
-                        LOG_TRACE("file_total_bytes_written[%lld], file_total_bytes_read[%lld]",
-                                  p_storage_->get_file_total_bytes_written(), p_storage_->get_total_bytes_read());
-                        result = p_storage_->file_to_consumer(p_consumer_socket_, false);
                     }
-                }
-                else if (p_storage_->get_broker_type() == broker_config::broker_queue)
-                {
-                    while (p_storage_->get_queue_size() <= 0)
+
+                    // drain what is available and hand it to the transport as one batch
+                    unsigned count = p_storage_->get_messages_from_queue(messages, max_count);
+                    result = count;
+                    if (consumer_transport.valid() && p_storage_->get_config().conflate_)
                     {
-                        utils::sleep_ms(utils::queue_poll_wait); // define magic number fixme
+                        result += dispatch_conflated(consumer_transport, messages, count);
                     }
-
-                    result = p_storage_->get_message_from_queue(message);
-                    if (result > 0)
+                    if (count > 0)
                     {
                         // write to push socket
-                        if (p_consumer_socket_)
+                        if (consumer_transport.valid() && !p_storage_->get_config().conflate_)
                         {
-                            connection_zmq *psocket = (connection_zmq *)p_consumer_socket_;
-                            LOG_TRACE("number of connected pull clients: %u", psocket->get_num_connected_clients());
-                            if (psocket->get_num_connected_clients() > 0)
+                            LOG_TRACE("number of connected pull clients: %u", get_num_pull_clients());
+                            if (get_num_pull_clients() > 0)
                             {
-                                result = psocket->write_msg(message.c_str(), message.length());
+                                consumer_transport.send_batch(messages, count);
                             }
                             else
                             {
                                 LOG_DEBUG("No clients are connected to push socket. Not sending message");
                             }
                         }
-                        // write to pub socket
-                        if (p_consumer_pub_socket)
+                        // write to pub socket and multicast group
+                        if (pub_transport.valid() || mcast_transport.valid())
                         {
-                            connection_zmq *psocket = (connection_zmq *)p_consumer_pub_socket;
-                            LOG_TRACE("number of connected pub clients: %u", psocket->get_num_connected_clients());
-                            if (psocket->get_num_connected_clients() > 0)
+                            uint64_t first_seq = p_storage_->next_publish_seq(count);
+                            for (unsigned i = 0; i < count; ++i)
+                            {
+                                p_storage_->update_last_value(first_seq + i, messages[i].c_str(), messages[i].length());
+                            }
+                            LOG_TRACE("number of connected pub clients: %u", get_num_pub_clients());
+                            if (pub_transport.valid() && get_num_pub_clients() > 0)
                             {
-                                result = psocket->write_msg(message.c_str(), message.length());
+                                pub_transport.send_batch_seq(messages, count, first_seq);
                             }
                             else
                             {
                                 LOG_DEBUG("No clients are connected to pub socket. Not sending message");
                             }
+                            if (mcast_transport.valid())
+                            {
+                                mcast_transport.send_batch_seq(messages, count, first_seq);
+                            }
+                        }
+                        if (latency_target_us > 0)
+                        {
+                            batch.update(p_storage_->get_queue_size(), count,
+                                         (utils::get_currenttime_nanoseconds() - waiting_since_ns) / 1000);
                         }
                     }
                 }
@@ -287,85 +395,297 @@ namespace myq
         }
 
         /**
-         * send file to socket
-         * @param p_consumer_socket
-         * @return
+         * wait until the queue holds a full batch, or its oldest message has waited the linger time.
+         * Idle polls are short enough for the latency target
+         * @param batch
+         * @param waiting_since_ns set to when the oldest message in the queue was enqueued
          */
-        ssize_t sendfile_to_socket(uint32_t bytes_to_send = utils::max_msg_size)
+        void wait_for_batch(adaptive_batch &batch, uint64_t &waiting_since_ns)
         {
-            LOG_IN("");
-            ssize_t result = 0;
-            connection_socket *psocket = (connection_socket *)p_consumer_socket_;
-            int socket_fd = psocket->get_next_fd();
-            LOG_DEBUG("received socket fd: %d", socket_fd);
+            uint64_t poll_us = batch.get_poll_us();
+            uint64_t poll_start_ns = utils::get_currenttime_nanoseconds();
+            while (p_storage_->get_queue_size() <= 0 && backlog_.empty() && !stop_)
+            {
+                poll_start_ns = utils::get_currenttime_nanoseconds();
+                utils::sleep_us(poll_us);
+            }
+            // the head of a backlog may have waited much longer than this poll
+            waiting_since_ns = p_storage_->get_oldest_enqueue_ns();
+            if (waiting_since_ns == 0)
+            {
+                waiting_since_ns = poll_start_ns;
+            }
+            uint64_t linger_end_ns = waiting_since_ns + batch.get_linger_us() * 1000;
+            while (p_storage_->get_queue_size() < batch.get_batch_size() && !stop_ &&
+                   utils::get_currenttime_nanoseconds() < linger_end_ns)
+            {
+                utils::sleep_us(std::max<uint64_t>(1, batch.get_linger_us() / 4));
+            }
+        }
 
-            if (socket_fd < 0)
+        /**
+         * dispatch batch to pull clients, conflating by key while they are backlogged.
+         * the backlog goes out first; a new message is only queued if the socket would block,
+         * replacing any pending message for its key. messages without a key are not conflated
+         * and wait for the consumer, as in normal delivery
+         * @param consumer_transport
+         * @param messages
+         * @param count
+         * @return number of backlogged messages delivered
+         */
+        ssize_t dispatch_conflated(transport<connection_zmq> &consumer_transport,
+                                   const std::string *messages, unsigned count)
+        {
+            LOG_IN("count[%u], backlog[%u]", count, backlog_.size());
+            ssize_t delivered = flush_backlog(consumer_transport, false);
+            for (unsigned i = 0; i < count; ++i)
             {
-                LOG_ERROR("No consumer to send data");
-                LOG_RET("no consumer to send data", 0);
+                const std::string &message = messages[i];
+                if (!utils::get_message_key(message.data(), message.length(),
+                                            p_storage_->get_config().key_delimiter_, conflation_key_))
+                {
+                    if (get_num_pull_clients() > 0)
+                    {
+                        flush_backlog(consumer_transport, true);
+                        consumer_transport.send(message);
+                    }
+                    continue;
+                }
+                if (backlog_.empty() && consumer_transport.try_send(message.data(), message.length()) != 0)
+                {
+                    continue;
+                }
+                backlog_.put(conflation_key_, message.data(), message.length());
             }
+            LOG_RET("", delivered);
+        }
 
-            uint64_t offset = psocket->get_write_offset();
+        /**
+         * conflation needs a non blocking send; raw socket consumers keep normal delivery
+         * @param consumer_transport
+         * @param messages
+         * @param count
+         * @return
+         */
+        ssize_t dispatch_conflated(transport<connection_socket> &consumer_transport,
+                                   const std::string *messages, unsigned count)
+        {
+            LOG_IN("count[%u]", count);
+            if (count > 0 && get_num_pull_clients() > 0)
+            {
+                consumer_transport.send_batch(messages, count);
+            }
+            LOG_RET("", 0);
+        }
 
-            LOG_DEBUG("Write offset: %llu", offset);
-            result = -1;
-            while (result < 0)
+        /**
+         * send pending conflated messages in key order
+         * @param consumer_transport
+         * @param block wait for the consumer instead of stopping at the first send that would block
+         * @return number of messages sent
+         */
+        ssize_t flush_backlog(transport<connection_zmq> &consumer_transport, bool block)
+        {
+            ssize_t sent = 0;
+            while (!backlog_.empty())
             {
-                result = p_storage_->get_file_connection()->send_file(socket_fd, offset, bytes_to_send);
-                if (result == -1)
+                const std::string &message = backlog_.front();
+                ssize_t result = block ? consumer_transport.send(message)
+                                       : consumer_transport.try_send(message.data(), message.length());
+                if (result < 0)
                 {
-                    LOG_ERROR("Failed to read file for socket fd:%d", socket_fd);
-                    psocket->remove_fd(socket_fd);
+                    LOG_ERROR("Failed to send conflated message on topic[%s]", config_.id_.c_str());
                     break;
                 }
-                else
+                if (result == 0 && !block)
                 {
-                    LOG_DEBUG("Read %u bytes", result);
-                    psocket->set_write_offset(offset + result);
-                    p_storage_->add_total_bytes_read(result);
+                    break;
                 }
+                backlog_.pop_front();
+                ++sent;
             }
-            LOG_RET("", result);
+            return sent;
         }
 
         /**
-         * send file to socket
-         * @param p_consumer_socket
+         * number of messages replaced by a newer message for the same key before delivery
          * @return
          */
-        ssize_t sendfile_to_socket(int socket_fd, uint32_t offset, uint32_t bytea_to_send = utils::max_msg_size)
+        inline uint64_t get_messages_conflated() const
         {
-            LOG_IN("socket_fd[%d], offset[%u], bytea_to_send[%u]",
-                   socket_fd, offset, bytea_to_send);
-            ssize_t result = 0;
-            connection_socket *psocket = (connection_socket *)p_consumer_socket_;
-            result = -1;
-            while (result < 0)
-            {
-                result = p_storage_->get_file_connection()->send_file(socket_fd, offset, bytea_to_send);
-                if (result == -1)
+            return backlog_.get_conflated();
+        }
+
+        /**
+         * Egress thread of a file topic: serves its share of the raw socket consumers until stopped
+         * @param shard
+         */
+        void process_egress(egress_shard &shard)
+        {
+            LOG_IN("shard[%u]", shard.index_);
+            while (!stop_)
+            {
+                dispatch_from_file(p_raw_socket_, shard);
+            }
+            LOG_OUT("");
+        }
+
+        /**
+         * dispatch the file log to raw socket consumers (sendfile), the consumer thread's share
+         * @param consumer_transport
+         * @return bytes sent, 0 if no consumer had pending data
+         */
+        ssize_t dispatch_from_file(transport<connection_socket> &consumer_transport,
+                                   transport<connection_zmq> & /*pub_transport*/,
+                                   transport<connection_multicast> & /*mcast_transport*/)
+        {
+            return dispatch_from_file(consumer_transport.get(), egress_shards_[0]);
+        }
+
+        /**
+         * dispatch the file log to the raw socket consumers of a shard (sendfile).
+         * every connection keeps its own position in the log and is served when it can take more data:
+         * a consumer lagging by catchup_threshold or more gets catchup_chunk_size per call so it drains the
+         * backlog with few syscalls, a consumer near the tail gets at most max_msg_size for low latency.
+         * shards only read the log segments, so they run in parallel on their own connections
+         * @param psocket
+         * @param shard
+         * @return bytes sent, 0 if no consumer had pending data
+         */
+        ssize_t dispatch_from_file(connection_socket *psocket, egress_shard &shard)
+        {
+            LOG_IN("shard[%u]", shard.index_);
+            std::vector<connection_socket::client_cursor> &cursors = shard.cursors_;
+            std::vector<pollfd> &pollfds = shard.pollfds_;
+            uint64_t total_written = p_storage_->get_file_total_bytes_written();
+            psocket->get_cursors(cursors, shard.index_, shard.count_);
+            // keep only consumers behind the log, pollfds[i] belongs to cursors[i]
+            pollfds.clear();
+            unsigned pending = 0;
+            for (unsigned i = 0; i < cursors.size(); ++i)
+            {
+                if (cursors[i].offset_ < total_written)
                 {
-                    LOG_ERROR("Failed to read file for socket fd:%d", socket_fd);
-                    psocket->remove_fd(socket_fd);
-                    break;
+                    pollfd pfd;
+                    pfd.fd = cursors[i].fd_;
+                    pfd.events = POLLOUT;
+                    pfd.revents = 0;
+                    pollfds.push_back(pfd);
+                    cursors[pending++] = cursors[i];
                 }
-                else
+            }
+            if (pollfds.empty())
+            {
+                utils::sleep_ms(utils::queue_poll_wait);
+                LOG_RET("nothing to send", 0);
+            }
+            int ready = poll(pollfds.data(), pollfds.size(), utils::queue_poll_wait);
+            if (ready <= 0)
+            {
+                LOG_RET("no consumer ready", 0);
+            }
+
+            ssize_t total_sent = 0;
+            for (unsigned i = 0; i < pollfds.size(); ++i)
+            {
+                int fd = pollfds[i].fd;
+                if (pollfds[i].revents & (POLLERR | POLLHUP | POLLNVAL))
+                {
+                    LOG_EVENT("Consumer fd %d disconnected", fd);
+                    psocket->remove_fd(fd);
+                    close(fd);
+                    continue;
+                }
+                if (!(pollfds[i].revents & POLLOUT))
+                {
+                    continue;
+                }
+                uint64_t offset = cursors[i].offset_;
+                uint64_t lag = total_written - offset;
+                uint64_t chunk = lag >= utils::catchup_threshold ? utils::catchup_chunk_size : utils::max_msg_size;
+                ssize_t result = p_storage_->get_file_connection()->send_file(fd, offset, std::min(lag, chunk));
+                if (result < 0)
                 {
-                    LOG_DEBUG("Read %u bytes", result);
-                    psocket->set_write_offset(offset + result);
-                    p_storage_->add_total_bytes_read(result);
+                    LOG_ERROR("Failed to send file to socket fd:%d", fd);
+                    psocket->remove_fd(fd);
+                    close(fd);
+                    continue;
                 }
+                LOG_TRACE("fd[%d] offset[%llu] lag[%llu] sent[%lld]", fd, offset, lag, (long long)result);
+                psocket->set_offset(fd, offset + result);
+                p_storage_->add_total_bytes_read(result);
+                total_sent += result;
             }
-            LOG_RET("", result);
+            LOG_RET("", total_sent);
         }
 
         /**
-         * get_consumer_socket
+         * dispatch next message of the file log to zmq consumers.
+         * pull clients get the payload, pub subscribers get it stamped with its position in the log.
+         * multicast packs messages into datagrams and flushes once it has caught up with the log
+         * @param consumer_transport
+         * @param pub_transport
+         * @param mcast_transport
          * @return
          */
-        connection *get_consumer_socket()
+        ssize_t dispatch_from_file(transport<connection_zmq> &consumer_transport,
+                                   transport<connection_zmq> &pub_transport,
+                                   transport<connection_multicast> &mcast_transport)
         {
-            return p_consumer_socket_;
+            LOG_IN("");
+            while (p_storage_->get_file_total_bytes_written() <=
+                       p_storage_->get_total_bytes_read() + sizeof(uint32_t) ||
+                   (get_num_pull_clients() == 0 && get_num_pub_clients() == 0 && !mcast_transport.valid()))
+            {
+                utils::sleep_ms(
+                    utils::queue_poll_wait); // define magic number fixme may be implement condition variabl
+            }
+            LOG_TRACE("file_total_bytes_written[%lld], file_total_bytes_read[%lld]",
+                      p_storage_->get_file_total_bytes_written(), p_storage_->get_total_bytes_read());
+            const char *p_payload = NULL;
+            uint64_t seq = 0;
+            ssize_t length = p_storage_->read_next_file_msg(p_payload, seq, false);
+            if (length <= 0)
+            {
+                LOG_RET("", length);
+            }
+            p_storage_->update_last_value(seq, p_payload, length);
+            if (consumer_transport.valid() && get_num_pull_clients() > 0)
+            {
+                consumer_transport.send(p_payload, length);
+            }
+            if (pub_transport.valid() && get_num_pub_clients() > 0)
+            {
+                pub_transport.send_seq(seq, p_payload, length);
+            }
+            if (mcast_transport.valid())
+            {
+                mcast_transport.send_seq(seq, p_payload, length);
+                if (p_storage_->get_file_total_bytes_written() <=
+                    p_storage_->get_total_bytes_read() + sizeof(uint32_t))
+                {
+                    mcast_transport.flush();
+                }
+            }
+            LOG_RET("", length);
+        }
+
+        /**
+         * get zmq push socket, NULL if consumer is raw socket
+         * @return
+         */
+        connection_zmq *get_zmq_consumer_socket()
+        {
+            return p_push_socket_;
+        }
+
+        /**
+         * get raw consumer socket, NULL if consumer is zmq
+         * @return
+         */
+        connection_socket *get_raw_consumer_socket()
+        {
+            return p_raw_socket_;
         }
 
         std::string get_pub_bind_uri()
@@ -378,12 +698,25 @@ namespace myq
             return config_.push_bind_uri_;
         }
 
+        std::string get_sync_bind_uri()
+        {
+            return config_.sync_bind_uri_;
+        }
+
+        /**
+         * multicast group of the pub stream, empty if the consumer has no multicast egress
+         * @return
+         */
+        std::string get_multicast_uri()
+        {
+            return p_mcast_socket_ ? config_.multicast_uri_ : std::string();
+        }
+
         unsigned get_num_pub_clients()
         {
-            if (p_consumer_pub_socket)
+            if (p_pub_socket_)
             {
-                connection_zmq *psocket = (connection_zmq *)p_consumer_pub_socket;
-                return psocket->get_num_connected_clients();
+                return p_pub_socket_->get_num_connected_clients();
             }
             else
             {
@@ -391,25 +724,57 @@ namespace myq
             }
         }
 
-        unsigned get_num_pull_clients()
+        /**
+         * cpu time of the thread dispatching to consumers and of the threads serving their connections
+         * (accepting socket consumers, retransmission requests)
+         * @return nanoseconds
+         */
+        uint64_t get_cpu_time_ns()
         {
-            if (p_consumer_socket_)
+            if (!running_)
             {
-                if (config_.stream_type_ == connection::stream_zmq)
-                {
-                    connection_zmq *psocket = (connection_zmq *)p_consumer_socket_;
-                    return psocket->get_num_connected_clients();
-                }
-                else if (config_.stream_type_ == connection::stream_socket)
-                {
-                    connection_socket *psocket = (connection_socket *)p_consumer_socket_;
-                    return psocket->get_total_connected_clients();
-                }
+                return 0;
             }
-            else
+            uint64_t cpu_ns = utils::get_thread_cpu_nanoseconds(consumer_tid_);
+            if (p_raw_socket_)
+            {
+                cpu_ns += p_raw_socket_->get_cpu_time_ns();
+            }
+            if (p_sync_endpoint_)
+            {
+                cpu_ns += p_sync_endpoint_->get_cpu_time_ns();
+            }
+            return cpu_ns;
+        }
+
+        /**
+         * cpu time of the egress threads past the first share
+         * @return nanoseconds
+         */
+        uint64_t get_egress_cpu_time_ns()
+        {
+            if (!running_)
             {
                 return 0;
             }
+            uint64_t cpu_ns = 0;
+            for (unsigned i = 0; i < egress_tids_.size(); ++i)
+            {
+                cpu_ns += utils::get_thread_cpu_nanoseconds(egress_tids_[i]);
+            }
+            return cpu_ns;
+        }
+
+        unsigned get_num_pull_clients()
+        {
+            if (p_push_socket_)
+            {
+                return p_push_socket_->get_num_connected_clients();
+            }
+            else if (p_raw_socket_)
+            {
+                return p_raw_socket_->get_total_connected_clients();
+            }
             return 0;
         }
 
@@ -417,11 +782,18 @@ namespace myq
         broker_storage *p_storage_;
         consumer_config config_;
         connection::endpoint_type consumer_endpoint_type_;
-        connection *p_consumer_socket_;
-        connection *p_consumer_pub_socket; // zqm only
-        bool stop_;
+        connection_zmq *p_push_socket_;
+        connection_zmq *p_pub_socket_; // zqm only
+        connection_socket *p_raw_socket_;
+        sync_endpoint *p_sync_endpoint_; // zqm only
+        connection_multicast *p_mcast_socket_; // zqm only
+        conflation_map backlog_;
+        std::string conflation_key_;
+        std::vector<egress_shard> egress_shards_; // file topics over raw sockets, one per egress thread
+        std::atomic<bool> stop_;
         std::thread consumer_tid_;
-        bool running_;
+        std::vector<std::thread> egress_tids_; // egress threads past the first share
+        std::atomic<bool> running_;            // threads started, their cpu time can be read
     };
 }
 
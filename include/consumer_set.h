@@ -0,0 +1,211 @@
+/*
+ * File:   consumer_set.h
+ *
+ *
+ * Created on October 20, 2026, 5:50 AM
+ */
+
+#ifndef CONSUMER_SET_H
+#define CONSUMER_SET_H
+
+#include <string>
+#include <vector>
+#include "log.h"
+#include "utils.h"
+#include "connection_zmq.h"
+#include "connection_socket.h"
+using namespace mymq;
+namespace myq
+{
+
+    /**
+     * consumer_set
+     * Consumer connections of many topics read by one thread. A receive polls every member with one
+     * zmq_poll call, then takes one message from each ready member per pass, in turn, until the caller's
+     * buffers are full or no member has more. The next receive starts after the last member served, so
+     * a busy topic can't starve the others.
+     * Members are zmq consumers (pull) or socket consumers. Reads never block: a socket member keeps the
+     * part of a message that arrived until the rest does, and a message larger than the caller's buffer
+     * is dropped. Not thread safe.
+     */
+    class consumer_set
+    {
+    public:
+        consumer_set() : next_(0)
+        {
+        }
+
+        /**
+         * add a zmq consumer
+         * @param topic
+         * @param p_conn
+         * @param p_handle caller's handle of the member, see get_handle
+         */
+        void add(const std::string &topic, connection_zmq *p_conn, void *p_handle)
+        {
+            LOG_IN("topic[%s], p_conn[%p]", topic.c_str(), p_conn);
+            member m = {topic, p_conn, NULL, p_handle};
+            members_.push_back(m);
+            zmq_pollitem_t item = {p_conn->get_socket_handle(), 0, ZMQ_POLLIN, 0};
+            items_.push_back(item);
+            LOG_OUT("");
+        }
+
+        /**
+         * add a socket consumer
+         * @param topic
+         * @param p_conn
+         * @param p_handle caller's handle of the member, see get_handle
+         */
+        void add(const std::string &topic, connection_socket *p_conn, void *p_handle)
+        {
+            LOG_IN("topic[%s], p_conn[%p]", topic.c_str(), p_conn);
+            member m = {topic, NULL, p_conn, p_handle};
+            members_.push_back(m);
+            zmq_pollitem_t item = {NULL, p_conn->get_socket_fd(), ZMQ_POLLIN, 0};
+            items_.push_back(item);
+            LOG_OUT("");
+        }
+
+        inline unsigned size() const
+        {
+            return members_.size();
+        }
+
+        inline void *get_handle(unsigned index) const
+        {
+            return members_[index].p_handle;
+        }
+
+        inline const std::string &get_topic(unsigned index) const
+        {
+            return members_[index].topic;
+        }
+
+        /**
+         * receive up to count messages from the members
+         * @param buffers
+         * @param buffer_lengths
+         * @param lengths set to the length of each message received
+         * @param indexes set to the member each message came from
+         * @param count
+         * @param timeout_ms wait for the first message, -1 to wait until one arrives. A member that is ready
+     *        with only part of a message doesn't end the wait
+         * @return messages received, 0 on timeout, -1 on error
+         */
+        int receive(char **buffers, const uint32_t *buffer_lengths, uint32_t *lengths, unsigned *indexes,
+                    unsigned count, int timeout_ms)
+        {
+            LOG_IN("count[%u], timeout_ms[%d]", count, timeout_ms);
+            if (members_.empty() || count == 0)
+            {
+                LOG_RET("nothing to receive", 0);
+            }
+            unsigned received = 0;
+            long timeout = timeout_ms;
+            uint64_t deadline_ms = utils::get_currenttime_milliseconds() + (timeout_ms > 0 ? timeout_ms : 0);
+            while (received < count)
+            {
+                int ready = zmq_poll(&items_[0], items_.size(), timeout);
+                if (ready < 0)
+                {
+                    if (zmq_errno() == EINTR && received == 0)
+                    {
+                        continue;
+                    }
+                    LOG_ERROR("Failed to poll consumers. Error number :%d, Description :%s", zmq_errno(),
+                              zmq_strerror(zmq_errno()));
+                    if (received == 0)
+                    {
+                        LOG_RET("error", -1);
+                    }
+                    break;
+                }
+                if (ready == 0)
+                {
+                    break;
+                }
+                // one message per ready member, in turn from next_
+                unsigned start = next_;
+                unsigned before = received;
+                for (unsigned i = 0; i < members_.size() && received < count; ++i)
+                {
+                    unsigned index = (start + i) % members_.size();
+                    if (!(items_[index].revents & (ZMQ_POLLIN | ZMQ_POLLERR)))
+                    {
+                        continue;
+                    }
+                    uint32_t length = 0;
+                    int result = read(index, buffers[received], buffer_lengths[received], length);
+                    if (result < 0)
+                    {
+                        LOG_ERROR("Failed to receive from topic[%s]", members_[index].topic.c_str());
+                        if (received == 0)
+                        {
+                            LOG_RET("error", -1);
+                        }
+                        next_ = (index + 1) % members_.size();
+                        LOG_RET("received before error", received);
+                    }
+                    if (result == 0)
+                    {
+                        continue;
+                    }
+                    lengths[received] = length;
+                    indexes[received] = index;
+                    ++received;
+                    next_ = (index + 1) % members_.size();
+                }
+                if (received > before)
+                {
+                    timeout = 0; // take what else is ready, without waiting
+                    continue;
+                }
+                if (received > 0)
+                {
+                    break; // ready members had no whole message yet
+                }
+                // nothing whole arrived yet (part of a message, or one dropped): wait for the rest of the timeout
+                if (timeout_ms >= 0)
+                {
+                    uint64_t now_ms = utils::get_currenttime_milliseconds();
+                    if (now_ms >= deadline_ms)
+                    {
+                        break;
+                    }
+                    timeout = deadline_ms - now_ms;
+                }
+            }
+            LOG_RET("", received);
+        }
+
+    private:
+        struct member
+        {
+            std::string topic;
+            connection_zmq *p_zmq;
+            connection_socket *p_socket;
+            void *p_handle;
+        };
+        std::vector<member> members_;
+        std::vector<zmq_pollitem_t> items_; // one per member, same order
+        unsigned next_;                     // member to serve first
+
+        /**
+         * read a message of a member without blocking
+         * @param index
+         * @param buffer
+         * @param buffer_length
+         * @param length set to the length of the message read, which may be 0
+         * @return 1 if a message was read, 0 if no whole message waited, -1 on error
+         */
+        int read(unsigned index, char *buffer, uint32_t buffer_length, uint32_t &length)
+        {
+            member &m = members_[index];
+            return m.p_zmq ? m.p_zmq->read_msg_nowait(buffer, buffer_length, length)
+                           : m.p_socket->read_msg_nowait(buffer, buffer_length, length);
+        }
+    };
+}
+
+#endif /* CONSUMER_SET_H */
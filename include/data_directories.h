@@ -0,0 +1,130 @@
+/*
+ * File:   data_directories.h
+ *
+ *
+ * Created on October 19, 2026, 10:50 PM
+ */
+
+#ifndef DATA_DIRECTORIES_H
+#define DATA_DIRECTORIES_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <atomic>
+#include <unistd.h>
+#include "log.h"
+#include "io_thread.h"
+
+namespace myq
+{
+
+    /**
+     * data_directories
+     * Directories (typically one per disk) the broker keeps topic logs in, and how segments are placed
+     * on them: each topic on the next directory in turn, or each topic's segments striped across all of them.
+     * Every directory has its own I/O thread for the work that waits on the device (syncing a segment
+     * once it is full), so writers never block on a sync and several disks sync in parallel.
+     */
+    class data_directories
+    {
+    public:
+        enum placement
+        {
+            place_topics,   // round robin topics across directories
+            stripe_segments // round robin the segments of every topic across directories
+        };
+
+        data_directories() : placement_(place_topics), next_topic_(0)
+        {
+        }
+
+        ~data_directories()
+        {
+            for (unsigned i = 0; i < dirs_.size(); ++i)
+            {
+                delete dirs_[i]; // runs what is left on its I/O thread
+            }
+        }
+
+        /**
+         * set directories and start their I/O threads. Only once, before topics are created
+         * @param paths
+         * @param policy
+         * @return false if a directory is not writable or directories were already set
+         */
+        bool init(const std::vector<std::string> &paths, placement policy)
+        {
+            LOG_IN("paths[%u], policy[%d]", paths.size(), policy);
+            if (!dirs_.empty() || paths.empty())
+            {
+                LOG_RET_FALSE("Data directories already set or empty");
+            }
+            for (unsigned i = 0; i < paths.size(); ++i)
+            {
+                if (access(paths[i].c_str(), W_OK) != 0)
+                {
+                    LOG_ERROR("Data directory %s is not writable. Err: %d, ErrDesc: %s",
+                              paths[i].c_str(), errno, strerror(errno));
+                    LOG_RET_FALSE("failed");
+                }
+            }
+            placement_ = policy;
+            for (unsigned i = 0; i < paths.size(); ++i)
+            {
+                directory *p_dir = new directory();
+                p_dir->path_ = paths[i];
+                dirs_.push_back(p_dir);
+                LOG_EVENT("Data directory %u: %s", i, paths[i].c_str());
+            }
+            LOG_RET_TRUE("");
+        }
+
+        inline unsigned size() const
+        {
+            return dirs_.size();
+        }
+
+        inline const std::string &get_path(unsigned index) const
+        {
+            return dirs_[index % dirs_.size()]->path_;
+        }
+
+        inline placement get_placement() const
+        {
+            return placement_;
+        }
+
+        /**
+         * directory for the next topic (and, when striping, for its first segment)
+         * @return
+         */
+        inline unsigned next_topic_directory()
+        {
+            return next_topic_++ % dirs_.size();
+        }
+
+        /**
+         * run a task on the I/O thread of a directory
+         * @param index
+         * @param task
+         */
+        void submit(unsigned index, const std::function<void()> &task)
+        {
+            dirs_[index % dirs_.size()]->io_.submit(task);
+        }
+
+    private:
+        struct directory
+        {
+            std::string path_;
+            io_thread io_;
+        };
+
+        std::vector<directory *> dirs_;
+        placement placement_;
+        std::atomic<unsigned> next_topic_;
+    };
+}
+
+#endif /* DATA_DIRECTORIES_H */
@@ -0,0 +1,254 @@
+/*
+ * File:   fd_cache.h
+ *
+ *
+ * Created on October 20, 2026, 5:10 AM
+ */
+
+#ifndef FD_CACHE_H
+#define FD_CACHE_H
+
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
+#include <fcntl.h>
+#include <unistd.h>
+#include "log.h"
+#include "utils.h"
+#include "file_details.h"
+using namespace mymq;
+namespace myq
+{
+
+    /**
+     * fd_cache
+     * Bounds the file descriptors the broker keeps open for full (sealed) log segments. The segment
+     * being written stays open; sealed segments keep their metadata in memory, but only the most recently
+     * read ones keep their fd. A cold segment is reopened read only when it is read again.
+     * Replacement is the clock approximation of LRU, so a read of an open segment takes no lock: the
+     * reader counts itself in the segment's users while it uses the fd, and a segment is only closed
+     * while it has no users. A reader that finds it closed reopens it under the cache lock.
+     */
+    class fd_cache
+    {
+    public:
+        static const uint32_t closed_ = 0x80000000; // set in file_details::users_ while the fd is closed
+
+        /**
+         * holds a segment's fd open for one read
+         */
+        class lease
+        {
+        public:
+            /**
+             * @param p_cache NULL to use the fd as is
+             * @param p_segment
+             */
+            lease(fd_cache *p_cache, file_details *p_segment)
+                : p_cache_(p_cache), p_segment_(p_segment), ok_(true), missed_(false)
+            {
+                if (p_cache_)
+                {
+                    ok_ = p_cache_->acquire(p_segment_, missed_);
+                }
+            }
+
+            ~lease()
+            {
+                if (p_cache_ && ok_)
+                {
+                    p_cache_->release(p_segment_);
+                }
+            }
+
+            inline bool ok() const
+            {
+                return ok_;
+            }
+
+            /**
+             * the segment had to be reopened
+             * @return
+             */
+            inline bool missed() const
+            {
+                return missed_;
+            }
+
+        private:
+            fd_cache *p_cache_;
+            file_details *p_segment_;
+            bool ok_;
+            bool missed_;
+        };
+
+        fd_cache() : capacity_(utils::default_open_segments), hand_(0), open_(0)
+        {
+        }
+
+        /**
+         * sealed segments that may keep their fd open, broker wide
+         * @param capacity at least 1
+         */
+        void set_capacity(uint32_t capacity)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            capacity_ = std::max<uint32_t>(1, capacity);
+            evict_locked();
+        }
+
+        inline uint32_t get_capacity() const
+        {
+            return capacity_;
+        }
+
+        /**
+         * sealed segments with an open fd
+         * @return
+         */
+        inline uint32_t get_open() const
+        {
+            return open_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * take a segment that was just sealed (fd open) into the cache
+         * @param p_segment
+         */
+        void add(file_details *p_segment)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            p_segment->referenced_.store(true, std::memory_order_relaxed);
+            ring_.push_back(p_segment);
+            ++open_;
+            evict_locked();
+        }
+
+        /**
+         * drop a segment before it is closed and deleted. Its fd is left as it is
+         * @param p_segment
+         */
+        void remove(file_details *p_segment)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (unsigned i = 0; i < ring_.size(); ++i)
+            {
+                if (ring_[i] != p_segment)
+                {
+                    continue;
+                }
+                if (!(p_segment->users_.load(std::memory_order_acquire) & closed_))
+                {
+                    --open_;
+                }
+                ring_.erase(ring_.begin() + i);
+                if (hand_ > i)
+                {
+                    --hand_;
+                }
+                break;
+            }
+        }
+
+    private:
+        std::mutex mutex_;
+        uint32_t capacity_;
+        std::vector<file_details *> ring_; // sealed segments, open or not
+        unsigned hand_;                    // clock hand into ring_
+        std::atomic<uint32_t> open_;
+
+        /**
+         * make the fd of a segment usable until release
+         * @param p_segment
+         * @param missed set if it had to be reopened
+         * @return false if it can't be reopened
+         */
+        bool acquire(file_details *p_segment, bool &missed)
+        {
+            uint32_t users = p_segment->users_.fetch_add(1, std::memory_order_acq_rel);
+            if (!(users & closed_))
+            {
+                p_segment->referenced_.store(true, std::memory_order_relaxed);
+                return true;
+            }
+            p_segment->users_.fetch_sub(1, std::memory_order_acq_rel);
+            if (!reopen(p_segment))
+            {
+                return false;
+            }
+            missed = true;
+            return true;
+        }
+
+        inline void release(file_details *p_segment)
+        {
+            p_segment->users_.fetch_sub(1, std::memory_order_release);
+        }
+
+        /**
+         * reopen a closed segment read only and count the caller in its users, then close others over
+         * capacity. Being in use, the segment itself can't be closed by that sweep
+         * @param p_segment
+         * @return false if it can't be reopened, the caller is not counted then
+         */
+        bool reopen(file_details *p_segment)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!(p_segment->users_.load(std::memory_order_acquire) & closed_))
+            {
+                // another reader reopened it, and only the sweep under this lock closes it
+                p_segment->users_.fetch_add(1, std::memory_order_acq_rel);
+                p_segment->referenced_.store(true, std::memory_order_relaxed);
+                return true;
+            }
+            int fd = open(p_segment->file_name_.c_str(), O_RDONLY);
+            if (fd < 0)
+            {
+                LOG_ERROR("Failed to reopen file[%s]. Err: %d, ErrDesc: %s",
+                          p_segment->file_name_.c_str(), errno, strerror(errno));
+                return false;
+            }
+            p_segment->fd_ = fd;
+            p_segment->referenced_.store(true, std::memory_order_relaxed);
+            p_segment->users_.fetch_add(1, std::memory_order_acq_rel);
+            p_segment->users_.fetch_and(~closed_, std::memory_order_release);
+            ++open_;
+            evict_locked();
+            return true;
+        }
+
+        /**
+         * close segments until no more than capacity_ are open. A segment read since the hand last
+         * passed gets another round; one in use is skipped
+         */
+        void evict_locked()
+        {
+            for (unsigned steps = 0; open_.load(std::memory_order_relaxed) > capacity_ && steps < 2 * ring_.size(); ++steps)
+            {
+                if (hand_ >= ring_.size())
+                {
+                    hand_ = 0;
+                }
+                file_details *p_segment = ring_[hand_++];
+                if (p_segment->users_.load(std::memory_order_relaxed) & closed_)
+                {
+                    continue;
+                }
+                if (p_segment->referenced_.exchange(false, std::memory_order_relaxed))
+                {
+                    continue;
+                }
+                uint32_t unused = 0;
+                if (p_segment->users_.compare_exchange_strong(unused, closed_, std::memory_order_acq_rel))
+                {
+                    ::close(p_segment->fd_);
+                    p_segment->fd_ = -1;
+                    --open_;
+                }
+            }
+        }
+    };
+}
+
+#endif /* FD_CACHE_H */
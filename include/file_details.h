@@ -18,12 +18,14 @@
 #include <netinet/in.h>
 #endif
 
+#include <atomic>
 #include "utils.h"
 
 namespace myq {
   //class connection info
   class file_details {
       friend class connection_file;
+      friend class fd_cache;
 
   public:
 
@@ -34,6 +36,8 @@ namespace myq {
           write_counter_ = 0;
           fd_ = -1;
           bytes_written_across_all_files_ = 0;
+          users_ = 0;
+          referenced_ = false;
           LOG_OUT("");
       }
 
@@ -88,23 +92,20 @@ namespace myq {
       }
 
       /**
-       * send file
+       * send file. size is clamped to the end of this file only, callers pick the chunk size
        * @param socket
        * @param offset
        * @param size
-       * @return
+       * @return bytes sent, 0 if the socket would block, -1 on error
        */
       ssize_t send_file(int socket, uint64_t offset, uint64_t size) {
-          LOG_IN("socket[%d], offset[%llu],  size[%u]", socket, offset, size);
-          LOG_DEBUG("Reading %llu  bytes from offset[%llu]", size, offset);
-          LOG_DEBUG("Current file offset[ %llu]", offset_);
-          if (size > utils::max_msg_size) {
-              size = utils::max_msg_size;
-          }
-          if (size + offset > offset_) {
-              size = offset_ - offset;
+          LOG_IN("socket[%d], offset[%llu],  size[%llu]", socket, offset, size);
+          uint64_t file_end = offset_.load(std::memory_order_acquire);
+          LOG_DEBUG("Current file offset[ %llu]", file_end);
+          if (size + offset > file_end) {
+              size = file_end - offset;
               LOG_DEBUG("offset [ %llu] + size[%llu] > offset_[%llu]. Setting size as offset_ - offset[%llu] ",
-                        offset, size, offset_, size);
+                        offset, size, file_end, size);
           }
           LOG_DEBUG("Reading %llu  bytes from offset[%llu]", size, offset);
           if (size <= 0) {
@@ -113,29 +114,27 @@ namespace myq {
           }
 
 
-          off_t size_offset = size;
 #ifdef __APPLE__
-
-          LOG_DEBUG("Reading %llu  bytes from offset[%llu]", size, offset);
+          off_t size_offset = size;
           ssize_t result = sendfile(fd_, socket, offset, &size_offset, NULL, 0);
-          if (result == 0 || result == EAGAIN) {
+          if (result == 0 || errno == EAGAIN) {
               LOG_DEBUG("Sendfile success, Read number of bytes [%u]", size_offset)
               LOG_RET("success", size_offset);
           }
-          LOG_DEBUG("Reading %llu  bytes from offset[%llu]", size, offset);
           LOG_ERROR("Failed to sendfile. Current fd[%d], socket_fd[%d], errnum[%d] error_desc[%s]",
-                    fd_, socket, result, strerror(result));
+                    fd_, socket, errno, strerror(errno));
           LOG_RET("failed", -1);
 #else
-           ssize_t result = sendfile(socket, fd_, &size_offset, size);
+           off_t file_offset = offset;
+           ssize_t result = sendfile(socket, fd_, &file_offset, size);
            if(result >= 0 ) {
                LOG_RET("success", result);
-           }else if(result == EAGAIN) {
+           }else if(errno == EAGAIN) { //same as EWOULDBLOCK on Linux
                LOG_RET("timeout/non-blocking", 0);
            }
            LOG_ERROR("Failed to sendfile. Current fd[%d], socket_fd[%d], errnum[%d] error_desc[%s]",
-                   fd_, socket, result, strerror(result));
-           
+                   fd_, socket, errno, strerror(errno));
+
            LOG_RET("failed", -1);
 #endif
       }
@@ -314,13 +313,24 @@ namespace myq {
 
   private:
 
+      //sparse append time index entry: records from offset_ (across all files) on were appended at or after timestamp_
+      struct time_index_entry {
+          uint64_t timestamp_;
+          uint64_t offset_;
+      };
+
       int fd_;
+      //readers using fd_ (fd_cache::closed_ is set while a sealed segment's fd is closed), see fd_cache
+      std::atomic<uint32_t> users_;
+      std::atomic<bool> referenced_; //read since the fd_cache clock hand last passed
       //this track offset for total bytes written across all the files
       //e.g if 9 bytes written across 3 files, first fd_details will have 3, 2nd will have 6 and 3rd will have 9
-      uint64_t bytes_written_across_all_files_;
+      //set by the writer once the bytes are in the file, read by any number of reader threads
+      std::atomic<uint64_t> bytes_written_across_all_files_;
       std::string file_name_;
-      uint64_t offset_;
+      std::atomic<uint64_t> offset_; //end of the file, only advanced by the writer
       uint32_t write_counter_;
+      std::vector<time_index_entry> time_index_; //guarded by connection_file::time_index_mutex_
 
       /**
        * write buffer to the file
@@ -415,8 +425,8 @@ namespace myq {
               result = pread(fd_, buffer + bytesRead, bytestoRead, offset);
               if (result < 1) {
                   LOG_ERROR("Failed to read length of the message");
-                  LOG_ERROR("offset_across_all_files_[%llu], file offset[%llu]", bytes_written_across_all_files_,
-                            offset_);
+                  LOG_ERROR("offset_across_all_files_[%llu], file offset[%llu]", bytes_written_across_all_files_.load(),
+                            offset_.load());
                   LOG_ERROR("buffer: %p, buf_size: %d, offset: %llu, ntohl_flag: %d", buffer, buf_size, offset, ntohl_flag);
                   LOG_RET("Error:", -1);
               }
@@ -0,0 +1,89 @@
+/*
+ * File:   io_thread.h
+ *
+ *
+ * Created on October 20, 2026, 4:20 AM
+ */
+
+#ifndef IO_THREAD_H
+#define IO_THREAD_H
+
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace myq
+{
+
+    /**
+     * io_thread
+     * Thread running tasks that wait on a device (syncing and creating log segments) in submission order,
+     * off the writer's path. Tasks left at shutdown still run.
+     */
+    class io_thread
+    {
+    public:
+        io_thread() : stop_(false)
+        {
+            tid_ = std::thread(
+                [this]()
+                {
+                    process_tasks();
+                });
+        }
+
+        ~io_thread()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            cond_.notify_one();
+            if (tid_.joinable())
+                tid_.join();
+        }
+
+        /**
+         * run a task on the thread
+         * @param task
+         */
+        void submit(const std::function<void()> &task)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                tasks_.push_back(task);
+            }
+            cond_.notify_one();
+        }
+
+    private:
+        std::thread tid_;
+        std::deque<std::function<void()> > tasks_;
+        std::mutex mutex_;
+        std::condition_variable cond_;
+        bool stop_;
+
+        void process_tasks()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (true)
+            {
+                cond_.wait(lock, [this]()
+                           { return stop_ || !tasks_.empty(); });
+                if (tasks_.empty())
+                {
+                    break; // stopped
+                }
+                std::function<void()> task = tasks_.front();
+                tasks_.pop_front();
+                lock.unlock();
+                task();
+                lock.lock();
+            }
+        }
+    };
+}
+
+#endif /* IO_THREAD_H */
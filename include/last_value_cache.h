@@ -0,0 +1,129 @@
+/*
+ * File:   last_value_cache.h
+ *
+ *
+ * Created on October 19, 2026, 1:20 PM
+ */
+
+#ifndef LAST_VALUE_CACHE_H
+#define LAST_VALUE_CACHE_H
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "log.h"
+
+namespace myq
+{
+
+    /**
+     * last_value_cache
+     * Latest message per key for a topic. Updated by the consumer thread as messages are published,
+     * read by the sync endpoint to give late-joining subscribers a snapshot.
+     * The map is split in stripes, each with its own lock, so updates only contend on one stripe;
+     * a snapshot takes every stripe to get a consistent cut at a single sequence number.
+     */
+    class last_value_cache
+    {
+    public:
+        struct entry
+        {
+            uint64_t seq_;
+            std::string message_;
+        };
+
+        last_value_cache() : last_seq_(0)
+        {
+        }
+
+        /**
+         * set latest message for key
+         * @param key
+         * @param seq
+         * @param message
+         * @param length
+         */
+        void update(const std::string &key, uint64_t seq, const char *message, unsigned length)
+        {
+            stripe &s = stripes_[std::hash<std::string>()(key) % num_stripes_];
+            std::lock_guard<std::mutex> lock(s.mutex_);
+            entry &e = s.map_[key];
+            e.seq_ = seq;
+            e.message_.assign(message, length);
+            if (seq > last_seq_)
+            {
+                last_seq_ = seq;
+            }
+        }
+
+        /**
+         * note a message without key, so snapshots still cover it
+         * @param seq
+         */
+        void advance(uint64_t seq)
+        {
+            std::lock_guard<std::mutex> lock(stripes_[0].mutex_);
+            if (seq > last_seq_)
+            {
+                last_seq_ = seq;
+            }
+        }
+
+        /**
+         * copy all entries
+         * @param entries
+         * @return highest sequence number reflected in the snapshot
+         */
+        uint64_t snapshot(std::vector<entry> &entries)
+        {
+            LOG_IN("");
+            for (unsigned i = 0; i < num_stripes_; ++i)
+            {
+                stripes_[i].mutex_.lock();
+            }
+            uint64_t last_seq = last_seq_;
+            for (unsigned i = 0; i < num_stripes_; ++i)
+            {
+                for (std::unordered_map<std::string, entry>::const_iterator it = stripes_[i].map_.begin();
+                     it != stripes_[i].map_.end(); ++it)
+                {
+                    entries.push_back(it->second);
+                }
+            }
+            for (unsigned i = num_stripes_; i > 0; --i)
+            {
+                stripes_[i - 1].mutex_.unlock();
+            }
+            LOG_RET("", last_seq);
+        }
+
+        /**
+         * number of keys
+         * @return
+         */
+        size_t size()
+        {
+            size_t total = 0;
+            for (unsigned i = 0; i < num_stripes_; ++i)
+            {
+                std::lock_guard<std::mutex> lock(stripes_[i].mutex_);
+                total += stripes_[i].map_.size();
+            }
+            return total;
+        }
+
+    private:
+        struct stripe
+        {
+            std::mutex mutex_;
+            std::unordered_map<std::string, entry> map_;
+        };
+
+        static const unsigned num_stripes_ = 16;
+        stripe stripes_[num_stripes_];
+        uint64_t last_seq_; // written only by the consumer thread, read with all stripes held
+    };
+}
+
+#endif /* LAST_VALUE_CACHE_H */
@@ -265,7 +265,7 @@ using namespace myq;
  */
 #define LOG_WARN(msg, ...)                                                     \
     if (log::logger().get() && log::logger()->should_log(spdlog::level::warn)) \
-        log::log_write(log::LOG_WARN, __FILE__, __LINE__, _FUNC_NAME_, msg, ##__VA_ARGS__);
+        log::log_write(log::LOG_WARNING, __FILE__, __LINE__, _FUNC_NAME_, msg, ##__VA_ARGS__);
 /**
  * LOG_EVENT logging macro
  */
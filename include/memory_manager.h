@@ -0,0 +1,193 @@
+/*
+ * File:   memory_manager.h
+ *
+ *
+ * Created on October 19, 2026, 8:05 PM
+ */
+
+#ifndef MEMORY_MANAGER_H
+#define MEMORY_MANAGER_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <map>
+#include <unistd.h>
+#include "log.h"
+
+namespace myq
+{
+
+    /**
+     * memory_manager
+     * Broker wide accounting of the memory topics hold: preallocated queue slots and buffers, messages
+     * waiting in queues and the log indexes. Every topic has an account, optionally capped by a quota,
+     * and all accounts together are capped by the broker limit.
+     * Admission control: a topic whose buffers don't fit is refused, a producer whose message doesn't
+     * fit waits until consumers drain the queue (so the pull socket backs up to the publishers), and
+     * new publishers are refused while the broker is over its limit.
+     */
+    class memory_manager
+    {
+    public:
+        struct account
+        {
+            std::string topic_;
+            uint64_t quota_;                   // 0 if bounded by the broker limit only
+            std::atomic<uint64_t> fixed_;      // preallocated queue slots and buffers
+            std::atomic<uint64_t> queued_;     // messages waiting in the queue
+            std::atomic<uint64_t> indexes_;    // seq and time indexes of the log
+            std::atomic<uint64_t> throttled_;  // messages that had to wait for memory
+
+            account() : quota_(0), fixed_(0), queued_(0), indexes_(0), throttled_(0)
+            {
+            }
+
+            inline uint64_t get_used() const
+            {
+                return fixed_.load() + queued_.load() + indexes_.load();
+            }
+        };
+
+        /**
+         * constructor
+         * @param limit bytes all topics may hold together, 0 for three quarters of physical memory
+         */
+        memory_manager(uint64_t limit = 0) : used_(0)
+        {
+            set_limit(limit);
+        }
+
+        ~memory_manager()
+        {
+            for (std::map<std::string, account *>::iterator it = accounts_.begin(); it != accounts_.end(); ++it)
+            {
+                delete it->second;
+            }
+        }
+
+        /**
+         * set broker limit
+         * @param limit bytes, 0 for three quarters of physical memory
+         */
+        void set_limit(uint64_t limit)
+        {
+            if (limit == 0)
+            {
+                limit = (uint64_t)sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE) / 4 * 3;
+            }
+            limit_ = limit;
+            LOG_EVENT("Broker memory limit is %llu bytes", limit);
+        }
+
+        /**
+         * open account for a topic and charge its preallocated buffers
+         * @param topic
+         * @param quota bytes the topic may hold, 0 for no quota
+         * @param fixed bytes preallocated by the topic
+         * @return NULL if the buffers don't fit the quota or the broker limit
+         */
+        account *open_account(const std::string &topic, uint64_t quota, uint64_t fixed)
+        {
+            LOG_IN("topic[%s], quota[%llu], fixed[%llu]", topic.c_str(), quota, fixed);
+            std::lock_guard<std::mutex> lock(mutex_);
+            if ((quota && fixed > quota) || used_ + fixed > limit_)
+            {
+                LOG_ERROR("Topic[%s] needs %llu bytes, quota %llu, broker using %llu of %llu bytes",
+                          topic.c_str(), fixed, quota, used_.load(), limit_.load());
+                LOG_RET("no memory", NULL);
+            }
+            account *p_account = new account();
+            p_account->topic_ = topic;
+            p_account->quota_ = quota;
+            p_account->fixed_ = fixed;
+            used_ += fixed;
+            accounts_[topic] = p_account;
+            LOG_RET("", p_account);
+        }
+
+        /**
+         * close account, releasing everything charged to it
+         * @param p_account
+         */
+        void close_account(account *p_account)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            used_ -= p_account->get_used();
+            accounts_.erase(p_account->topic_);
+            delete p_account;
+        }
+
+        /**
+         * charge a message about to be queued. An empty queue always takes one message,
+         * so a topic makes progress whatever its quota
+         * @param p_account
+         * @param bytes
+         * @return false if it doesn't fit the topic quota or the broker limit
+         */
+        bool try_charge(account *p_account, uint64_t bytes)
+        {
+            bool empty = p_account->queued_ == 0;
+            if (!empty && p_account->quota_ && p_account->get_used() + bytes > p_account->quota_)
+            {
+                return false;
+            }
+            if (used_.fetch_add(bytes) + bytes > limit_ && !empty)
+            {
+                used_ -= bytes;
+                return false;
+            }
+            p_account->queued_ += bytes;
+            return true;
+        }
+
+        /**
+         * release messages taken off the queue
+         * @param p_account
+         * @param bytes
+         */
+        inline void release(account *p_account, uint64_t bytes)
+        {
+            p_account->queued_ -= bytes;
+            used_ -= bytes;
+        }
+
+        /**
+         * set the size of the topic indexes
+         * @param p_account
+         * @param bytes
+         */
+        inline void set_indexes(account *p_account, uint64_t bytes)
+        {
+            uint64_t previous = p_account->indexes_.exchange(bytes);
+            used_ += bytes - previous;
+        }
+
+        /**
+         * whether the broker takes new publishers
+         * @return
+         */
+        inline bool admit_publisher() const
+        {
+            return used_ < limit_;
+        }
+
+        inline uint64_t get_used() const
+        {
+            return used_.load();
+        }
+
+        inline uint64_t get_limit() const
+        {
+            return limit_.load();
+        }
+
+    private:
+        std::atomic<uint64_t> limit_;
+        std::atomic<uint64_t> used_;
+        std::map<std::string, account *> accounts_;
+        std::mutex mutex_; // guards accounts_ and admission of new topics
+    };
+}
+
+#endif /* MEMORY_MANAGER_H */
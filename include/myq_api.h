@@ -22,7 +22,7 @@ extern "C" {
     #define DEFAULT_VALUE(value)
     #define true 1
     #define false 0
-    typedef int bool;
+    typedef _Bool bool; /* same size as the C++ bool, so structs shared with the library line up */
 #endif
 /**
      Log Level
@@ -48,6 +48,14 @@ typedef enum {
     queue_file_type
 }broker_storage_type;
 
+/**
+ * How topic logs are placed on the broker data directories
+ */
+typedef enum {
+    placement_round_robin_topics, //each topic on the next directory in turn
+    placement_stripe_segments //the segments of every topic go to the directories in turn
+}data_placement;
+
 /**
  * Topic statistics
  */
@@ -62,6 +70,25 @@ typedef struct {
     uint64_t subscribers_count;
     uint64_t total_bytes_written;
     uint64_t total_bytes_read;
+    uint64_t messages_conflated;
+    uint64_t duplicates_dropped;
+    uint64_t memory_used; //bytes the topic holds in memory: buffers, queued messages, indexes
+    uint64_t memory_quota; //0 if the topic is bounded by the broker limit only
+    uint64_t memory_throttled; //messages held back until memory was available
+    uint64_t broker_memory_used;
+    uint64_t broker_memory_limit;
+    uint64_t append_latency_avg_ns; //time the broker takes to store a received batch, moving average
+    uint64_t append_latency_max_ns;
+    uint64_t memory_fixed; //preallocated queue slots and buffers
+    uint64_t memory_queued; //messages waiting in the queue
+    uint64_t memory_indexes; //seq and time indexes of the log
+    uint64_t cpu_producer_ns; //cpu time of the threads receiving from publishers
+    uint64_t cpu_consumer_ns; //cpu time of the threads dispatching to and serving consumers
+    uint64_t cpu_egress_ns; //cpu time of the extra egress threads of a file topic
+    uint64_t segment_cache_hits; //reads of full log segments whose file was open
+    uint64_t segment_cache_misses; //reads of full log segments that reopened the file
+    uint64_t broker_segments_open; //full log segments with an open file, across topics
+    uint64_t broker_segments_open_limit;
 }topic_stats;
 
 
@@ -85,8 +112,10 @@ typedef struct {
     uint64_t last_queue_size; //only used for determining if queue depth increasing
     char topic_type[256];
     bool delay_pub_on_slow_consumer;
+    uint64_t producer_id; //random per init_producer; set it to an earlier id to resume that producer's sequence
 
     void (*pubDelayAlgorithm)(void *);
+    void *batcher; //adaptive client batching, see set_producer_latency_target
 }myq_producer_conn;
 
 /**
@@ -94,7 +123,9 @@ typedef struct {
  */
 typedef enum {
     zmq_consumer,
-    socket_consumer
+    socket_consumer,
+    zmq_subscriber, //pub/sub with sequence gap detection and recovery
+    multicast_subscriber //as zmq_subscriber, reading the stream from the topic udp multicast group
 }consumer_socket_type;
 
 //consumer connection
@@ -103,6 +134,95 @@ typedef struct {
     consumer_socket_type socket_type;
 }myq_consumer_conn;
 
+/**
+ * Consumers of many topics read by one thread, see init_consumer_set
+ */
+typedef struct {
+    void *set;
+    char userid[128];
+    char password[128];
+    char broker_uri[256];
+    consumer_socket_type socket_type;
+}myq_consumer_set;
+
+/**
+ * Message received from a consumer set
+ */
+typedef struct {
+    char *buffer; //set by the caller
+    uint32_t buffer_length; //set by the caller
+    uint32_t length;
+    const char *topic; //topic of the message, valid until the set is freed
+}myq_message;
+
+//request/reply connection, see init_rpc_conn
+typedef struct {
+    myq_conn *p_myq_conn;
+    bool responder;
+}myq_rpc_conn;
+
+/**
+ * Request received by a responder, passed back to send_reply
+ */
+typedef struct {
+    char requester[256]; //zmq identity of the requester connection
+    uint32_t requester_length;
+    uint64_t correlation_id;
+}myq_request_context;
+
+
+/**
+ * Subscriber statistics (consumer_socket_type zmq_subscriber or multicast_subscriber)
+ */
+typedef struct {
+    uint64_t last_seq;
+    uint64_t gaps_detected;
+    uint64_t messages_recovered;
+    uint64_t messages_lost;
+    uint64_t snapshot_messages;
+}subscriber_stats;
+
+/**
+ * Optional topic settings for create_topic_with_options
+ */
+typedef struct {
+    bool last_value_cache; //keep the latest message per key; subscribers start from a snapshot
+    char key_delimiter; //message key is the prefix before this character, '|' when 0
+    bool conflate; //slow consumers get only the newest pending message per key
+    const char *multicast_uri; //udp://group:port to also send the pub stream to, NULL for none
+    const char *multicast_interface; //local address to send multicast on, NULL for default route
+    uint64_t memory_quota_mb; //memory the topic may hold (also sizes its queue), 0 for the broker limit only
+    uint32_t egress_threads; //file topics: threads sending to socket consumers, 0 or 1 for one
+    uint64_t aggregate_window_ms; //tumbling window of per key aggregates computed on ingest, 0 for none
+    uint32_t aggregate_field; //field after the key holding the value to sum (1 based), 0 to count only
+    uint64_t latency_target_us; //queue topics: size dispatch batches to keep latency below this, 0 for fixed batches
+    uint32_t segment_size_mb; //file topics: size of a log segment, 0 for the default (2 GB)
+    bool preallocate_segments; //file topics: reserve the full segment size on disk when a segment is created
+}topic_options;
+
+/**
+ * Aggregate of one key over a window
+ */
+typedef struct {
+    char key[256];
+    uint64_t count; //messages for the key
+    uint64_t values; //messages whose value field is a number
+    double sum;
+    double min;
+    double max;
+}key_aggregate;
+
+/**
+ * Called by get_aggregates once per key
+ */
+typedef void (*aggregate_callback)(const key_aggregate *aggregate, void *context);
+
+/**
+ * Reader of the topic statistics a local broker publishes in shared memory
+ */
+typedef struct {
+    void *shm;
+}myq_stats_reader;
 
 /**
  * Broker manager
@@ -145,6 +265,60 @@ void free_producer_conn(myq_producer_conn *producer_conn);
  */
 int publish_message(myq_producer_conn *conn, const char *message, uint32_t message_length);
 
+/**
+ * Publish message with a producer sequence number (starting at 1, one per message).
+ * Retrying a publish with the same seq is safe: the broker stores it once per producer_id,
+ * as long as the seq is within the last 256 sequences it accepted from the producer
+ * @param conn
+ * @param seq
+ * @param message
+ * @param message_length
+ * @return
+ */
+int publish_message_idempotent(myq_producer_conn *conn, uint64_t seq, const char *message, uint32_t message_length);
+
+/**
+ * Batch publish_message calls to a latency target: messages are sent together as atomic batches, sized
+ * so that a message waits at most about latency_target_us in the client. A quiet producer still sends
+ * each message at once. publish_message then returns once the message is queued; call flush_producer to
+ * send what waits. Idempotent and batch publishes flush first, so publish order is kept. 0 turns it off
+ * @param conn
+ * @param latency_target_us
+ * @return
+ */
+bool set_producer_latency_target(myq_producer_conn *conn, uint64_t latency_target_us);
+
+/**
+ * Send the messages waiting in the client batch of set_producer_latency_target
+ * @param conn
+ * @return bytes sent, 0 if none waited, -1 on error
+ */
+int flush_producer(myq_producer_conn *conn);
+
+/**
+ * Publish messages as one atomic batch: the broker appends them contiguously, with nothing from other
+ * producers in between, and consumers see either all of them or none
+ * @param conn
+ * @param messages
+ * @param message_lengths
+ * @param count
+ * @return bytes sent, -1 on error
+ */
+int publish_batch(myq_producer_conn *conn, const char **messages, const uint32_t *message_lengths, uint32_t count);
+
+/**
+ * Publish atomic batch with producer sequence numbers first_seq .. first_seq + count - 1.
+ * Retrying the whole batch with the same first_seq is safe, as with publish_message_idempotent
+ * @param conn
+ * @param first_seq
+ * @param messages
+ * @param message_lengths
+ * @param count
+ * @return bytes sent, -1 on error
+ */
+int publish_batch_idempotent(myq_producer_conn *conn, uint64_t first_seq, const char **messages,
+                             const uint32_t *message_lengths, uint32_t count);
+
 /**
  * Initialize consumer
  * @param topic
@@ -168,6 +342,134 @@ void free_consumer_conn(myq_consumer_conn *consumer_conn);
  * @return
  */
 int receive_message(myq_consumer_conn *p_consumer_conn, char *buffer, uint32_t buffer_length);
+/**
+ * Restart a socket consumer of a file topic at the given message. Sequence numbers are 1 based
+ * positions in the log; a seq past the end of the log waits for new messages.
+ * Only for consumer_socket_type socket_consumer
+ * @param p_consumer_conn
+ * @param seq
+ * @return
+ */
+bool seek(myq_consumer_conn *p_consumer_conn, uint64_t seq);
+
+/**
+ * Restart a socket consumer of a file topic at the first message of the log
+ * @param p_consumer_conn
+ * @return
+ */
+bool seek_to_beginning(myq_consumer_conn *p_consumer_conn);
+
+/**
+ * Restart a socket consumer of a file topic after the last message written, so it only gets new messages
+ * @param p_consumer_conn
+ * @return
+ */
+bool seek_to_end(myq_consumer_conn *p_consumer_conn);
+
+/**
+ * Restart a socket consumer of a file topic from the records appended at or after the given time.
+ * The broker keeps a sparse time index, so up to 100ms of earlier records may be delivered first.
+ * Only for consumer_socket_type socket_consumer
+ * @param p_consumer_conn
+ * @param timestamp_ms milliseconds since epoch
+ * @return
+ */
+bool seek_to_time(myq_consumer_conn *p_consumer_conn, uint64_t timestamp_ms);
+
+/**
+ * Initialize an empty consumer set. Topics joined with consumer_set_add are read together by
+ * consumer_set_receive, so one thread can consume many topics.
+ * Only for consumer_socket_type zmq_consumer or socket_consumer
+ * @param userid
+ * @param password
+ * @param broker_uri
+ * @param type
+ * @return
+ */
+myq_consumer_set *init_consumer_set(
+    const char *userid, const char *password, const char *broker_uri,
+    consumer_socket_type type DEFAULT_VALUE(consumer_socket_type::zmq_consumer));
+
+/**
+ * Join a topic as a consumer of the set
+ * @param p_set
+ * @param topic
+ * @return
+ */
+bool consumer_set_add(myq_consumer_set *p_set, const char *topic);
+
+/**
+ * Receive messages from the topics of the set. All of them are polled at once; ready topics give one
+ * message each in turn, starting after the topic served last, so a busy topic doesn't starve the others.
+ * @param p_set
+ * @param messages buffer and buffer_length set by the caller; length and topic are set for each message received
+ * @param count
+ * @param timeout_ms wait for the first message, -1 to wait until one arrives
+ * @return messages received, 0 on timeout, -1 on error
+ */
+int consumer_set_receive(myq_consumer_set *p_set, myq_message *messages, uint32_t count, int timeout_ms);
+
+/**
+ * free the consumer set and its consumer connections
+ * @param p_set
+ */
+void free_consumer_set(myq_consumer_set *p_set);
+
+/**
+ * Initialize a request/reply connection to a topic. Requests go through the broker to a responder of the
+ * topic and the reply comes back on the same connection; nothing is stored.
+ * @param userid
+ * @param password
+ * @param topic
+ * @param broker_uri
+ * @param responder serve requests (receive_request/send_reply) instead of making them (send_request)
+ * @return
+ */
+myq_rpc_conn *init_rpc_conn(
+    const char *userid, const char *password, const char *topic, const char *broker_uri,
+    bool responder DEFAULT_VALUE(false));
+
+/**
+ * free request/reply connection
+ * @param p_rpc_conn
+ */
+void free_rpc_conn(myq_rpc_conn *p_rpc_conn);
+
+/**
+ * Send a request and wait for its reply
+ * @param p_rpc_conn
+ * @param request
+ * @param length
+ * @param reply
+ * @param reply_length
+ * @param timeout_ms -1 to wait until the reply arrives
+ * @return reply length, 0 on timeout, -1 on error or when the topic has no responder
+ */
+int send_request(myq_rpc_conn *p_rpc_conn, const char *request, uint32_t length, char *reply, uint32_t reply_length,
+                 int timeout_ms);
+
+/**
+ * Wait for a request - responder
+ * @param p_rpc_conn
+ * @param context set to what send_reply needs to answer the request
+ * @param buffer
+ * @param buffer_length
+ * @param timeout_ms -1 to wait until a request arrives
+ * @return request length, 0 on timeout, -1 on error
+ */
+int receive_request(myq_rpc_conn *p_rpc_conn, myq_request_context *context, char *buffer, uint32_t buffer_length,
+                    int timeout_ms);
+
+/**
+ * Answer a request - responder. Requests may be answered in any order
+ * @param p_rpc_conn
+ * @param context
+ * @param reply
+ * @param length
+ * @return bytes sent, -1 on error
+ */
+int send_reply(myq_rpc_conn *p_rpc_conn, const myq_request_context *context, const char *reply, uint32_t length);
+
 /**
  * Get stats
  * @param conn
@@ -175,6 +477,67 @@ int receive_message(myq_consumer_conn *p_consumer_conn, char *buffer, uint32_t b
  */
 bool get_stats(myq_conn *conn, topic_stats *stats);
 
+/**
+ * Get subscriber gap/recovery statistics. Only for consumer_socket_type zmq_subscriber or multicast_subscriber
+ * @param p_consumer_conn
+ * @param stats
+ * @return
+ */
+bool get_subscriber_stats(myq_consumer_conn *p_consumer_conn, subscriber_stats *stats);
+
+/**
+ * Get the per key aggregates the broker computed for a window of a topic created with aggregate_window_ms
+ * @param conn
+ * @param window_start_ms in: start of the closed window, 0 for the latest closed window.
+ *                        out: start of the window returned
+ * @param open true for the window still collecting messages instead
+ * @param callback called once per key
+ * @param context passed to callback
+ * @return false if the topic has no aggregates or the window is no longer kept
+ */
+bool get_aggregates(myq_conn *conn, uint64_t *window_start_ms, bool open, aggregate_callback callback, void *context);
+
+/**
+ * Open the shared memory statistics of a broker running on this host. Reads need no round trip
+ * to the broker; values are refreshed by the broker every 100 ms (see topic updated_ms)
+ * @param broker_uri admin uri of the broker, e.g. tcp://127.0.0.1:5500
+ * @return NULL if the broker is not running here
+ */
+myq_stats_reader *open_stats_reader(const char *broker_uri);
+
+/**
+ * Close stats reader
+ * @param reader
+ */
+void close_stats_reader(myq_stats_reader *reader);
+
+/**
+ * Number of topics in the statistics table
+ * @param reader
+ * @return
+ */
+uint32_t get_stats_topic_count(myq_stats_reader *reader);
+
+/**
+ * Read the statistics of the topic at index (0 to get_stats_topic_count - 1)
+ * @param reader
+ * @param index
+ * @param stats
+ * @param updated_ms when the broker last refreshed them, may be NULL
+ * @return
+ */
+bool read_stats_at(myq_stats_reader *reader, uint32_t index, topic_stats *stats, uint64_t *updated_ms);
+
+/**
+ * Read the statistics of a topic
+ * @param reader
+ * @param topic
+ * @param stats
+ * @param updated_ms when the broker last refreshed them, may be NULL
+ * @return
+ */
+bool read_stats(myq_stats_reader *reader, const char *topic, topic_stats *stats, uint64_t *updated_ms);
+
 /**
  * publish delay algorithm function: default implementation
  * @param
@@ -208,6 +571,45 @@ void free_broker_mgr(myq_broker_mgr *broker_mgr);
  */
 bool run_broker(myq_broker_mgr *broker, bool block DEFAULT_VALUE(true));
 
+/**
+ * Set the memory all topics of the broker may hold together. Producers are throttled and new
+ * publishers refused while the broker is at the limit
+ * @param broker_mgr
+ * @param limit_mb 0 for three quarters of physical memory (the default)
+ * @return
+ */
+bool set_broker_memory_limit(myq_broker_mgr *broker_mgr, uint64_t limit_mb);
+
+/**
+ * Bound the file descriptors the broker keeps for full log segments, across topics. The segment being
+ * written always stays open; the least recently read full segments are closed and reopened on demand
+ * @param broker_mgr
+ * @param max_open at least 1, 1024 by default
+ * @return
+ */
+bool set_broker_max_open_segments(myq_broker_mgr *broker_mgr, uint32_t max_open);
+
+/**
+ * Keep topic logs in several directories, typically one per disk, instead of /tmp. Each directory
+ * gets its own I/O thread. Call once, before topics are created
+ * @param broker_mgr
+ * @param directories
+ * @param count
+ * @param placement
+ * @return false if a directory is not writable or directories were already set
+ */
+bool set_broker_data_directories(
+    myq_broker_mgr *broker_mgr, const char **directories, unsigned count, data_placement placement);
+
+/**
+ * Let pipelines load plugins from this directory, and from nowhere else: create_pipeline names a shared
+ * library in it. Without one the broker refuses pipelines
+ * @param broker_mgr
+ * @param directory
+ * @return false if it is not a readable directory
+ */
+bool set_broker_plugin_directory(myq_broker_mgr *broker_mgr, const char *directory);
+
 /**
  * create a topic
  * @param broker_uri
@@ -223,6 +625,40 @@ bool create_topic(
     const char *broker_uri, const char *topic, const char *admin_userid, const char *admin_password,
     const char *userid, const char *password, broker_storage_type storage_type);
 
+/**
+ * create a topic with optional settings
+ * @param broker_uri
+ * @param topic
+ * @param admin_userid
+ * @param admin_password
+ * @param userid
+ * @param password
+ * @param storage_type
+ * @param options NULL for defaults
+ * @return
+ */
+bool create_topic_with_options(
+    const char *broker_uri, const char *topic, const char *admin_userid, const char *admin_password,
+    const char *userid, const char *password, broker_storage_type storage_type, const topic_options *options);
+
+/**
+ * Derive target_topic from source_topic inside the broker: the plugin (see myq_plugin.h) transforms or
+ * filters every message of the source log, from its start, into the target. The source must be a file
+ * or queue_file topic; the target must have no publishers and takes none afterwards. The broker needs a
+ * plugin directory, see set_broker_plugin_directory
+ * @param broker_uri
+ * @param admin_userid
+ * @param admin_password
+ * @param source_topic
+ * @param target_topic
+ * @param plugin file name of the shared library in the broker plugin directory
+ * @param plugin_args passed to the plugin myq_plugin_init, may be NULL
+ * @return
+ */
+bool create_pipeline(
+    const char *broker_uri, const char *admin_userid, const char *admin_password,
+    const char *source_topic, const char *target_topic, const char *plugin, const char *plugin_args);
+
 
 /**
  * str to log level
@@ -0,0 +1,263 @@
+/*
+ * File:   pipeline.h
+ *
+ *
+ * Created on October 20, 2026, 12:45 AM
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dlfcn.h>
+#include "log.h"
+#include "utils.h"
+#include "broker_storage.h"
+#include "myq_plugin.h"
+using namespace mymq;
+namespace myq
+{
+
+    /**
+     * pipeline
+     * Derives a target topic from the log of a source topic through a plugin (see myq_plugin.h), inside
+     * the broker. The pipeline thread reads the source log from the start at its own position, like a
+     * socket consumer, passes the records of every read to the plugin in place and stores what the plugin
+     * emits in the target as atomic batches. Nothing crosses a socket and nothing is serialized again.
+     * The pipeline is the only writer of its target topic.
+     */
+    class pipeline
+    {
+    public:
+        /**
+         * constructor
+         * @param name
+         * @param p_source file or queue_file topic
+         * @param p_target
+         */
+        pipeline(const std::string &name, broker_storage *p_source, broker_storage *p_target)
+            : name_(name), p_source_(p_source), p_target_(p_target), p_library_(NULL), p_state_(NULL),
+              init_(NULL), transform_(NULL), destroy_(NULL), stop_(false), offset_(0), seq_(0),
+              messages_in_(0), messages_out_(0), batches_failed_(0), out_count_(0)
+        {
+        }
+
+        ~pipeline()
+        {
+            stop_ = true;
+            if (pipeline_tid_.joinable())
+                pipeline_tid_.join();
+            if (destroy_)
+                destroy_(p_state_);
+            if (p_library_)
+                dlclose(p_library_);
+        }
+
+        /**
+         * load the plugin and set it up
+         * @param plugin_path shared library
+         * @param args passed to myq_plugin_init
+         * @return
+         */
+        bool init(const std::string &plugin_path, const std::string &args)
+        {
+            LOG_IN("name[%s], plugin_path[%s], args[%s]", name_.c_str(), plugin_path.c_str(), args.c_str());
+            p_library_ = dlopen(plugin_path.c_str(), RTLD_NOW | RTLD_LOCAL);
+            if (p_library_ == NULL)
+            {
+                LOG_ERROR("Failed to load plugin %s: %s", plugin_path.c_str(), dlerror());
+                LOG_RET_FALSE("failed");
+            }
+            transform_ = reinterpret_cast<myq_plugin_transform_fn>(dlsym(p_library_, "myq_plugin_transform"));
+            init_ = reinterpret_cast<myq_plugin_init_fn>(dlsym(p_library_, "myq_plugin_init"));
+            destroy_ = reinterpret_cast<myq_plugin_destroy_fn>(dlsym(p_library_, "myq_plugin_destroy"));
+            if (transform_ == NULL)
+            {
+                LOG_ERROR("Plugin %s has no myq_plugin_transform", plugin_path.c_str());
+                LOG_RET_FALSE("failed");
+            }
+            if (init_ && init_(args.c_str(), &p_state_) != MYQ_PLUGIN_ABI_VERSION)
+            {
+                destroy_ = NULL; // nothing to release
+                LOG_ERROR("Plugin %s refused pipeline %s", plugin_path.c_str(), name_.c_str());
+                LOG_RET_FALSE("failed");
+            }
+            buffer_.resize(utils::max_msg_size + sizeof(uint32_t));
+            out_.reserve(utils::max_msg_size);
+            LOG_RET_TRUE("");
+        }
+
+        /**
+         * start the pipeline thread
+         * @return
+         */
+        bool run()
+        {
+            LOG_IN("");
+            pipeline_tid_ = std::thread(
+                [&]()
+                {
+                    process_source();
+                });
+            LOG_EVENT("Pipeline %s is running", name_.c_str());
+            LOG_RET_TRUE("");
+        }
+
+        inline const std::string &get_name() const
+        {
+            return name_;
+        }
+
+        inline uint64_t get_messages_in() const
+        {
+            return messages_in_.load();
+        }
+
+        inline uint64_t get_messages_out() const
+        {
+            return messages_out_.load();
+        }
+
+        inline uint64_t get_batches_failed() const
+        {
+            return batches_failed_.load();
+        }
+
+    private:
+        std::string name_;
+        broker_storage *p_source_;
+        broker_storage *p_target_;
+        void *p_library_;
+        void *p_state_;
+        myq_plugin_init_fn init_;
+        myq_plugin_transform_fn transform_;
+        myq_plugin_destroy_fn destroy_;
+        std::atomic<bool> stop_;
+        std::thread pipeline_tid_;
+        uint64_t offset_; // position in the source log
+        uint64_t seq_;    // seq of the last message read
+        std::atomic<uint64_t> messages_in_;
+        std::atomic<uint64_t> messages_out_;
+        std::atomic<uint64_t> batches_failed_;
+        std::vector<char> buffer_;                // records read from the source
+        std::vector<myq_plugin_message> batch_;  // points into buffer_
+        std::string out_;                         // emitted records, packed as the log stores them
+        unsigned out_count_;
+
+        /**
+         * pipeline thread: read, transform, store until stopped
+         */
+        void process_source()
+        {
+            LOG_IN("");
+            while (!stop_)
+            {
+                if (process_batch() == 0)
+                {
+                    utils::sleep_ms(utils::queue_poll_wait);
+                }
+            }
+            LOG_OUT("");
+        }
+
+        /**
+         * run the plugin on the records of one read of the source log
+         * @return messages read
+         */
+        unsigned process_batch()
+        {
+            connection_file *p_file = p_source_->get_file_connection();
+            ssize_t bytes = p_file->read_bytes(buffer_.data(), buffer_.size(), offset_);
+            if (bytes <= 0)
+            {
+                return 0;
+            }
+            // whole records only, a record cut by the end of the buffer is read again next time
+            batch_.clear();
+            uint64_t used = 0;
+            while (used + sizeof(uint32_t) <= (uint64_t)bytes)
+            {
+                uint32_t length;
+                memcpy(&length, buffer_.data() + used, sizeof(length));
+                if (used + sizeof(length) + length > (uint64_t)bytes)
+                {
+                    break;
+                }
+                myq_plugin_message message;
+                message.data = buffer_.data() + used + sizeof(length);
+                message.length = length;
+                message.seq = ++seq_;
+                batch_.push_back(message);
+                used += sizeof(length) + length;
+            }
+            if (batch_.empty())
+            {
+                return 0;
+            }
+            out_.clear();
+            out_count_ = 0;
+            if (transform_(p_state_, batch_.data(), batch_.size(), &pipeline::emit, this) < 0)
+            {
+                ++batches_failed_;
+                LOG_WARN("Pipeline %s dropped output of messages %llu to %llu", name_.c_str(),
+                         batch_.front().seq, batch_.back().seq);
+            }
+            else
+            {
+                flush();
+            }
+            offset_ += used;
+            messages_in_ += batch_.size();
+            return batch_.size();
+        }
+
+        /**
+         * store emitted messages in the target
+         */
+        void flush()
+        {
+            if (out_count_ == 0)
+            {
+                return;
+            }
+            if (!p_target_->add_batch_to_storage(out_.data(), out_.length(), out_count_))
+            {
+                ++batches_failed_;
+                LOG_ERROR("Pipeline %s failed to store %u messages", name_.c_str(), out_count_);
+            }
+            else
+            {
+                messages_out_ += out_count_;
+            }
+            out_.clear();
+            out_count_ = 0;
+        }
+
+        /**
+         * myq_plugin_emit_fn: append a message to the output batch, stored as one batch after the
+         * transform or earlier once it is max_batch_size messages
+         */
+        static int emit(void *emit_context, const char *data, uint32_t length)
+        {
+            pipeline *p_pipeline = static_cast<pipeline *>(emit_context);
+            if (length > utils::max_msg_size)
+            {
+                return -1;
+            }
+            if (p_pipeline->out_count_ >= utils::max_batch_size ||
+                p_pipeline->out_.length() + sizeof(length) + length > utils::max_msg_size)
+            {
+                p_pipeline->flush();
+            }
+            p_pipeline->out_.append(reinterpret_cast<const char *>(&length), sizeof(length));
+            p_pipeline->out_.append(data, length);
+            ++p_pipeline->out_count_;
+            return 0;
+        }
+    };
+}
+
+#endif /* PIPELINE_H */
@@ -21,6 +21,7 @@
 #include "broker_storage.h"
 #include "connection_zmq.h"
 #include "connection_socket.h"
+#include "transport.h"
 using namespace myq;
 namespace mymq
 {
@@ -46,7 +47,9 @@ namespace mymq
             LOG_IN("broker_storage: %p, config: %s, pconnection::endpoint_type::conn_publisher",
                    p_storage_, config.producer_bind_uri_.c_str());
             stop_ = false;
-            p_producer_socket = NULL;
+            running_ = false;
+            p_zmq_socket_ = NULL;
+            p_raw_socket_ = NULL;
             LOG_OUT("");
         }
 
@@ -59,7 +62,8 @@ namespace mymq
             if (producer_tid_.joinable())
                 producer_tid_.join();
 
-            delete p_producer_socket;
+            delete p_zmq_socket_;
+            delete p_raw_socket_;
 
             LOG_OUT("");
         }
@@ -73,15 +77,14 @@ namespace mymq
             LOG_IN("");
             if (config_.producer_stream_type_ == connection::stream_type::stream_zmq)
             {
-                p_producer_socket = new connection_zmq(
+                p_zmq_socket_ = new connection_zmq(
                     config_.id_,
                     config_.producer_bind_uri_,
                     connection::endpoint_type::conn_publisher,
                     connection_zmq::zmq_pull,
                     config_.producer_socket_connect_type_,
                     true, true);
-                // connection_zmq* p_zmq_producer = (connection_zmq*)p_producer_socket;
-                if (!p_producer_socket->init())
+                if (!p_zmq_socket_->init())
                 {
 
                     LOG_RET_FALSE(utils::format_str(
@@ -93,16 +96,14 @@ namespace mymq
             else if (config_.producer_stream_type_ == connection::stream_socket)
             {
 
-                p_producer_socket = new connection_socket(
+                p_raw_socket_ = new connection_socket(
                     config_.id_,
                     config_.producer_bind_uri_,
                     connection::endpoint_type::conn_publisher,
                     connection::bind_socket,
                     true);
 
-                connection_socket *psocket = (connection_socket *)p_producer_socket;
-
-                if (!psocket->init(p_storage_))
+                if (!p_raw_socket_->init(p_storage_))
                 {
 
                     LOG_RET_FALSE(utils::format_str(
@@ -113,7 +114,7 @@ namespace mymq
                 else
                 {
 
-                    if (!p_producer_socket->run())
+                    if (!p_raw_socket_->run())
                     {
                         LOG_RET_FALSE(utils::format_str(
                                           "Failed to run consumer broker: %s, consumer_bind_uri: %s",
@@ -142,6 +143,7 @@ namespace mymq
                 {
                     process_producers();
                 });
+            running_ = true;
             LOG_RET_TRUE("");
         }
         /*
@@ -199,36 +201,86 @@ namespace mymq
 
         /**
          * process producers
+         * Picks the concrete transport once, then runs the receive loop statically typed over it.
          * @return
          */
         bool process_producers()
         {
             LOG_IN("");
-            std::string message;
-            message.reserve(utils::max_msg_size);
+            if (p_raw_socket_)
+            {
+                transport<connection_socket> socket_transport(p_raw_socket_);
+                LOG_RET("", process_producers(socket_transport));
+            }
+            transport<connection_zmq> zmq_transport(p_zmq_socket_);
+            LOG_RET("", process_producers(zmq_transport));
+        }
+
+        /**
+         * process producers over the given transport
+         * @param producer_transport
+         * @return
+         */
+        template <typename Connection>
+        bool process_producers(transport<Connection> &producer_transport)
+        {
+            LOG_IN("");
+            std::string messages[utils::max_batch_size];
+            connection::producer_stamp stamps[utils::max_batch_size];
             while (!stop_)
             {
-                message.clear();
-                ssize_t bytes_read = p_producer_socket->read_msg(message);
-                if (bytes_read < 0)
+                ssize_t count = producer_transport.receive_batch_stamped(messages, stamps, utils::max_batch_size);
+                if (count < 0)
                 {
                     LOG_ERROR("Failed to read from producer connection id: %s, producer_bind_uri: %s",
                               config_.id_.c_str(), config_.producer_bind_uri_.c_str());
                     LOG_RET_FALSE("failure");
                 }
-                LOG_DEBUG("Read message with size: %d", bytes_read);
-                // if bytes read zero, continue
-                if (bytes_read == 0)
-                    continue;
-                bool write_message_size = true;
-                // if producer is socket, we expect producer to have message size included in the payload
-                if (p_producer_socket->get_stream_type() == connection::stream_socket)
+                LOG_DEBUG("Read batch of %d messages", count);
+                uint64_t received_ns = count > 0 ? utils::get_currenttime_nanoseconds() : 0;
+                // if nothing read, continue
+                for (ssize_t i = 0; i < count; ++i)
                 {
-                    write_message_size = true;
+                    if (messages[i].empty())
+                        continue;
+                    if (stamps[i].producer_id_ != 0 &&
+                        p_storage_->is_duplicate_producer_seq(stamps[i].producer_id_, stamps[i].seq_))
+                    {
+                        LOG_DEBUG("Dropping duplicate producer_id[%llu], seq[%llu]", stamps[i].producer_id_, stamps[i].seq_);
+                        messages[i].clear();
+                        continue;
+                    }
+                    if (stamps[i].batch_count_ > 0)
+                    {
+                        if (!p_storage_->add_batch_to_storage(messages[i].data(), messages[i].length(),
+                                                              stamps[i].batch_count_))
+                        {
+                            // not committed, a retry of the batch is stored
+                            LOG_ERROR("Dropping batch of %u messages from producer connection id: %s",
+                                      stamps[i].batch_count_, config_.id_.c_str());
+                            messages[i].clear();
+                            continue;
+                        }
+                        // a batch is retried whole, so its first seq decides; the rest are only recorded
+                        for (uint32_t j = 0; stamps[i].producer_id_ != 0 && j < stamps[i].batch_count_; ++j)
+                        {
+                            p_storage_->commit_producer_seq(stamps[i].producer_id_, stamps[i].seq_ + j);
+                        }
+                    }
+                    else if (!p_storage_->add_to_storage(messages[i], true))
+                    {
+                        LOG_RET_FALSE("failure");
+                    }
+                    else if (stamps[i].producer_id_ != 0)
+                    {
+                        p_storage_->commit_producer_seq(stamps[i].producer_id_, stamps[i].seq_);
+                    }
+                    messages[i].clear();
                 }
-                if (!p_storage_->add_to_storage(message, write_message_size))
+                if (count > 0)
                 {
-                    LOG_RET_FALSE("failure");
+                    p_storage_->flush_producer_state();
+                    p_storage_->record_append_latency(utils::get_currenttime_nanoseconds() - received_ns);
                 }
             }
             LOG_RET_TRUE("done");
@@ -241,15 +293,33 @@ namespace mymq
 
         unsigned get_num_clients()
         {
-            if (p_producer_socket)
+            if (p_zmq_socket_)
             {
-                connection_zmq *psocket = (connection_zmq *)p_producer_socket;
-                return psocket->get_num_connected_clients();
+                return p_zmq_socket_->get_num_connected_clients();
             }
-            else
+            else if (p_raw_socket_)
+            {
+                return p_raw_socket_->get_total_connected_clients();
+            }
+            return 0;
+        }
+
+        /**
+         * cpu time of the threads receiving from publishers
+         * @return nanoseconds
+         */
+        uint64_t get_cpu_time_ns()
+        {
+            if (!running_)
             {
                 return 0;
             }
+            uint64_t cpu_ns = utils::get_thread_cpu_nanoseconds(producer_tid_);
+            if (p_raw_socket_)
+            {
+                cpu_ns += p_raw_socket_->get_cpu_time_ns();
+            }
+            return cpu_ns;
         }
 
         connection::endpoint_type get_endpoint_type()
@@ -261,8 +331,10 @@ namespace mymq
         broker_storage *p_storage_;
         producer_config config_;
         connection::endpoint_type producer_endpoint_type_;
-        connection *p_producer_socket;
+        connection_zmq *p_zmq_socket_;
+        connection_socket *p_raw_socket_;
         bool stop_;
+        std::atomic<bool> running_; // threads started, their cpu time can be read
         std::thread producer_tid_;
     };
 }
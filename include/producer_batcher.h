@@ -0,0 +1,215 @@
+/*
+ * File:   producer_batcher.h
+ *
+ *
+ * Created on October 20, 2026, 3:40 AM
+ */
+
+#ifndef PRODUCER_BATCHER_H
+#define PRODUCER_BATCHER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "log.h"
+#include "utils.h"
+#include "connection_zmq.h"
+#include "adaptive_batch.h"
+using namespace mymq;
+namespace myq
+{
+
+    /**
+     * producer_batcher
+     * Client side batching of a producer connection, sized to a latency target by adaptive_batch.
+     * Published messages are packed as log records and go out as one atomic batch once the batch is full,
+     * or when the oldest has waited the linger time (on the flusher thread). With no linger, quiet traffic
+     * is sent from the publishing thread at once; publishes that come faster than the latency target
+     * start the linger (see adaptive_batch::arrived). Every send on the connection goes through the batcher,
+     * so the zmq socket is only used by one thread at a time.
+     * A batch that fails to send is kept and sent again: by the flusher after a pause, and first thing
+     * on the next publish or flush, which return -1 while it still fails.
+     */
+    class producer_batcher
+    {
+    public:
+        /**
+         * constructor
+         * @param p_conn push connection to the broker
+         * @param latency_target_us
+         */
+        producer_batcher(connection_zmq *p_conn, uint64_t latency_target_us)
+            : p_conn_(p_conn), batch_(latency_target_us, utils::max_adaptive_batch_size), count_(0),
+              oldest_ns_(0), last_publish_ns_(0), stop_(false), send_failed_(false), messages_sent_(0), batches_sent_(0)
+        {
+            flusher_tid_ = std::thread(
+                [&]()
+                {
+                    process_flush();
+                });
+        }
+
+        ~producer_batcher()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+                if (flush_locked() < 0)
+                {
+                    LOG_ERROR("Dropping %u messages that failed to send", count_);
+                }
+            }
+            cv_.notify_all();
+            if (flusher_tid_.joinable())
+            {
+                flusher_tid_.join();
+            }
+        }
+
+        /**
+         * add a message to the batch
+         * @param message
+         * @param length
+         * @return length, -1 if the waiting batch failed to send, the message is then not added
+         */
+        int publish(const char *message, uint32_t length)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (send_failed_ && flush_locked() < 0)
+            {
+                return -1;
+            }
+            if (records_.length() + sizeof(length) + length > utils::max_msg_size && flush_locked() < 0)
+            {
+                return -1;
+            }
+            uint64_t now_ns = utils::get_currenttime_nanoseconds();
+            batch_.arrived((now_ns - last_publish_ns_) / 1000);
+            last_publish_ns_ = now_ns;
+            if (count_ == 0)
+            {
+                oldest_ns_ = now_ns;
+            }
+            records_.append(reinterpret_cast<const char *>(&length), sizeof(length));
+            records_.append(message, length);
+            ++count_;
+            if (count_ >= batch_.get_batch_size() || batch_.get_linger_us() == 0)
+            {
+                // the message stays in the kept batch
+                return flush_locked() < 0 ? -1 : (int)length;
+            }
+            if (count_ == 1)
+            {
+                cv_.notify_one();
+            }
+            return length;
+        }
+
+        /**
+         * send the messages waiting in the batch
+         * @return bytes sent, 0 if none waited, -1 on error, the batch is then kept
+         */
+        ssize_t flush()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return flush_locked();
+        }
+
+        /**
+         * send the waiting messages, then run a send of the caller on the connection, so sends
+         * that bypass the batch stay in publish order
+         * @param send
+         * @return result of send, -1 if the waiting messages failed to send
+         */
+        ssize_t send_after_flush(const std::function<ssize_t()> &send)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (flush_locked() < 0)
+            {
+                return -1;
+            }
+            return send();
+        }
+
+        inline uint64_t get_messages_sent() const
+        {
+            return messages_sent_.load();
+        }
+
+        inline uint64_t get_batches_sent() const
+        {
+            return batches_sent_.load();
+        }
+
+    private:
+        connection_zmq *p_conn_;
+        adaptive_batch batch_;
+        std::string records_; // [length: uint32][payload] per message, as the log stores them
+        unsigned count_;
+        uint64_t oldest_ns_;  // when the oldest waiting message was published
+        uint64_t last_publish_ns_;
+        bool stop_;
+        bool send_failed_;    // the waiting batch failed to send, retry it before adding to it
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::thread flusher_tid_;
+        std::atomic<uint64_t> messages_sent_;
+        std::atomic<uint64_t> batches_sent_;
+
+        ssize_t flush_locked()
+        {
+            if (count_ == 0)
+            {
+                return 0;
+            }
+            ssize_t bytes_sent = p_conn_->write_batch(0, 0, records_.data(), records_.length(), count_);
+            if (bytes_sent < 0)
+            {
+                LOG_ERROR("Failed to send batch of %u messages, keeping it to retry", count_);
+                send_failed_ = true;
+                return -1;
+            }
+            send_failed_ = false;
+            uint64_t latency_us = (utils::get_currenttime_nanoseconds() - oldest_ns_) / 1000;
+            messages_sent_ += count_;
+            ++batches_sent_;
+            // a full batch means more is coming, the controller counts it as backlog
+            batch_.update(count_ >= batch_.get_batch_size() ? 1 : 0, count_, latency_us);
+            records_.clear();
+            count_ = 0;
+            return bytes_sent;
+        }
+
+        /**
+         * flusher thread: send a batch once its oldest message has waited the linger time
+         */
+        void process_flush()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!stop_)
+            {
+                if (count_ == 0)
+                {
+                    cv_.wait(lock);
+                    continue;
+                }
+                uint64_t deadline_ns = oldest_ns_ + batch_.get_linger_us() * 1000;
+                uint64_t now_ns = utils::get_currenttime_nanoseconds();
+                if (now_ns >= deadline_ns)
+                {
+                    if (flush_locked() < 0)
+                    {
+                        cv_.wait_for(lock, std::chrono::milliseconds(utils::queue_poll_wait));
+                    }
+                    continue;
+                }
+                cv_.wait_for(lock, std::chrono::nanoseconds(deadline_ns - now_ns));
+            }
+        }
+    };
+}
+
+#endif /* PRODUCER_BATCHER_H */
@@ -0,0 +1,280 @@
+/*
+ * File:   producer_dedup.h
+ *
+ *
+ * Created on October 19, 2026, 6:10 PM
+ */
+
+#ifndef PRODUCER_DEDUP_H
+#define PRODUCER_DEDUP_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include "log.h"
+#include "utils.h"
+using namespace mymq;
+namespace myq
+{
+
+    /**
+     * producer_dedup
+     * Drops messages an idempotent producer sent more than once (e.g. a publish retried after a timeout).
+     * Each producer id has a ring of the last window_size_ sequence numbers it got stored: a sequence is a
+     * duplicate if its ring slot already holds it, or if it is too old to still be in the window.
+     * A sequence is only committed once its message is stored, so a retry of a failed store goes through.
+     * Producers idle for producer_expiry_ms_ are forgotten, as clients pick a new id per connection.
+     * On file backed topics every committed (producer id, seq) pair is appended to a journal next to the log
+     * and replayed at startup, so retries that straddle a broker restart are still caught. The journal is
+     * rewritten with just the live windows every compact_bytes_ appended.
+     * Only used by the producer thread of the topic.
+     */
+    class producer_dedup
+    {
+    public:
+        /**
+         * constructor
+         * @param journal_path file to persist accepted sequences to, empty to keep them in memory only
+         */
+        producer_dedup(const std::string &journal_path)
+            : journal_path_(journal_path), fd_(-1), journal_bytes_(0), now_ms_(utils::get_currenttime_milliseconds()),
+              last_expiry_ms_(now_ms_), duplicates_(0)
+        {
+        }
+
+        ~producer_dedup()
+        {
+            flush();
+            if (fd_ > -1)
+            {
+                ::close(fd_);
+            }
+        }
+
+        /**
+         * replay the journal, then rewrite it with just the current windows
+         * @return
+         */
+        bool init()
+        {
+            LOG_IN("journal_path[%s]", journal_path_.c_str());
+            if (journal_path_.empty())
+            {
+                LOG_RET_TRUE("in memory");
+            }
+            int fd = open(journal_path_.c_str(), O_RDONLY);
+            if (fd > -1)
+            {
+                char entry[entry_size_];
+                while (read(fd, entry, sizeof(entry)) == (ssize_t)sizeof(entry))
+                {
+                    commit(utils::decode_uint64(entry), utils::decode_uint64(entry + sizeof(uint64_t)));
+                }
+                ::close(fd);
+                journal_.clear();
+                LOG_EVENT("Loaded %u producers from %s", windows_.size(), journal_path_.c_str());
+            }
+            if (!compact())
+            {
+                LOG_RET_FALSE("Failed to compact journal");
+            }
+            LOG_RET_TRUE("");
+        }
+
+        /**
+         * check message of a producer against its window
+         * @param producer_id
+         * @param seq
+         * @return true if the message was already stored
+         */
+        bool is_duplicate(uint64_t producer_id, uint64_t seq)
+        {
+            std::unordered_map<uint64_t, window>::const_iterator it = windows_.find(producer_id);
+            if (it == windows_.end())
+            {
+                return false;
+            }
+            const window &w = it->second;
+            if (seq + window_size_ <= w.high_ || w.ring_[seq % window_size_] == seq)
+            {
+                ++duplicates_;
+                return true;
+            }
+            return false;
+        }
+
+        /**
+         * record the sequence number of a message that was stored
+         * @param producer_id
+         * @param seq
+         */
+        void commit(uint64_t producer_id, uint64_t seq)
+        {
+            window &w = windows_[producer_id];
+            w.last_used_ms_ = now_ms_;
+            w.ring_[seq % window_size_] = seq;
+            if (seq > w.high_)
+            {
+                w.high_ = seq;
+            }
+            if (!journal_path_.empty())
+            {
+                append_entry(journal_, producer_id, seq);
+            }
+        }
+
+        /**
+         * write sequences committed since the last flush to the journal, forget idle producers and
+         * compact the journal once enough was appended
+         */
+        void flush()
+        {
+            now_ms_ = utils::get_currenttime_milliseconds();
+            if (now_ms_ - last_expiry_ms_ >= expiry_interval_ms_)
+            {
+                expire();
+            }
+            if (fd_ < 0 || journal_.empty())
+            {
+                return;
+            }
+            if (utils::write_buffer(fd_, journal_.data(), journal_.length()) != (ssize_t)journal_.length())
+            {
+                LOG_ERROR("Failed to write producer journal %s. Err: %d, ErrDesc: %s",
+                          journal_path_.c_str(), errno, strerror(errno));
+            }
+            journal_bytes_ += journal_.length();
+            journal_.clear();
+            if (journal_bytes_ >= compact_bytes_ && !compact())
+            {
+                LOG_ERROR("Failed to compact producer journal %s", journal_path_.c_str());
+            }
+        }
+
+        /**
+         * number of messages dropped as duplicates
+         * @return
+         */
+        inline uint64_t get_duplicates() const
+        {
+            return duplicates_.load();
+        }
+
+    private:
+        static const unsigned window_size_ = 256;
+        static const unsigned entry_size_ = 2 * sizeof(uint64_t);
+        static const uint64_t compact_bytes_ = 16 * 1024 * 1024;
+        static const uint64_t producer_expiry_ms_ = 60 * 60 * 1000;
+        static const uint64_t expiry_interval_ms_ = 60 * 1000;
+
+        struct window
+        {
+            uint64_t high_;
+            uint64_t last_used_ms_;
+            uint64_t ring_[window_size_]; // producer sequences start at 1, so 0 marks an empty slot
+
+            window() : high_(0), last_used_ms_(0)
+            {
+                memset(ring_, 0, sizeof(ring_));
+            }
+        };
+
+        std::string journal_path_;
+        int fd_;
+        std::unordered_map<uint64_t, window> windows_;
+        std::string journal_;    // committed entries not written yet
+        uint64_t journal_bytes_; // appended since the last compaction
+        uint64_t now_ms_;        // as of the last flush, close enough for expiry
+        uint64_t last_expiry_ms_;
+        std::atomic<uint64_t> duplicates_;
+
+        static void append_entry(std::string &buffer, uint64_t producer_id, uint64_t seq)
+        {
+            char entry[entry_size_];
+            utils::encode_uint64(producer_id, entry);
+            utils::encode_uint64(seq, entry + sizeof(uint64_t));
+            buffer.append(entry, sizeof(entry));
+        }
+
+        /**
+         * forget producers that committed nothing for producer_expiry_ms_
+         */
+        void expire()
+        {
+            last_expiry_ms_ = now_ms_;
+            size_t before = windows_.size();
+            for (std::unordered_map<uint64_t, window>::iterator it = windows_.begin(); it != windows_.end();)
+            {
+                if (now_ms_ - it->second.last_used_ms_ >= producer_expiry_ms_)
+                {
+                    it = windows_.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+            if (windows_.size() != before)
+            {
+                LOG_EVENT("Expired %u idle producers, %u left", (unsigned)(before - windows_.size()),
+                          (unsigned)windows_.size());
+            }
+        }
+
+        /**
+         * replace the journal with the sequences still inside the windows and open it for append
+         * @return
+         */
+        bool compact()
+        {
+            LOG_IN("");
+            std::string entries;
+            for (std::unordered_map<uint64_t, window>::const_iterator it = windows_.begin(); it != windows_.end(); ++it)
+            {
+                for (unsigned i = 0; i < window_size_; ++i)
+                {
+                    uint64_t seq = it->second.ring_[i];
+                    if (seq != 0 && seq + window_size_ > it->second.high_)
+                    {
+                        append_entry(entries, it->first, seq);
+                    }
+                }
+            }
+            std::string tmp_path = journal_path_ + ".tmp";
+            int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0 ||
+                (!entries.empty() && utils::write_buffer(fd, entries.data(), entries.length()) != (ssize_t)entries.length()))
+            {
+                LOG_ERROR("Failed to write %s. Err: %d, ErrDesc: %s", tmp_path.c_str(), errno, strerror(errno));
+                if (fd > -1)
+                {
+                    ::close(fd);
+                }
+                LOG_RET_FALSE("");
+            }
+            fdatasync(fd);
+            ::close(fd);
+            if (rename(tmp_path.c_str(), journal_path_.c_str()) != 0)
+            {
+                LOG_RET_FALSE(utils::format_str("Failed to rename %s", tmp_path.c_str()).c_str());
+            }
+            if (fd_ > -1)
+            {
+                ::close(fd_);
+            }
+            journal_bytes_ = 0;
+            fd_ = open(journal_path_.c_str(), O_WRONLY | O_APPEND);
+            if (fd_ < 0)
+            {
+                LOG_RET_FALSE(utils::format_str("Failed to open %s", journal_path_.c_str()).c_str());
+            }
+            LOG_RET_TRUE("");
+        }
+    };
+}
+
+#endif /* PRODUCER_DEDUP_H */
@@ -0,0 +1,268 @@
+/*
+ * File:   rpc_client.h
+ *
+ *
+ * Created on October 20, 2026, 6:55 AM
+ */
+
+#ifndef RPC_CLIENT_H
+#define RPC_CLIENT_H
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include "log.h"
+#include "utils.h"
+#include "connection_zmq.h"
+#include "rpc_endpoint.h"
+using namespace mymq;
+namespace myq
+{
+
+    /**
+     * rpc_client
+     * Dealer connection to the rpc endpoint of a topic (see rpc_endpoint). Its zmq identity is the reply
+     * inbox of the client: every request made on it gets its reply on the same connection, matched by
+     * correlation id. Replies to requests that timed out are dropped when they arrive.
+     * A responder registers itself when it connects, and again every utils::rpc_serve_interval while it
+     * waits for requests, so a broker that restarted or dropped it learns its new identity. It answers
+     * requests in any order.
+     * Not thread safe.
+     */
+    class rpc_client
+    {
+    public:
+        /**
+         * constructor
+         * @param topic
+         * @param bind_uri broker rpc endpoint
+         * @param responder serve requests instead of making them
+         */
+        rpc_client(const std::string &topic, const std::string &bind_uri, bool responder)
+            : topic_(topic), bind_uri_(bind_uri), responder_(responder), p_socket_(NULL), next_correlation_id_(0),
+              last_serve_ms_(0)
+        {
+            LOG_IN("topic[%s], bind_uri[%s], responder[%d]", topic.c_str(), bind_uri.c_str(), responder);
+            LOG_OUT("");
+        }
+
+        ~rpc_client()
+        {
+            LOG_IN("");
+            if (p_socket_ && responder_)
+            {
+                std::string unserve = RPC_UNSERVE;
+                p_socket_->write_frames_nowait(&unserve, 1);
+            }
+            delete p_socket_;
+            LOG_OUT("");
+        }
+
+        /**
+         * connect, and register a responder
+         * @return
+         */
+        bool init()
+        {
+            LOG_IN("");
+            p_socket_ = new connection_zmq(
+                topic_, bind_uri_,
+                connection::conn_consumer,
+                connection_zmq::zmq_dealer,
+                connection::connect_socket,
+                false,
+                false);
+            if (!p_socket_->init())
+            {
+                LOG_RET_FALSE("Failed to connect to rpc endpoint");
+            }
+            if (responder_ && !serve())
+            {
+                LOG_RET_FALSE("Failed to register responder");
+            }
+            LOG_RET_TRUE("");
+        }
+
+        /**
+         * send a request and wait for its reply
+         * @param request
+         * @param length
+         * @param reply
+         * @param reply_length
+         * @param timeout_ms -1 to wait until the reply arrives
+         * @return reply length, 0 on timeout, -1 on error or when no responder took the request
+         */
+        ssize_t request(const char *request, uint32_t length, char *reply, uint32_t reply_length, int timeout_ms)
+        {
+            LOG_IN("length[%u], reply_length[%u], timeout_ms[%d]", length, reply_length, timeout_ms);
+            char correlation_id[sizeof(uint64_t)];
+            utils::encode_uint64(++next_correlation_id_, correlation_id);
+            frames_.resize(3);
+            frames_[0] = RPC_REQUEST;
+            frames_[1].assign(correlation_id, sizeof(correlation_id));
+            frames_[2].assign(request, length);
+            if (p_socket_->write_frames(frames_.data(), frames_.size()) < 0)
+            {
+                LOG_RET("Failed to send request", -1);
+            }
+            uint64_t deadline_ms = utils::get_currenttime_milliseconds() + timeout_ms;
+            while (true)
+            {
+                int wait_ms = timeout_ms;
+                if (timeout_ms >= 0)
+                {
+                    uint64_t now_ms = utils::get_currenttime_milliseconds();
+                    wait_ms = now_ms >= deadline_ms ? 0 : deadline_ms - now_ms;
+                }
+                ssize_t result = read(wait_ms);
+                if (result <= 0)
+                {
+                    LOG_RET(result == 0 ? "timeout" : "error", result);
+                }
+                if (frames_.size() != 3 || frames_[1].compare(0, std::string::npos, correlation_id,
+                                                              sizeof(correlation_id)) != 0)
+                {
+                    LOG_DEBUG("Dropping stale reply on topic[%s]", topic_.c_str());
+                    continue;
+                }
+                if (frames_[0] == RPC_ERROR)
+                {
+                    LOG_ERROR("Request on topic[%s] failed: %s", topic_.c_str(), frames_[2].c_str());
+                    LOG_RET("failed", -1);
+                }
+                if (frames_[2].length() > reply_length)
+                {
+                    LOG_ERROR("Reply length %u is larger than buffer length %u", frames_[2].length(), reply_length);
+                    LOG_RET("error", -1);
+                }
+                memcpy(reply, frames_[2].data(), frames_[2].length());
+                LOG_RET("", frames_[2].length());
+            }
+        }
+
+        /**
+         * wait for a request to serve
+         * @param requester set to the identity to reply to
+         * @param correlation_id set to the id to reply with
+         * @param buffer
+         * @param buffer_length
+         * @param timeout_ms -1 to wait until a request arrives
+         * @return request length, 0 on timeout, -1 on error
+         */
+        ssize_t receive_request(std::string &requester, uint64_t &correlation_id, char *buffer,
+                                uint32_t buffer_length, int timeout_ms)
+        {
+            LOG_IN("buffer_length[%u], timeout_ms[%d]", buffer_length, timeout_ms);
+            uint64_t deadline_ms = utils::get_currenttime_milliseconds() + timeout_ms;
+            while (true)
+            {
+                uint64_t now_ms = utils::get_currenttime_milliseconds();
+                if (now_ms - last_serve_ms_ >= utils::rpc_serve_interval)
+                {
+                    serve();
+                }
+                // wake up for the next registration too
+                uint64_t next_serve_ms = last_serve_ms_ + utils::rpc_serve_interval;
+                uint64_t wait_ms = next_serve_ms > now_ms ? next_serve_ms - now_ms : 0;
+                if (timeout_ms >= 0)
+                {
+                    wait_ms = std::min<uint64_t>(wait_ms, now_ms >= deadline_ms ? 0 : deadline_ms - now_ms);
+                }
+                ssize_t result = read((int)wait_ms);
+                if (result < 0)
+                {
+                    LOG_RET("error", result);
+                }
+                if (result == 0)
+                {
+                    if (timeout_ms >= 0 && utils::get_currenttime_milliseconds() >= deadline_ms)
+                    {
+                        LOG_RET("timeout", 0);
+                    }
+                    continue;
+                }
+                if (frames_.size() != 4 || frames_[0] != RPC_REQUEST || frames_[2].length() != sizeof(uint64_t))
+                {
+                    LOG_WARN("Dropping invalid rpc message on topic[%s]", topic_.c_str());
+                    continue;
+                }
+                if (frames_[3].length() > buffer_length)
+                {
+                    LOG_ERROR("Request length %u is larger than buffer length %u", frames_[3].length(), buffer_length);
+                    LOG_RET("error", -1);
+                }
+                requester.swap(frames_[1]);
+                correlation_id = utils::decode_uint64(frames_[2].data());
+                memcpy(buffer, frames_[3].data(), frames_[3].length());
+                LOG_RET("", frames_[3].length());
+            }
+        }
+
+        /**
+         * answer a request
+         * @param requester
+         * @param correlation_id
+         * @param reply
+         * @param length
+         * @return bytes sent, -1 on error
+         */
+        ssize_t reply(const std::string &requester, uint64_t correlation_id, const char *reply, uint32_t length)
+        {
+            LOG_IN("correlation_id[%llu], length[%u]", correlation_id, length);
+            char correlation_buffer[sizeof(uint64_t)];
+            utils::encode_uint64(correlation_id, correlation_buffer);
+            std::string frames[4] = {RPC_REPLY, requester, std::string(correlation_buffer, sizeof(correlation_buffer)),
+                                     std::string(reply, length)};
+            LOG_RET("", p_socket_->write_frames(frames, 4));
+        }
+
+    private:
+        std::string topic_;
+        std::string bind_uri_;
+        bool responder_;
+        connection_zmq *p_socket_;
+        uint64_t next_correlation_id_;
+        std::vector<std::string> frames_;
+        uint64_t last_serve_ms_;
+
+        /**
+         * register as a responder. The broker ignores repeats, so this is sent again periodically
+         * @return false if the registration could not be queued
+         */
+        bool serve()
+        {
+            last_serve_ms_ = utils::get_currenttime_milliseconds();
+            std::string serve = RPC_SERVE;
+            if (p_socket_->write_frames_nowait(&serve, 1) < 0)
+            {
+                LOG_DEBUG("Failed to register rpc responder on topic[%s]", topic_.c_str());
+                return false;
+            }
+            return true;
+        }
+
+        /**
+         * read the next message into frames_
+         * @param timeout_ms
+         * @return frames read, 0 on timeout, -1 on error
+         */
+        ssize_t read(int timeout_ms)
+        {
+            zmq_pollitem_t item = {p_socket_->get_socket_handle(), 0, ZMQ_POLLIN, 0};
+            int ready = zmq_poll(&item, 1, timeout_ms);
+            if (ready < 0)
+            {
+                LOG_ERROR("Failed to poll rpc connection. Error number :%d, Description :%s", zmq_errno(),
+                          zmq_strerror(zmq_errno()));
+                return -1;
+            }
+            if (ready == 0)
+            {
+                return 0;
+            }
+            return p_socket_->read_frames(frames_);
+        }
+    };
+}
+
+#endif /* RPC_CLIENT_H */
@@ -0,0 +1,265 @@
+/*
+ * File:   rpc_endpoint.h
+ *
+ *
+ * Created on October 20, 2026, 6:30 AM
+ */
+
+#ifndef RPC_ENDPOINT_H
+#define RPC_ENDPOINT_H
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "log.h"
+#include "utils.h"
+#include "connection_zmq.h"
+
+namespace myq
+{
+    // first frame of every rpc message, see rpc_endpoint
+    const char *const RPC_SERVE = "serve";
+    const char *const RPC_UNSERVE = "unserve";
+    const char *const RPC_REQUEST = "req";
+    const char *const RPC_REPLY = "rep";
+    const char *const RPC_ERROR = "err";
+
+    /**
+     * rpc_endpoint
+     * Per topic request/reply router (zmq router). Requesters and responders both connect dealer sockets;
+     * the broker knows each by its zmq identity, so a reply goes straight back to the connection that
+     * sent the request. Nothing is stored: a request goes to the next responder in turn and is lost if
+     * it fails, the requester times out and retries. Sends never block the router: a responder that
+     * can't take more is skipped for that request, one that is gone is dropped until it registers again.
+     * Frames after the identity the router adds:
+     *   responder:  [serve] to register, again every utils::rpc_serve_interval ms, [unserve] before disconnecting
+     *   requester:  [req][correlation id][payload]
+     *     to the responder as [req][requester identity][correlation id][payload]
+     *   responder:  [rep][requester identity][correlation id][payload]
+     *     to the requester as [rep][correlation id][payload]
+     *   with no responder free to take it the requester gets [err][correlation id][description]
+     */
+    class rpc_endpoint
+    {
+    public:
+        /**
+         * constructor
+         * @param id
+         * @param bind_uri
+         */
+        rpc_endpoint(const std::string &id, const std::string &bind_uri)
+            : id_(id), bind_uri_(bind_uri), p_socket_(NULL), stop_(false), next_responder_(0)
+        {
+            LOG_IN("id: %s, bind_uri: %s", id.c_str(), bind_uri.c_str());
+            LOG_OUT("");
+        }
+
+        /**
+         * destructor
+         */
+        ~rpc_endpoint()
+        {
+            LOG_IN("");
+            stop_ = true;
+            if (rpc_tid_.joinable())
+                rpc_tid_.join();
+
+            delete p_socket_;
+            LOG_OUT("");
+        }
+
+        /**
+         * init
+         * @return
+         */
+        bool init()
+        {
+            LOG_IN("");
+            p_socket_ = new connection_zmq(
+                id_, bind_uri_,
+                connection::endpoint_type::conn_broker,
+                connection_zmq::zmq_router,
+                connection::bind_socket,
+                false,
+                false);
+            if (!p_socket_->init())
+            {
+                LOG_RET_FALSE(utils::format_str(
+                                  "Failed to initialize rpc endpoint: %s, bind_uri: %s",
+                                  id_.c_str(), bind_uri_.c_str())
+                                  .c_str());
+            }
+            // fail sends to identities that are gone instead of dropping them, to skip dead responders
+            int mandatory = 1;
+            zmq_setsockopt(p_socket_->get_socket_handle(), ZMQ_ROUTER_MANDATORY, &mandatory, sizeof(mandatory));
+            LOG_RET_TRUE("");
+        }
+
+        /**
+         * run
+         * @return
+         */
+        bool run()
+        {
+            LOG_IN("");
+            rpc_tid_ = std::thread(
+                [&]()
+                {
+                    process_messages();
+                });
+            LOG_RET_TRUE("");
+        }
+
+        std::string get_bind_uri()
+        {
+            return bind_uri_;
+        }
+
+    private:
+        std::string id_;
+        std::string bind_uri_;
+        connection_zmq *p_socket_;
+        std::atomic<bool> stop_;
+        std::thread rpc_tid_;
+        std::vector<std::string> responders_; // identities, in turn from next_responder_
+        unsigned next_responder_;
+
+        const long stop_poll_ms_ = 100;
+
+        /**
+         * route messages until stopped
+         */
+        void process_messages()
+        {
+            LOG_IN("");
+            std::vector<std::string> frames;
+            zmq_pollitem_t item = {p_socket_->get_socket_handle(), 0, ZMQ_POLLIN, 0};
+            while (!stop_)
+            {
+                int ready = zmq_poll(&item, 1, stop_poll_ms_);
+                if (ready < 0)
+                {
+                    if (zmq_errno() == ETERM)
+                    {
+                        break;
+                    }
+                    continue;
+                }
+                if (ready == 0)
+                {
+                    continue;
+                }
+                if (p_socket_->read_frames(frames) < 0)
+                {
+                    LOG_ERROR("Failed to read from rpc endpoint id: %s", id_.c_str());
+                    break;
+                }
+                if (frames.size() < 2)
+                {
+                    continue;
+                }
+                const std::string &kind = frames[1];
+                if (kind == RPC_REQUEST && frames.size() == 4)
+                {
+                    route_request(frames);
+                }
+                else if (kind == RPC_REPLY && frames.size() == 5)
+                {
+                    route_reply(frames);
+                }
+                else if (kind == RPC_SERVE)
+                {
+                    if (std::find(responders_.begin(), responders_.end(), frames[0]) == responders_.end())
+                    {
+                        responders_.push_back(frames[0]);
+                        LOG_EVENT("Topic[%s] has %u rpc responders", id_.c_str(), (unsigned)responders_.size());
+                    }
+                }
+                else if (kind == RPC_UNSERVE)
+                {
+                    remove_responder(std::find(responders_.begin(), responders_.end(), frames[0]) - responders_.begin());
+                }
+                else
+                {
+                    LOG_WARN("Dropping invalid rpc message of %u frames on topic[%s]", (unsigned)frames.size(), id_.c_str());
+                }
+            }
+            LOG_OUT("");
+        }
+
+        /**
+         * send [requester][req][correlation id][payload] to the next responder as
+         * [responder][req][requester][correlation id][payload]
+         * @param frames
+         */
+        void route_request(std::vector<std::string> &frames)
+        {
+            std::string requester;
+            requester.swap(frames[0]);
+            frames.insert(frames.begin() + 2, std::string());
+            frames[2].swap(requester);
+            // each responder is tried once: a full one is skipped for this request, a gone one dropped
+            unsigned tries = responders_.size();
+            bool busy = false;
+            while (tries > 0 && !responders_.empty())
+            {
+                --tries;
+                if (next_responder_ >= responders_.size())
+                {
+                    next_responder_ = 0;
+                }
+                unsigned index = next_responder_++;
+                frames[0] = responders_[index];
+                int error = 0;
+                if (p_socket_->write_frames_nowait(frames.data(), frames.size(), &error) >= 0)
+                {
+                    return;
+                }
+                if (error == EHOSTUNREACH)
+                {
+                    LOG_WARN("Rpc responder of topic[%s] is gone", id_.c_str());
+                    remove_responder(index);
+                }
+                else
+                {
+                    LOG_DEBUG("Rpc responder of topic[%s] is full, error: %d", id_.c_str(), error);
+                    busy = true;
+                }
+            }
+            std::string error[4] = {frames[2], RPC_ERROR, frames[3], busy ? "responders busy" : "no responder"};
+            p_socket_->write_frames_nowait(error, 4);
+        }
+
+        /**
+         * send [responder][rep][requester][correlation id][payload] to the requester as
+         * [requester][rep][correlation id][payload]
+         * @param frames
+         */
+        void route_reply(std::vector<std::string> &frames)
+        {
+            frames[0].swap(frames[2]);
+            frames.erase(frames.begin() + 2);
+            if (p_socket_->write_frames_nowait(frames.data(), frames.size()) < 0)
+            {
+                LOG_DEBUG("Requester of topic[%s] is gone or full, dropping reply", id_.c_str());
+            }
+        }
+
+        void remove_responder(unsigned index)
+        {
+            if (index >= responders_.size())
+            {
+                return;
+            }
+            responders_.erase(responders_.begin() + index);
+            if (next_responder_ > index)
+            {
+                --next_responder_;
+            }
+            LOG_EVENT("Topic[%s] has %u rpc responders", id_.c_str(), (unsigned)responders_.size());
+        }
+    };
+}
+
+#endif /* RPC_ENDPOINT_H */
@@ -0,0 +1,319 @@
+/*
+ * File:   stats_shm.h
+ *
+ *
+ * Created on October 19, 2026, 9:30 PM
+ */
+
+#ifndef STATS_SHM_H
+#define STATS_SHM_H
+
+#include <atomic>
+#include <string>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "log.h"
+#include "utils.h"
+using namespace mymq;
+namespace myq
+{
+
+    /**
+     * stats_shm
+     * Topic statistics published by the broker in a POSIX shared memory segment, so local tools read
+     * them with plain loads instead of a stats request through the admin loop.
+     * The segment is a header followed by a fixed array of slots, one per topic in creation order.
+     * Each slot is guarded by a seqlock: the writer makes the sequence odd, updates the record and
+     * makes it even again; a reader copies the record and retries if the sequence was odd or moved.
+     * The broker opens it as writer; readers map it read only and never block the broker.
+     */
+    class stats_shm
+    {
+    public:
+        static const uint32_t magic_ = 0x4d595153; // "MYQS"
+        static const uint32_t version_ = 3;
+        static const uint32_t max_topics_ = 4096;
+
+        // one topic, all fields of the stats response
+        struct record
+        {
+            char topic_[256];
+            char topic_type_[32];
+            uint64_t queue_size_;
+            uint64_t messages_sent_;
+            uint64_t messages_received_;
+            uint64_t publishers_count_;
+            uint64_t subscribers_count_;
+            uint64_t total_bytes_written_;
+            uint64_t total_bytes_read_;
+            uint64_t messages_conflated_;
+            uint64_t duplicates_dropped_;
+            uint64_t memory_used_;
+            uint64_t memory_quota_;
+            uint64_t memory_throttled_;
+            uint64_t broker_memory_used_;
+            uint64_t broker_memory_limit_;
+            uint64_t append_latency_avg_ns_;
+            uint64_t append_latency_max_ns_;
+            uint64_t memory_fixed_;
+            uint64_t memory_queued_;
+            uint64_t memory_indexes_;
+            uint64_t cpu_producer_ns_;
+            uint64_t cpu_consumer_ns_;
+            uint64_t cpu_egress_ns_;
+            uint64_t segment_cache_hits_;
+            uint64_t segment_cache_misses_;
+            uint64_t broker_segments_open_;
+            uint64_t broker_segments_open_limit_;
+            uint64_t updated_ms_; // when the broker last wrote the record
+        };
+
+        struct slot
+        {
+            std::atomic<uint64_t> seq_; // odd while the record is being written
+            record record_;
+        };
+
+        struct header
+        {
+            uint32_t magic_;
+            uint32_t version_;
+            uint32_t max_topics_;
+            std::atomic<uint32_t> topic_count_; // slots in use, published after the slot is set up
+        };
+
+        /**
+         * constructor
+         * @param name shared memory object name, see name_for_uri
+         */
+        stats_shm(const std::string &name) : name_(name), writer_(false), p_header_(NULL), p_slots_(NULL)
+        {
+        }
+
+        ~stats_shm()
+        {
+            if (p_header_)
+            {
+                munmap(p_header_, get_size());
+            }
+            if (writer_)
+            {
+                shm_unlink(name_.c_str());
+            }
+        }
+
+        /**
+         * shared memory name of the broker listening on admin uri: tcp endpoints by port, so the
+         * bind uri (tcp://<any>:5500) and the connect uri (tcp://127.0.0.1:5500) give the same name
+         * @param uri
+         * @return
+         */
+        static std::string name_for_uri(const std::string &uri)
+        {
+            std::string address = uri;
+            size_t pos = address.find("://");
+            if (pos != std::string::npos)
+            {
+                address = address.substr(pos + 3);
+            }
+            pos = address.rfind(':');
+            if (uri.compare(0, 6, "tcp://") == 0 && pos != std::string::npos)
+            {
+                address = address.substr(pos + 1);
+            }
+            std::string name = "/myq_stats_";
+            for (unsigned i = 0; i < address.length(); ++i)
+            {
+                name += isalnum(address[i]) ? address[i] : '_';
+            }
+            return name;
+        }
+
+        /**
+         * create the segment (broker side), replacing one left by an earlier broker
+         * @return
+         */
+        bool create()
+        {
+            LOG_IN("name[%s]", name_.c_str());
+            shm_unlink(name_.c_str());
+            int fd = shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+            if (fd < 0 || ftruncate(fd, get_size()) != 0)
+            {
+                LOG_ERROR("Failed to create shared memory %s. Err: %d, ErrDesc: %s", name_.c_str(), errno, strerror(errno));
+                if (fd > -1)
+                {
+                    ::close(fd);
+                }
+                LOG_RET_FALSE("failed");
+            }
+            void *p = mmap(NULL, get_size(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (p == MAP_FAILED)
+            {
+                LOG_RET_FALSE(utils::format_str("Failed to map %s", name_.c_str()).c_str());
+            }
+            writer_ = true;
+            set_pointers(p);
+            // ftruncate zero fills, so every slot starts with an even sequence
+            p_header_->version_ = version_;
+            p_header_->max_topics_ = max_topics_;
+            p_header_->topic_count_ = 0;
+            std::atomic_thread_fence(std::memory_order_release);
+            p_header_->magic_ = magic_;
+            LOG_EVENT("Publishing topic stats in shared memory %s", name_.c_str());
+            LOG_RET_TRUE("");
+        }
+
+        /**
+         * map the segment read only (reader side)
+         * @return
+         */
+        bool open()
+        {
+            LOG_IN("name[%s]", name_.c_str());
+            int fd = shm_open(name_.c_str(), O_RDONLY, 0);
+            if (fd < 0)
+            {
+                LOG_RET_FALSE(utils::format_str("No shared memory %s", name_.c_str()).c_str());
+            }
+            struct stat st;
+            if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < get_size())
+            {
+                ::close(fd);
+                LOG_RET_FALSE("Shared memory too small");
+            }
+            void *p = mmap(NULL, get_size(), PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (p == MAP_FAILED)
+            {
+                LOG_RET_FALSE(utils::format_str("Failed to map %s", name_.c_str()).c_str());
+            }
+            set_pointers(p);
+            if (p_header_->magic_ != magic_ || p_header_->version_ != version_)
+            {
+                munmap(p_header_, get_size());
+                p_header_ = NULL;
+                LOG_RET_FALSE("Unknown shared memory layout");
+            }
+            LOG_RET_TRUE("");
+        }
+
+        /**
+         * take the next slot for a topic (writer)
+         * @param topic
+         * @return slot index, -1 if the table is full
+         */
+        int add_topic(const std::string &topic)
+        {
+            uint32_t index = p_header_->topic_count_.load(std::memory_order_relaxed);
+            if (index >= max_topics_)
+            {
+                LOG_WARN("Stats table is full, topic[%s] is not published", topic.c_str());
+                return -1;
+            }
+            record r;
+            memset(&r, 0, sizeof(r));
+            strncpy(r.topic_, topic.c_str(), sizeof(r.topic_) - 1);
+            write(index, r);
+            p_header_->topic_count_.store(index + 1, std::memory_order_release);
+            return index;
+        }
+
+        /**
+         * update a slot (writer)
+         * @param index
+         * @param r
+         */
+        void write(uint32_t index, const record &r)
+        {
+            slot &s = p_slots_[index];
+            uint64_t seq = s.seq_.load(std::memory_order_relaxed);
+            s.seq_.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            memcpy(&s.record_, &r, sizeof(r));
+            s.seq_.store(seq + 2, std::memory_order_release);
+        }
+
+        /**
+         * copy a consistent snapshot of a slot (reader)
+         * @param index
+         * @param r
+         * @return false if index is not in use
+         */
+        bool read(uint32_t index, record &r) const
+        {
+            if (index >= get_topic_count())
+            {
+                return false;
+            }
+            const slot &s = p_slots_[index];
+            while (true)
+            {
+                uint64_t before = s.seq_.load(std::memory_order_acquire);
+                if (before & 1)
+                {
+                    continue; // writer in progress
+                }
+                memcpy(&r, &s.record_, sizeof(r));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (s.seq_.load(std::memory_order_relaxed) == before)
+                {
+                    return true;
+                }
+            }
+        }
+
+        /**
+         * find a topic (reader)
+         * @param topic
+         * @param r
+         * @return false if the topic is not published
+         */
+        bool read(const std::string &topic, record &r) const
+        {
+            uint32_t count = get_topic_count();
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                // topic names never change once the slot is published
+                if (topic == p_slots_[i].record_.topic_)
+                {
+                    return read(i, r);
+                }
+            }
+            return false;
+        }
+
+        inline uint32_t get_topic_count() const
+        {
+            return p_header_->topic_count_.load(std::memory_order_acquire);
+        }
+
+        inline const std::string &get_name() const
+        {
+            return name_;
+        }
+
+    private:
+        std::string name_;
+        bool writer_;
+        header *p_header_;
+        slot *p_slots_;
+
+        static inline uint64_t get_size()
+        {
+            return sizeof(header) + (uint64_t)max_topics_ * sizeof(slot);
+        }
+
+        void set_pointers(void *p)
+        {
+            p_header_ = static_cast<header *>(p);
+            p_slots_ = reinterpret_cast<slot *>(static_cast<char *>(p) + sizeof(header));
+        }
+    };
+}
+
+#endif /* STATS_SHM_H */
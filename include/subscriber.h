@@ -0,0 +1,319 @@
+/*
+ * File:   subscriber.h
+ *
+ *
+ * Created on October 19, 2026, 11:40 AM
+ */
+
+#ifndef SUBSCRIBER_H
+#define SUBSCRIBER_H
+
+#include <deque>
+#include <vector>
+#include <cstring>
+#include "log.h"
+#include "admin_cmd.h"
+#include "connection_zmq.h"
+#include "connection_multicast.h"
+
+namespace myq
+{
+
+    /**
+     * subscriber
+     * Client side of a pub subscription. Tracks the per topic sequence number stamped by the broker,
+     * detects gaps and asks the topic sync endpoint to retransmit the missing range before delivering
+     * newer messages, so the application sees messages in order without silent loss.
+     * On topics with a last value cache the subscription starts from a snapshot of the latest message
+     * per key, stitched to the live stream by sequence number.
+     * The live stream is read from the zmq pub socket, or from the topic multicast group when given.
+     */
+    class subscriber
+    {
+    public:
+        /**
+         * constructor
+         * @param topic
+         * @param bind_uri broker pub endpoint
+         * @param sync_uri broker sync endpoint, empty to disable recovery
+         * @param last_value_cache start from the topic snapshot
+         * @param multicast_uri udp multicast group to read the stream from instead of bind_uri, empty for zmq
+         * @param multicast_interface local address to join the group on
+         */
+        subscriber(const std::string &topic, const std::string &bind_uri, const std::string &sync_uri,
+                   bool last_value_cache = false, const std::string &multicast_uri = "",
+                   const std::string &multicast_interface = "")
+            : topic_(topic), bind_uri_(bind_uri), sync_uri_(sync_uri), last_value_cache_(last_value_cache),
+              multicast_uri_(multicast_uri), multicast_interface_(multicast_interface)
+        {
+            LOG_IN("topic[%s], bind_uri[%s], sync_uri[%s], last_value_cache[%d], multicast_uri[%s]",
+                   topic.c_str(), bind_uri.c_str(), sync_uri.c_str(), last_value_cache, multicast_uri.c_str());
+            p_sub_socket_ = NULL;
+            p_mcast_socket_ = NULL;
+            p_sync_socket_ = NULL;
+            expected_seq_ = 0;
+            gaps_detected_ = 0;
+            messages_recovered_ = 0;
+            messages_lost_ = 0;
+            snapshot_messages_ = 0;
+            LOG_OUT("");
+        }
+
+        /**
+         * destructor
+         */
+        ~subscriber()
+        {
+            LOG_IN("");
+            delete p_sub_socket_;
+            delete p_mcast_socket_;
+            delete p_sync_socket_;
+            LOG_OUT("");
+        }
+
+        /**
+         * init
+         * @return
+         */
+        bool init()
+        {
+            LOG_IN("");
+            if (!multicast_uri_.empty())
+            {
+                p_mcast_socket_ = new connection_multicast(
+                    topic_, multicast_uri_,
+                    connection::conn_consumer,
+                    connection::connect_socket,
+                    multicast_interface_);
+                if (!p_mcast_socket_->init())
+                {
+                    LOG_RET_FALSE("Failed to join multicast group");
+                }
+            }
+            else
+            {
+                p_sub_socket_ = new connection_zmq(
+                    topic_, bind_uri_,
+                    connection::conn_consumer,
+                    connection_zmq::zmq_sub,
+                    connection::connect_socket,
+                    false,
+                    false);
+                if (!p_sub_socket_->init())
+                {
+                    LOG_RET_FALSE("Failed to initialize sub connection");
+                }
+            }
+            if (!sync_uri_.empty())
+            {
+                p_sync_socket_ = new connection_zmq(
+                    topic_, sync_uri_,
+                    connection::conn_consumer,
+                    connection_zmq::zmq_req,
+                    connection::connect_socket,
+                    false,
+                    false);
+                if (!p_sync_socket_->init())
+                {
+                    LOG_RET_FALSE("Failed to initialize sync connection");
+                }
+                // subscribed first, so live messages newer than the snapshot queue up behind it
+                if (last_value_cache_ && !load_snapshot())
+                {
+                    LOG_RET_FALSE("Failed to load snapshot");
+                }
+            }
+            LOG_RET_TRUE("");
+        }
+
+        /**
+         * read next message in sequence order
+         * @param buffer
+         * @param buffer_length
+         * @return bytes copied to buffer, -1 on error
+         */
+        ssize_t read_msg(char *buffer, uint32_t buffer_length)
+        {
+            LOG_IN("buffer[%p], buffer_length[%u]", buffer, buffer_length);
+            while (pending_.empty())
+            {
+                uint64_t seq = 0;
+                ssize_t result = p_mcast_socket_ ? p_mcast_socket_->read_msg_seq(message_, seq)
+                                                 : p_sub_socket_->read_msg_seq(message_, seq);
+                if (result < 0)
+                {
+                    LOG_RET("error", -1);
+                }
+                if (result == 0 && message_.empty())
+                {
+                    continue;
+                }
+                if (expected_seq_ == 0)
+                {
+                    // first message seen on this subscription
+                    expected_seq_ = seq;
+                }
+                if (seq < expected_seq_)
+                {
+                    LOG_DEBUG("Dropping duplicate seq[%llu], expected[%llu]", seq, expected_seq_);
+                    continue;
+                }
+                if (seq > expected_seq_)
+                {
+                    ++gaps_detected_;
+                    LOG_WARN("Gap detected on topic[%s]: expected seq[%llu], received[%llu]",
+                             topic_.c_str(), expected_seq_, seq);
+                    recover(expected_seq_, seq - 1);
+                }
+                pending_.push_back(std::string());
+                pending_.back().swap(message_);
+                expected_seq_ = seq + 1;
+            }
+
+            std::string &message = pending_.front();
+            if (message.length() > buffer_length)
+            {
+                LOG_ERROR("Message length %u is larger than buffer length %u", message.length(), buffer_length);
+                pending_.pop_front();
+                LOG_RET("error", -1);
+            }
+            memcpy(buffer, message.data(), message.length());
+            ssize_t length = message.length();
+            pending_.pop_front();
+            LOG_RET("", length);
+        }
+
+        inline uint64_t get_gaps_detected() const
+        {
+            return gaps_detected_;
+        }
+
+        inline uint64_t get_messages_recovered() const
+        {
+            return messages_recovered_;
+        }
+
+        inline uint64_t get_messages_lost() const
+        {
+            return messages_lost_;
+        }
+
+        inline uint64_t get_snapshot_messages() const
+        {
+            return snapshot_messages_;
+        }
+
+        /**
+         * sequence number of the last message received (0 if none)
+         * @return
+         */
+        inline uint64_t get_last_seq() const
+        {
+            return expected_seq_ ? expected_seq_ - 1 : 0;
+        }
+
+    private:
+        std::string topic_;
+        std::string bind_uri_;
+        std::string sync_uri_;
+        bool last_value_cache_;
+        std::string multicast_uri_;
+        std::string multicast_interface_;
+        connection_zmq *p_sub_socket_;
+        connection_multicast *p_mcast_socket_;
+        connection_zmq *p_sync_socket_;
+        uint64_t expected_seq_;
+        std::deque<std::string> pending_;
+        std::string message_;
+        uint64_t gaps_detected_;
+        uint64_t messages_recovered_;
+        uint64_t messages_lost_;
+        uint64_t snapshot_messages_;
+
+        /**
+         * fetch the latest message per key and queue it for delivery ahead of the live stream.
+         * live messages at or below the snapshot sequence are already reflected in it and get dropped
+         * @return
+         */
+        bool load_snapshot()
+        {
+            LOG_IN("");
+            admin_cmd::snapshot_req req;
+            req.topic_ = topic_;
+            std::vector<std::string> frames;
+            if (p_sync_socket_->write_msg(req.to_json()) <= 0 ||
+                p_sync_socket_->read_frames(frames) <= 0)
+            {
+                LOG_RET_FALSE(utils::format_str("Failed to request snapshot from %s", sync_uri_.c_str()).c_str());
+            }
+            admin_cmd::snapshot_resp resp;
+            if (!resp.from_json(frames[0]) || resp.status_ != "ok")
+            {
+                LOG_RET_FALSE(utils::format_str("Snapshot refused: %s", frames[0].c_str()).c_str());
+            }
+            for (unsigned i = 1; i + 1 < frames.size(); i += 2)
+            {
+                pending_.push_back(std::string());
+                pending_.back().swap(frames[i + 1]);
+                ++snapshot_messages_;
+            }
+            if (resp.last_seq_ > 0)
+            {
+                expected_seq_ = resp.last_seq_ + 1;
+            }
+            LOG_DEBUG("Snapshot of %llu keys, live stream from seq[%llu]", snapshot_messages_, expected_seq_);
+            LOG_RET_TRUE("");
+        }
+
+        /**
+         * request retransmission of [from_seq, to_seq] and queue recovered messages for delivery.
+         * whatever the broker can't serve is counted as lost
+         * @param from_seq
+         * @param to_seq
+         */
+        void recover(uint64_t from_seq, uint64_t to_seq)
+        {
+            LOG_IN("from_seq[%llu], to_seq[%llu]", from_seq, to_seq);
+            std::vector<std::string> frames;
+            while (p_sync_socket_ && from_seq <= to_seq)
+            {
+                admin_cmd::nak_req req;
+                req.topic_ = topic_;
+                req.from_seq_ = from_seq;
+                req.to_seq_ = to_seq;
+                if (p_sync_socket_->write_msg(req.to_json()) <= 0 ||
+                    p_sync_socket_->read_frames(frames) <= 0)
+                {
+                    LOG_ERROR("Failed to request retransmission from %s", sync_uri_.c_str());
+                    break;
+                }
+                admin_cmd::nak_resp resp;
+                if (!resp.from_json(frames[0]) || resp.status_ != "ok")
+                {
+                    LOG_ERROR("Retransmission refused: %s", frames[0].c_str());
+                    break;
+                }
+                for (unsigned i = 1; i + 1 < frames.size(); i += 2)
+                {
+                    pending_.push_back(std::string());
+                    pending_.back().swap(frames[i + 1]);
+                    ++messages_recovered_;
+                }
+                if (resp.to_seq_ < (int64_t)from_seq)
+                {
+                    break; // nothing more available
+                }
+                from_seq = resp.to_seq_ + 1;
+            }
+            if (from_seq <= to_seq)
+            {
+                messages_lost_ += to_seq - from_seq + 1;
+                LOG_WARN("Topic[%s]: %llu messages [%llu - %llu] could not be recovered",
+                         topic_.c_str(), to_seq - from_seq + 1, from_seq, to_seq);
+            }
+            LOG_OUT("");
+        }
+    };
+}
+
+#endif /* SUBSCRIBER_H */
@@ -0,0 +1,299 @@
+/*
+ * File:   sync_endpoint.h
+ *
+ *
+ * Created on October 19, 2026, 11:05 AM
+ */
+
+#ifndef SYNC_ENDPOINT_H
+#define SYNC_ENDPOINT_H
+
+#include <thread>
+#include <vector>
+#include "log.h"
+#include "admin_cmd.h"
+#include "broker_storage.h"
+#include "connection_zmq.h"
+
+namespace myq
+{
+
+    /**
+     * sync_endpoint
+     * Per topic side channel (zmq rep) used by subscribers to recover messages they missed on the
+     * pub socket. Requests name a sequence range; replies are served from the file log.
+     * Topics with a last value cache also serve a per key snapshot to late joiners.
+     */
+    class sync_endpoint
+    {
+    public:
+        /**
+         * constructor
+         * @param pstorage
+         * @param id
+         * @param bind_uri
+         */
+        sync_endpoint(broker_storage *pstorage, const std::string &id, const std::string &bind_uri)
+            : p_storage_(pstorage), id_(id), bind_uri_(bind_uri)
+        {
+            LOG_IN("broker_storage: %p, id: %s, bind_uri: %s", pstorage, id.c_str(), bind_uri.c_str());
+            stop_ = false;
+            p_socket_ = NULL;
+            LOG_OUT("");
+        }
+
+        /**
+         * destructor
+         */
+        ~sync_endpoint()
+        {
+            LOG_IN("");
+            if (sync_tid_.joinable())
+                sync_tid_.join();
+
+            delete p_socket_;
+            LOG_OUT("");
+        }
+
+        /**
+         * init
+         * @return
+         */
+        bool init()
+        {
+            LOG_IN("");
+            p_socket_ = new connection_zmq(
+                id_, bind_uri_,
+                connection::endpoint_type::conn_broker,
+                connection_zmq::zmq_rep,
+                connection::bind_socket,
+                false,
+                false);
+            if (!p_socket_->init())
+            {
+                LOG_RET_FALSE(utils::format_str(
+                                  "Failed to initialize sync endpoint: %s, bind_uri: %s",
+                                  id_.c_str(), bind_uri_.c_str())
+                                  .c_str());
+            }
+            LOG_RET_TRUE("");
+        }
+
+        /**
+         * run
+         * @return
+         */
+        bool run()
+        {
+            LOG_IN("");
+            sync_tid_ = std::thread(
+                [&]()
+                {
+                    process_requests();
+                });
+            LOG_RET_TRUE("");
+        }
+
+        /**
+         * cpu time of the sync thread
+         * @return nanoseconds
+         */
+        uint64_t get_cpu_time_ns()
+        {
+            return utils::get_thread_cpu_nanoseconds(sync_tid_);
+        }
+
+        /**
+         * Process sync requests
+         */
+        void process_requests()
+        {
+            LOG_IN("");
+            std::string message;
+            while (!stop_)
+            {
+                message.clear();
+                ssize_t bytes_read = p_socket_->read_msg(message);
+                if (bytes_read < 0)
+                {
+                    LOG_ERROR("Failed to read from sync endpoint id: %s", id_.c_str());
+                    break;
+                }
+                if (bytes_read == 0)
+                    continue;
+
+                std::string cmd;
+                if (!admin_cmd::get_cmd(message, cmd))
+                {
+                    reply_error(CMD_INVALID, "invalid request");
+                    continue;
+                }
+                if (cmd == CMD_NAK)
+                {
+                    admin_cmd::nak_req req;
+                    if (!req.from_json(message))
+                    {
+                        reply_error(cmd, "invalid request");
+                        continue;
+                    }
+                    reply_to_nak(req);
+                }
+                else if (cmd == CMD_SNAPSHOT)
+                {
+                    admin_cmd::snapshot_req req;
+                    if (!req.from_json(message))
+                    {
+                        reply_error(cmd, "invalid request");
+                        continue;
+                    }
+                    reply_to_snapshot(req);
+                }
+                else
+                {
+                    reply_error(cmd, "invalid request");
+                }
+            }
+            LOG_OUT("");
+        }
+
+        /**
+         * reply to retransmission request with [nak_resp][seq][payload][seq][payload]...
+         * @param req
+         * @return
+         */
+        ssize_t reply_to_nak(admin_cmd::nak_req &req)
+        {
+            LOG_IN("from_seq[%lld], to_seq[%lld]", req.from_seq_, req.to_seq_);
+            admin_cmd::nak_resp resp;
+            resp.topic_ = id_;
+            resp.from_seq_ = req.from_seq_;
+            resp.to_seq_ = req.from_seq_ - 1;
+            resp.last_seq_ = p_storage_->get_last_publish_seq();
+
+            connection_file *p_file = p_storage_->get_file_connection();
+            if (p_file == NULL)
+            {
+                resp.status_ = STATUS_ERROR;
+                resp.description_ = "retransmission is only available for file backed topics";
+                std::string resp_str = resp.to_json();
+                LOG_RET("", p_socket_->write_frames(&resp_str, 1));
+            }
+            if (req.from_seq_ <= 0 || req.to_seq_ < req.from_seq_)
+            {
+                resp.status_ = STATUS_ERROR;
+                resp.description_ = "invalid sequence range";
+                std::string resp_str = resp.to_json();
+                LOG_RET("", p_socket_->write_frames(&resp_str, 1));
+            }
+
+            // a reply carries at most max_nak_messages_/max_nak_bytes_, clients ask again for the rest
+            int64_t to_seq = std::min<int64_t>(req.to_seq_, req.from_seq_ + max_nak_messages_ - 1);
+            to_seq = std::min<int64_t>(to_seq, resp.last_seq_);
+            std::vector<std::string> frames;
+            frames.push_back(std::string());
+            uint64_t total_bytes = 0;
+            char seq_buffer[sizeof(uint64_t)];
+            for (int64_t seq = req.from_seq_; seq <= to_seq && total_bytes < max_nak_bytes_; ++seq)
+            {
+                ssize_t bytes_read = p_file->read_by_seq(seq, buffer_, utils::max_msg_size);
+                if (bytes_read < (ssize_t)sizeof(uint32_t))
+                {
+                    LOG_ERROR("Failed to read seq[%lld] from the log", seq);
+                    break;
+                }
+                utils::encode_uint64(seq, seq_buffer);
+                frames.push_back(std::string(seq_buffer, sizeof(seq_buffer)));
+                frames.push_back(std::string(&buffer_[sizeof(uint32_t)], bytes_read - sizeof(uint32_t)));
+                total_bytes += bytes_read;
+                resp.to_seq_ = seq;
+            }
+            resp.status_ = STATUS_SUCCESS;
+            frames[0] = resp.to_json();
+            LOG_DEBUG("Retransmitting seq[%lld - %lld]", resp.from_seq_, resp.to_seq_);
+            LOG_RET("", p_socket_->write_frames(frames.data(), frames.size()));
+        }
+
+        /**
+         * reply to snapshot request with [snapshot_resp][seq][payload][seq][payload]...
+         * one pair per key, holding the latest message published for that key
+         * @param req
+         * @return
+         */
+        ssize_t reply_to_snapshot(admin_cmd::snapshot_req &req)
+        {
+            LOG_IN("topic[%s]", req.topic_.c_str());
+            admin_cmd::snapshot_resp resp;
+            resp.topic_ = id_;
+
+            last_value_cache *p_lvc = p_storage_->get_last_value_cache();
+            if (p_lvc == NULL)
+            {
+                resp.status_ = STATUS_ERROR;
+                resp.description_ = "last value cache is not enabled for this topic";
+                std::string resp_str = resp.to_json();
+                LOG_RET("", p_socket_->write_frames(&resp_str, 1));
+            }
+
+            std::vector<last_value_cache::entry> entries;
+            resp.last_seq_ = p_lvc->snapshot(entries);
+            resp.count_ = entries.size();
+
+            std::vector<std::string> frames;
+            frames.reserve(entries.size() * 2 + 1);
+            frames.push_back(std::string());
+            char seq_buffer[sizeof(uint64_t)];
+            for (size_t i = 0; i < entries.size(); ++i)
+            {
+                utils::encode_uint64(entries[i].seq_, seq_buffer);
+                frames.push_back(std::string(seq_buffer, sizeof(seq_buffer)));
+                frames.push_back(std::string());
+                frames.back().swap(entries[i].message_);
+            }
+            resp.status_ = STATUS_SUCCESS;
+            frames[0] = resp.to_json();
+            LOG_DEBUG("Snapshot of %lld keys up to seq[%lld]", resp.count_, resp.last_seq_);
+            LOG_RET("", p_socket_->write_frames(frames.data(), frames.size()));
+        }
+
+        std::string get_bind_uri()
+        {
+            return bind_uri_;
+        }
+
+    private:
+        broker_storage *p_storage_;
+        std::string id_;
+        std::string bind_uri_;
+        connection_zmq *p_socket_;
+        bool stop_;
+        std::thread sync_tid_;
+        char buffer_[utils::max_msg_size];
+
+        const unsigned max_nak_messages_ = 1024;
+        const uint64_t max_nak_bytes_ = 4 * 1024 * 1024;
+        const std::string CMD_INVALID = "invalid_cmd";
+        const std::string CMD_NAK = "nak";
+        const std::string CMD_SNAPSHOT = "snapshot";
+        const std::string STATUS_ERROR = "error";
+        const std::string STATUS_SUCCESS = "ok";
+
+        /**
+         * reply with error
+         * @param cmd
+         * @param description
+         * @return
+         */
+        ssize_t reply_error(const std::string &cmd, const std::string &description)
+        {
+            LOG_IN("cmd[%s], description[%s]", cmd.c_str(), description.c_str());
+            admin_cmd::common_resp resp;
+            resp.cmd_ = cmd;
+            resp.status_ = STATUS_ERROR;
+            resp.description_ = description;
+            std::string resp_str = resp.to_json();
+            LOG_RET("", p_socket_->write_frames(&resp_str, 1));
+        }
+    };
+}
+
+#endif /* SYNC_ENDPOINT_H */
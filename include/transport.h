@@ -0,0 +1,169 @@
+/*
+ * File:   transport.h
+ *
+ *
+ * Created on October 19, 2026, 9:12 AM
+ */
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <string>
+#include "connection.h"
+
+namespace myq
+{
+
+    /**
+     * transport
+     * Statically typed handle over a concrete connection (connection_zmq, connection_socket, ...).
+     * Endpoints pick the transport once at init time and run their message loops as templates over it,
+     * so every send/receive is a direct (inlinable) call instead of a virtual call through connection*.
+     */
+    template <typename Connection>
+    class transport
+    {
+    public:
+        typedef Connection connection_type;
+
+        explicit transport(Connection *p_conn = NULL) : p_conn_(p_conn)
+        {
+        }
+
+        /**
+         * send message
+         * @param message
+         * @param length
+         * @return
+         */
+        inline ssize_t send(const char *message, unsigned length)
+        {
+            return p_conn_->write_msg(message, length);
+        }
+
+        /**
+         * send message
+         * @param message
+         * @return
+         */
+        inline ssize_t send(const std::string &message)
+        {
+            return p_conn_->write_msg(message.c_str(), message.length());
+        }
+
+        /**
+         * send message without blocking
+         * @param message
+         * @param length
+         * @return bytes sent, 0 if the peer is backlogged
+         */
+        inline ssize_t try_send(const char *message, unsigned length)
+        {
+            return p_conn_->try_write_msg(message, length);
+        }
+
+        /**
+         * send batch of messages
+         * @param messages
+         * @param count
+         * @return bytes sent
+         */
+        inline ssize_t send_batch(const std::string *messages, unsigned count)
+        {
+            return p_conn_->write_msgs(messages, count);
+        }
+
+        /**
+         * send batch of messages stamped with consecutive sequence numbers
+         * @param messages
+         * @param count
+         * @param first_seq
+         * @return bytes sent
+         */
+        inline ssize_t send_batch_seq(const std::string *messages, unsigned count, uint64_t first_seq)
+        {
+            return p_conn_->write_msgs_seq(messages, count, first_seq);
+        }
+
+        /**
+         * send message stamped with a sequence number
+         * @param seq
+         * @param message
+         * @param length
+         * @return
+         */
+        inline ssize_t send_seq(uint64_t seq, const char *message, unsigned length)
+        {
+            return p_conn_->write_msg_seq(seq, message, length);
+        }
+
+        /**
+         * send whatever the connection has buffered (packing transports only)
+         * @return
+         */
+        inline ssize_t flush()
+        {
+            return p_conn_->flush();
+        }
+
+        /**
+         * receive message
+         * @param message
+         * @return
+         */
+        inline ssize_t receive(std::string &message)
+        {
+            return p_conn_->read_msg(message);
+        }
+
+        /**
+         * receive batch of messages
+         * @param messages
+         * @param max_count
+         * @return number of messages received
+         */
+        inline ssize_t receive_batch(std::string *messages, unsigned max_count)
+        {
+            return p_conn_->read_msgs(messages, max_count);
+        }
+
+        /**
+         * receive batch of messages with the producer stamp of each (zero for plain messages)
+         * @param messages
+         * @param stamps
+         * @param max_count
+         * @return number of messages received
+         */
+        inline ssize_t receive_batch_stamped(std::string *messages, connection::producer_stamp *stamps, unsigned max_count)
+        {
+            return p_conn_->read_msgs_stamped(messages, stamps, max_count);
+        }
+
+        /**
+         * type-erased send, used where the owner of the transport can't name the connection type
+         * @param p_conn
+         * @param message
+         * @param length
+         * @return
+         */
+        static ssize_t send_thunk(void *p_conn, const char *message, unsigned length)
+        {
+            return static_cast<Connection *>(p_conn)->write_msg(message, length);
+        }
+
+        inline Connection *get() const
+        {
+            return p_conn_;
+        }
+
+        inline bool valid() const
+        {
+            return p_conn_ != NULL;
+        }
+
+    private:
+        Connection *p_conn_;
+    };
+}
+
+#endif /* TRANSPORT_H */
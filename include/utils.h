@@ -14,6 +14,9 @@
 #include <string>
 #include <chrono>
 #include <vector>
+#include <thread>
+#include <pthread.h>
+#include <time.h>
 #include "log.h"
 
 using namespace std::chrono;
@@ -29,6 +32,12 @@ namespace mymq
             max_small_msg_size = 256,
             zmq_sync_wait = 1000, // ms
             queue_poll_wait = 20,
+            max_batch_size = 128, // messages per transport batch
+            max_adaptive_batch_size = 1024, // upper bound of batches sized to a latency target
+            catchup_threshold = 4 * 1024 * 1024, // socket consumer lag (bytes) that switches to catch-up mode
+            catchup_chunk_size = 64 * 1024 * 1024, // bytes per sendfile call in catch-up mode
+            default_open_segments = 1024, // sealed log segments the broker keeps an fd open for
+            rpc_serve_interval = 1000, // ms between registrations of an rpc responder
 
         };
 
@@ -144,6 +153,32 @@ namespace mymq
             return (t1.time_since_epoch() / std::chrono::milliseconds(1));
         }
 
+        /**
+         * monotonic clock, for measuring intervals
+         * @return
+         */
+        inline static uint64_t get_currenttime_nanoseconds()
+        {
+            return std::chrono::steady_clock::now().time_since_epoch() / std::chrono::nanoseconds(1);
+        }
+
+        /**
+         * cpu time consumed by a running thread
+         * @param t
+         * @return nanoseconds, 0 if the thread is not running
+         */
+        static uint64_t get_thread_cpu_nanoseconds(std::thread &t)
+        {
+            clockid_t clock_id;
+            struct timespec ts;
+            if (!t.joinable() || pthread_getcpuclockid(t.native_handle(), &clock_id) != 0 ||
+                clock_gettime(clock_id, &ts) != 0)
+            {
+                return 0;
+            }
+            return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+        }
+
         /**
          * random string
          * @param length
@@ -449,6 +484,77 @@ namespace mymq
             LOG_RET("Success", bytes_written);
         }
 
+        /**
+         * encode uint64 in network byte order
+         * @param value
+         * @param buffer must hold at least sizeof(uint64_t) bytes
+         */
+        static void encode_uint64(uint64_t value, char *buffer)
+        {
+            for (int i = sizeof(uint64_t) - 1; i >= 0; --i)
+            {
+                buffer[i] = static_cast<char>(value & 0xff);
+                value >>= 8;
+            }
+        }
+
+        /**
+         * decode uint64 from network byte order
+         * @param buffer
+         * @return
+         */
+        static uint64_t decode_uint64(const char *buffer)
+        {
+            uint64_t value = 0;
+            for (unsigned i = 0; i < sizeof(uint64_t); ++i)
+            {
+                value = (value << 8) | static_cast<unsigned char>(buffer[i]);
+            }
+            return value;
+        }
+
+        /**
+         * encode uint32 in network byte order
+         * @param value
+         * @param buffer must hold at least sizeof(uint32_t) bytes
+         */
+        static void encode_uint32(uint32_t value, char *buffer)
+        {
+            value = htonl(value);
+            memcpy(buffer, &value, sizeof(value));
+        }
+
+        /**
+         * decode uint32 from network byte order
+         * @param buffer
+         * @return
+         */
+        static uint32_t decode_uint32(const char *buffer)
+        {
+            uint32_t value;
+            memcpy(&value, buffer, sizeof(value));
+            return ntohl(value);
+        }
+
+        /**
+         * get message key: the bytes before the first delimiter
+         * @param message
+         * @param length
+         * @param delimiter
+         * @param key
+         * @return false if the message has no delimiter
+         */
+        static bool get_message_key(const char *message, unsigned length, char delimiter, std::string &key)
+        {
+            const char *end = static_cast<const char *>(memchr(message, delimiter, length));
+            if (end == NULL)
+            {
+                return false;
+            }
+            key.assign(message, end - message);
+            return true;
+        }
+
         /**
          * sleep in mill sec
          * @param msecs
@@ -465,6 +571,22 @@ namespace mymq
 #endif
         }
 
+        /**
+         * sleep in micro sec
+         * @param usecs
+         */
+        static void sleep_us(unsigned usecs)
+        {
+#if (defined(_WIN32))
+            Sleep((usecs + 999) / 1000);
+#else
+            struct timespec t;
+            t.tv_sec = usecs / 1000000;
+            t.tv_nsec = (usecs % 1000000) * 1000;
+            nanosleep(&t, NULL);
+#endif
+        }
+
         /**
          * read line
          * @param fd
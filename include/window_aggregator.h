@@ -0,0 +1,262 @@
+/*
+ * File:   window_aggregator.h
+ *
+ *
+ * Created on October 19, 2026, 11:40 PM
+ */
+
+#ifndef WINDOW_AGGREGATOR_H
+#define WINDOW_AGGREGATOR_H
+
+#include <mutex>
+#include <string>
+#include <deque>
+#include <unordered_map>
+#include <cstring>
+#include <cstdlib>
+#include "log.h"
+#include "utils.h"
+using namespace mymq;
+namespace myq
+{
+
+    /**
+     * window_aggregator
+     * Per key count, sum, min and max of a numeric field over tumbling windows, updated once messages are
+     * stored so consumers don't have to read the raw traffic to get them. A window tracks at most
+     * max_window_keys_ keys, messages of further keys are only counted as untracked, so the memory of
+     * the kept windows stays bounded.
+     * A message is "key<d>field1<d>field2..." with the topic key delimiter <d>; the value is the field
+     * at value_field (1 is the first field after the key), 0 counts messages only. Messages without key
+     * are not aggregated, fields that are not numbers are counted but not summed.
+     * Windows are aligned to multiples of the window size since epoch. A window closes with the first
+     * message or query past its end and is kept, with the last max_closed_windows_ before it, for queries;
+     * a window no message or query fell in is never opened, so it is not kept.
+     */
+    class window_aggregator
+    {
+    public:
+        static const unsigned max_closed_windows_ = 16;
+        static const unsigned max_window_keys_ = 16384;
+
+        struct aggregate
+        {
+            uint64_t count_;  // messages for the key
+            uint64_t values_; // messages with a numeric value
+            double sum_;
+            double min_;
+            double max_;
+
+            aggregate() : count_(0), values_(0), sum_(0), min_(0), max_(0)
+            {
+            }
+        };
+
+        struct window
+        {
+            uint64_t start_ms_;
+            uint64_t end_ms_;
+            uint64_t messages_;
+            uint64_t untracked_; // messages of keys past max_window_keys_
+            std::unordered_map<std::string, aggregate> keys_;
+
+            window() : start_ms_(0), end_ms_(0), messages_(0), untracked_(0)
+            {
+            }
+        };
+
+        /**
+         * constructor
+         * @param window_ms
+         * @param value_field
+         * @param delimiter
+         */
+        window_aggregator(uint64_t window_ms, unsigned value_field, char delimiter)
+            : window_ms_(window_ms), value_field_(value_field), delimiter_(delimiter)
+        {
+            roll(utils::get_currenttime_milliseconds());
+        }
+
+        /**
+         * aggregate a message into the current window
+         * @param message
+         * @param length
+         */
+        void add(const char *message, unsigned length)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            roll(utils::get_currenttime_milliseconds());
+            add_locked(message, length);
+        }
+
+        /**
+         * aggregate the records of a batch, packed as the log stores them ([uint32 length][payload] each)
+         * @param records
+         * @param length
+         * @param count
+         */
+        void add_records(const char *records, unsigned length, unsigned count)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            roll(utils::get_currenttime_milliseconds());
+            unsigned offset = 0;
+            for (unsigned i = 0; i < count && offset + sizeof(uint32_t) <= length; ++i)
+            {
+                uint32_t record_length;
+                memcpy(&record_length, records + offset, sizeof(record_length));
+                add_locked(records + offset + sizeof(record_length), record_length);
+                offset += sizeof(record_length) + record_length;
+            }
+        }
+
+        /**
+         * copy a closed window
+         * @param start_ms start of the window, 0 for the latest closed one
+         * @param result
+         * @return false if the window is not (or no longer) kept
+         */
+        bool get_closed_window(uint64_t start_ms, window &result)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            roll(utils::get_currenttime_milliseconds());
+            for (std::deque<window>::reverse_iterator it = closed_.rbegin(); it != closed_.rend(); ++it)
+            {
+                if (start_ms == 0 || it->start_ms_ == start_ms)
+                {
+                    result = *it;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * copy the window still collecting messages
+         * @param result
+         */
+        void get_open_window(window &result)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            roll(utils::get_currenttime_milliseconds());
+            result = current_;
+        }
+
+        inline uint64_t get_window_ms() const
+        {
+            return window_ms_;
+        }
+
+    private:
+        uint64_t window_ms_;
+        unsigned value_field_;
+        char delimiter_;
+        window current_;
+        std::deque<window> closed_;
+        std::string key_; // reused by add_locked
+        std::mutex mutex_;
+
+        /**
+         * close the current window if now is past its end and open the one now falls in
+         * @param now_ms
+         */
+        void roll(uint64_t now_ms)
+        {
+            if (now_ms < current_.end_ms_)
+            {
+                return;
+            }
+            if (current_.end_ms_ != 0)
+            {
+                closed_.push_back(window());
+                closed_.back().start_ms_ = current_.start_ms_;
+                closed_.back().end_ms_ = current_.end_ms_;
+                closed_.back().messages_ = current_.messages_;
+                closed_.back().untracked_ = current_.untracked_;
+                closed_.back().keys_.swap(current_.keys_);
+                if (closed_.size() > max_closed_windows_)
+                {
+                    closed_.pop_front();
+                }
+            }
+            current_.keys_.clear();
+            current_.messages_ = 0;
+            current_.untracked_ = 0;
+            current_.start_ms_ = now_ms / window_ms_ * window_ms_;
+            current_.end_ms_ = current_.start_ms_ + window_ms_;
+        }
+
+        void add_locked(const char *message, unsigned length)
+        {
+            if (!utils::get_message_key(message, length, delimiter_, key_))
+            {
+                return;
+            }
+            ++current_.messages_;
+            std::unordered_map<std::string, aggregate>::iterator it = current_.keys_.find(key_);
+            if (it == current_.keys_.end())
+            {
+                if (current_.keys_.size() >= max_window_keys_)
+                {
+                    ++current_.untracked_;
+                    return;
+                }
+                it = current_.keys_.insert(std::make_pair(key_, aggregate())).first;
+            }
+            aggregate &a = it->second;
+            ++a.count_;
+            double value;
+            if (value_field_ > 0 && get_value(message + key_.length() + 1, length - key_.length() - 1, value))
+            {
+                if (a.values_ == 0 || value < a.min_)
+                {
+                    a.min_ = value;
+                }
+                if (a.values_ == 0 || value > a.max_)
+                {
+                    a.max_ = value;
+                }
+                a.sum_ += value;
+                ++a.values_;
+            }
+        }
+
+        /**
+         * parse the field at value_field_
+         * @param fields message after the key and its delimiter
+         * @param length
+         * @param value
+         * @return false if the message has no such field or it is not a number
+         */
+        bool get_value(const char *fields, unsigned length, double &value) const
+        {
+            const char *end = fields + length;
+            for (unsigned field = 1; field < value_field_; ++field)
+            {
+                const char *next = static_cast<const char *>(memchr(fields, delimiter_, end - fields));
+                if (next == NULL)
+                {
+                    return false;
+                }
+                fields = next + 1;
+            }
+            const char *field_end = static_cast<const char *>(memchr(fields, delimiter_, end - fields));
+            if (field_end == NULL)
+            {
+                field_end = end;
+            }
+            char buffer[64];
+            size_t field_length = field_end - fields;
+            if (field_length == 0 || field_length >= sizeof(buffer))
+            {
+                return false;
+            }
+            memcpy(buffer, fields, field_length);
+            buffer[field_length] = '\0';
+            char *parsed_end = NULL;
+            value = strtod(buffer, &parsed_end);
+            return parsed_end == buffer + field_length;
+        }
+    };
+}
+
+#endif /* WINDOW_AGGREGATOR_H */
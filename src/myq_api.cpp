@@ -5,8 +5,14 @@
  * Created on April 2, 2015, 8:37 AM
  */
 #include <iostream>
+#include <random>
 #include "log.h"
 #include "broker_manager.h"
+#include "subscriber.h"
+#include "stats_shm.h"
+#include "producer_batcher.h"
+#include "consumer_set.h"
+#include "rpc_client.h"
 #include "myq_api.h"
 #include "utils.h"
 
@@ -192,6 +198,13 @@ myq_producer_conn *init_producer(
         p_producer_conn->delay_pub_on_slow_consumer = true;
         p_producer_conn->last_queue_size = 0;
         p_producer_conn->pubDelayAlgorithm = publish_delay_algorithm;
+        p_producer_conn->batcher = NULL;
+        // 0 means "not idempotent" on the wire
+        std::random_device random;
+        do
+        {
+            p_producer_conn->producer_id = (static_cast<uint64_t>(random()) << 32) | random();
+        } while (p_producer_conn->producer_id == 0);
         strcpy(p_producer_conn->topic_type, "");
         LOG_EVENT("myq_producer_conn for producer created successfully.");
         utils::sleep_ms(utils::zmq_sync_wait);
@@ -220,6 +233,12 @@ void free_producer_conn(myq_producer_conn *producer_conn)
         return;
     }
 
+    if (producer_conn->batcher)
+    {
+        // sends what still waits before the connection goes
+        delete static_cast<myq::producer_batcher *>(producer_conn->batcher);
+        producer_conn->batcher = NULL;
+    }
     if (producer_conn->conn)
     {
         if (producer_conn->conn->admin_conn)
@@ -241,16 +260,17 @@ void free_producer_conn(myq_producer_conn *producer_conn)
 }
 
 /**
- * Publish message
- * @param conn
+ * send message of a producer, stamped with producer id and seq when seq > 0
+ * @param p_producer_conn
+ * @param seq
  * @param message
  * @param message_length
  * @return
  */
-int publish_message(myq_producer_conn *p_producer_conn, const char *message, uint32_t message_length)
+static int send_message(myq_producer_conn *p_producer_conn, uint64_t seq, const char *message, uint32_t message_length)
 {
-    LOG_IN("conn[%p], message[%s], message_length[%u]",
-           p_producer_conn, message, message_length);
+    LOG_IN("conn[%p], seq[%llu], message[%s], message_length[%u]",
+           p_producer_conn, seq, message, message_length);
 
     if (!p_producer_conn)
     {
@@ -273,7 +293,24 @@ int publish_message(myq_producer_conn *p_producer_conn, const char *message, uin
     try
     {
         myq::connection_zmq *pub_conn = static_cast<myq::connection_zmq *>(p_producer_conn->conn->client_conn);
-        bytes_sent = pub_conn->write_msg(message, message_length);
+        myq::producer_batcher *p_batcher = static_cast<myq::producer_batcher *>(p_producer_conn->batcher);
+        if (p_batcher && seq == 0)
+        {
+            bytes_sent = p_batcher->publish(message, message_length);
+        }
+        else if (p_batcher)
+        {
+            bytes_sent = p_batcher->send_after_flush(
+                [&]()
+                {
+                    return pub_conn->write_msg_stamped(p_producer_conn->producer_id, seq, message, message_length);
+                });
+        }
+        else
+        {
+            bytes_sent = seq ? pub_conn->write_msg_stamped(p_producer_conn->producer_id, seq, message, message_length)
+                             : pub_conn->write_msg(message, message_length);
+        }
         if (bytes_sent < 0)
         {
             LOG_ERROR("Failed to send message");
@@ -297,6 +334,182 @@ int publish_message(myq_producer_conn *p_producer_conn, const char *message, uin
     LOG_RET("success", bytes_sent);
 }
 
+/**
+ * Publish message
+ * @param conn
+ * @param message
+ * @param message_length
+ * @return
+ */
+int publish_message(myq_producer_conn *p_producer_conn, const char *message, uint32_t message_length)
+{
+    return send_message(p_producer_conn, 0, message, message_length);
+}
+
+/**
+ * Publish message with producer sequence number
+ * @param conn
+ * @param seq
+ * @param message
+ * @param message_length
+ * @return
+ */
+int publish_message_idempotent(myq_producer_conn *p_producer_conn, uint64_t seq, const char *message, uint32_t message_length)
+{
+    if (seq == 0)
+    {
+        LOG_ERROR("Producer sequence numbers start at 1");
+        return -1;
+    }
+    return send_message(p_producer_conn, seq, message, message_length);
+}
+
+/**
+ * Batch publish_message calls to a latency target
+ * @param p_producer_conn
+ * @param latency_target_us
+ * @return
+ */
+bool set_producer_latency_target(myq_producer_conn *p_producer_conn, uint64_t latency_target_us)
+{
+    LOG_IN("conn[%p], latency_target_us[%llu]", p_producer_conn, latency_target_us);
+    if (!p_producer_conn || !p_producer_conn->conn || !p_producer_conn->conn->client_conn)
+    {
+        LOG_ERROR("myq_conn is null. you must call init_producer() prior to setting a latency target");
+        LOG_RET_FALSE("error");
+    }
+    if (p_producer_conn->batcher)
+    {
+        delete static_cast<myq::producer_batcher *>(p_producer_conn->batcher);
+        p_producer_conn->batcher = NULL;
+    }
+    if (latency_target_us > 0)
+    {
+        myq::connection_zmq *pub_conn = static_cast<myq::connection_zmq *>(p_producer_conn->conn->client_conn);
+        p_producer_conn->batcher = new myq::producer_batcher(pub_conn, latency_target_us);
+    }
+    LOG_RET_TRUE("success");
+}
+
+/**
+ * Send the messages waiting in the client batch
+ * @param p_producer_conn
+ * @return
+ */
+int flush_producer(myq_producer_conn *p_producer_conn)
+{
+    LOG_IN("conn[%p]", p_producer_conn);
+    if (!p_producer_conn || !p_producer_conn->batcher)
+    {
+        LOG_RET("nothing to flush", 0);
+    }
+    int bytes_sent = static_cast<myq::producer_batcher *>(p_producer_conn->batcher)->flush();
+    LOG_RET("success", bytes_sent);
+}
+
+/**
+ * pack messages as log records and send them as one batch
+ * @param p_producer_conn
+ * @param first_seq 0 if not idempotent
+ * @param messages
+ * @param message_lengths
+ * @param count
+ * @return
+ */
+static int send_batch(myq_producer_conn *p_producer_conn, uint64_t first_seq, const char **messages,
+                      const uint32_t *message_lengths, uint32_t count)
+{
+    LOG_IN("conn[%p], first_seq[%llu], messages[%p], count[%u]", p_producer_conn, first_seq, messages, count);
+    if (!p_producer_conn || !p_producer_conn->conn || !p_producer_conn->conn->client_conn)
+    {
+        LOG_ERROR("myq_conn is null. you must call init_producer() prior to publishing messages");
+        LOG_RET("error", -1);
+    }
+    if (count == 0 || !messages || !message_lengths)
+    {
+        LOG_ERROR("Empty batch");
+        LOG_RET("error", -1);
+    }
+    std::string records;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (message_lengths[i] > utils::max_msg_size)
+        {
+            LOG_ERROR("Message length %u is larger than allowed message length %u. Can't send batch",
+                      message_lengths[i], utils::max_msg_size);
+            LOG_RET("error", -1);
+        }
+        records.append((const char *)&message_lengths[i], sizeof(uint32_t));
+        records.append(messages[i], message_lengths[i]);
+    }
+    int bytes_sent = -1;
+    try
+    {
+        myq::connection_zmq *pub_conn = static_cast<myq::connection_zmq *>(p_producer_conn->conn->client_conn);
+        myq::producer_batcher *p_batcher = static_cast<myq::producer_batcher *>(p_producer_conn->batcher);
+        auto send = [&]()
+        {
+            return pub_conn->write_batch(first_seq ? p_producer_conn->producer_id : 0, first_seq,
+                                         records.data(), records.length(), count);
+        };
+        bytes_sent = p_batcher ? p_batcher->send_after_flush(send) : send();
+        if (bytes_sent < 0)
+        {
+            LOG_ERROR("Failed to send batch");
+            LOG_RET("error", bytes_sent);
+        }
+        p_producer_conn->conn->message_counter += count;
+        p_producer_conn->conn->payload_size_counter += bytes_sent;
+
+        if (p_producer_conn->delay_pub_on_slow_consumer && p_producer_conn->pubDelayAlgorithm)
+        {
+            p_producer_conn->pubDelayAlgorithm(p_producer_conn);
+        }
+    }
+    catch (std::exception &ex)
+    {
+        LOG_ERROR("Error: Exception [%s]", ex.what());
+    }
+    catch (...)
+    {
+    }
+    LOG_RET("success", bytes_sent);
+}
+
+/**
+ * Publish atomic batch
+ * @param conn
+ * @param messages
+ * @param message_lengths
+ * @param count
+ * @return
+ */
+int publish_batch(myq_producer_conn *p_producer_conn, const char **messages, const uint32_t *message_lengths,
+                  uint32_t count)
+{
+    return send_batch(p_producer_conn, 0, messages, message_lengths, count);
+}
+
+/**
+ * Publish atomic batch with producer sequence numbers
+ * @param conn
+ * @param first_seq
+ * @param messages
+ * @param message_lengths
+ * @param count
+ * @return
+ */
+int publish_batch_idempotent(myq_producer_conn *p_producer_conn, uint64_t first_seq, const char **messages,
+                             const uint32_t *message_lengths, uint32_t count)
+{
+    if (first_seq == 0)
+    {
+        LOG_ERROR("Producer sequence numbers start at 1");
+        return -1;
+    }
+    return send_batch(p_producer_conn, first_seq, messages, message_lengths, count);
+}
+
 /**
  * publish delay algorithm
  * @param conn
@@ -381,6 +594,7 @@ myq_consumer_conn *init_consumer(
         }
         std::string response;
         myq::admin_cmd::join_req req;
+        req.type_ = "pull";
         if (consumer_type == consumer_socket_type::zmq_consumer)
         {
             req.connection_type_ = "zmq";
@@ -389,9 +603,14 @@ myq_consumer_conn *init_consumer(
         {
             req.connection_type_ = "socket";
         }
+        else if (consumer_type == consumer_socket_type::zmq_subscriber ||
+                 consumer_type == consumer_socket_type::multicast_subscriber)
+        {
+            req.connection_type_ = "zmq";
+            req.type_ = "sub";
+        }
         req.password_ = password;
         req.user_id_ = userid;
-        req.type_ = "pull";
         req.topic_ = topic;
         std::string req_str = req.to_json();
         LOG_DEBUG("Sending request [%s]", req_str.c_str());
@@ -410,8 +629,32 @@ myq_consumer_conn *init_consumer(
             LOG_RET("error", p_consumer_conn);
         }
         utils::sleep_ms(utils::zmq_sync_wait);
+        void *p_client_conn = NULL;
         myq::connection *p_consumer_socket = NULL;
-        if (consumer_type == consumer_socket_type::zmq_consumer)
+        if (consumer_type == consumer_socket_type::zmq_subscriber ||
+            consumer_type == consumer_socket_type::multicast_subscriber)
+        {
+            std::string multicast_uri;
+            if (consumer_type == consumer_socket_type::multicast_subscriber)
+            {
+                multicast_uri = resp.multicast_uri_;
+                if (multicast_uri.empty())
+                {
+                    LOG_WARN("Topic[%s] has no multicast group, subscribing over zmq", resp.topic_.c_str());
+                }
+            }
+            myq::subscriber *p_subscriber = new myq::subscriber(resp.topic_, resp.bind_uri_, resp.sync_uri_,
+                                                                   resp.last_value_cache_, multicast_uri,
+                                                                   resp.multicast_interface_);
+            if (!p_subscriber->init())
+            {
+                LOG_ERROR("Failed to initialize subscriber connection");
+                delete p_subscriber;
+                LOG_RET("error", p_consumer_conn);
+            }
+            p_client_conn = static_cast<void *>(p_subscriber);
+        }
+        else if (consumer_type == consumer_socket_type::zmq_consumer)
         {
             p_consumer_socket = new myq::connection_zmq(
                 resp.topic_, resp.bind_uri_,
@@ -429,13 +672,24 @@ myq_consumer_conn *init_consumer(
                 connection::conn_consumer,
                 connection::connect_socket, false);
         }
-        if (!p_consumer_socket->init())
+        if (p_consumer_socket)
         {
-            LOG_ERROR("Failed to initialize producer connection");
-            LOG_RET("error", p_consumer_conn);
+            if (!p_consumer_socket->init())
+            {
+                LOG_ERROR("Failed to initialize producer connection");
+                LOG_RET("error", p_consumer_conn);
+            }
+            if (consumer_type == consumer_socket_type::socket_consumer &&
+                !static_cast<myq::connection_socket *>(p_consumer_socket)->send_fetch_request(
+                    myq::connection_socket::fetch_from_offset, 0))
+            {
+                LOG_ERROR("Failed to send fetch request");
+                LOG_RET("error", p_consumer_conn);
+            }
+            p_client_conn = static_cast<void *>(p_consumer_socket);
         }
         myq_conn *pconn = new myq_conn();
-        pconn->client_conn = static_cast<void *>(p_consumer_socket);
+        pconn->client_conn = p_client_conn;
         pconn->admin_conn = static_cast<void *>(p_admin_socket);
         pconn->message_counter = 0;
         pconn->payload_size_counter = 0;
@@ -489,6 +743,12 @@ void free_consumer_conn(myq_consumer_conn *consumer_conn)
                 myq::connection_zmq *p_push_socket = static_cast<myq::connection_zmq *>(consumer_conn->p_myq_conn->client_conn);
                 delete p_push_socket;
             }
+            else if (consumer_conn->socket_type == consumer_socket_type::zmq_subscriber ||
+                     consumer_conn->socket_type == consumer_socket_type::multicast_subscriber)
+            {
+                myq::subscriber *p_subscriber = static_cast<myq::subscriber *>(consumer_conn->p_myq_conn->client_conn);
+                delete p_subscriber;
+            }
             else
             {
                 myq::connection_socket *p_push_socket = static_cast<myq::connection_socket *>(consumer_conn->p_myq_conn->client_conn);
@@ -523,6 +783,13 @@ int receive_message(myq_consumer_conn *p_consumer_conn, char *buffer, uint32_t b
             bytes_read = p_conn_sock->read_msg(buffer, buffer_length);
             LOG_DEBUG("buffer read size[%d], data[%s]", bytes_read, buffer);
         }
+        else if (p_consumer_conn->socket_type == consumer_socket_type::zmq_subscriber ||
+                 p_consumer_conn->socket_type == consumer_socket_type::multicast_subscriber)
+        {
+            subscriber *p_subscriber = static_cast<subscriber *>(p_consumer_conn->p_myq_conn->client_conn);
+            bytes_read = p_subscriber->read_msg(buffer, buffer_length);
+            LOG_DEBUG("buffer read size[%d]", bytes_read);
+        }
         else
         {
             connection_socket *p_conn_sock = static_cast<connection_socket *>(p_consumer_conn->p_myq_conn->client_conn);
@@ -541,49 +808,37 @@ int receive_message(myq_consumer_conn *p_consumer_conn, char *buffer, uint32_t b
 }
 
 /**
- * Get stats
- * @param conn
+ * reconnect socket consumer, starting at the given position of the file log.
+ * the start position is sent once per connection, so seeking reconnects
+ * @param p_consumer_conn
+ * @param type
+ * @param value
  * @return
  */
-bool get_stats(myq_conn *p_myq_conn, topic_stats *stats)
+static bool reconnect_socket_consumer(
+    myq_consumer_conn *p_consumer_conn, connection_socket::fetch_type type, uint64_t value)
 {
-    LOG_IN("p_myq_conn[%p]", p_myq_conn);
+    LOG_IN("p_consumer_conn[%p], type[%d], value[%llu]", p_consumer_conn, type, value);
+    if (!p_consumer_conn || !p_consumer_conn->p_myq_conn ||
+        p_consumer_conn->socket_type != consumer_socket_type::socket_consumer)
+    {
+        LOG_ERROR("Seek is only available for socket consumer connections");
+        LOG_RET_FALSE("failed");
+    }
     try
     {
-        myq::admin_cmd::stats_req stat_req;
-        stat_req.password_ = p_myq_conn->password;
-        stat_req.user_id_ = p_myq_conn->userid;
-        stat_req.topic_ = p_myq_conn->topic;
-        myq::connection_zmq *admin_conn = static_cast<myq::connection_zmq *>(p_myq_conn->admin_conn);
-        ssize_t size = admin_conn->write_msg(stat_req.to_json());
-        if (size <= 0)
-        {
-            LOG_ERROR("Failed to send for stats request");
-            strcpy(stats->status, "error");
-            LOG_RET_FALSE("Failed");
-        }
-        std::string response;
-        admin_conn->read_msg(response);
-        LOG_EVENT("Stats :%s ", response.c_str());
-        myq::admin_cmd::stats_resp resp;
-        resp.from_json(response);
-        if (resp.status_ == "error")
+        connection_socket *p_old = static_cast<connection_socket *>(p_consumer_conn->p_myq_conn->client_conn);
+        connection_socket *p_conn_sock = new connection_socket(
+            p_old->get_topic(),
+            p_old->get_resource_uri_(),
+            connection::conn_consumer,
+            connection::connect_socket, false);
+        delete p_old;
+        p_consumer_conn->p_myq_conn->client_conn = static_cast<void *>(p_conn_sock);
+        if (!p_conn_sock->init() || !p_conn_sock->send_fetch_request(type, value))
         {
-            LOG_ERROR("Failed to get stat response. response %s", response.c_str());
-            strcpy(stats->status, "error");
-            LOG_RET_FALSE("Failed");
+            LOG_RET_FALSE("Failed to reconnect");
         }
-        //  std::cout << "Stats Response:" << response << std::endl;
-        stats->messages_received = resp.messages_received_;
-        stats->messages_sent = resp.messages_sent_;
-        stats->publishers_count = resp.publishers_count_;
-        stats->queue_size = resp.queue_size_;
-        strcpy(stats->status, resp.status_.c_str());
-        stats->subscribers_count = resp.subscribers_count_;
-        strcpy(stats->topic, resp.topic_.c_str());
-        strcpy(stats->topic_type, resp.topic_type_.c_str());
-        stats->total_bytes_read = resp.total_bytes_read_;
-        stats->total_bytes_written = resp.total_bytes_written_;
         LOG_RET_TRUE("success");
     }
     catch (std::exception &ex)
@@ -597,36 +852,111 @@ bool get_stats(myq_conn *p_myq_conn, topic_stats *stats)
 }
 
 /**
- * initialize broker
- * @param bind_uri
- * @param start_port
+ * Seek socket consumer to message
+ * @param p_consumer_conn
+ * @param seq
  * @return
  */
-myq_broker_mgr *init_broker(
-    const char *admin_userid, const char *admin_password, const char *transport,
-    const char *bind_ip, unsigned bind_port)
+bool seek(myq_consumer_conn *p_consumer_conn, uint64_t seq)
 {
-    LOG_IN("admin_userid[%s], admin_password[%u], transport[%s], bind_ip[%s], bind_port[%d]",
-           admin_userid, admin_password, transport, bind_ip, bind_port);
+    LOG_IN("p_consumer_conn[%p], seq[%llu]", p_consumer_conn, seq);
+    LOG_RET("", reconnect_socket_consumer(p_consumer_conn, connection_socket::fetch_from_seq, seq));
+}
+
+/**
+ * Seek socket consumer to the first message
+ * @param p_consumer_conn
+ * @return
+ */
+bool seek_to_beginning(myq_consumer_conn *p_consumer_conn)
+{
+    LOG_IN("p_consumer_conn[%p]", p_consumer_conn);
+    LOG_RET("", reconnect_socket_consumer(p_consumer_conn, connection_socket::fetch_from_offset, 0));
+}
+
+/**
+ * Seek socket consumer past the last message
+ * @param p_consumer_conn
+ * @return
+ */
+bool seek_to_end(myq_consumer_conn *p_consumer_conn)
+{
+    LOG_IN("p_consumer_conn[%p]", p_consumer_conn);
+    LOG_RET("", reconnect_socket_consumer(p_consumer_conn, connection_socket::fetch_from_offset, UINT64_MAX));
+}
+
+/**
+ * Seek socket consumer to time
+ * @param p_consumer_conn
+ * @param timestamp_ms
+ * @return
+ */
+bool seek_to_time(myq_consumer_conn *p_consumer_conn, uint64_t timestamp_ms)
+{
+    LOG_IN("p_consumer_conn[%p], timestamp_ms[%llu]", p_consumer_conn, timestamp_ms);
+    LOG_RET("", reconnect_socket_consumer(p_consumer_conn, connection_socket::fetch_from_time, timestamp_ms));
+}
+
+/**
+ * Initialize consumer set
+ * @param userid
+ * @param password
+ * @param broker_uri
+ * @param type
+ * @return
+ */
+myq_consumer_set *init_consumer_set(
+    const char *userid, const char *password, const char *broker_uri, consumer_socket_type type)
+{
+    LOG_IN("userid[%s], broker_uri[%s], type[%d]", userid, broker_uri, type);
+    if (type != consumer_socket_type::zmq_consumer && type != consumer_socket_type::socket_consumer)
+    {
+        LOG_ERROR("Consumer sets only take zmq or socket consumers");
+        LOG_RET("error", (myq_consumer_set *)NULL);
+    }
+    myq_consumer_set *p_set = new myq_consumer_set();
+    p_set->set = static_cast<void *>(new myq::consumer_set());
+    strcpy(p_set->userid, userid);
+    strcpy(p_set->password, password);
+    strcpy(p_set->broker_uri, broker_uri);
+    p_set->socket_type = type;
+    LOG_RET("", p_set);
+}
+
+/**
+ * Join a topic as a consumer of the set
+ * @param p_set
+ * @param topic
+ * @return
+ */
+bool consumer_set_add(myq_consumer_set *p_set, const char *topic)
+{
+    LOG_IN("p_set[%p], topic[%s]", p_set, topic);
+    if (!p_set || !p_set->set)
+    {
+        LOG_RET_FALSE("no set");
+    }
+    myq_consumer_conn *p_consumer_conn = init_consumer(p_set->userid, p_set->password, topic,
+                                                       p_set->broker_uri, p_set->socket_type);
+    if (!p_consumer_conn)
+    {
+        LOG_RET_FALSE("Failed to join topic");
+    }
     try
     {
-        ;
-        std::string bind_uri = transport;
-        bind_uri.append("://");
-        bind_uri.append(bind_ip);
-        bind_uri.append(":");
-        bind_uri.append(std::to_string(broker_config::get_next_port(bind_port)));
-        broker_manager *p_mgr = new broker_manager(bind_uri, admin_userid, admin_password);
-        if (!p_mgr->init())
+        myq::consumer_set *p_consumer_set = static_cast<myq::consumer_set *>(p_set->set);
+        void *p_client_conn = p_consumer_conn->p_myq_conn->client_conn;
+        if (p_set->socket_type == consumer_socket_type::zmq_consumer)
         {
-            LOG_ERROR("Failed to initialize broker at bind uri[%s]", bind_uri.c_str());
-            LOG_RET("failed", NULL);
+            p_consumer_set->add(p_consumer_conn->p_myq_conn->topic, static_cast<connection_zmq *>(p_client_conn),
+                                p_consumer_conn);
         }
-        myq_broker_mgr *p_myq_mgr = new myq_broker_mgr();
-        p_myq_mgr->broker = static_cast<void *>(p_mgr);
-        strcpy(p_myq_mgr->broker_uri, bind_uri.c_str());
-        utils::sleep_ms(utils::zmq_sync_wait);
-        LOG_RET("success", p_myq_mgr);
+        else
+        {
+            p_consumer_set->add(p_consumer_conn->p_myq_conn->topic, static_cast<connection_socket *>(p_client_conn),
+                                p_consumer_conn);
+        }
+        LOG_RET_TRUE("success");
     }
     catch (std::exception &ex)
     {
@@ -635,21 +965,637 @@ myq_broker_mgr *init_broker(
     catch (...)
     {
     }
-    LOG_RET("failed", NULL);
+    free_consumer_conn(p_consumer_conn);
+    LOG_RET_FALSE("failed");
 }
 
 /**
- * Free producer connection
- * @param conn
+ * Receive messages from the topics of the set
+ * @param p_set
+ * @param messages
+ * @param count
+ * @param timeout_ms
+ * @return
  */
-void free_broker_mgr(myq_broker_mgr *broker_mgr)
+int consumer_set_receive(myq_consumer_set *p_set, myq_message *messages, uint32_t count, int timeout_ms)
 {
-    LOG_IN("broker_mgr[%p]", broker_mgr);
-    if (broker_mgr == NULL)
+    LOG_IN("p_set[%p], messages[%p], count[%u], timeout_ms[%d]", p_set, messages, count, timeout_ms);
+    if (!p_set || !p_set->set)
     {
-        return;
+        LOG_RET("no set", -1);
     }
-
+    int received = -1;
+    try
+    {
+        myq::consumer_set *p_consumer_set = static_cast<myq::consumer_set *>(p_set->set);
+        std::vector<char *> buffers(count);
+        std::vector<uint32_t> buffer_lengths(count);
+        std::vector<uint32_t> lengths(count);
+        std::vector<unsigned> indexes(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            buffers[i] = messages[i].buffer;
+            buffer_lengths[i] = messages[i].buffer_length;
+        }
+        received = p_consumer_set->receive(buffers.data(), buffer_lengths.data(), lengths.data(), indexes.data(),
+                                           count, timeout_ms);
+        for (int i = 0; i < received; ++i)
+        {
+            messages[i].length = lengths[i];
+            messages[i].topic = p_consumer_set->get_topic(indexes[i]).c_str();
+        }
+    }
+    catch (std::exception &ex)
+    {
+        LOG_ERROR("Error: Exception [%s]", ex.what());
+    }
+    catch (...)
+    {
+    }
+    LOG_RET("", received);
+}
+
+/**
+ * free consumer set
+ * @param p_set
+ */
+void free_consumer_set(myq_consumer_set *p_set)
+{
+    LOG_IN("p_set[%p]", p_set);
+    if (p_set == NULL)
+    {
+        return;
+    }
+    myq::consumer_set *p_consumer_set = static_cast<myq::consumer_set *>(p_set->set);
+    if (p_consumer_set)
+    {
+        for (unsigned i = 0; i < p_consumer_set->size(); ++i)
+        {
+            free_consumer_conn(static_cast<myq_consumer_conn *>(p_consumer_set->get_handle(i)));
+        }
+        delete p_consumer_set;
+    }
+    delete p_set;
+    LOG_OUT("");
+}
+
+/**
+ * Initialize request/reply connection
+ * @param userid
+ * @param password
+ * @param topic
+ * @param broker_uri
+ * @param responder
+ * @return
+ */
+myq_rpc_conn *init_rpc_conn(
+    const char *userid, const char *password, const char *topic, const char *broker_uri, bool responder)
+{
+    LOG_IN("userid[%s], topic[%s], broker_uri[%s], responder[%d]", userid, topic, broker_uri, responder);
+    myq_rpc_conn *p_rpc_conn = NULL;
+    try
+    {
+        myq::connection_zmq *p_admin_socket = new myq::connection_zmq(
+            topic, broker_uri,
+            myq::connection::conn_consumer,
+            myq::connection_zmq::zmq_req,
+            myq::connection::connect_socket,
+            false,
+            false);
+        if (!p_admin_socket->init() || !p_admin_socket->run())
+        {
+            LOG_ERROR("Failed to initialize admin connection");
+            delete p_admin_socket;
+            LOG_RET("error", p_rpc_conn);
+        }
+        myq::admin_cmd::join_req req;
+        req.type_ = "rpc";
+        req.connection_type_ = "zmq";
+        req.password_ = password;
+        req.user_id_ = userid;
+        req.topic_ = topic;
+        std::string response;
+        if (p_admin_socket->write_msg(req.to_json()) <= 0 || p_admin_socket->read_msg(response) <= 0)
+        {
+            LOG_ERROR("Failed to join topic[%s]", topic);
+            delete p_admin_socket;
+            LOG_RET("error", p_rpc_conn);
+        }
+        myq::admin_cmd::join_resp resp;
+        resp.from_json(response);
+        if (resp.status_ != "ok")
+        {
+            LOG_ERROR("Login Failed. response %s", response.c_str());
+            delete p_admin_socket;
+            LOG_RET("error", p_rpc_conn);
+        }
+        myq::rpc_client *p_client = new myq::rpc_client(resp.topic_, resp.bind_uri_, responder);
+        if (!p_client->init())
+        {
+            LOG_ERROR("Failed to initialize rpc connection");
+            delete p_client;
+            delete p_admin_socket;
+            LOG_RET("error", p_rpc_conn);
+        }
+        myq_conn *pconn = new myq_conn();
+        pconn->client_conn = static_cast<void *>(p_client);
+        pconn->admin_conn = static_cast<void *>(p_admin_socket);
+        pconn->message_counter = 0;
+        pconn->payload_size_counter = 0;
+        strcpy(pconn->topic, resp.topic_.c_str());
+        strcpy(pconn->userid, userid);
+        strcpy(pconn->password, password);
+        strcpy(pconn->broker_uri, broker_uri);
+
+        p_rpc_conn = new myq_rpc_conn();
+        p_rpc_conn->p_myq_conn = pconn;
+        p_rpc_conn->responder = responder;
+        LOG_EVENT("myq_rpc_conn[%p] created successfully.", p_rpc_conn);
+    }
+    catch (std::exception &ex)
+    {
+        LOG_ERROR("Error: Exception [%s]", ex.what());
+    }
+    catch (...)
+    {
+    }
+    LOG_RET("", p_rpc_conn);
+}
+
+/**
+ * free request/reply connection
+ * @param p_rpc_conn
+ */
+void free_rpc_conn(myq_rpc_conn *p_rpc_conn)
+{
+    LOG_IN("p_rpc_conn[%p]", p_rpc_conn);
+    if (p_rpc_conn == NULL)
+    {
+        return;
+    }
+    if (p_rpc_conn->p_myq_conn)
+    {
+        delete static_cast<myq::connection_zmq *>(p_rpc_conn->p_myq_conn->admin_conn);
+        delete static_cast<myq::rpc_client *>(p_rpc_conn->p_myq_conn->client_conn);
+        delete p_rpc_conn->p_myq_conn;
+    }
+    delete p_rpc_conn;
+    LOG_OUT("");
+}
+
+/**
+ * Send a request and wait for its reply
+ * @param p_rpc_conn
+ * @param request
+ * @param length
+ * @param reply
+ * @param reply_length
+ * @param timeout_ms
+ * @return
+ */
+int send_request(myq_rpc_conn *p_rpc_conn, const char *request, uint32_t length, char *reply, uint32_t reply_length,
+                 int timeout_ms)
+{
+    LOG_IN("p_rpc_conn[%p], length[%u], reply_length[%u], timeout_ms[%d]", p_rpc_conn, length, reply_length,
+           timeout_ms);
+    if (!p_rpc_conn || !p_rpc_conn->p_myq_conn || p_rpc_conn->responder)
+    {
+        LOG_ERROR("Requests are sent on requester rpc connections");
+        LOG_RET("error", -1);
+    }
+    int bytes_read = -1;
+    try
+    {
+        myq::rpc_client *p_client = static_cast<myq::rpc_client *>(p_rpc_conn->p_myq_conn->client_conn);
+        bytes_read = p_client->request(request, length, reply, reply_length, timeout_ms);
+        if (bytes_read > 0)
+        {
+            ++p_rpc_conn->p_myq_conn->message_counter;
+            p_rpc_conn->p_myq_conn->payload_size_counter += length;
+        }
+    }
+    catch (std::exception &ex)
+    {
+        LOG_ERROR("Error: Exception [%s]", ex.what());
+    }
+    catch (...)
+    {
+    }
+    LOG_RET("", bytes_read);
+}
+
+/**
+ * Wait for a request
+ * @param p_rpc_conn
+ * @param context
+ * @param buffer
+ * @param buffer_length
+ * @param timeout_ms
+ * @return
+ */
+int receive_request(myq_rpc_conn *p_rpc_conn, myq_request_context *context, char *buffer, uint32_t buffer_length,
+                    int timeout_ms)
+{
+    LOG_IN("p_rpc_conn[%p], buffer_length[%u], timeout_ms[%d]", p_rpc_conn, buffer_length, timeout_ms);
+    if (!p_rpc_conn || !p_rpc_conn->p_myq_conn || !p_rpc_conn->responder)
+    {
+        LOG_ERROR("Requests are received on responder rpc connections");
+        LOG_RET("error", -1);
+    }
+    int bytes_read = -1;
+    try
+    {
+        myq::rpc_client *p_client = static_cast<myq::rpc_client *>(p_rpc_conn->p_myq_conn->client_conn);
+        std::string requester;
+        bytes_read = p_client->receive_request(requester, context->correlation_id, buffer, buffer_length,
+                                               timeout_ms);
+        if (bytes_read >= 0 && requester.length() > sizeof(context->requester))
+        {
+            LOG_ERROR("Requester identity of %u bytes is too long", requester.length());
+            bytes_read = -1;
+        }
+        else if (bytes_read >= 0)
+        {
+            memcpy(context->requester, requester.data(), requester.length());
+            context->requester_length = requester.length();
+        }
+    }
+    catch (std::exception &ex)
+    {
+        LOG_ERROR("Error: Exception [%s]", ex.what());
+    }
+    catch (...)
+    {
+    }
+    LOG_RET("", bytes_read);
+}
+
+/**
+ * Answer a request
+ * @param p_rpc_conn
+ * @param context
+ * @param reply
+ * @param length
+ * @return
+ */
+int send_reply(myq_rpc_conn *p_rpc_conn, const myq_request_context *context, const char *reply, uint32_t length)
+{
+    LOG_IN("p_rpc_conn[%p], length[%u]", p_rpc_conn, length);
+    if (!p_rpc_conn || !p_rpc_conn->p_myq_conn || !p_rpc_conn->responder)
+    {
+        LOG_ERROR("Replies are sent on responder rpc connections");
+        LOG_RET("error", -1);
+    }
+    int bytes_written = -1;
+    try
+    {
+        myq::rpc_client *p_client = static_cast<myq::rpc_client *>(p_rpc_conn->p_myq_conn->client_conn);
+        bytes_written = p_client->reply(std::string(context->requester, context->requester_length),
+                                        context->correlation_id, reply, length);
+    }
+    catch (std::exception &ex)
+    {
+        LOG_ERROR("Error: Exception [%s]", ex.what());
+    }
+    catch (...)
+    {
+    }
+    LOG_RET("", bytes_written);
+}
+
+/**
+ * Get stats
+ * @param conn
+ * @return
+ */
+bool get_stats(myq_conn *p_myq_conn, topic_stats *stats)
+{
+    LOG_IN("p_myq_conn[%p]", p_myq_conn);
+    try
+    {
+        myq::admin_cmd::stats_req stat_req;
+        stat_req.password_ = p_myq_conn->password;
+        stat_req.user_id_ = p_myq_conn->userid;
+        stat_req.topic_ = p_myq_conn->topic;
+        myq::connection_zmq *admin_conn = static_cast<myq::connection_zmq *>(p_myq_conn->admin_conn);
+        ssize_t size = admin_conn->write_msg(stat_req.to_json());
+        if (size <= 0)
+        {
+            LOG_ERROR("Failed to send for stats request");
+            strcpy(stats->status, "error");
+            LOG_RET_FALSE("Failed");
+        }
+        std::string response;
+        admin_conn->read_msg(response);
+        LOG_EVENT("Stats :%s ", response.c_str());
+        myq::admin_cmd::stats_resp resp;
+        resp.from_json(response);
+        if (resp.status_ == "error")
+        {
+            LOG_ERROR("Failed to get stat response. response %s", response.c_str());
+            strcpy(stats->status, "error");
+            LOG_RET_FALSE("Failed");
+        }
+        //  std::cout << "Stats Response:" << response << std::endl;
+        stats->messages_received = resp.messages_received_;
+        stats->messages_sent = resp.messages_sent_;
+        stats->publishers_count = resp.publishers_count_;
+        stats->queue_size = resp.queue_size_;
+        strcpy(stats->status, resp.status_.c_str());
+        stats->subscribers_count = resp.subscribers_count_;
+        strcpy(stats->topic, resp.topic_.c_str());
+        strcpy(stats->topic_type, resp.topic_type_.c_str());
+        stats->total_bytes_read = resp.total_bytes_read_;
+        stats->total_bytes_written = resp.total_bytes_written_;
+        stats->messages_conflated = resp.messages_conflated_;
+        stats->duplicates_dropped = resp.duplicates_dropped_;
+        stats->memory_used = resp.memory_used_;
+        stats->memory_quota = resp.memory_quota_;
+        stats->memory_throttled = resp.memory_throttled_;
+        stats->broker_memory_used = resp.broker_memory_used_;
+        stats->broker_memory_limit = resp.broker_memory_limit_;
+        stats->append_latency_avg_ns = resp.append_latency_avg_ns_;
+        stats->append_latency_max_ns = resp.append_latency_max_ns_;
+        stats->memory_fixed = resp.memory_fixed_;
+        stats->memory_queued = resp.memory_queued_;
+        stats->memory_indexes = resp.memory_indexes_;
+        stats->cpu_producer_ns = resp.cpu_producer_ns_;
+        stats->cpu_consumer_ns = resp.cpu_consumer_ns_;
+        stats->cpu_egress_ns = resp.cpu_egress_ns_;
+        stats->segment_cache_hits = resp.segment_cache_hits_;
+        stats->segment_cache_misses = resp.segment_cache_misses_;
+        stats->broker_segments_open = resp.broker_segments_open_;
+        stats->broker_segments_open_limit = resp.broker_segments_open_limit_;
+        LOG_RET_TRUE("success");
+    }
+    catch (std::exception &ex)
+    {
+        LOG_ERROR("Error: Exception [%s]", ex.what());
+    }
+    catch (...)
+    {
+    }
+    LOG_RET_FALSE("failed");
+}
+
+/**
+ * Get subscriber stats
+ * @param p_consumer_conn
+ * @param stats
+ * @return
+ */
+bool get_subscriber_stats(myq_consumer_conn *p_consumer_conn, subscriber_stats *stats)
+{
+    LOG_IN("p_consumer_conn[%p]", p_consumer_conn);
+    if (!p_consumer_conn || !p_consumer_conn->p_myq_conn || !stats ||
+        (p_consumer_conn->socket_type != consumer_socket_type::zmq_subscriber &&
+         p_consumer_conn->socket_type != consumer_socket_type::multicast_subscriber))
+    {
+        LOG_ERROR("Subscriber stats are only available for subscriber connections");
+        LOG_RET_FALSE("failed");
+    }
+    subscriber *p_subscriber = static_cast<subscriber *>(p_consumer_conn->p_myq_conn->client_conn);
+    stats->last_seq = p_subscriber->get_last_seq();
+    stats->gaps_detected = p_subscriber->get_gaps_detected();
+    stats->messages_recovered = p_subscriber->get_messages_recovered();
+    stats->messages_lost = p_subscriber->get_messages_lost();
+    stats->snapshot_messages = p_subscriber->get_snapshot_messages();
+    LOG_RET_TRUE("success");
+}
+
+/**
+ * Get windowed aggregates
+ * @param p_myq_conn
+ * @param window_start_ms
+ * @param open
+ * @param callback
+ * @param context
+ * @return
+ */
+bool get_aggregates(myq_conn *p_myq_conn, uint64_t *window_start_ms, bool open, aggregate_callback callback, void *context)
+{
+    LOG_IN("p_myq_conn[%p], open[%d]", p_myq_conn, open);
+    try
+    {
+        myq::admin_cmd::aggregates_req req;
+        req.password_ = p_myq_conn->password;
+        req.user_id_ = p_myq_conn->userid;
+        req.topic_ = p_myq_conn->topic;
+        req.window_start_ms_ = window_start_ms ? *window_start_ms : 0;
+        req.open_ = open;
+        myq::connection_zmq *admin_conn = static_cast<myq::connection_zmq *>(p_myq_conn->admin_conn);
+        if (admin_conn->write_msg(req.to_json()) <= 0)
+        {
+            LOG_RET_FALSE("Failed to send aggregates request");
+        }
+        std::string response;
+        admin_conn->read_msg(response);
+        myq::admin_cmd::aggregates_resp resp;
+        if (!resp.from_json(response) || resp.status_ == "error")
+        {
+            LOG_ERROR("Failed to get aggregates. response %s", response.c_str());
+            LOG_RET_FALSE("Failed");
+        }
+        if (window_start_ms)
+        {
+            *window_start_ms = resp.window_start_ms_;
+        }
+        key_aggregate aggregate;
+        for (unsigned i = 0; callback && i < resp.keys_.size(); ++i)
+        {
+            memset(&aggregate, 0, sizeof(aggregate));
+            strncpy(aggregate.key, resp.keys_[i].key_.c_str(), sizeof(aggregate.key) - 1);
+            aggregate.count = resp.keys_[i].count_;
+            aggregate.values = resp.keys_[i].values_;
+            aggregate.sum = resp.keys_[i].sum_;
+            aggregate.min = resp.keys_[i].min_;
+            aggregate.max = resp.keys_[i].max_;
+            callback(&aggregate, context);
+        }
+        LOG_RET_TRUE("success");
+    }
+    catch (std::exception &ex)
+    {
+        LOG_ERROR("Error: Exception [%s]", ex.what());
+    }
+    catch (...)
+    {
+    }
+    LOG_RET_FALSE("failed");
+}
+
+/**
+ * Open shared memory stats of a local broker
+ * @param broker_uri
+ * @return
+ */
+myq_stats_reader *open_stats_reader(const char *broker_uri)
+{
+    LOG_IN("broker_uri[%s]", broker_uri);
+    myq::stats_shm *p_shm = new myq::stats_shm(myq::stats_shm::name_for_uri(broker_uri));
+    if (!p_shm->open())
+    {
+        delete p_shm;
+        LOG_RET("failed", NULL);
+    }
+    myq_stats_reader *reader = new myq_stats_reader;
+    reader->shm = p_shm;
+    LOG_RET("", reader);
+}
+
+/**
+ * Close stats reader
+ * @param reader
+ */
+void close_stats_reader(myq_stats_reader *reader)
+{
+    if (reader)
+    {
+        delete static_cast<myq::stats_shm *>(reader->shm);
+        delete reader;
+    }
+}
+
+uint32_t get_stats_topic_count(myq_stats_reader *reader)
+{
+    return static_cast<myq::stats_shm *>(reader->shm)->get_topic_count();
+}
+
+/**
+ * copy a shared memory record to the api stats
+ * @param r
+ * @param stats
+ * @param updated_ms
+ */
+static void copy_stats(const myq::stats_shm::record &r, topic_stats *stats, uint64_t *updated_ms)
+{
+    strcpy(stats->status, "ok");
+    strcpy(stats->topic, r.topic_);
+    strcpy(stats->topic_type, r.topic_type_);
+    stats->queue_size = r.queue_size_;
+    stats->messages_sent = r.messages_sent_;
+    stats->messages_received = r.messages_received_;
+    stats->publishers_count = r.publishers_count_;
+    stats->subscribers_count = r.subscribers_count_;
+    stats->total_bytes_written = r.total_bytes_written_;
+    stats->total_bytes_read = r.total_bytes_read_;
+    stats->messages_conflated = r.messages_conflated_;
+    stats->duplicates_dropped = r.duplicates_dropped_;
+    stats->memory_used = r.memory_used_;
+    stats->memory_quota = r.memory_quota_;
+    stats->memory_throttled = r.memory_throttled_;
+    stats->broker_memory_used = r.broker_memory_used_;
+    stats->broker_memory_limit = r.broker_memory_limit_;
+    stats->append_latency_avg_ns = r.append_latency_avg_ns_;
+    stats->append_latency_max_ns = r.append_latency_max_ns_;
+    stats->memory_fixed = r.memory_fixed_;
+    stats->memory_queued = r.memory_queued_;
+    stats->memory_indexes = r.memory_indexes_;
+    stats->cpu_producer_ns = r.cpu_producer_ns_;
+    stats->cpu_consumer_ns = r.cpu_consumer_ns_;
+    stats->cpu_egress_ns = r.cpu_egress_ns_;
+    stats->segment_cache_hits = r.segment_cache_hits_;
+    stats->segment_cache_misses = r.segment_cache_misses_;
+    stats->broker_segments_open = r.broker_segments_open_;
+    stats->broker_segments_open_limit = r.broker_segments_open_limit_;
+    if (updated_ms)
+    {
+        *updated_ms = r.updated_ms_;
+    }
+}
+
+/**
+ * Read stats of topic at index
+ * @param reader
+ * @param index
+ * @param stats
+ * @param updated_ms
+ * @return
+ */
+bool read_stats_at(myq_stats_reader *reader, uint32_t index, topic_stats *stats, uint64_t *updated_ms)
+{
+    myq::stats_shm::record r;
+    if (!reader || !stats || !static_cast<myq::stats_shm *>(reader->shm)->read(index, r))
+    {
+        return false;
+    }
+    copy_stats(r, stats, updated_ms);
+    return true;
+}
+
+/**
+ * Read stats of topic
+ * @param reader
+ * @param topic
+ * @param stats
+ * @param updated_ms
+ * @return
+ */
+bool read_stats(myq_stats_reader *reader, const char *topic, topic_stats *stats, uint64_t *updated_ms)
+{
+    myq::stats_shm::record r;
+    if (!reader || !topic || !stats || !static_cast<myq::stats_shm *>(reader->shm)->read(std::string(topic), r))
+    {
+        return false;
+    }
+    copy_stats(r, stats, updated_ms);
+    return true;
+}
+
+/**
+ * initialize broker
+ * @param bind_uri
+ * @param start_port
+ * @return
+ */
+myq_broker_mgr *init_broker(
+    const char *admin_userid, const char *admin_password, const char *transport,
+    const char *bind_ip, unsigned bind_port)
+{
+    LOG_IN("admin_userid[%s], admin_password[%u], transport[%s], bind_ip[%s], bind_port[%d]",
+           admin_userid, admin_password, transport, bind_ip, bind_port);
+    try
+    {
+        ;
+        std::string bind_uri = transport;
+        bind_uri.append("://");
+        bind_uri.append(bind_ip);
+        bind_uri.append(":");
+        bind_uri.append(std::to_string(broker_config::get_next_port(bind_port)));
+        broker_manager *p_mgr = new broker_manager(bind_uri, admin_userid, admin_password);
+        if (!p_mgr->init())
+        {
+            LOG_ERROR("Failed to initialize broker at bind uri[%s]", bind_uri.c_str());
+            LOG_RET("failed", NULL);
+        }
+        myq_broker_mgr *p_myq_mgr = new myq_broker_mgr();
+        p_myq_mgr->broker = static_cast<void *>(p_mgr);
+        strcpy(p_myq_mgr->broker_uri, bind_uri.c_str());
+        utils::sleep_ms(utils::zmq_sync_wait);
+        LOG_RET("success", p_myq_mgr);
+    }
+    catch (std::exception &ex)
+    {
+        LOG_ERROR("Error: Exception [%s]", ex.what());
+    }
+    catch (...)
+    {
+    }
+    LOG_RET("failed", NULL);
+}
+
+/**
+ * Free producer connection
+ * @param conn
+ */
+void free_broker_mgr(myq_broker_mgr *broker_mgr)
+{
+    LOG_IN("broker_mgr[%p]", broker_mgr);
+    if (broker_mgr == NULL)
+    {
+        return;
+    }
+
     if (broker_mgr->broker)
     {
         broker_manager *mgr = static_cast<broker_manager *>(broker_mgr->broker);
@@ -698,6 +1644,78 @@ bool run_broker(myq_broker_mgr *p_broker_mgr, bool block)
     LOG_RET("result", result);
 }
 
+/**
+ * set broker memory limit
+ * @param p_broker_mgr
+ * @param limit_mb
+ * @return
+ */
+bool set_broker_memory_limit(myq_broker_mgr *p_broker_mgr, uint64_t limit_mb)
+{
+    LOG_IN("p_broker_mgr[%p], limit_mb[%llu]", p_broker_mgr, limit_mb);
+    if (p_broker_mgr == NULL || p_broker_mgr->broker == NULL)
+    {
+        LOG_RET_FALSE("broker is not initialized");
+    }
+    static_cast<broker_manager *>(p_broker_mgr->broker)->set_memory_limit(limit_mb * 1024 * 1024);
+    LOG_RET_TRUE("");
+}
+
+/**
+ * set the bound on open full log segments
+ * @param p_broker_mgr
+ * @param max_open
+ * @return
+ */
+bool set_broker_max_open_segments(myq_broker_mgr *p_broker_mgr, uint32_t max_open)
+{
+    LOG_IN("p_broker_mgr[%p], max_open[%u]", p_broker_mgr, max_open);
+    if (p_broker_mgr == NULL || p_broker_mgr->broker == NULL)
+    {
+        LOG_RET_FALSE("broker is not initialized");
+    }
+    static_cast<broker_manager *>(p_broker_mgr->broker)->set_max_open_segments(max_open);
+    LOG_RET_TRUE("");
+}
+
+/**
+ * set broker data directories
+ * @param p_broker_mgr
+ * @param directories
+ * @param count
+ * @param placement
+ * @return
+ */
+bool set_broker_data_directories(
+    myq_broker_mgr *p_broker_mgr, const char **directories, unsigned count, data_placement placement)
+{
+    LOG_IN("p_broker_mgr[%p], count[%u], placement[%d]", p_broker_mgr, count, placement);
+    if (p_broker_mgr == NULL || p_broker_mgr->broker == NULL || directories == NULL)
+    {
+        LOG_RET_FALSE("broker is not initialized");
+    }
+    std::vector<std::string> paths(directories, directories + count);
+    LOG_RET("", static_cast<broker_manager *>(p_broker_mgr->broker)->set_data_directories(
+                    paths, placement == placement_stripe_segments ? data_directories::stripe_segments
+                                                                  : data_directories::place_topics));
+}
+
+/**
+ * set broker plugin directory
+ * @param p_broker_mgr
+ * @param directory
+ * @return
+ */
+bool set_broker_plugin_directory(myq_broker_mgr *p_broker_mgr, const char *directory)
+{
+    LOG_IN("p_broker_mgr[%p], directory[%s]", p_broker_mgr, directory ? directory : "");
+    if (p_broker_mgr == NULL || p_broker_mgr->broker == NULL || directory == NULL)
+    {
+        LOG_RET_FALSE("broker is not initialized");
+    }
+    LOG_RET("", static_cast<broker_manager *>(p_broker_mgr->broker)->set_plugin_directory(directory));
+}
+
 /**
  * create a topic
  * @param broker_uri
@@ -712,10 +1730,30 @@ bool run_broker(myq_broker_mgr *p_broker_mgr, bool block)
 bool create_topic(
     const char *broker_uri, const char *topic, const char *admin_userid, const char *admin_password,
     const char *userid, const char *password, broker_storage_type storage_type)
+{
+    return create_topic_with_options(broker_uri, topic, admin_userid, admin_password, userid, password,
+                                     storage_type, NULL);
+}
+
+/**
+ * create a topic with optional settings
+ * @param broker_uri
+ * @param topic
+ * @param admin_userid
+ * @param admin_password
+ * @param userid
+ * @param password
+ * @param storage_type
+ * @param options NULL for defaults
+ * @return
+ */
+bool create_topic_with_options(
+    const char *broker_uri, const char *topic, const char *admin_userid, const char *admin_password,
+    const char *userid, const char *password, broker_storage_type storage_type, const topic_options *options)
 {
     LOG_IN(
-        "broker_uri[%s], topic[%s], admin_userid[%s], admin_password[%s], userid[%s], password[%s], storage_type[%d]",
-        broker_uri, topic, admin_userid, admin_password, userid, password, storage_type);
+        "broker_uri[%s], topic[%s], admin_userid[%s], admin_password[%s], userid[%s], password[%s], storage_type[%d], options[%p]",
+        broker_uri, topic, admin_userid, admin_password, userid, password, storage_type, options);
     try
     {
         myq::connection_zmq admin_socket(
@@ -738,10 +1776,45 @@ bool create_topic(
         {
             req.broker_type_ = "file";
         }
+        else if (storage_type == broker_storage_type::direct_type)
+        {
+            req.broker_type_ = "direct";
+        }
+        else if (storage_type == broker_storage_type::queue_file_type)
+        {
+            req.broker_type_ = "queue_file";
+        }
         else
         {
             req.broker_type_ = "queue";
         }
+        if (options != NULL)
+        {
+            req.last_value_cache_ = options->last_value_cache;
+            if (options->key_delimiter != '\0')
+            {
+                req.key_delimiter_ = std::string(1, options->key_delimiter);
+            }
+            if (options->conflate)
+            {
+                req.delivery_mode_ = "conflate";
+            }
+            if (options->multicast_uri)
+            {
+                req.multicast_uri_ = options->multicast_uri;
+            }
+            if (options->multicast_interface)
+            {
+                req.multicast_interface_ = options->multicast_interface;
+            }
+            req.memory_quota_mb_ = options->memory_quota_mb;
+            req.egress_threads_ = options->egress_threads;
+            req.aggregate_window_ms_ = options->aggregate_window_ms;
+            req.aggregate_field_ = options->aggregate_field;
+            req.latency_target_us_ = options->latency_target_us;
+            req.segment_size_mb_ = options->segment_size_mb;
+            req.preallocate_segments_ = options->preallocate_segments;
+        }
 
         req.topic_ = topic;
         req.user_id_ = userid;
@@ -755,6 +1828,12 @@ bool create_topic(
             return false;
         }
         admin_socket.read_msg(response);
+        admin_cmd::common_resp resp;
+        if (!resp.from_json(response) || resp.status_ == "error")
+        {
+            LOG_ERROR("Failed to create topic. response %s", response.c_str());
+            LOG_RET_FALSE("failed");
+        }
         LOG_EVENT("topic [%s] creation success", req.topic_.c_str());
         LOG_RET_TRUE("success");
     }
@@ -768,6 +1847,67 @@ bool create_topic(
     LOG_RET_FALSE("failed");
 }
 
+/**
+ * create pipeline
+ * @param broker_uri
+ * @param admin_userid
+ * @param admin_password
+ * @param source_topic
+ * @param target_topic
+ * @param plugin
+ * @param plugin_args
+ * @return
+ */
+bool create_pipeline(
+    const char *broker_uri, const char *admin_userid, const char *admin_password,
+    const char *source_topic, const char *target_topic, const char *plugin, const char *plugin_args)
+{
+    LOG_IN("broker_uri[%s], source_topic[%s], target_topic[%s], plugin[%s]",
+           broker_uri, source_topic, target_topic, plugin);
+    try
+    {
+        myq::connection_zmq admin_socket(
+            target_topic, broker_uri,
+            connection::conn_publisher,
+            connection_zmq::zmq_req,
+            connection::connect_socket,
+            false,
+            false);
+        if (!admin_socket.init())
+        {
+            LOG_RET_FALSE("Failed to initialize admin connection");
+        }
+        myq::admin_cmd::create_pipeline_req req;
+        req.admin_user_id_ = admin_userid;
+        req.admin_password_ = admin_password;
+        req.source_topic_ = source_topic;
+        req.target_topic_ = target_topic;
+        req.plugin_ = plugin;
+        req.plugin_args_ = plugin_args ? plugin_args : "";
+        if (admin_socket.write_msg(req.to_json()) <= 0)
+        {
+            LOG_RET_FALSE("Failed to send create pipeline request");
+        }
+        std::string response;
+        admin_socket.read_msg(response);
+        myq::admin_cmd::common_resp resp;
+        if (!resp.from_json(response) || resp.status_ == "error")
+        {
+            LOG_ERROR("Failed to create pipeline. response %s", response.c_str());
+            LOG_RET_FALSE("failed");
+        }
+        LOG_RET_TRUE("success");
+    }
+    catch (std::exception &ex)
+    {
+        LOG_ERROR("Error: Exception [%s]", ex.what());
+    }
+    catch (...)
+    {
+    }
+    LOG_RET_FALSE("failed");
+}
+
 /**
  * str to log level
  * @param log_level
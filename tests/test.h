@@ -0,0 +1,64 @@
+/*
+ * File:   test.h
+ *
+ *
+ * Created on October 21, 2026, 9:10 AM
+ */
+
+#ifndef TEST_H
+#define TEST_H
+
+#include <cstdio>
+#include <string>
+#include "../include/log.h"
+
+/**
+ * Checks of the unit tests. A failed check prints where it failed and makes the test exit with 1
+ */
+#define CHECK(condition)                                                                     \
+    do                                                                                       \
+    {                                                                                        \
+        if (!(condition))                                                                    \
+        {                                                                                    \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);    \
+            ++myq_test::failures();                                                          \
+        }                                                                                    \
+    } while (0)
+
+namespace myq_test
+{
+    inline unsigned &failures()
+    {
+        static unsigned failures = 0;
+        return failures;
+    }
+
+    /**
+     * log errors only, to stdout, with the event log in the working directory
+     * @param name
+     */
+    inline void init(const std::string &name)
+    {
+        myq::log::init(".", name, spdlog::level::err);
+    }
+
+    /**
+     * print the result
+     * @param name
+     * @return exit code
+     */
+    inline int result(const std::string &name)
+    {
+        if (failures() > 0)
+        {
+            printf("%s: %u checks failed\n", name.c_str(), failures());
+            fflush(stdout);
+            return 1;
+        }
+        printf("%s: passed\n", name.c_str());
+        fflush(stdout);
+        return 0;
+    }
+}
+
+#endif /* TEST_H */
@@ -0,0 +1,208 @@
+/*
+ * File:   test_connection_file.cpp
+ *
+ *
+ * Created on October 21, 2026, 10:00 AM
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include "test.h"
+#include "../include/utils.h"
+using namespace mymq; // file_details.h expects utils in scope, as the headers including it have
+#include "../include/connection_file.h"
+
+using namespace myq;
+
+static const unsigned segment_size = 64 * 1024; // rolls over every few hundred records
+static const uint64_t records = 100000;
+static const unsigned readers = 4;
+
+/**
+ * payload of a record: its seq, then a filler of a length that varies with it
+ * @param seq
+ * @return
+ */
+static std::string make_record(uint64_t seq)
+{
+    std::string record = utils::format_str("%010llu", (unsigned long long)seq);
+    record.append(seq % 97, (char)('a' + seq % 26));
+    return record;
+}
+
+static std::string make_directory()
+{
+    char directory[] = "/tmp/myq_test_XXXXXX";
+    return mkdtemp(directory) ? directory : "";
+}
+
+static void remove_directory(const std::string &directory)
+{
+    DIR *p_dir = opendir(directory.c_str());
+    if (p_dir == NULL)
+    {
+        return;
+    }
+    while (struct dirent *p_entry = readdir(p_dir))
+    {
+        std::string name = p_entry->d_name;
+        if (name != "." && name != "..")
+        {
+            unlink((directory + "/" + name).c_str());
+        }
+    }
+    closedir(p_dir);
+    rmdir(directory.c_str());
+}
+
+/**
+ * follow the log from its start with read_bytes until every record was read, checking each in order
+ * @param log
+ * @param p_failed set on the first record out of place
+ */
+static void tail(connection_file &log, std::atomic<bool> *p_failed)
+{
+    std::vector<char> buffer(4096);
+    uint64_t offset = 0;
+    uint64_t seq = 0;
+    while (seq < records && !*p_failed)
+    {
+        ssize_t bytes = log.read_bytes(buffer.data(), buffer.size(), offset);
+        if (bytes < 0)
+        {
+            fprintf(stderr, "read_bytes failed at offset %llu\n", (unsigned long long)offset);
+            *p_failed = true;
+            return;
+        }
+        // take the whole records, the rest is read again from where it starts
+        ssize_t used = 0;
+        while (used + (ssize_t)sizeof(uint32_t) <= bytes)
+        {
+            uint32_t length;
+            memcpy(&length, buffer.data() + used, sizeof(length));
+            if (used + (ssize_t)sizeof(length) + length > bytes)
+            {
+                break;
+            }
+            ++seq;
+            if (std::string(buffer.data() + used + sizeof(length), length) != make_record(seq))
+            {
+                fprintf(stderr, "record %llu at offset %llu is wrong\n", (unsigned long long)seq,
+                        (unsigned long long)(offset + used));
+                *p_failed = true;
+                return;
+            }
+            used += sizeof(length) + length;
+        }
+        offset += used;
+        if (used == 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+/**
+ * look records up by seq among those already written
+ * @param log
+ * @param p_done
+ * @param p_failed
+ */
+static void seek(connection_file &log, std::atomic<bool> *p_done, std::atomic<bool> *p_failed)
+{
+    std::vector<char> buffer(4096);
+    unsigned seed = 1;
+    while (!*p_done && !*p_failed)
+    {
+        uint64_t written = log.get_msg_counter();
+        if (written == 0)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        uint64_t seq = 1 + rand_r(&seed) % written;
+        ssize_t bytes = log.read_by_seq(seq, buffer.data(), buffer.size());
+        std::string expected = make_record(seq);
+        if (bytes != (ssize_t)(sizeof(uint32_t) + expected.length()) ||
+            std::string(buffer.data() + sizeof(uint32_t), expected.length()) != expected)
+        {
+            fprintf(stderr, "read_by_seq(%llu) returned %lld\n", (unsigned long long)seq, (long long)bytes);
+            *p_failed = true;
+        }
+    }
+}
+
+/**
+ * append records while readers tail the log and seek in it, across many segment rollovers
+ * @param p_cache NULL to keep every segment open
+ * @return the log's segment cache misses
+ */
+static uint64_t write_while_reading(fd_cache *p_cache)
+{
+    std::string directory = make_directory();
+    CHECK(!directory.empty());
+    uint64_t misses = 0;
+    {
+        connection_file log(directory, "test", "", connection::conn_broker);
+        log.set_max_file_size(segment_size);
+        log.set_fd_cache(p_cache);
+        std::atomic<bool> done(false);
+        std::atomic<bool> failed(false);
+        std::vector<std::thread> threads;
+        for (unsigned i = 0; i < readers; ++i)
+        {
+            threads.push_back(std::thread(tail, std::ref(log), &failed));
+        }
+        threads.push_back(std::thread(seek, std::ref(log), &done, &failed));
+        for (uint64_t seq = 1; seq <= records && !failed; ++seq)
+        {
+            std::string record = make_record(seq);
+            CHECK(log.write_to_file(record.data(), record.length()) > 0);
+        }
+        for (unsigned i = 0; i < readers; ++i)
+        {
+            threads[i].join();
+        }
+        done = true;
+        threads.back().join();
+        CHECK(!failed);
+        CHECK(log.get_msg_counter() == records);
+        CHECK(log.get_total_bytes_writen() > 10 * segment_size);
+        misses = log.get_segment_cache_misses();
+    }
+    remove_directory(directory);
+    return misses;
+}
+
+/**
+ * readers that tail the log see every record once and in order while segments are added under them
+ */
+static void test_readers_across_rollover()
+{
+    write_while_reading(NULL);
+}
+
+/**
+ * the same with room for one sealed segment's fd: readers keep reopening segments the others evicted
+ */
+static void test_readers_with_evictions()
+{
+    fd_cache cache;
+    cache.set_capacity(1);
+    uint64_t misses = write_while_reading(&cache);
+    CHECK(misses > 0);
+    CHECK(cache.get_open() <= 1);
+    printf("%llu reads reopened a segment\n", (unsigned long long)misses);
+}
+
+int main()
+{
+    myq_test::init("test_connection_file");
+    test_readers_across_rollover();
+    test_readers_with_evictions();
+    int result = myq_test::result("test_connection_file");
+    _exit(result);
+}
@@ -0,0 +1,113 @@
+/*
+ * File:   test_producer_batcher.cpp
+ *
+ *
+ * Created on October 21, 2026, 9:20 AM
+ */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "test.h"
+#include "../include/producer_batcher.h"
+
+using namespace myq;
+
+/**
+ * pull end of the batcher's connection, counting the batches and messages that arrive
+ */
+struct batch_reader
+{
+    connection_zmq pull_;
+    std::atomic<uint64_t> batches_;
+    std::atomic<uint64_t> messages_;
+
+    explicit batch_reader(const std::string &uri)
+        : pull_("test", uri, connection::conn_broker, connection_zmq::zmq_pull, connection::bind_socket, false, false),
+          batches_(0), messages_(0)
+    {
+    }
+
+    /**
+     * read batches until expected messages arrived
+     * @param expected
+     */
+    void read(uint64_t expected)
+    {
+        std::vector<std::string> frames;
+        while (messages_ < expected && pull_.read_frames(frames) > 0)
+        {
+            if (frames.size() != 2 || frames[0].length() < 2 * sizeof(uint64_t) + sizeof(uint32_t))
+            {
+                continue;
+            }
+            messages_ += utils::decode_uint32(frames[0].data() + 2 * sizeof(uint64_t));
+            ++batches_;
+        }
+    }
+};
+
+/**
+ * a burst of publishes goes out in fewer sends than messages
+ */
+static void test_burst_is_batched()
+{
+    const uint64_t messages = 5000;
+    batch_reader reader("inproc://test_burst");
+    CHECK(reader.pull_.init());
+    connection_zmq push("test", "inproc://test_burst", connection::conn_publisher, connection_zmq::zmq_push,
+                        connection::connect_socket, false, false);
+    CHECK(push.init());
+    std::thread reader_tid([&]() { reader.read(messages); });
+    {
+        producer_batcher batcher(&push, 2000);
+        std::string message(100, 'm');
+        for (uint64_t i = 0; i < messages; ++i)
+        {
+            CHECK(batcher.publish(message.data(), message.length()) == (int)message.length());
+        }
+        CHECK(batcher.flush() >= 0);
+        CHECK(batcher.get_messages_sent() == messages);
+        CHECK(batcher.get_batches_sent() < messages);
+        printf("burst of %llu messages sent in %llu batches\n", (unsigned long long)messages,
+               (unsigned long long)batcher.get_batches_sent());
+    }
+    reader_tid.join();
+    CHECK(reader.messages_ == messages);
+    CHECK(reader.batches_ < messages);
+}
+
+/**
+ * messages further apart than the latency target are sent as they are published
+ */
+static void test_quiet_is_sent_at_once()
+{
+    const uint64_t messages = 5;
+    batch_reader reader("inproc://test_quiet");
+    CHECK(reader.pull_.init());
+    connection_zmq push("test", "inproc://test_quiet", connection::conn_publisher, connection_zmq::zmq_push,
+                        connection::connect_socket, false, false);
+    CHECK(push.init());
+    std::thread reader_tid([&]() { reader.read(messages); });
+    {
+        producer_batcher batcher(&push, 2000);
+        std::string message(100, 'm');
+        for (uint64_t i = 0; i < messages; ++i)
+        {
+            CHECK(batcher.publish(message.data(), message.length()) == (int)message.length());
+            CHECK(batcher.get_messages_sent() == i + 1);
+            utils::sleep_ms(10);
+        }
+    }
+    reader_tid.join();
+    CHECK(reader.batches_ == messages);
+}
+
+int main()
+{
+    myq_test::init("test_producer_batcher");
+    test_burst_is_batched();
+    test_quiet_is_sent_at_once();
+    int result = myq_test::result("test_producer_batcher");
+    _exit(result); // skip the zmq context teardown, its sockets are gone already
+}
@@ -0,0 +1,125 @@
+/*
+ * File:   test_producer_dedup.cpp
+ *
+ *
+ * Created on October 21, 2026, 11:40 AM
+ */
+
+#include <cstdlib>
+#include <sys/stat.h>
+#include "test.h"
+#include "../include/producer_dedup.h"
+
+using namespace myq;
+
+static const uint64_t window = 256; // producer_dedup::window_size_
+
+static uint64_t file_size(const std::string &path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? (uint64_t)st.st_size : 0;
+}
+
+/**
+ * commit seqs first to last of a producer
+ * @param dedup
+ * @param producer_id
+ * @param first
+ * @param last
+ */
+static void commit_range(producer_dedup &dedup, uint64_t producer_id, uint64_t first, uint64_t last)
+{
+    for (uint64_t seq = first; seq <= last; ++seq)
+    {
+        dedup.commit(producer_id, seq);
+    }
+}
+
+/**
+ * the sequences of producer 1 after commit_range(1, 300) and a commit of 400 alone
+ * @param dedup
+ */
+static void check_window(producer_dedup &dedup)
+{
+    CHECK(dedup.is_duplicate(1, 400));
+    CHECK(!dedup.is_duplicate(1, 401));
+    // 301..399 were never stored: retries of them go through
+    CHECK(!dedup.is_duplicate(1, 301));
+    CHECK(!dedup.is_duplicate(1, 399));
+    // the oldest seq still in the window is stored, the one before it has left the window
+    CHECK(dedup.is_duplicate(1, 400 - window + 1));
+    CHECK(dedup.is_duplicate(1, 400 - window));
+    CHECK(dedup.is_duplicate(1, 1));
+    // producers have windows of their own
+    CHECK(!dedup.is_duplicate(2, 400));
+}
+
+/**
+ * a seq is a duplicate once committed or once too old for the window, and not before
+ */
+static void test_window_edges()
+{
+    producer_dedup dedup("");
+    CHECK(dedup.init());
+    CHECK(!dedup.is_duplicate(1, 1));
+    CHECK(!dedup.is_duplicate(1, 1)); // checked but not stored, e.g. the store failed
+    commit_range(dedup, 1, 1, 300);
+    CHECK(dedup.is_duplicate(1, 300));
+    CHECK(!dedup.is_duplicate(1, 301));
+    CHECK(dedup.is_duplicate(1, 300 - window));     // too old
+    CHECK(dedup.is_duplicate(1, 300 - window + 1)); // oldest in the window
+    dedup.commit(1, 400);
+    check_window(dedup);
+    // 356 was never stored, though it shares its ring slot with 100 that was
+    CHECK(!dedup.is_duplicate(1, 356));
+    CHECK(dedup.get_duplicates() == 7);
+}
+
+/**
+ * committed sequences survive a restart through the journal, which is rewritten with the live windows only
+ */
+static void test_journal_replay()
+{
+    char directory[] = "/tmp/myq_test_XXXXXX";
+    CHECK(mkdtemp(directory) != NULL);
+    std::string path = std::string(directory) + "/test.producers";
+    {
+        producer_dedup dedup(path);
+        CHECK(dedup.init());
+        commit_range(dedup, 1, 1, 300);
+        dedup.commit(1, 400);
+        commit_range(dedup, 3, 1, 10);
+        dedup.flush();
+        CHECK(file_size(path) == (300 + 1 + 10) * 2 * sizeof(uint64_t));
+        dedup.commit(3, 11); // left to the destructor's flush
+    }
+    {
+        producer_dedup dedup(path);
+        CHECK(dedup.init());
+        check_window(dedup);
+        CHECK(dedup.is_duplicate(3, 11));
+        CHECK(!dedup.is_duplicate(3, 12));
+        // only the seqs inside a window were kept: 400 - window + 1 .. 300 and 400 of producer 1, 1..11 of 3
+        CHECK(file_size(path) == (300 - (400 - window) + 1 + 11) * 2 * sizeof(uint64_t));
+        CHECK(file_size(path + ".tmp") == 0);
+        dedup.commit(3, 12);
+    }
+    {
+        // the compacted journal replays the same windows
+        producer_dedup dedup(path);
+        CHECK(dedup.init());
+        check_window(dedup);
+        CHECK(dedup.is_duplicate(3, 12));
+    }
+    unlink(path.c_str());
+    rmdir(directory);
+}
+
+int main()
+{
+    myq_test::init("test_producer_dedup");
+    test_window_edges();
+    test_journal_replay();
+    int result = myq_test::result("test_producer_dedup");
+    _exit(result);
+}
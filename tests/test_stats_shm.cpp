@@ -0,0 +1,162 @@
+/*
+ * File:   test_stats_shm.cpp
+ *
+ *
+ * Created on October 21, 2026, 11:00 AM
+ */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "test.h"
+#include "../include/stats_shm.h"
+
+using namespace myq;
+
+static const unsigned topics = 4;
+static const unsigned readers = 4;
+static const uint64_t updates = 200000;
+
+/**
+ * a record whose every counter is the update number, so a copy mixing two updates shows
+ * @param index slot
+ * @param update
+ * @param r
+ */
+static void make_record(unsigned index, uint64_t update, stats_shm::record &r)
+{
+    memset(&r, 0, sizeof(r));
+    snprintf(r.topic_, sizeof(r.topic_), "topic_%u", index);
+    snprintf(r.topic_type_, sizeof(r.topic_type_), "%llu", (unsigned long long)update);
+    uint64_t *p_first = &r.queue_size_;
+    uint64_t *p_last = &r.updated_ms_;
+    for (uint64_t *p = p_first; p <= p_last; ++p)
+    {
+        *p = update;
+    }
+}
+
+/**
+ * @param index
+ * @param r
+ * @return true if every field of r comes from the same update of slot index
+ */
+static bool consistent(unsigned index, const stats_shm::record &r)
+{
+    if (utils::format_str("topic_%u", index) != r.topic_ ||
+        utils::format_str("%llu", (unsigned long long)r.queue_size_) != r.topic_type_)
+    {
+        return false;
+    }
+    const uint64_t *p_first = &r.queue_size_;
+    const uint64_t *p_last = &r.updated_ms_;
+    for (const uint64_t *p = p_first; p <= p_last; ++p)
+    {
+        if (*p != r.queue_size_)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * map the segment read only, as the stats tools do, and read the slots until the writer is done:
+ * every copy must be whole and no slot may go back to an older update
+ * @param name
+ * @param p_done
+ * @param p_failed
+ * @param p_reads
+ */
+static void read_slots(const std::string &name, std::atomic<bool> *p_done, std::atomic<bool> *p_failed,
+                       std::atomic<uint64_t> *p_reads)
+{
+    stats_shm shm(name);
+    if (!shm.open())
+    {
+        fprintf(stderr, "failed to open %s\n", name.c_str());
+        *p_failed = true;
+        return;
+    }
+    std::vector<uint64_t> last(topics, 0);
+    stats_shm::record r;
+    uint64_t reads = 0;
+    while (!*p_done && !*p_failed)
+    {
+        for (unsigned i = 0; i < topics; ++i)
+        {
+            if (!shm.read(i, r) || !consistent(i, r) || r.queue_size_ < last[i])
+            {
+                fprintf(stderr, "slot %u read torn or stale, update %llu after %llu\n", i,
+                        (unsigned long long)r.queue_size_, (unsigned long long)last[i]);
+                *p_failed = true;
+                return;
+            }
+            last[i] = r.queue_size_;
+            ++reads;
+        }
+    }
+    *p_reads += reads;
+}
+
+/**
+ * readers mapping the table never see a record half written while the broker keeps updating it
+ */
+static void test_reads_under_writes()
+{
+    std::string name = utils::format_str("/myq_stats_test_%d", (int)getpid());
+    stats_shm shm(name);
+    CHECK(shm.create());
+    stats_shm::record r;
+    for (unsigned i = 0; i < topics; ++i)
+    {
+        CHECK(shm.add_topic(utils::format_str("topic_%u", i)) == (int)i);
+        make_record(i, 0, r);
+        shm.write(i, r);
+    }
+    CHECK(shm.get_topic_count() == topics);
+    std::atomic<bool> done(false);
+    std::atomic<bool> failed(false);
+    std::atomic<uint64_t> reads(0);
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < readers; ++i)
+    {
+        threads.push_back(std::thread(read_slots, name, &done, &failed, &reads));
+    }
+    for (uint64_t update = 1; update <= updates && !failed; ++update)
+    {
+        unsigned index = update % topics;
+        make_record(index, update, r);
+        shm.write(index, r);
+    }
+    done = true;
+    for (unsigned i = 0; i < readers; ++i)
+    {
+        threads[i].join();
+    }
+    CHECK(!failed);
+    CHECK(reads > 0);
+    CHECK(shm.read("topic_1", r) && consistent(1, r));
+    CHECK(!shm.read("topic_none", r));
+    CHECK(!shm.read(topics, r));
+    printf("%llu updates, %llu consistent reads\n", (unsigned long long)updates, (unsigned long long)reads);
+}
+
+/**
+ * brokers listening on the same port share the name, whatever address the uri gives
+ */
+static void test_name_for_uri()
+{
+    CHECK(stats_shm::name_for_uri("tcp://*:5500") == stats_shm::name_for_uri("tcp://127.0.0.1:5500"));
+    CHECK(stats_shm::name_for_uri("tcp://*:5500") != stats_shm::name_for_uri("tcp://*:5501"));
+    CHECK(stats_shm::name_for_uri("ipc:///tmp/admin") == "/myq_stats__tmp_admin");
+}
+
+int main()
+{
+    myq_test::init("test_stats_shm");
+    test_reads_under_writes();
+    test_name_for_uri();
+    int result = myq_test::result("test_stats_shm");
+    _exit(result);
+}